@@ -0,0 +1,82 @@
+// Per-fetch TLS trust setup: what a fetch used to cost (read the host's PEM
+// bundle into memory, then have libcurl load and parse a CA file into a fresh
+// SSL_CTX) versus installing the cached X509_STORE from Cert::HostStore.
+//
+// usage: bench_cert_setup [iterations=200]
+//                         [ca_file=/etc/ssl/certs/ca-certificates.crt]
+
+#include "Cert.hpp"
+#include "CertCache.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include <openssl/ssl.h>
+
+using Clock = std::chrono::steady_clock;
+
+static double Micros(Clock::duration d, size_t n) {
+  return std::chrono::duration<double, std::micro>(d).count() / n;
+}
+
+int main(int argc, char* argv[]) {
+  const size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10)
+                                     : 200;
+  const std::filesystem::path ca_file =
+    argc > 2 ? argv[2] : "/etc/ssl/certs/ca-certificates.crt";
+  if (!std::filesystem::exists(ca_file)) {
+    std::cerr << "CA bundle not found: " << ca_file << "\n";
+    return 1;
+  }
+  std::cout << "CA bundle: " << ca_file << " ("
+            << std::filesystem::file_size(ca_file) << " bytes), "
+            << iterations << " iterations\n";
+
+  // Before: ApplyHostBundle read the bundle per fetch, then libcurl parsed
+  // CAINFO into each new SSL_CTX
+  {
+    size_t bytes = 0;
+    const auto t0 = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+      std::ifstream f(ca_file, std::ios::binary);
+      std::string blob((std::istreambuf_iterator<char>(f)), {});
+      bytes += blob.size();
+      SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+      SSL_CTX_load_verify_locations(ctx, ca_file.c_str(), nullptr);
+      SSL_CTX_free(ctx);
+    }
+    std::cout << "read + parse CA file: "
+              << Micros(Clock::now() - t0, iterations) << " us/fetch ("
+              << bytes / iterations << " bytes read per fetch)\n";
+  }
+
+  // After: the parsed store is shared; each SSL_CTX just takes a reference
+  {
+    CertCache cache;
+    Cert cert("", ca_file, cache);
+    const auto t_first = Clock::now();
+    auto warm = cert.HostStore("example.com");  // parses once
+    std::cout << "first HostStore (parse once): "
+              << Micros(Clock::now() - t_first, 1) << " us\n";
+    if (!warm) {
+      std::cerr << "could not parse " << ca_file << "\n";
+      return 1;
+    }
+
+    const auto t0 = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+      SSL_CTX* ctx = SSL_CTX_new(TLS_client_method());
+      auto store = cert.HostStore("example.com");
+      SSL_CTX_set1_cert_store(ctx, store.get());
+      SSL_CTX_free(ctx);
+    }
+    std::cout << "cached X509_STORE:    "
+              << Micros(Clock::now() - t0, iterations) << " us/fetch\n";
+  }
+  return 0;
+}
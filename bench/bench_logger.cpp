@@ -0,0 +1,100 @@
+// Logging under contention: the former synchronous LogEntry (global mutex
+// held per statement, std::endl flush per line) versus the async logr writer,
+// plus the cost of a muted statement.
+//
+// Output goes to stderr; redirect it so the terminal is not what is measured:
+// usage: bench_logger [lines_per_thread=200000] [max_threads=8] 2>/dev/null
+
+#include "Logger.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+// The LogEntry the async writer replaced, minus colours
+class SyncEntry {
+ public:
+  SyncEntry() : lock_(Mutex()) {
+  }
+  ~SyncEntry() {
+    std::cerr << std::endl;
+  }
+  template <typename T>
+  SyncEntry& operator<<(T const& v) {
+    std::cerr << v;
+    return *this;
+  }
+
+ private:
+  static std::mutex& Mutex() {
+    static std::mutex m;
+    return m;
+  }
+  std::unique_lock<std::mutex> lock_;
+};
+
+template <typename Log>
+double Run(Log log, unsigned threads, size_t per_thread) {
+  auto t0 = Clock::now();
+  std::vector<std::thread> ts;
+  for (unsigned t = 0; t < threads; ++t) {
+    ts.emplace_back([&, t] {
+      for (size_t i = 0; i < per_thread; ++i)
+        log(t, i);
+    });
+  }
+  for (auto& t : ts)
+    t.join();
+  const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+  return static_cast<double>(threads * per_thread) / s;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t per_thread =
+    argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  const unsigned max_threads = argc > 2 ? std::atoi(argv[2]) : 8;
+
+  std::cout << "threads  sync lines/s  async lines/s  muted ns/stmt/thread\n";
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    const double a = Run(
+      [](unsigned t, size_t i) {
+        SyncEntry() << "worker " << t << " fetched https://example.com/" << i;
+      },
+      n, per_thread);
+
+    // includes draining: the writer must have caught up before the clock stops
+    auto t0 = Clock::now();
+    Run(
+      [](unsigned t, size_t i) {
+        logr::warning << "worker " << t << " fetched https://example.com/"
+                      << i;
+      },
+      n, per_thread);
+    logr::Flush();
+    const double b =
+      static_cast<double>(n * per_thread) /
+      std::chrono::duration<double>(Clock::now() - t0).count();
+
+    const double muted =
+      logr::ShouldMute(logr::Level::Debug)
+        ? n * 1e9 / Run(
+                  [](unsigned t, size_t i) {
+                    logr::debug << "worker " << t
+                                << " fetched https://example.com/" << i;
+                  },
+                  n, per_thread * 10)
+        : 0;
+
+    std::cout << n << "  " << static_cast<long long>(a) << "  "
+              << static_cast<long long>(b) << "  " << muted << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,194 @@
+// Per-page allocations: the crawler's transient page data (response headers
+// and body, the body handed to Lua, the page's links) on the global heap,
+// as it was, versus in a per-page monotonic arena.
+//
+// usage: bench_page_alloc [pages=20000] [threads=1] [body_kb=96] [links=200]
+//
+// Each thread builds pages the way the fetch, parse and store stages do,
+// minus the network, Lua and disk: header lines and 16 KiB body pieces as
+// curl delivers them, then the page's links as strings. Counts are calls to
+// operator new (which the heap path and the arenas' upstream both reach).
+
+#include "HttpResponse.hpp"
+#include "URL.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory_resource>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+std::atomic<std::uint64_t> g_news{0};
+
+void* Counted(size_t n, size_t align) {
+  g_news.fetch_add(1, std::memory_order_relaxed);
+  n = n ? n : 1;
+  void* p = align > alignof(std::max_align_t)
+              ? std::aligned_alloc(align, (n + align - 1) / align * align)
+              : std::malloc(n);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+}  // namespace
+
+void* operator new(size_t n) {
+  return Counted(n, 0);
+}
+void* operator new(size_t n, std::align_val_t align) {
+  return Counted(n, static_cast<size_t>(align));
+}
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+void operator delete(void* p, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct Input {
+  std::vector<std::string> header_lines;
+  std::string body;
+  std::vector<std::string> links;  // resolved, canonical
+};
+
+// Before: std::string header lines and pairs, a copy of the body for Lua,
+// links collected as URLs in an unordered_set, stored via ToString()
+static size_t HeapPage(const Input& in) {
+  struct Page {
+    std::optional<HttpResponse> response;
+    std::optional<std::string> content;
+    std::unordered_set<URL> new_urls;
+  } page;
+  HttpResponse resp(std::pmr::new_delete_resource());
+  for (const auto& l : in.header_lines) {
+    const std::string line(l.data(), l.size());  // the callback's copy
+    resp.AddHeaderLine(line);
+    resp.AddRawHeaderLine(line.data(), line.size());
+  }
+  for (size_t at = 0; at < in.body.size(); at += 16 * 1024)
+    resp.AppendBody(in.body.data() + at,
+                    std::min<size_t>(16 * 1024, in.body.size() - at));
+  page.content = std::string(resp.GetBody());
+  page.response = std::move(resp);
+  for (const auto& link : in.links) {
+    URL url(link);  // built for the domain check in both paths
+    page.new_urls.insert(std::move(url));
+  }
+  size_t n = page.content->size();
+  for (const auto& u : page.new_urls)
+    n += u.ToString().size();
+  return n;
+}
+
+// After: everything in the page's arena, the body viewed in place. With
+// `use_arena` false the same code allocates from the heap, which isolates
+// what the arena itself saves.
+static size_t ArenaPage(const Input& in, bool use_arena) {
+  struct Page {
+    explicit Page(bool use_arena)
+        : mr{use_arena ? static_cast<std::pmr::memory_resource*>(&arena)
+                       : std::pmr::new_delete_resource()} {
+    }
+    std::pmr::monotonic_buffer_resource arena{64 * 1024};
+    std::pmr::memory_resource* mr;
+    std::optional<HttpResponse> response;
+    std::optional<std::string_view> content;
+    std::pmr::vector<std::pmr::string> new_urls{mr};
+  } page(use_arena);
+  HttpResponse resp(page.mr);
+  for (const auto& line : in.header_lines) {
+    resp.AddHeaderLine(line);
+    resp.AddRawHeaderLine(line.data(), line.size());
+  }
+  for (size_t at = 0; at < in.body.size(); at += 16 * 1024)
+    resp.AppendBody(in.body.data() + at,
+                    std::min<size_t>(16 * 1024, in.body.size() - at));
+  page.response = std::move(resp);
+  page.content = page.response->GetBody();
+  page.new_urls.reserve(in.links.size());
+  for (const auto& link : in.links) {
+    const URL url(link);  // built for the domain check in both paths
+    page.new_urls.emplace_back(link);
+  }
+  size_t n = page.content->size();
+  for (const auto& u : page.new_urls)
+    n += u.size();
+  return n;
+}
+
+template <typename F>
+static void Run(const char* name, F page_fn, const Input& in, size_t pages,
+                unsigned threads) {
+  const auto news0 = g_news.load();
+  std::atomic<size_t> check{0};
+  const auto t0 = Clock::now();
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; ++t) {
+    workers.emplace_back([&] {
+      size_t n = 0;
+      for (size_t p = 0; p < pages / threads; ++p)
+        n += page_fn(in);
+      check += n;
+    });
+  }
+  for (auto& w : workers)
+    w.join();
+  const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+  const size_t done = pages / threads * threads;
+  std::cout << name << ": " << s * 1e6 / done << " us/page, "
+            << static_cast<double>(g_news.load() - news0) / done
+            << " operator new/page (checksum " << check << ")\n";
+}
+
+int main(int argc, char* argv[]) {
+  const size_t pages = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+  const unsigned threads = argc > 2 ? std::atoi(argv[2]) : 1;
+  const size_t body_kb = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 96;
+  const size_t links = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 200;
+
+  Input in;
+  in.header_lines = {"HTTP/2 200\r\n",
+                     "content-type: text/html; charset=utf-8\r\n",
+                     "content-length: " + std::to_string(body_kb * 1024) +
+                       "\r\n",
+                     "date: Mon, 12 Oct 2026 10:00:00 GMT\r\n",
+                     "server: nginx\r\n",
+                     "cache-control: max-age=600\r\n",
+                     "etag: \"5f2b-63a1c2f0\"\r\n",
+                     "last-modified: Sun, 11 Oct 2026 08:00:00 GMT\r\n",
+                     "vary: Accept-Encoding\r\n",
+                     "x-frame-options: SAMEORIGIN\r\n",
+                     "strict-transport-security: max-age=31536000\r\n",
+                     "set-cookie: session=abcdef0123456789; Path=/\r\n",
+                     "\r\n"};
+  in.body.assign(body_kb * 1024, 'x');
+  for (size_t i = 0; i < links; ++i)
+    in.links.push_back("https://www.example.com/section/article-" +
+                       std::to_string(i) + ".html");
+
+  std::cout << "pages: " << pages << ", threads: " << threads
+            << ", body: " << body_kb << " KiB, links/page: " << links
+            << "\n";
+  Run("before (heap)", HeapPage, in, pages, threads);
+  Run("after, heap resource",
+      [](const Input& i) { return ArenaPage(i, false); }, in, pages, threads);
+  Run("after (arena)", [](const Input& i) { return ArenaPage(i, true); }, in,
+      pages, threads);
+  return 0;
+}
@@ -0,0 +1,110 @@
+// Producer/consumer contention: the former mutex + condition_variable
+// ThreadSafeQueue versus the lock-free MPMCQueue.
+//
+// usage: bench_queue [items_per_producer=1000000] [max_threads=8]
+
+#include "MPMCQueue.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+// The queue MPMCQueue replaced, plus the close() it lacked so the benchmark
+// can shut consumers down.
+template <typename T>
+class ThreadSafeQueue {
+ public:
+  void push(const T& item) {
+    std::unique_lock<std::mutex> lock(mtx);
+    q.push(item);
+    cv.notify_one();
+  }
+
+  std::optional<T> pop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return !q.empty() || closed; });
+    if (q.empty())
+      return std::nullopt;
+    T item = q.front();
+    q.pop();
+    return item;
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mtx);
+    closed = true;
+    cv.notify_all();
+  }
+
+ private:
+  std::queue<T> q;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool closed = false;
+};
+
+struct Payload {
+  std::string url;
+  size_t id;
+};
+
+template <typename Queue, typename Push>
+double Run(Queue& q, Push push, unsigned producers, unsigned consumers,
+           size_t per_producer) {
+  auto t0 = Clock::now();
+  std::vector<std::thread> cs, ps;
+  for (unsigned c = 0; c < consumers; ++c) {
+    cs.emplace_back([&] {
+      size_t sink = 0;
+      while (auto v = q.pop())
+        sink += v->id;
+      (void)sink;
+    });
+  }
+  for (unsigned p = 0; p < producers; ++p) {
+    ps.emplace_back([&, p] {
+      for (size_t i = 0; i < per_producer; ++i)
+        push(q, Payload{"https://example.com/" + std::to_string(i), p + i});
+    });
+  }
+  for (auto& t : ps)
+    t.join();
+  q.close();
+  for (auto& t : cs)
+    t.join();
+  const double s = std::chrono::duration<double>(Clock::now() - t0).count();
+  return static_cast<double>(producers * per_producer) / s;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const size_t per_producer =
+    argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  const unsigned max_threads = argc > 2 ? std::atoi(argv[2]) : 8;
+
+  std::cout << "threads(p+c)  ThreadSafeQueue ops/s  MPMCQueue ops/s\n";
+  for (unsigned n = 1; n <= max_threads; n *= 2) {
+    ThreadSafeQueue<Payload> locked;
+    const double a = Run(
+      locked, [](auto& q, Payload&& v) { q.push(v); }, n, n, per_producer);
+
+    MPMCQueue<Payload> ring(1024);
+    const double b = Run(
+      ring, [](auto& q, Payload&& v) { q.push(std::move(v)); }, n, n,
+      per_producer);
+
+    std::cout << n << "+" << n << "  " << static_cast<long long>(a) << "  "
+              << static_cast<long long>(b) << "\n";
+  }
+  return 0;
+}
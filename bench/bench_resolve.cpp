@@ -0,0 +1,125 @@
+// Link resolution: the old per-link URL::Resolve + Canonicalize path versus
+// LinkResolver, which splits the base once and resolves a page's links into
+// one arena.
+//
+// usage: bench_resolve [links=2000] [pages=500]
+//
+// Each "page" resolves the same `links` hrefs (a mix of relative, absolute
+// path, absolute, scheme-relative, query and fragment references) against
+// one base. Timings are per page and per link; "+URL" also builds the URL
+// objects the crawler hands to the frontier.
+
+#include "Canonicalizer.hpp"
+#include "LinkResolver.hpp"
+#include "URL.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double Seconds(Clock::time_point since) {
+  return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+static void Report(const char* name, double s, size_t pages, size_t links,
+                   size_t check) {
+  std::cout << name << ": " << s * 1e6 / pages << " us/page, "
+            << s * 1e9 / (pages * links) << " ns/link, "
+            << static_cast<size_t>(pages * links / s) << " links/s"
+            << " (checksum " << check << ")\n";
+}
+
+int main(int argc, char* argv[]) {
+  const size_t links = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+  const size_t pages = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500;
+
+  const std::string base =
+    "https://www.example.com/section/topic/index.html?page=3";
+  std::vector<std::string> hrefs;
+  for (size_t i = 0; i < links; ++i) {
+    const std::string n = std::to_string(i);
+    switch (i % 8) {
+      case 0: hrefs.push_back("../other/article-" + n + ".html"); break;
+      case 1: hrefs.push_back("/tag/t" + n + "?utm_source=feed&id=" + n); break;
+      case 2: hrefs.push_back("item/" + n + "/"); break;
+      case 3:
+        hrefs.push_back("https://www.example.com/a/./b/../p" + n + "#c");
+        break;
+      case 4: hrefs.push_back("//www.example.com/img/" + n + ".png"); break;
+      case 5: hrefs.push_back("?page=" + n + "&sort=asc"); break;
+      case 6: hrefs.push_back("#section-" + n); break;
+      default: hrefs.push_back("related?b=" + n + "&a=1"); break;
+    }
+  }
+  const std::vector<std::string_view> refs(hrefs.begin(), hrefs.end());
+  std::cout << "links/page: " << links << ", pages: " << pages << "\n";
+
+  const Canonicalizer canon;
+
+  // Baseline: what Crawler::ParseStage did per link
+  {
+    size_t check = 0;
+    const auto t0 = Clock::now();
+    for (size_t p = 0; p < pages; ++p) {
+      const URL page(base);
+      for (const auto& href : hrefs)
+        check += canon.Canonicalize(page.Resolve(href)).ToString().size();
+    }
+    Report("URL::Resolve+Canonicalize", Seconds(t0), pages, links, check);
+  }
+
+  {
+    LinkResolver resolver(&canon);
+    size_t check = 0;
+    const auto t0 = Clock::now();
+    for (size_t p = 0; p < pages; ++p) {
+      resolver.Reset(base);
+      for (const auto& link : resolver.Resolve(refs))
+        check += link.url.size();
+    }
+    Report("LinkResolver", Seconds(t0), pages, links, check);
+  }
+
+  {
+    LinkResolver resolver(&canon);
+    size_t check = 0;
+    const auto t0 = Clock::now();
+    for (size_t p = 0; p < pages; ++p) {
+      resolver.Reset(base);
+      for (const auto& link : resolver.Resolve(refs))
+        check += URL(std::string(link.url)).ToString().size();
+    }
+    Report("LinkResolver+URL", Seconds(t0), pages, links, check);
+  }
+
+  // Resolution alone, without canonicalization
+  {
+    size_t check = 0;
+    const auto t0 = Clock::now();
+    for (size_t p = 0; p < pages; ++p) {
+      const URL page(base);
+      for (const auto& href : hrefs)
+        check += page.Resolve(href).ToString().size();
+    }
+    Report("URL::Resolve", Seconds(t0), pages, links, check);
+  }
+
+  {
+    LinkResolver resolver;
+    size_t check = 0;
+    const auto t0 = Clock::now();
+    for (size_t p = 0; p < pages; ++p) {
+      resolver.Reset(base);
+      for (const auto& link : resolver.Resolve(refs))
+        check += link.url.size();
+    }
+    Report("LinkResolver (no canonicalizer)", Seconds(t0), pages, links,
+           check);
+  }
+  return 0;
+}
@@ -0,0 +1,83 @@
+// Seed loading: the old getline + vector + per-domain std::set path versus
+// URLManager::LoadSeeds (mmap, line-aligned chunks, per-domain batches).
+//
+// usage: bench_seed_load [lines=1000000] [threads=0] [baseline=1]
+//
+// Pass baseline=0 for very large seed sets; the old path keeps every URL
+// resident and will not fit in memory at tens of millions of lines.
+
+#include "URL.hpp"
+#include "URLManager.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+static double Seconds(Clock::time_point since) {
+  return std::chrono::duration<double>(Clock::now() - since).count();
+}
+
+int main(int argc, char* argv[]) {
+  const size_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  const unsigned threads = argc > 2 ? std::atoi(argv[2]) : 0;
+  const bool baseline = argc > 3 ? std::atoi(argv[3]) != 0 : true;
+
+  const fs::path dir = fs::temp_directory_path() / "bench_seed_load";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  {
+    std::ofstream out(dir / "seeds.list");
+    for (size_t i = 0; i < lines; ++i) {
+      out << "https://www.site" << (i % 1000) << ".com/path/" << i
+          << "?q=" << (i * 7) << "\n";
+    }
+  }
+  std::cout << "seed lines: " << lines << "\n";
+
+  // Baseline: what URLManager did before (vector, then per-domain sets)
+  if (baseline) {
+    auto t0 = Clock::now();
+    std::vector<URL> urls;
+    std::ifstream in(dir / "seeds.list");
+    std::string line;
+    while (std::getline(in, line)) {
+      if (!line.empty()) {
+        URL url{line};
+        if (url.IsValid())
+          urls.push_back(std::move(url));
+      }
+    }
+    const double read_s = Seconds(t0);
+    std::unordered_map<URL, std::set<URL>> batches;
+    for (const auto& url : urls)
+      batches[url.GetDomain()].insert(url);
+    std::cout << "getline+vector+sets: read " << read_s << " s, total "
+              << Seconds(t0) << " s, " << batches.size() << " domains\n";
+  }
+
+  // LoadSeeds into per-domain counters
+  {
+    URLManager urlm(dir);
+    std::unordered_map<URL, size_t> counts;
+    auto t0 = Clock::now();
+    size_t n = urlm.LoadSeeds(
+      [&](const URL& domain, std::vector<URL>& urls) {
+        counts[domain] += urls.size();
+      },
+      threads);
+    std::cout << "LoadSeeds: " << n << " urls in " << Seconds(t0) << " s, "
+              << counts.size() << " domains\n";
+  }
+
+  fs::remove_all(dir);
+  return 0;
+}
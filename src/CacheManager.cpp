@@ -38,7 +38,7 @@ std::optional<std::string> CacheManager::Fetch(const URL& url) const {
   return in ? std::optional<std::string>(std::move(data)) : std::nullopt;
 }
 
-void CacheManager::Store(const URL& url, const std::string& content) {
+void CacheManager::Store(const URL& url, std::string_view content) {
   std::filesystem::create_directories(dir_);  // error_code overload preferred
   std::filesystem::path filename = dir_ / url.GetSha256();
   std::filesystem::path tmp = filename;
@@ -78,7 +78,12 @@ void CacheManager::Store(const URL& url, const HttpResponse& response) {
   Store(url, response.GetBody());
   nlohmann::json headers;
   for (const auto& [key, val] : response.GetHeaders()) {
-    headers[key] = val;
+    headers[std::string(key)] = std::string(val);
   }
+  // the response's metadata is cached alongside, as X- headers
+  headers["X-HTTP-Status"] = std::to_string(response.GetStatusCode());
+  headers["X-Redirect-Count"] = std::to_string(response.GetRedirectCount());
+  if (response.HasEffectiveUrl())
+    headers["X-Effective-URL"] = response.GetEffectiveUrl().ToString();
   Store(url, headers, "headers");
 }
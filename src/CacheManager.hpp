@@ -3,6 +3,7 @@
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <filesystem>
+#include <string_view>
 
 #include "HttpResponse.hpp"
 #include "URL.hpp"
@@ -19,7 +20,7 @@ class CacheManager {
 
   std::optional<std::string> Fetch(const URL& url) const;
 
-  void Store(const URL& url, const std::string& content);
+  void Store(const URL& url, std::string_view content);
   void Store(const URL& url, const nlohmann::json& data,
              const std::string& ext = "json");
   void Store(const URL& url, const HttpResponse& response);
@@ -0,0 +1,295 @@
+#include "Canonicalizer.hpp"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace {
+char Lower(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c;
+}
+
+std::string ToLower(std::string_view s) {
+  std::string out(s);
+  std::transform(out.begin(), out.end(), out.begin(), Lower);
+  return out;
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  c = Lower(c);
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+bool IsUnreserved(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+         (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' ||
+         c == '~';
+}
+
+// Decode escapes of unreserved characters, upper-case the hex of the rest
+// and escape bytes that may not appear raw (controls, space, non-ASCII)
+void AppendNormalizedPercent(std::string_view s, std::string& out) {
+  static const char kHex[] = "0123456789ABCDEF";
+  for (size_t i = 0; i < s.size(); ++i) {
+    // copy runs of plain characters in one go
+    size_t run = i;
+    while (run < s.size() && s[run] != '%' &&
+           static_cast<unsigned char>(s[run]) > 0x20 &&
+           static_cast<unsigned char>(s[run]) < 0x7f)
+      ++run;
+    if (run > i) {
+      out.append(s.substr(i, run - i));
+      i = run - 1;
+      continue;
+    }
+    const auto c = static_cast<unsigned char>(s[i]);
+    if (c == '%' && i + 2 < s.size() && HexValue(s[i + 1]) >= 0 &&
+        HexValue(s[i + 2]) >= 0) {
+      const auto v = static_cast<unsigned char>(HexValue(s[i + 1]) * 16 +
+                                                HexValue(s[i + 2]));
+      if (IsUnreserved(v)) {
+        out += static_cast<char>(v);
+      } else {
+        out += '%';
+        out += kHex[v >> 4];
+        out += kHex[v & 15];
+      }
+      i += 2;
+    } else if (c <= 0x20 || c >= 0x7f) {
+      out += '%';
+      out += kHex[c >> 4];
+      out += kHex[c & 15];
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+}
+
+void AppendLower(std::string_view s, std::string& out) {
+  const size_t at = out.size();
+  out.append(s);
+  std::transform(out.begin() + at, out.end(), out.begin() + at, Lower);
+}
+
+bool EqualsNoCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(),
+                    [](char x, char y) { return Lower(x) == Lower(y); });
+}
+
+// RFC 3986 remove_dot_segments on out[root..], which holds an absolute path;
+// empty segments and a trailing slash stay. Works in place: segments are
+// copied down over the ones ".." removes.
+void RemoveDotSegments(std::string& out, size_t root) {
+  size_t read = root + 1;  // past the leading '/'
+  size_t write = root;
+  for (;;) {
+    auto slash = out.find('/', read);
+    const bool last = slash == std::string::npos;
+    if (last)
+      slash = out.size();
+    const std::string_view seg(out.data() + read, slash - read);
+    if (seg == "." || seg == "..") {
+      if (seg == ".." && write > root)
+        write = out.rfind('/', write - 1);
+      if (last)
+        out[write++] = '/';
+    } else {
+      out[write++] = '/';
+      std::char_traits<char>::move(&out[write], seg.data(), seg.size());
+      write += seg.size();
+    }
+    if (last)
+      break;
+    read = slash + 1;
+  }
+  out.resize(write == root ? root + 1 : write);
+  out[root] = '/';
+}
+}  // namespace
+
+bool Canonicalizer::StripList::Matches(std::string_view name) const {
+  if (std::any_of(names.begin(), names.end(),
+                  [&](const auto& n) { return EqualsNoCase(name, n); }))
+    return true;
+  return std::any_of(prefixes.begin(), prefixes.end(), [&](const auto& p) {
+    return name.size() >= p.size() && EqualsNoCase(name.substr(0, p.size()), p);
+  });
+}
+
+Canonicalizer::Canonicalizer(Options opts) : opts_{std::move(opts)} {
+  auto add = [](StripList& list, const std::vector<std::string>& params) {
+    for (const auto& p : params) {
+      if (!p.empty() && p.back() == '*')
+        list.prefixes.push_back(ToLower(p.substr(0, p.size() - 1)));
+      else
+        list.names.push_back(ToLower(p));
+    }
+  };
+  add(strip_, opts_.strip_params);
+  for (const auto& [domain, params] : opts_.domain_params) {
+    auto& list = domain_strip_[ToLower(domain)];
+    list = strip_;
+    add(list, params);
+  }
+}
+
+// The most specific configured domain wins: with both example.com and
+// shop.example.com listed, shop.example.com and its subdomains use the latter
+const Canonicalizer::StripList& Canonicalizer::ListFor(
+  std::string_view host) const {
+  const StripList* best = &strip_;
+  size_t best_len = 0;
+  for (const auto& [domain, list] : domain_strip_) {
+    if (domain.size() > best_len && host.size() >= domain.size() &&
+        host.compare(host.size() - domain.size(), domain.size(), domain) ==
+          0 &&
+        (host.size() == domain.size() ||
+         host[host.size() - domain.size() - 1] == '.')) {
+      best = &list;
+      best_len = domain.size();
+    }
+  }
+  return *best;
+}
+
+URL Canonicalizer::Canonicalize(const URL& url) const {
+  if (!opts_.enabled)
+    return url;
+  const std::string& raw = url.ToString();
+  std::string canonical = Canonicalize(raw);
+  return canonical == raw ? url : URL(canonical);
+}
+
+std::string Canonicalizer::Canonicalize(std::string_view url) const {
+  std::string out;
+  Canonicalize(url, out);
+  return out;
+}
+
+// Appends straight to `out`; the only other buffers are per-thread and keep
+// their capacity, so a warm caller canonicalizes without allocating.
+void Canonicalizer::Canonicalize(std::string_view url,
+                                 std::string& out) const {
+  const auto sep = url.find("://");
+  if (!opts_.enabled || sep == std::string_view::npos) {
+    out.append(url);
+    return;
+  }
+
+  const std::string_view scheme = url.substr(0, sep);
+  std::string_view rest = url.substr(sep + 3);
+  const auto auth_end = rest.find_first_of("/?#");
+  std::string_view authority = rest.substr(0, auth_end);
+  rest.remove_prefix(auth_end == std::string_view::npos ? rest.size()
+                                                        : auth_end);
+  const auto frag_at = rest.find('#');
+  std::string_view fragment;
+  if (frag_at != std::string_view::npos) {
+    fragment = rest.substr(frag_at);
+    rest = rest.substr(0, frag_at);
+  }
+  const auto query_at = rest.find('?');
+  std::string_view path = rest.substr(0, query_at);
+  std::string_view query = query_at == std::string_view::npos
+                             ? std::string_view{}
+                             : rest.substr(query_at + 1);
+
+  // authority: [userinfo@]host[:port]
+  std::string_view userinfo;
+  if (const auto at = authority.rfind('@'); at != std::string_view::npos) {
+    userinfo = authority.substr(0, at + 1);
+    authority.remove_prefix(at + 1);
+  }
+  std::string_view host = authority;
+  std::string_view port;
+  const auto colon = host.rfind(':');
+  if (colon != std::string_view::npos &&
+      host.find(']', colon) == std::string_view::npos) {  // not inside [v6]
+    port = host.substr(colon + 1);
+    host = host.substr(0, colon);
+  }
+  if (opts_.lowercase_host && !host.empty() && host.back() == '.')
+    host.remove_suffix(1);
+  if (opts_.drop_default_port &&
+      ((port == "80" && EqualsNoCase(scheme, "http")) ||
+       (port == "443" && EqualsNoCase(scheme, "https"))))
+    port = {};
+
+  if (opts_.lowercase_host)
+    AppendLower(scheme, out);
+  else
+    out.append(scheme);
+  out.append("://").append(userinfo);
+  const size_t host_at = out.size();
+  if (opts_.lowercase_host)
+    AppendLower(host, out);
+  else
+    out.append(host);
+  const size_t host_len = out.size() - host_at;
+  if (!port.empty())
+    out.append(":").append(port);
+
+  // an empty path is "/"
+  const size_t path_at = out.size();
+  if (opts_.normalize_percent)
+    AppendNormalizedPercent(path, out);
+  else
+    out.append(path);
+  if (opts_.normalize_path) {
+    if (out.size() == path_at)
+      out += '/';
+    else
+      RemoveDotSegments(out, path_at);
+  }
+
+  // query: drop tracking parameters and empty pieces, then sort by name
+  if (!query.empty()) {
+    thread_local std::string normalized;
+    thread_local std::vector<std::pair<std::string_view, std::string_view>>
+      params;  // name, "=v"
+    if (opts_.normalize_percent) {
+      normalized.clear();
+      AppendNormalizedPercent(query, normalized);
+      query = normalized;
+    }
+    params.clear();
+    const StripList& strip =
+      ListFor(std::string_view(out).substr(host_at, host_len));
+    for (size_t start = 0; start <= query.size();) {
+      auto amp = query.find('&', start);
+      if (amp == std::string_view::npos)
+        amp = query.size();
+      const std::string_view piece = query.substr(start, amp - start);
+      start = amp + 1;
+      if (piece.empty())
+        continue;
+      const auto eq = piece.find('=');
+      const std::string_view name = piece.substr(0, eq);
+      if (strip.Matches(name))
+        continue;
+      params.emplace_back(name, eq == std::string_view::npos
+                                  ? std::string_view{}
+                                  : piece.substr(eq));
+    }
+    if (opts_.sort_query) {
+      // stable insertion sort: queries are short, and std::stable_sort
+      // allocates its buffer on every call
+      for (size_t i = 1; i < params.size(); ++i) {
+        for (size_t j = i; j > 0 && params[j].first < params[j - 1].first; --j)
+          std::swap(params[j], params[j - 1]);
+      }
+    }
+    for (size_t i = 0; i < params.size(); ++i) {
+      out += i == 0 ? '?' : '&';
+      out.append(params[i].first).append(params[i].second);
+    }
+  }
+
+  if (!opts_.drop_fragment)
+    out.append(fragment);
+}
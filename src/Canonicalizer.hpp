@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "URL.hpp"
+
+// Rewrites a URL into the one form the crawler de-duplicates, caches and
+// fetches it under, so trivially different spellings of a page collapse into
+// one frontier entry:
+//
+//   HTTPS://WWW.Example.com:443/a/./b/../c%7e?utm_source=x&b=2&a=1#top
+//     -> https://www.example.com/a/c~?a=1&b=2
+//
+// Each step can be turned off. Query parameters are dropped by name; a name
+// ending in '*' matches as a prefix ("utm_*"). Each registrable domain can
+// add its own names to the default list. Thread-safe (const after
+// construction).
+class Canonicalizer {
+ public:
+  struct Options {
+    bool enabled{true};
+    bool lowercase_host{true};     // scheme and host
+    bool drop_default_port{true};  // :80 for http, :443 for https
+    bool normalize_path{true};     // resolve "." and ".." segments
+    bool normalize_percent{true};  // decode unreserved, upper-case hex
+    bool sort_query{true};         // stable, by name
+    bool drop_fragment{true};
+    std::vector<std::string> strip_params{
+      "utm_*", "gclid", "dclid", "fbclid", "msclkid", "yclid", "mc_cid",
+      "mc_eid", "_ga", "_gl"};
+    // domain -> further parameters to drop on it and its subdomains; a host
+    // under several uses the longest
+    std::unordered_map<std::string, std::vector<std::string>> domain_params;
+  };
+
+  Canonicalizer() : Canonicalizer(Options{}) {
+  }
+  explicit Canonicalizer(Options opts);
+
+  URL Canonicalize(const URL& url) const;
+  std::string Canonicalize(std::string_view url) const;
+  /// Append the canonical form of `url` to `out`
+  void Canonicalize(std::string_view url, std::string& out) const;
+
+  bool Enabled() const {
+    return opts_.enabled;
+  }
+
+ private:
+  struct StripList {
+    std::vector<std::string> names;     // lower case
+    std::vector<std::string> prefixes;  // lower case, '*' removed
+    bool Matches(std::string_view name) const;
+  };
+
+  const StripList& ListFor(std::string_view host) const;
+
+  Options opts_;
+  StripList strip_;
+  std::unordered_map<std::string, StripList> domain_strip_;
+};
@@ -1,12 +1,14 @@
-// Cert.cpp (refactored: per-instance caches, no locks)
+// Cert.cpp (caches shared process-wide through CertCache)
 
 #include "Cert.hpp"
+#include "Resolver.hpp"
 
 #include <iostream>
 #include <algorithm>
 #include <cctype>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <iterator>
 #include <string>
 #include <string_view>
@@ -27,6 +29,7 @@
 #include <openssl/pem.h>
 #include <openssl/buffer.h>  // BUF_MEM for BIO_get_mem_ptr
 #include <openssl/bio.h>
+#include <openssl/ssl.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 
@@ -67,6 +70,91 @@ static size_t WriteStrCb(char* p, size_t sz, size_t nm, void* ud) {
   return sz * nm;
 }
 
+static std::string X509ToPem(X509* x) {
+  std::string pem;
+  BIO* bio = BIO_new(BIO_s_mem());
+  if (!bio)
+    return pem;
+  if (PEM_write_bio_X509(bio, x)) {
+    BUF_MEM* mem = nullptr;
+    BIO_get_mem_ptr(bio, &mem);
+    if (mem && mem->data && mem->length > 0)
+      pem.assign(mem->data, mem->length);
+  }
+  BIO_free(bio);
+  return pem;
+}
+
+// Runs OpenSSL's normal chain verification; on failure remembers the leaf
+// (and the SNI it was served for) in the Cert::PeerChain passed as `arg`.
+static int CaptureVerifyCb(X509_STORE_CTX* ctx, void* arg) {
+  const int ok = X509_verify_cert(ctx);
+  if (ok > 0)
+    return ok;
+
+  auto* chain = static_cast<Cert::PeerChain*>(arg);
+  if (X509* leaf = X509_STORE_CTX_get0_cert(ctx))
+    chain->leaf_pem = X509ToPem(leaf);
+  auto* ssl = static_cast<SSL*>(
+    X509_STORE_CTX_get_ex_data(ctx, SSL_get_ex_data_X509_STORE_CTX_idx()));
+  const char* sni =
+    ssl ? SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name) : nullptr;
+  chain->host = sni ? sni : "";
+  return ok;
+}
+
+// libcurl calls this once per connection, after its own TLS setup
+static CURLcode TlsCtxHook(CURL*, void* ssl_ctx, void* userptr) {
+  auto* hook = static_cast<Cert::TlsHook*>(userptr);
+  auto* ctx = static_cast<SSL_CTX*>(ssl_ctx);
+  if (hook->cert) {
+    if (auto store = hook->cert->HostStore(hook->host))
+      SSL_CTX_set1_cert_store(ctx, store.get());  // shared, ref-counted
+  }
+  if (hook->capture)
+    SSL_CTX_set_cert_verify_callback(ctx, CaptureVerifyCb, hook->capture);
+  return CURLE_OK;
+}
+
+// Copy of `base` plus the certificates in `pems`
+static CertCache::StorePtr BuildStore(X509_STORE* base,
+                                      const std::vector<std::string>& pems) {
+  X509_STORE* s = X509_STORE_new();
+  if (!s)
+    return nullptr;
+  CertCache::StorePtr store(s, X509_STORE_free);
+  X509_STORE_set_flags(s, X509_V_FLAG_TRUSTED_FIRST |
+                            X509_V_FLAG_PARTIAL_CHAIN);
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+  STACK_OF(X509)* certs = X509_STORE_get1_all_certs(base);
+  for (int i = 0; certs && i < sk_X509_num(certs); ++i)
+    X509_STORE_add_cert(s, sk_X509_value(certs, i));
+  sk_X509_pop_free(certs, X509_free);
+#else
+  X509_STORE_lock(base);
+  STACK_OF(X509_OBJECT)* objs = X509_STORE_get0_objects(base);
+  for (int i = 0; i < sk_X509_OBJECT_num(objs); ++i) {
+    if (X509* x = X509_OBJECT_get0_X509(sk_X509_OBJECT_value(objs, i)))
+      X509_STORE_add_cert(s, x);
+  }
+  X509_STORE_unlock(base);
+#endif
+
+  for (const auto& pem : pems) {
+    BIO* bio = BIO_new_mem_buf(pem.data(), static_cast<int>(pem.size()));
+    if (!bio)
+      continue;
+    while (X509* x = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr)) {
+      X509_STORE_add_cert(s, x);
+      X509_free(x);
+    }
+    ERR_clear_error();  // PEM_read_bio_X509 ends on "no start line"
+    BIO_free(bio);
+  }
+  return store;
+}
+
 // ---------- TempPem ----------
 
 TempPem::~TempPem() {
@@ -93,6 +181,13 @@ bool Cert::HttpGetToString(const std::string& url, std::string& out) {
   curl_easy_setopt(h, CURLOPT_CONNECTTIMEOUT_MS, 4000L);
   curl_easy_setopt(h, CURLOPT_TIMEOUT_MS, 10000L);
 
+  struct curl_slist* resolve = nullptr;
+  if (const auto entry = Resolver::Instance().CurlResolveEntry(url);
+      !entry.empty()) {
+    resolve = curl_slist_append(resolve, entry.c_str());
+    curl_easy_setopt(h, CURLOPT_RESOLVE, resolve);
+  }
+
   struct curl_slist* hdrs = nullptr;
   hdrs =
     curl_slist_append(hdrs,
@@ -102,9 +197,11 @@ bool Cert::HttpGetToString(const std::string& url, std::string& out) {
   curl_easy_setopt(h, CURLOPT_HTTPHEADER, hdrs);
 
   const auto rc = curl_easy_perform(h);
+  curl_easy_cleanup(h);
   if (hdrs)
     curl_slist_free_all(hdrs);
-  curl_easy_cleanup(h);
+  if (resolve)
+    curl_slist_free_all(resolve);
   return rc == CURLE_OK;
 }
 
@@ -307,18 +404,76 @@ std::string Cert::LeafPemFromCertinfo(CURL* easy) {
   return EnsurePem(pem);
 }
 
-// Discover AIA URLs for a URL's leaf cert, with per-instance caches.
-std::vector<std::string> Cert::ExtractAiaUrls(const std::string& url) {
+bool Cert::InstallTlsHook(CURL* easy, TlsHook* hook) {
+  if (hook->cert) {
+    if (hook->cert->cache_.BaseStore(hook->cert->base_ca_path_)) {
+      // the hook supplies the store; don't let libcurl read a bundle
+      curl_easy_setopt(easy, CURLOPT_CAINFO, nullptr);
+      curl_easy_setopt(easy, CURLOPT_CAPATH, nullptr);
+    } else if (!hook->cert->base_ca_path_.empty()) {
+      curl_easy_setopt(easy, CURLOPT_CAINFO,
+                       hook->cert->base_ca_path_.c_str());
+    }
+  }
+  return curl_easy_setopt(easy, CURLOPT_SSL_CTX_FUNCTION, &TlsCtxHook) ==
+           CURLE_OK &&
+         curl_easy_setopt(easy, CURLOPT_SSL_CTX_DATA, hook) == CURLE_OK;
+}
+
+CertCache::StorePtr Cert::HostStore(const std::string& host) const {
+  if (auto store = cache_.HostStore(host))
+    return store;
+  if (cache_.HostIssuers(host).empty())
+    return cache_.BaseStore(base_ca_path_);
+  RebuildHostBundle(host);
+  return cache_.HostStore(host);
+}
+
+// AIA URLs of a leaf PEM, via the fingerprint cache; mirrored under `host`.
+std::vector<std::string> Cert::AiaFromLeaf(
+  const std::string& host, const std::string& pem,
+  std::chrono::steady_clock::time_point now) {
+  const std::string fp = LeafFingerprintSha256Hex(pem);
+
+  // Fingerprint cache: does this leaf map already exist?
+  if (!fp.empty()) {
+    if (auto hit = cache_.AiaForLeaf(fp)) {
+      cache_.PutAia(host, {}, *hit);  // mirror
+      return hit->urls;
+    }
+  }
+
+  // Parse AIA from PEM
+  auto urls = AiaCaIssuersFromPem(pem);
+
+  // Insert into caches (positive / negative)
+  CertCache::AiaEntry entry;
+  entry.urls = urls;  // may be empty
+  entry.negative = urls.empty();
+  entry.expires =
+    now + std::chrono::seconds(entry.negative ? kAiaNegTtlSeconds
+                                              : kAiaTtlSeconds);
+  cache_.PutAia(host, fp, entry);
+
+  return urls;
+}
+
+// Discover AIA URLs for a URL's leaf cert, via the shared cache.
+std::vector<std::string> Cert::ExtractAiaUrls(const std::string& url,
+                                              const std::string& leaf_pem) {
   using clock = std::chrono::steady_clock;
   const auto now = clock::now();
   const std::string host = HostFromUrl(url);
 
-  // Fast path: host-level cache (no lock; per-instance)
-  if (auto it = aia_by_host_.find(host);
-      it != aia_by_host_.end() && it->second.expires > now) {
-    return it->second.urls;  // may be empty (negative)
+  // Fast path: host-level cache
+  if (auto hit = cache_.AiaForHost(host)) {
+    return hit->urls;  // may be empty (negative)
   }
 
+  // Leaf captured from the failed handshake: no need to connect again
+  if (!leaf_pem.empty())
+    return AiaFromLeaf(host, leaf_pem, now);
+
   std::vector<std::string> urls;
 
   CURL* h = curl_easy_init();
@@ -338,215 +493,91 @@ std::vector<std::string> Cert::ExtractAiaUrls(const std::string& url) {
   curl_easy_setopt(h, CURLOPT_CONNECTTIMEOUT_MS, 4000L);
   curl_easy_setopt(h, CURLOPT_TIMEOUT_MS, 8000L);
 
+  struct curl_slist* resolve = nullptr;
   CURLcode code;
   if (Cert::TestHooks::force_perform_result) {
     code = *Cert::TestHooks::force_perform_result;
   } else {
+    if (const auto entry = Resolver::Instance().CurlResolveEntry(url);
+        !entry.empty()) {
+      resolve = curl_slist_append(resolve, entry.c_str());
+      curl_easy_setopt(h, CURLOPT_RESOLVE, resolve);
+    }
     code = curl_easy_perform(h);
   }
 
   if (code == CURLE_OK) {
-    std::string pem = LeafPemFromCertinfo(h);
-    if (!pem.empty()) {
-      const std::string fp = LeafFingerprintSha256Hex(pem);
-
-      // Fingerprint cache: does this leaf map already exist?
-      if (!fp.empty()) {
-        if (auto it = aia_by_fp_.find(fp);
-            it != aia_by_fp_.end() && it->second.expires > now) {
-          aia_by_host_[host] = it->second;  // mirror
-          curl_easy_cleanup(h);
-          return it->second.urls;
-        }
-      }
-
-      // Parse AIA from PEM
-      urls = AiaCaIssuersFromPem(pem);
-
-      // Insert into caches (positive / negative)
-      AiaCacheEntry entry;
-      entry.urls = urls;  // may be empty
-      entry.negative = urls.empty();
-      entry.expires =
-        now + std::chrono::seconds(entry.negative ? kAiaNegTtlSeconds
-                                                  : kAiaTtlSeconds);
-
-      if (!fp.empty())
-        aia_by_fp_[fp] = entry;
-      aia_by_host_[host] = entry;
-
-      // crude size caps
-      if (aia_by_fp_.size() > 4096)
-        aia_by_fp_.clear();
-      if (aia_by_host_.size() > 4096)
-        aia_by_host_.clear();
-    }
+    const std::string pem = LeafPemFromCertinfo(h);
+    if (!pem.empty())
+      urls = AiaFromLeaf(host, pem, now);
   }
 
   curl_easy_cleanup(h);
+  if (resolve)
+    curl_slist_free_all(resolve);
   return urls;
 }
 
-bool Cert::RebuildHostBundle(const std::string& host) {
-  if (pem_dir_.empty() || base_ca_path_.empty())
+bool Cert::RebuildHostBundle(const std::string& host) const {
+  auto base = cache_.BaseStore(base_ca_path_);
+  if (!base)
     return false;
-  if (!std::filesystem::exists(base_ca_path_))
+  auto extras = cache_.HostIssuers(host);
+  auto store = extras.empty() ? base : BuildStore(base.get(), extras);
+  if (!store)
     return false;
-
-  std::error_code ec;
-  const auto bundle_dir = pem_dir_ / "bundles";
-  std::filesystem::create_directories(bundle_dir, ec);
-
-  const auto bundle_path = (bundle_dir / (host + ".bundle.pem")).string();
-
-  // Start with the base bundle
-  std::ifstream in(base_ca_path_);
-  if (!in)
-    return false;
-
-  std::string combined((std::istreambuf_iterator<char>(in)), {});
-  if (combined.empty() || combined.back() != '\n')
-    combined.push_back('\n');
-
-  // Append any issuer PEMs we previously persisted for this host
-  // Pattern: "<host>__<issuer>.pem"
-  for (auto const& entry : std::filesystem::directory_iterator(pem_dir_, ec)) {
-    if (ec)
-      break;
-    if (!entry.is_regular_file())
-      continue;
-    const auto name = entry.path().filename().string();
-
-    // Naive prefix/suffix check (keeps it simple & fast)
-    const std::string prefix = host + "__";
-    const std::string suffix = ".pem";
-    if (name.rfind(prefix, 0) == 0 &&
-        name.size() > prefix.size() + suffix.size() &&
-        name.substr(name.size() - suffix.size()) == suffix) {
-      std::ifstream p(entry.path());
-      if (!p)
-        continue;
-      combined.append((std::istreambuf_iterator<char>(p)), {});
-      if (combined.empty() || combined.back() != '\n')
-        combined.push_back('\n');
-    }
-  }
-
-  // Write out the per-host bundle (idempotent)
-  std::ofstream out(bundle_path, std::ios::binary | std::ios::trunc);
-  if (!out)
-    return false;
-  out.write(combined.data(), static_cast<std::streamsize>(combined.size()));
-  out.flush();
-
-  bundle_path_by_host_[host] = bundle_path;
+  cache_.PutHostStore(host, std::move(store));
   return true;
 }
 
-bool Cert::ApplyHostBundle(CURL* easy, const std::string& host) const {
-  // If we have a cached path and it still exists, use it.
-  auto it = bundle_path_by_host_.find(host);
-  if (it != bundle_path_by_host_.end() && std::filesystem::exists(it->second)) {
-    // Prefer CAINFO_BLOB if supported; otherwise CAINFO path
-#if LIBCURL_VERSION_NUM >= 0x074700
-    if (supports_cainfo_blob_) {
-      std::ifstream f(it->second, std::ios::binary);
-      if (f) {
-        std::string blob((std::istreambuf_iterator<char>(f)), {});
-        if (!blob.empty()) {
-          curl_blob b{const_cast<char*>(blob.data()), blob.size(),
-                      CURL_BLOB_COPY};
-          return curl_easy_setopt(easy, CURLOPT_CAINFO_BLOB, &b) == CURLE_OK;
-        }
-      }
-    }
-#endif
-    return curl_easy_setopt(easy, CURLOPT_CAINFO, it->second.c_str()) ==
-           CURLE_OK;
-  }
-
-  // Try to rebuild (e.g., first time after a new issuer was saved)
-  Cert* self = const_cast<Cert*>(this);  // for map update
-  if (!self->RebuildHostBundle(host))
-    return false;
-
-  const auto& path = bundle_path_by_host_.at(host);
-
-#if LIBCURL_VERSION_NUM >= 0x074700
-  if (supports_cainfo_blob_) {
-    std::ifstream f(path, std::ios::binary);
-    if (f) {
-      std::string blob((std::istreambuf_iterator<char>(f)), {});
-      if (!blob.empty()) {
-        curl_blob b{const_cast<char*>(blob.data()), blob.size(),
-                    CURL_BLOB_COPY};
-        return curl_easy_setopt(easy, CURLOPT_CAINFO_BLOB, &b) == CURLE_OK;
-      }
-    }
-  }
-#endif
-  return curl_easy_setopt(easy, CURLOPT_CAINFO, path.c_str()) == CURLE_OK;
-}
-
 // Attempt to augment CA trust for a connection with intermediates fetched via
-// AIA. On success, configures libcurl to use a combined CA bundle (temp file or
-// BLOB).
+// AIA. On success the host's cached store includes them (taking effect through
+// the TLS hook); without a base store, falls back to a combined CA bundle
+// (temp file or BLOB) on `easy`.
 bool Cert::AugmentWithIntermediates(CURL* easy, const std::string& url,
-                                    TempPem& hold) {
+                                    TempPem& hold,
+                                    const std::string& leaf_pem) {
   // 1) Discover AIA URLs (with cache)
-  auto aia = ExtractAiaUrls(url);
+  auto aia = ExtractAiaUrls(url, leaf_pem);
   if (aia.empty())
     return false;
 
-  // 2) Download/convert, de-dup by issuer CN, persist new ones
+  // 2) Issuer PEMs (shared cache or concurrent download), de-dup by issuer
+  // CN, persist per host
   std::vector<std::string> extras;
   const std::string domain = HostFromUrl(url);
+  std::vector<std::string> seen_cns;
 
-  for (const auto& issuer_url : aia) {
-    if (issuer_url.rfind("ldap://", 0) == 0)
-      continue;  // not supported
-
-    std::string raw;
-    if (!HttpGetToString(issuer_url, raw))
-      continue;
-
-    std::string pem = EnsurePem(raw);
-    if (pem.empty())
-      continue;
-
+  for (auto& pem : FetchIssuers(aia)) {
     const std::string issuer_cn = ExtractIssuerCNFromPem(pem);
     if (issuer_cn.empty())
       continue;
+    if (std::find(seen_cns.begin(), seen_cns.end(), issuer_cn) !=
+        seen_cns.end())
+      continue;
+    seen_cns.push_back(issuer_cn);
 
-    const bool already =
-      (issuer_pem_cache_.find(issuer_cn) != issuer_pem_cache_.end());
-    if (!already)
-      issuer_pem_cache_.emplace(issuer_cn, pem);
-
-    if (!already) {
-      // Persist new issuer PEMs to pem_dir_ if configured
-      PersistPemIfConfigured(domain, issuer_cn, pem);
-      extras.push_back(std::move(pem));
-    }
+    // Persist issuer PEMs to pem_dir_ (for this host's bundle) if configured
+    PersistPemIfConfigured(domain, issuer_cn, pem);
+    extras.push_back(std::move(pem));
   }
 
-  // If we discovered nothing new, there’s nothing to apply.
+  // If we found no issuers, there’s nothing to apply.
   if (extras.empty())
     return false;
 
-  // **NEW SECTION: Build or refresh the per-host bundle and apply it**
-  // This replaces temp files and one-shot blobs.
-  if (RebuildHostBundle(domain)) {
-    if (ApplyHostBundle(easy, domain)) {
-      return true;
-    }
-    // If applying the host bundle fails, we still fall through and try temp
-    // blob.
+  // Record them for this host and rebuild its in-memory store
+  auto known = cache_.HostIssuers(domain);
+  for (const auto& pem : extras) {
+    if (std::find(known.begin(), known.end(), pem) == known.end())
+      known.push_back(pem);
   }
+  cache_.SetHostIssuers(domain, std::move(known));
+  if (RebuildHostBundle(domain))
+    return true;
 
-  // --- EXISTING FALLBACK BEHAVIOR ---
-  // If CAINFO_BLOB is supported and you still want to use in-memory blobs,
-  // you can keep this block as a fallback:
+  // --- FALLBACK: no parsed base store ---
+  // If CAINFO_BLOB is supported, use an in-memory blob:
   if (supports_cainfo_blob_ && ApplyCombinedViaBlob(easy, extras)) {
     return true;
   }
@@ -562,6 +593,36 @@ bool Cert::AugmentWithIntermediates(CURL* easy, const std::string& url,
   return false;
 }
 
+std::vector<std::string> Cert::FetchIssuers(
+  const std::vector<std::string>& aia) {
+  std::vector<std::string> pems;
+  std::vector<std::pair<std::string, std::future<std::string>>> downloads;
+  for (const auto& issuer_url : aia) {
+    if (issuer_url.rfind("ldap://", 0) == 0)
+      continue;  // not supported
+    if (auto pem = cache_.Issuer(issuer_url)) {
+      pems.push_back(std::move(*pem));
+      continue;
+    }
+    downloads.emplace_back(
+      issuer_url, std::async(std::launch::async, [issuer_url] {
+        std::string raw;
+        if (!HttpGetToString(issuer_url, raw))
+          raw.clear();
+        return raw;
+      }));
+  }
+
+  for (auto& [issuer_url, download] : downloads) {
+    std::string pem = EnsurePem(download.get());
+    if (pem.empty())
+      continue;
+    cache_.PutIssuer(issuer_url, pem);
+    pems.push_back(std::move(pem));
+  }
+  return pems;
+}
+
 // Append extras to base bundle and write to a temp file; return its path.
 std::string Cert::WriteTempBundle(
   const std::vector<std::string>& extra_pems) const {
@@ -6,10 +6,13 @@
 
 #include <chrono>
 #include <filesystem>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "CertCache.hpp"
+
 // ---------- TempPem ----------
 // RAII for temporary PEM files created on disk; deletes on destruction.
 struct TempPem {
@@ -34,27 +37,60 @@ class Cert {
     static inline std::optional<std::string> fake_http_response = std::nullopt;
   };
 
-  // Construct with optional directory for persisting PEM files.
+  // Construct with optional directory for persisting PEM files. Lookups
+  // go through `cache`, shared process-wide by default.
   explicit Cert(
     const std::filesystem::path& pem_dir,
-    const std::filesystem::path& ca_path = "/etc/pki/tls/certs/ca-bundle.crt")
-      : pem_dir_{pem_dir}, base_ca_path_{ca_path} {
+    const std::filesystem::path& ca_path = "/etc/pki/tls/certs/ca-bundle.crt",
+    CertCache& cache = CertCache::Instance())
+      : pem_dir_{pem_dir}, base_ca_path_{ca_path}, cache_{cache} {
   }
 
+  // Leaf certificate of a handshake that failed verification, recorded by
+  // the TLS hook.
+  struct PeerChain {
+    std::string host;  // SNI name of that handshake
+    std::string leaf_pem;
+  };
+
+  // CURLOPT_SSL_CTX_FUNCTION state for one transfer: whose trust store to
+  // install, and where to record the leaf of a failed verification. Must
+  // outlive the transfer.
+  struct TlsHook {
+    const Cert* cert{nullptr};  // nullptr: keep libcurl's own CA setup
+    std::string host;
+    PeerChain* capture{nullptr};  // nullptr: record nothing
+  };
+
   const std::filesystem::path& GetBaseCaPath() const {
     return base_ca_path_;
   }
 
-  // Fetches additional intermediates via AIA, if needed.
+  // Install `hook` on `easy`. When the base CA bundle parses, libcurl loads
+  // no CA file at all and each handshake gets the cached X509_STORE for
+  // hook->host instead; a captured leaf lets the repair path skip a second
+  // connection. OpenSSL only.
+  static bool InstallTlsHook(CURL* easy, TlsHook* hook);
+
+  // Trust store for `host`: the shared base store, or base plus the host's
+  // recorded issuers. nullptr if the base CA bundle is unreadable.
+  CertCache::StorePtr HostStore(const std::string& host) const;
+
+  // Fetches additional intermediates via AIA, if needed, and folds them into
+  // the host's store, which a retry on a handle carrying this Cert's TlsHook
+  // picks up. A captured `leaf_pem` skips the probe connection.
   bool AugmentWithIntermediates(CURL* easy, const std::string& url,
-                                TempPem& hold);
+                                TempPem& hold,
+                                const std::string& leaf_pem = {});
 
-  // Extract AIA URLs from a URL's certificate (thread-safe via per-instance
-  // caches).
-  std::vector<std::string> ExtractAiaUrls(const std::string& url);
+  // Extract AIA URLs from a URL's certificate (cached in the shared
+  // CertCache). Probes the server unless `leaf_pem` is given.
+  std::vector<std::string> ExtractAiaUrls(const std::string& url,
+                                          const std::string& leaf_pem = {});
 
-  bool ApplyHostBundle(CURL* easy, const std::string& host) const;
-  bool RebuildHostBundle(const std::string& host);
+  // Rebuild the cached store for `host` from the base bundle and its
+  // recorded issuers.
+  bool RebuildHostBundle(const std::string& host) const;
 
   // Extract PEM from CURL's certinfo (leaf cert only).
   static std::string LeafPemFromCertinfo(CURL* easy);
@@ -90,23 +126,19 @@ class Cert {
                               const std::string& pem) const;
 
  private:
-  // host -> on-disk bundle path
-  mutable std::unordered_map<std::string, std::string> bundle_path_by_host_;
+  // AIA URLs of `leaf_pem` via the fingerprint cache; caches under `host`.
+  std::vector<std::string> AiaFromLeaf(
+    const std::string& host, const std::string& leaf_pem,
+    std::chrono::steady_clock::time_point now);
 
-  struct AiaCacheEntry {
-    std::vector<std::string> urls;  // May be empty → "negative" cache.
-    bool negative = false;
-    std::chrono::steady_clock::time_point expires{};
-  };
+  // Issuer PEMs for the AIA URLs, from the cache or downloaded concurrently
+  std::vector<std::string> FetchIssuers(const std::vector<std::string>& aia);
 
-  // ---------- Per-instance state (safe with one Cert per thread) ----------
+  // ---------- Per-instance settings; caches live in CertCache ----------
   std::filesystem::path pem_dir_;
   std::filesystem::path
     base_ca_path_{};  // System CA bundle path, set externally if needed.
   bool supports_cainfo_blob_{
     false};  // True if libcurl supports CURLOPT_CAINFO_BLOB.
-
-  std::unordered_map<std::string, AiaCacheEntry> aia_by_host_;
-  std::unordered_map<std::string, AiaCacheEntry> aia_by_fp_;
-  std::unordered_map<std::string, std::string> issuer_pem_cache_;
+  CertCache& cache_;
 };
@@ -0,0 +1,204 @@
+#include "CertCache.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+#include <openssl/evp.h>
+
+CertCache::CertCache() : CertCache(Limits{}) {
+}
+
+CertCache::CertCache(Limits limits)
+    : aia_by_host_{limits.aia_hosts},
+      aia_by_fp_{limits.aia_leaves},
+      issuer_by_url_{limits.issuers},
+      store_by_host_{limits.host_stores} {
+}
+
+CertCache& CertCache::Instance() {
+  static CertCache instance;
+  return instance;
+}
+
+std::optional<CertCache::AiaEntry> CertCache::AiaForHost(
+  const std::string& host) const {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+  if (const auto* e = aia_by_host_.Find(host, clock_);
+      e && e->expires > Clock::now())
+    return *e;
+  return std::nullopt;
+}
+
+std::optional<CertCache::AiaEntry> CertCache::AiaForLeaf(
+  const std::string& fingerprint) const {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+  if (const auto* e = aia_by_fp_.Find(fingerprint, clock_);
+      e && e->expires > Clock::now())
+    return *e;
+  return std::nullopt;
+}
+
+void CertCache::PutAia(const std::string& host, const std::string& fingerprint,
+                       const AiaEntry& entry) {
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  aia_by_host_.Put(host, entry, clock_);
+  if (!fingerprint.empty())
+    aia_by_fp_.Put(fingerprint, entry, clock_);
+}
+
+std::optional<std::string> CertCache::Issuer(const std::string& url) const {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+  if (const auto* pem = issuer_by_url_.Find(url, clock_))
+    return *pem;
+  return std::nullopt;
+}
+
+void CertCache::PutIssuer(const std::string& url, const std::string& pem) {
+  std::filesystem::path file;
+  {
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    issuer_by_url_.Put(url, pem, clock_);
+    if (!issuer_dir_.empty())
+      file = IssuerFile(url);
+  }
+  if (file.empty())
+    return;
+
+  // "# <url>" header line, then the PEM; written aside and renamed so a
+  // concurrent loader never sees half a file
+  const auto tmp = file.string() + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out)
+      return;
+    out << "# " << url << '\n' << pem;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, file, ec);
+}
+
+CertCache::StorePtr CertCache::BaseStore(
+  const std::filesystem::path& ca_file) {
+  const std::string key = ca_file.string();
+  {
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    if (auto it = base_stores_.find(key); it != base_stores_.end())
+      return it->second;
+  }
+
+  // Parse outside the lock; a racing thread may parse too, first one wins
+  StorePtr store;
+  if (X509_STORE* s = X509_STORE_new()) {
+    store.reset(s, X509_STORE_free);
+    // the flags libcurl would set on a store it loaded itself
+    X509_STORE_set_flags(s, X509_V_FLAG_TRUSTED_FIRST |
+                              X509_V_FLAG_PARTIAL_CHAIN);
+    if (key.empty() ||
+        X509_STORE_load_locations(s, key.c_str(), nullptr) != 1)
+      store.reset();
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  return base_stores_.try_emplace(key, std::move(store)).first->second;
+}
+
+CertCache::StorePtr CertCache::HostStore(const std::string& host) const {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+  if (const auto* store = store_by_host_.Find(host, clock_))
+    return *store;
+  return nullptr;
+}
+
+void CertCache::PutHostStore(const std::string& host, StorePtr store) {
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  store_by_host_.Put(host, std::move(store), clock_);
+}
+
+std::vector<std::string> CertCache::HostIssuers(
+  const std::string& host) const {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+  if (auto it = host_issuers_.find(host); it != host_issuers_.end())
+    return it->second;
+  return {};
+}
+
+void CertCache::SetHostIssuers(const std::string& host,
+                               std::vector<std::string> pems) {
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  host_issuers_[host] = std::move(pems);
+  store_by_host_.Erase(host);
+}
+
+size_t CertCache::LoadHostIssuers(const std::filesystem::path& pem_dir) {
+  std::unordered_map<std::string, std::vector<std::string>> found;
+  size_t files = 0;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(pem_dir, ec)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".pem")
+      continue;
+    const auto name = entry.path().filename().string();
+    const auto sep = name.find("__");
+    if (sep == std::string::npos || sep == 0)
+      continue;
+    std::ifstream in(entry.path(), std::ios::binary);
+    std::string pem((std::istreambuf_iterator<char>(in)), {});
+    if (pem.find("-----BEGIN CERTIFICATE-----") == std::string::npos)
+      continue;
+    found[name.substr(0, sep)].push_back(std::move(pem));
+    ++files;
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  for (auto& [host, pems] : found) {
+    auto& dst = host_issuers_[host];
+    for (auto& pem : pems)
+      dst.push_back(std::move(pem));
+    store_by_host_.Erase(host);
+  }
+  return files;
+}
+
+size_t CertCache::SetIssuerDir(const std::filesystem::path& dir) {
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+
+  std::vector<std::pair<std::string, std::string>> loaded;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".pem")
+      continue;
+    std::ifstream in(entry.path(), std::ios::binary);
+    std::string header;
+    if (!std::getline(in, header) || header.rfind("# ", 0) != 0)
+      continue;
+    std::string pem((std::istreambuf_iterator<char>(in)), {});
+    if (pem.find("-----BEGIN CERTIFICATE-----") == std::string::npos)
+      continue;
+    loaded.emplace_back(header.substr(2), std::move(pem));
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  issuer_dir_ = dir;
+  for (auto& [url, pem] : loaded)
+    issuer_by_url_.Put(url, std::move(pem), clock_);
+  return loaded.size();
+}
+
+size_t CertCache::IssuerCount() const {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+  return issuer_by_url_.Size();
+}
+
+// <issuer_dir>/<sha256(url)>.pem
+std::filesystem::path CertCache::IssuerFile(const std::string& url) const {
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int n = 0;
+  EVP_Digest(url.data(), url.size(), md, &n, EVP_sha256(), nullptr);
+  static const char* d = "0123456789abcdef";
+  std::string hex(n * 2, '0');
+  for (unsigned i = 0; i < n; ++i) {
+    hex[2 * i] = d[(md[i] >> 4) & 0xF];
+    hex[2 * i + 1] = d[md[i] & 0xF];
+  }
+  return issuer_dir_ / (hex + ".pem");
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <openssl/x509.h>
+
+// Process-wide cache behind Cert: AIA URLs by host and by leaf fingerprint,
+// downloaded issuer PEMs by AIA URL, and parsed trust stores (the base CA
+// bundle, plus per-host stores for hosts with extra issuers). Shared by
+// every Crawler thread, so an intermediate common to many sites is fetched
+// once per run, (with an issuer directory set) once across runs, and no
+// handshake re-reads or re-parses a PEM bundle.
+//
+// Lookups take a shared lock and only bump an atomic recency tick; inserts
+// take the exclusive lock and, past a table's limit, evict its least
+// recently used eighth in one pass.
+class CertCache {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using StorePtr = std::shared_ptr<X509_STORE>;
+
+  struct AiaEntry {
+    std::vector<std::string> urls;  // may be empty -> negative entry
+    bool negative{false};
+    Clock::time_point expires{};
+  };
+
+  struct Limits {
+    size_t aia_hosts{16384};
+    size_t aia_leaves{16384};
+    size_t issuers{4096};
+    size_t host_stores{4096};
+  };
+
+  CertCache();
+  explicit CertCache(Limits limits);
+  CertCache(const CertCache&) = delete;
+  CertCache& operator=(const CertCache&) = delete;
+
+  /// The instance shared by every Cert
+  static CertCache& Instance();
+
+  /// Unexpired AIA entry for a host / leaf SHA-256 fingerprint
+  std::optional<AiaEntry> AiaForHost(const std::string& host) const;
+  std::optional<AiaEntry> AiaForLeaf(const std::string& fingerprint) const;
+
+  /// Record `entry` under `host` and, if non-empty, `fingerprint`
+  void PutAia(const std::string& host, const std::string& fingerprint,
+              const AiaEntry& entry);
+
+  /// Issuer PEM previously downloaded from `url`
+  std::optional<std::string> Issuer(const std::string& url) const;
+
+  /// Remember an issuer PEM; also written to the issuer directory if set
+  void PutIssuer(const std::string& url, const std::string& pem);
+
+  /// Trust store parsed from `ca_file`, once per path; nullptr if it could
+  /// not be read
+  StorePtr BaseStore(const std::filesystem::path& ca_file);
+
+  /// Store built for `host` (base plus its issuers), if any
+  StorePtr HostStore(const std::string& host) const;
+  void PutHostStore(const std::string& host, StorePtr store);
+
+  /// Issuer PEMs recorded for `host`
+  std::vector<std::string> HostIssuers(const std::string& host) const;
+
+  /// Record issuers for `host`, replacing earlier ones; drops its store
+  void SetHostIssuers(const std::string& host, std::vector<std::string> pems);
+
+  /// Index the "<host>__<issuer>.pem" files Cert persisted in earlier runs;
+  /// returns how many were read
+  size_t LoadHostIssuers(const std::filesystem::path& pem_dir);
+
+  /// Persist issuers under `dir` from now on and load those saved by earlier
+  /// runs; returns how many were loaded
+  size_t SetIssuerDir(const std::filesystem::path& dir);
+
+  size_t IssuerCount() const;
+
+ private:
+  // Hash map with approximate LRU eviction; callers hold CertCache::mtx_
+  template <typename V>
+  class LruMap {
+   public:
+    explicit LruMap(size_t limit) : limit_{std::max<size_t>(limit, 8)} {
+    }
+
+    // Shared lock is enough: only the atomic tick changes
+    const V* Find(const std::string& key,
+                  std::atomic<std::uint64_t>& clock) const {
+      auto it = map_.find(key);
+      if (it == map_.end())
+        return nullptr;
+      it->second.tick.store(clock.fetch_add(1, std::memory_order_relaxed),
+                            std::memory_order_relaxed);
+      return &it->second.value;
+    }
+
+    // Exclusive lock required
+    void Put(const std::string& key, V value,
+             std::atomic<std::uint64_t>& clock) {
+      const auto tick = clock.fetch_add(1, std::memory_order_relaxed);
+      auto [it, inserted] = map_.try_emplace(key);
+      it->second.value = std::move(value);
+      it->second.tick.store(tick, std::memory_order_relaxed);
+      if (inserted && map_.size() > limit_)
+        Evict();
+    }
+
+    // Exclusive lock required
+    void Erase(const std::string& key) {
+      map_.erase(key);
+    }
+
+    size_t Size() const {
+      return map_.size();
+    }
+
+   private:
+    struct Node {
+      V value{};
+      mutable std::atomic<std::uint64_t> tick{0};
+    };
+
+    void Evict() {
+      std::vector<std::uint64_t> ticks;
+      ticks.reserve(map_.size());
+      for (const auto& [k, n] : map_)
+        ticks.push_back(n.tick.load(std::memory_order_relaxed));
+      const size_t drop = std::max<size_t>(1, map_.size() / 8);
+      std::nth_element(ticks.begin(), ticks.begin() + (drop - 1),
+                       ticks.end());
+      const auto cutoff = ticks[drop - 1];
+      std::erase_if(map_, [&](const auto& kv) {
+        return kv.second.tick.load(std::memory_order_relaxed) <= cutoff;
+      });
+    }
+
+    const size_t limit_;
+    std::unordered_map<std::string, Node> map_;
+  };
+
+  std::filesystem::path IssuerFile(const std::string& url) const;
+
+  mutable std::shared_mutex mtx_;
+  mutable std::atomic<std::uint64_t> clock_{0};
+  LruMap<AiaEntry> aia_by_host_;
+  LruMap<AiaEntry> aia_by_fp_;
+  LruMap<std::string> issuer_by_url_;
+  LruMap<StorePtr> store_by_host_;
+  std::unordered_map<std::string, StorePtr> base_stores_;  // by CA file
+  std::unordered_map<std::string, std::vector<std::string>> host_issuers_;
+  std::filesystem::path issuer_dir_;
+};
@@ -0,0 +1,244 @@
+#include "Checkpoint.hpp"
+#include "Logger.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+std::uint64_t Fnv1a(std::string_view data) {
+  std::uint64_t h = 14695981039346656037ull;
+  for (unsigned char c : data) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+template <typename T>
+void Put(std::string& out, T v) {
+  out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+template <typename T>
+bool Get(std::string_view& in, T& v) {
+  if (in.size() < sizeof(v))
+    return false;
+  std::memcpy(&v, in.data(), sizeof(v));
+  in.remove_prefix(sizeof(v));
+  return true;
+}
+}  // namespace
+
+Checkpoint::Checkpoint(Options opts, Frontiers& frontiers,
+                       std::function<void()> before)
+    : opts_{std::move(opts)}, before_{std::move(before)} {
+  targets_.reserve(frontiers.size());
+  for (auto& [domain, frontier] : frontiers) {
+    targets_.push_back({domain.ToString(),
+                        opts_.dir / (domain.GetSha256() + ".ckpt"),
+                        &frontier,
+                        {},
+                        {}});
+  }
+  // tail dirs from an earlier run stay until each domain's next write
+  std::unordered_map<std::string, Target*> by_stem;
+  for (auto& t : targets_)
+    by_stem.emplace(t.file.stem().string(), &t);
+  std::error_code ec;
+  for (const auto& f : std::filesystem::directory_iterator(opts_.dir, ec)) {
+    const std::string name = f.path().filename().string();
+    if (f.path().extension() != ".tail")
+      continue;
+    if (auto it = by_stem.find(name.substr(0, name.find('.')));
+        it != by_stem.end())
+      it->second->stale.push_back(name);
+  }
+  thread_ = std::thread([this] { Loop(); });
+}
+
+Checkpoint::~Checkpoint() {
+  Stop();
+}
+
+void Checkpoint::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void Checkpoint::Loop() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!cv_.wait_for(lock, opts_.interval, [this] { return stop_; })) {
+    lock.unlock();
+    Write();
+    lock.lock();
+  }
+}
+
+std::string Checkpoint::Encode(const std::string& domain,
+                               const Frontier& frontier,
+                               const std::filesystem::path& tail_dir) {
+  std::string out(kMagic, sizeof(kMagic));
+  Put(out, kVersion);
+  Put<std::uint64_t>(out, domain.size());
+  out += domain;
+  Put<std::uint64_t>(
+    out, std::chrono::duration_cast<std::chrono::milliseconds>(
+           std::chrono::system_clock::now().time_since_epoch())
+           .count());
+  const std::string tail = tail_dir.filename().string();
+  Put<std::uint64_t>(out, tail.size());
+  out += tail;
+  frontier.Save(out, tail_dir);
+  Put(out, Fnv1a(out));
+  return out;
+}
+
+bool Checkpoint::Decode(std::string_view data, std::string& domain,
+                        std::string& tail_dir, std::string_view& frontier) {
+  std::uint64_t sum;
+  if (data.size() < sizeof(kMagic) + sizeof(sum))
+    return false;
+  std::string_view tail = data.substr(data.size() - sizeof(sum));
+  data.remove_suffix(sizeof(sum));
+  if (!Get(tail, sum) || sum != Fnv1a(data))
+    return false;
+  if (data.substr(0, sizeof(kMagic)) != std::string_view(kMagic, 8))
+    return false;
+  data.remove_prefix(sizeof(kMagic));
+
+  std::uint32_t version;
+  std::uint64_t len, written_ms;
+  if (!Get(data, version) || version != kVersion || !Get(data, len) ||
+      data.size() < len)
+    return false;
+  domain.assign(data.substr(0, len));
+  data.remove_prefix(len);
+  if (!Get(data, written_ms) || !Get(data, len) || data.size() < len)
+    return false;
+  tail_dir.assign(data.substr(0, len));
+  data.remove_prefix(len);
+  frontier = data;
+  return true;
+}
+
+size_t Checkpoint::Write() {
+  std::lock_guard<std::mutex> write_lock(write_mtx_);
+  if (before_)
+    before_();
+
+  const auto t0 = std::chrono::steady_clock::now();
+  std::error_code ec;
+  std::filesystem::create_directories(opts_.dir, ec);
+  size_t written = 0, bytes = 0;
+  const auto stamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+  for (auto& t : targets_) {
+    // a fresh name: the current file's tail dir stays until this one is in
+    const std::string stem = t.file.stem().string() + ".";
+    auto n = stamp;
+    std::string tail = stem + std::to_string(n) + ".tail";
+    while (std::filesystem::exists(opts_.dir / tail, ec))
+      tail = stem + std::to_string(++n) + ".tail";
+    const std::string data = Encode(t.domain, *t.frontier, opts_.dir / tail);
+    const auto tmp = t.file.string() + ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(data.data(), static_cast<std::streamsize>(data.size()));
+      if (!out) {
+        logr::error << "[Checkpoint] failed to write " << tmp;
+        std::filesystem::remove_all(opts_.dir / tail, ec);
+        continue;
+      }
+    }
+    std::filesystem::rename(tmp, t.file, ec);
+    if (ec) {
+      logr::error << "[Checkpoint] failed to rename " << tmp << ": "
+                  << ec.message();
+      std::filesystem::remove_all(opts_.dir / tail, ec);
+      continue;
+    }
+    RemoveTails(t);
+    t.tail = tail;
+    ++written;
+    bytes += data.size();
+  }
+  logr::info << "[Checkpoint] " << written << " frontier(s), " << bytes / 1024
+             << " KiB in "
+             << std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::steady_clock::now() - t0)
+                  .count()
+             << " ms";
+  return written;
+}
+
+void Checkpoint::Clear() {
+  Stop();
+  std::lock_guard<std::mutex> write_lock(write_mtx_);
+  std::error_code ec;
+  for (auto& t : targets_) {
+    std::filesystem::remove(t.file, ec);
+    RemoveTails(t);
+  }
+}
+
+void Checkpoint::RemoveTails(Target& t) {
+  std::error_code ec;
+  if (!t.tail.empty())
+    std::filesystem::remove_all(opts_.dir / t.tail, ec);
+  for (const auto& name : t.stale)
+    std::filesystem::remove_all(opts_.dir / name, ec);
+  t.tail.clear();
+  t.stale.clear();
+}
+
+size_t Checkpoint::Restore(const std::filesystem::path& dir,
+                           const FrontierFor& frontier_for) {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(dir, ec))
+    return 0;
+
+  const auto t0 = std::chrono::steady_clock::now();
+  size_t restored = 0;
+  for (const auto& f : std::filesystem::directory_iterator(dir, ec)) {
+    if (!f.is_regular_file() || f.path().extension() != ".ckpt")
+      continue;
+    std::ifstream in(f.path(), std::ios::binary);
+    const std::string data{std::istreambuf_iterator<char>(in),
+                           std::istreambuf_iterator<char>()};
+
+    std::string domain, tail;
+    std::string_view payload;
+    if (!Decode(data, domain, tail, payload)) {
+      logr::warning << "[Checkpoint] ignoring damaged " << f.path();
+      continue;
+    }
+    Frontier* frontier = frontier_for(URL(domain));
+    if (frontier == nullptr)
+      continue;  // not crawled this run
+    if (!frontier->Load(payload, tail.empty() ? std::filesystem::path{}
+                                              : dir / tail)) {
+      logr::warning << "[Checkpoint] ignoring damaged " << f.path();
+      continue;
+    }
+    ++restored;
+  }
+  if (restored > 0) {
+    logr::info << "[Checkpoint] resumed " << restored << " domain(s) from "
+               << dir << " in "
+               << std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - t0)
+                    .count()
+               << " ms";
+  }
+  return restored;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Frontier.hpp"
+#include "URL.hpp"
+
+// Periodic crash-recovery snapshots of every domain's frontier, so a restart
+// resumes where the last run stopped instead of re-walking every seed. Each
+// domain gets <dir>/<sha256(domain)>.ckpt:
+//
+//   "CRAWLCK1" | u32 version | domain | u64 unix ms | tail dir name |
+//   Frontier::Save() | u64 FNV-1a of everything before it
+//
+// The frontier's spilled segments are hard-linked into the tail dir,
+// <dir>/<sha256(domain)>.<unix ms>.tail, rather than copied into the file.
+// Files are written under a temporary name and renamed, so a crash mid-write
+// leaves the previous checkpoint and its tail dir in place; older tail dirs
+// go once the new file is in. Restore() loads the valid ones at startup;
+// Clear() removes them once the crawl has finished.
+class Checkpoint {
+ public:
+  struct Options {
+    std::filesystem::path dir;
+    std::chrono::seconds interval{60};
+  };
+
+  using Frontiers = std::unordered_map<URL, Frontier>;
+  using FrontierFor = std::function<Frontier*(const URL& domain)>;
+
+  static constexpr char kMagic[8] = {'C', 'R', 'A', 'W', 'L', 'C', 'K', '1'};
+  static constexpr std::uint32_t kVersion = 5;
+
+  /// Snapshot `frontiers` every interval on a background thread. `before`
+  /// runs ahead of each round, e.g. to flush buffered URL lists to disk.
+  Checkpoint(Options opts, Frontiers& frontiers,
+             std::function<void()> before = {});
+  /// Stops the thread; writes nothing
+  ~Checkpoint();
+  Checkpoint(const Checkpoint&) = delete;
+  Checkpoint& operator=(const Checkpoint&) = delete;
+
+  /// Write every frontier now; returns the number of files written
+  size_t Write();
+
+  /// Stop writing and remove every checkpoint file
+  void Clear();
+
+  /// Load each valid checkpoint in `dir` into frontier_for(domain), skipping
+  /// domains it returns nullptr for; returns the number of domains restored
+  static size_t Restore(const std::filesystem::path& dir,
+                        const FrontierFor& frontier_for);
+
+  /// Encode one frontier as a checkpoint file body, linking its spilled
+  /// segments into `tail_dir` (a sibling of the file)
+  static std::string Encode(const std::string& domain,
+                            const Frontier& frontier,
+                            const std::filesystem::path& tail_dir = {});
+
+  /// Check a checkpoint file body and split it into its domain, the name of
+  /// its tail dir and the Frontier::Load() payload (a view into `data`)
+  static bool Decode(std::string_view data, std::string& domain,
+                     std::string& tail_dir, std::string_view& frontier);
+
+ private:
+  struct Target {
+    std::string domain;
+    std::filesystem::path file;
+    Frontier* frontier;
+    // tail dirs on disk: the one the current file names, once written, and
+    // any an earlier run left behind
+    std::string tail;
+    std::vector<std::string> stale;
+  };
+
+  void Stop();
+  void Loop();
+  // Remove every tail dir of `t`'s
+  void RemoveTails(Target& t);
+
+  const Options opts_;
+  std::function<void()> before_;
+  // resolved up front: the map's URL keys cache lazily and are not
+  // safe to touch from this thread
+  std::vector<Target> targets_;
+
+  std::mutex write_mtx_;  // one round at a time
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool stop_{false};
+  std::thread thread_;
+};
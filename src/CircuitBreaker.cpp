@@ -0,0 +1,123 @@
+#include "CircuitBreaker.hpp"
+
+#include <algorithm>
+
+namespace {
+// while a probe is out, other fetches to the host check back this often
+constexpr std::chrono::seconds kProbeWait{1};
+}  // namespace
+
+CircuitBreaker::CircuitBreaker(Options opts) : opts_{opts} {
+}
+
+const char* CircuitBreaker::Name(State s) {
+  switch (s) {
+    case State::Closed:
+      return "closed";
+    case State::Open:
+      return "open";
+    case State::HalfOpen:
+      return "half-open";
+    case State::Dead:
+      return "dead";
+  }
+  return "?";
+}
+
+std::optional<CircuitBreaker::Clock::time_point> CircuitBreaker::Admit(
+  const std::string& host, Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = hosts_.find(host);
+  if (it == hosts_.end() || it->second.state == State::Closed)
+    return std::nullopt;
+
+  Host& h = it->second;
+  if (h.state == State::Dead) {
+    ++h.rejected;
+    return kGiveUp;
+  }
+  if (h.state == State::Open) {
+    if (now < h.open_until) {
+      ++h.rejected;
+      return h.open_until;
+    }
+    h.state = State::HalfOpen;
+  }
+  if (!h.probing) {
+    h.probing = true;  // this caller is the probe
+    return std::nullopt;
+  }
+  ++h.rejected;
+  return now + kProbeWait;
+}
+
+void CircuitBreaker::OnSuccess(const std::string& host) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = hosts_.find(host);
+  if (it == hosts_.end())
+    return;
+  Host& h = it->second;
+  h.state = State::Closed;
+  h.failures = 0;
+  h.cooldown = std::chrono::seconds{0};
+  h.probing = false;
+}
+
+std::optional<CircuitBreaker::Clock::time_point> CircuitBreaker::OnFailure(
+  const std::string& host, Clock::time_point now) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  Host& h = hosts_[host];
+  ++h.failures;
+  switch (h.state) {
+    case State::Closed:
+      if (h.failures >= std::max(1u, opts_.failure_threshold))
+        return Trip(h, now);
+      return std::nullopt;
+    case State::HalfOpen:
+      return Trip(h, now);  // the probe failed
+    case State::Open:
+    case State::Dead:
+      // a fetch admitted before the trip finished late
+      return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+CircuitBreaker::Clock::time_point CircuitBreaker::Trip(Host& h,
+                                                       Clock::time_point now) {
+  const auto longest = std::max(opts_.open, opts_.max_open);
+  ++h.trips;
+  if (h.cooldown >= longest) {
+    // down for the longest cool-down we allow: stop probing
+    h.state = State::Dead;
+    h.probing = false;
+    return kGiveUp;
+  }
+  h.cooldown = h.cooldown.count() == 0 ? opts_.open
+                                       : std::min(h.cooldown * 2, longest);
+  h.state = State::Open;
+  h.probing = false;
+  h.open_until = now + h.cooldown;
+  return h.open_until;
+}
+
+CircuitBreaker::State CircuitBreaker::GetState(const std::string& host) const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = hosts_.find(host);
+  return it == hosts_.end() ? State::Closed : it->second.state;
+}
+
+std::vector<CircuitBreaker::HostReport> CircuitBreaker::Report() const {
+  std::vector<HostReport> out;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (const auto& [name, h] : hosts_) {
+      if (h.trips == 0 && h.state == State::Closed)
+        continue;
+      out.push_back({name, h.state, h.failures, h.trips, h.rejected});
+    }
+  }
+  std::sort(out.begin(), out.end(),
+            [](const auto& a, const auto& b) { return a.host < b.host; });
+  return out;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-host circuit breaker for connection-level failures.
+//
+//   closed    -- fetches flow; consecutive failures are counted
+//   open      -- `failure_threshold` failures in a row tripped it; fetches
+//                are held back until the cool-down ends
+//   half-open -- the cool-down ended; exactly one probe fetch is let through.
+//                Success closes the breaker, failure re-opens it with twice
+//                the cool-down (up to `max_open`).
+//   dead      -- a probe failed after a cool-down of `max_open`: the host is
+//                given up on, and Admit() and OnFailure() say so with
+//                kGiveUp so the caller can stop queueing work for it.
+//
+// Thread-safe. Callers report the outcome of every fetch Admit() lets
+// through, so a half-open probe always resolves.
+class CircuitBreaker {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class State { Closed = 0, Open, HalfOpen, Dead };
+
+  // "hold until" for a dead host: never
+  static constexpr Clock::time_point kGiveUp = Clock::time_point::max();
+
+  struct Options {
+    unsigned failure_threshold{5};
+    std::chrono::seconds open{30};
+    std::chrono::seconds max_open{600};
+  };
+
+  struct HostReport {
+    std::string host;
+    State state{State::Closed};
+    unsigned failures{0};       // current run of consecutive failures
+    std::uint64_t trips{0};     // closed/half-open -> open transitions
+    std::uint64_t rejected{0};  // fetches held back while not closed
+  };
+
+  explicit CircuitBreaker(Options opts);
+
+  /// nullopt if a fetch to `host` may go ahead now (claiming the probe slot
+  /// when half-open); otherwise the time to hold the host's work back until,
+  /// kGiveUp once the host is dead
+  std::optional<Clock::time_point> Admit(const std::string& host,
+                                         Clock::time_point now = Clock::now());
+
+  /// The host accepted a connection (any HTTP status or a transfer that
+  /// failed midway counts)
+  void OnSuccess(const std::string& host);
+
+  /// A connection-level failure; returns the reopen time if this tripped
+  /// the breaker, kGiveUp if it killed the host
+  std::optional<Clock::time_point> OnFailure(
+    const std::string& host, Clock::time_point now = Clock::now());
+
+  State GetState(const std::string& host) const;
+
+  /// Hosts that have tripped at least once or are not closed, by host name
+  std::vector<HostReport> Report() const;
+
+  static const char* Name(State s);
+
+ private:
+  struct Host {
+    State state{State::Closed};
+    unsigned failures{0};
+    Clock::time_point open_until{};
+    std::chrono::seconds cooldown{0};
+    bool probing{false};
+    std::uint64_t trips{0};
+    std::uint64_t rejected{0};
+  };
+
+  Clock::time_point Trip(Host& h, Clock::time_point now);
+
+  const Options opts_;
+  mutable std::mutex mtx_;
+  std::unordered_map<std::string, Host> hosts_;
+};
@@ -55,7 +55,74 @@ Config::Config(const std::filesystem::path& config_file)
     //   "rate_limit_ms": {
     //     "example.com": 500
     //   },
-    //   "cache_age_limit_s": 86400
+    //   "cache_age_limit_s": 86400,
+    //   "max_depth": 2,
+    //   "frontier_head_limit": 100000,
+    //   "pipeline": {
+    //     "fetch_workers": 1,
+    //     "parse_workers": 1,
+    //     "store_workers": 1,
+    //     "queue_capacity": 64
+    //   },
+    //   "dns": {
+    //     "threads": 4,
+    //     "min_ttl_s": 5,
+    //     "max_ttl_s": 3600,
+    //     "negative_ttl_s": 60,
+    //     "timeout_s": 2,
+    //     "max_entries": 65536,
+    //     "nameservers": ["127.0.0.53:53"]
+    //   },
+    //   "http": {
+    //     "max_host_connections": 2,
+    //     "max_streams": 100
+    //   },
+    //   "retry": {
+    //     "jitter": 0.5,
+    //     "max_retry_after_s": 3600,
+    //     "server": { "max_retries": 3, "base_ms": 5000, "cap_ms": 120000 }
+    //   },
+    //   "circuit_breaker": {
+    //     "failure_threshold": 5,
+    //     "open_s": 30,
+    //     "max_open_s": 600
+    //   },
+    //   "metrics": {
+    //     "file": "/var/lib/crawler/metrics.prom",
+    //     "interval_s": 10,
+    //     "listen_port": 9464
+    //   },
+    //   "trace_file": "/var/lib/crawler/trace.jsonl",
+    //   "checkpoint": {
+    //     "dir": "/var/lib/crawler/checkpoint",
+    //     "interval_s": 60
+    //   },
+    //   "results": {
+    //     "format": "jsonl",
+    //     "dir": "/var/lib/crawler/results",
+    //     "max_mb": 256,
+    //     "max_age_s": 3600,
+    //     "batch": 512
+    //   },
+    //   "warc": {
+    //     "dir": "/var/lib/crawler/warc",
+    //     "max_mb": 1024,
+    //     "cdx": true
+    //   },
+    //   "canonicalize": {
+    //     "enabled": true,
+    //     "sort_query": true,
+    //     "drop_fragment": true,
+    //     "strip_params": ["utm_*", "gclid", "fbclid"],
+    //     "domains": {
+    //       "example.com": ["ref", "sessionid"]
+    //     }
+    //   },
+    //   "near_duplicates": {
+    //     "enabled": false,
+    //     "max_distance": 3,
+    //     "shingle": 4
+    //   }
     // }
     //
     cache_dir_ = j.at("cache_dir").get<std::string>();
@@ -66,6 +133,196 @@ Config::Config(const std::filesystem::path& config_file)
     user_agent_list_ = j.at("user_agent_list").get<std::string>();
     cache_age_limit_s_ =
       std::chrono::seconds{j.value("cache_age_limit_s", 86400LL)};
+    // links beyond this many hops from a seed are stored, not crawled
+    max_depth_ = j.value("max_depth", 0u);
+    // pending URLs held in memory per host; the rest spill under data_dir
+    frontier_head_limit_ =
+      j.value("frontier_head_limit", frontier_head_limit_);
+
+    if (auto it = j.find("pipeline"); it != j.end() && it->is_object()) {
+      const auto& p = *it;
+      pipeline_.fetch_workers =
+        std::max(1u, p.value("fetch_workers", pipeline_.fetch_workers));
+      pipeline_.parse_workers =
+        std::max(1u, p.value("parse_workers", pipeline_.parse_workers));
+      pipeline_.store_workers =
+        std::max(1u, p.value("store_workers", pipeline_.store_workers));
+      pipeline_.queue_capacity = std::max<size_t>(
+        2, p.value("queue_capacity", pipeline_.queue_capacity));
+    }
+
+    if (auto it = j.find("dns"); it != j.end() && it->is_object()) {
+      const auto& d = *it;
+      dns_.threads = std::max(1u, d.value("threads", dns_.threads));
+      dns_.min_ttl = std::chrono::seconds{
+        d.value("min_ttl_s", (long long)dns_.min_ttl.count())};
+      dns_.max_ttl = std::chrono::seconds{
+        d.value("max_ttl_s", (long long)dns_.max_ttl.count())};
+      dns_.negative_ttl = std::chrono::seconds{
+        d.value("negative_ttl_s", (long long)dns_.negative_ttl.count())};
+      dns_.timeout = std::chrono::seconds{std::max(
+        1LL, d.value("timeout_s", (long long)dns_.timeout.count()))};
+      dns_.max_entries = d.value("max_entries", dns_.max_entries);
+      if (auto ns = d.find("nameservers"); ns != d.end() && ns->is_array()) {
+        for (const auto& v : *ns) {
+          if (!v.is_string())
+            continue;
+          // "addr" or "addr:port"
+          std::string addr = v.get<std::string>();
+          std::uint16_t port = 53;
+          if (auto colon = addr.rfind(':'); colon != std::string::npos) {
+            port = static_cast<std::uint16_t>(
+              std::stoi(addr.substr(colon + 1)));
+            addr.erase(colon);
+          }
+          dns_.nameservers.emplace_back(std::move(addr), port);
+        }
+      }
+    }
+
+    // connections per origin and HTTP/2 streams per connection, shared by
+    // all of a domain's fetch workers
+    if (auto it = j.find("http"); it != j.end() && it->is_object()) {
+      const auto& h = *it;
+      http_.max_host_connections = std::max(
+        1L, h.value("max_host_connections", http_.max_host_connections));
+      http_.max_streams =
+        std::max(1L, h.value("max_streams", http_.max_streams));
+    }
+
+    // per-outcome budgets: dns, connect, transfer, tls, server,
+    // rate_limited, client, other; omitted classes keep their defaults
+    if (auto it = j.find("retry"); it != j.end() && it->is_object()) {
+      const auto& r = *it;
+      retry_.jitter = r.value("jitter", retry_.jitter);
+      retry_.max_retry_after = std::chrono::seconds{r.value(
+        "max_retry_after_s", (long long)retry_.max_retry_after.count())};
+      for (size_t i = 1; i < RetryPolicy::kOutcomes; ++i) {
+        const auto outcome = static_cast<RetryPolicy::Outcome>(i);
+        auto c = r.find(RetryPolicy::Name(outcome));
+        if (c == r.end() || !c->is_object())
+          continue;
+        auto& b = retry_.For(outcome);
+        b.max_retries = c->value("max_retries", b.max_retries);
+        b.base = std::chrono::milliseconds{
+          c->value("base_ms", (long long)b.base.count())};
+        b.cap = std::chrono::milliseconds{
+          std::max((long long)b.base.count(),
+                   c->value("cap_ms", (long long)b.cap.count()))};
+      }
+    }
+
+    // consecutive connection failures that park a host, and for how long;
+    // a host still down after a max_open_s cool-down is given up on
+    if (auto it = j.find("circuit_breaker"); it != j.end() && it->is_object()) {
+      const auto& c = *it;
+      breaker_.failure_threshold = std::max(
+        1u, c.value("failure_threshold", breaker_.failure_threshold));
+      breaker_.open = std::chrono::seconds{std::max(
+        1LL, c.value("open_s", (long long)breaker_.open.count()))};
+      breaker_.max_open = std::chrono::seconds{
+        c.value("max_open_s", (long long)breaker_.max_open.count())};
+    }
+
+    // Prometheus text: a rewritten file and/or a loopback /metrics listener
+    if (auto it = j.find("metrics"); it != j.end() && it->is_object()) {
+      const auto& m = *it;
+      MetricsExporter::Options opts;
+      opts.file = m.value("file", std::string{});
+      opts.interval = std::chrono::seconds{std::max(
+        1LL, m.value("interval_s", (long long)opts.interval.count()))};
+      if (auto p = m.find("listen_port"); p != m.end() && p->is_number())
+        opts.listen_port = p->get<std::uint16_t>();
+      metrics_ = std::move(opts);
+    }
+
+    // per-page timing records; summarise with trace_summary
+    trace_file_ = j.value("trace_file", std::string{});
+
+    // frontier snapshots for resuming after a crash; dir defaults under
+    // data_dir
+    if (auto it = j.find("checkpoint"); it != j.end() && it->is_object()) {
+      const auto& c = *it;
+      Checkpoint::Options opts;
+      opts.dir = c.value("dir", std::string{});
+      if (opts.dir.empty())
+        opts.dir = data_dir_ / "checkpoint";
+      opts.interval = std::chrono::seconds{std::max(
+        1LL, c.value("interval_s", (long long)opts.interval.count()))};
+      checkpoint_ = std::move(opts);
+    }
+
+    // Lua results: per-URL files in the cache (default) or rotated JSONL
+    if (auto it = j.find("results"); it != j.end() && it->is_object()) {
+      const auto& r = *it;
+      const auto format = r.value("format", std::string{"cache"});
+      if (format == "jsonl") {
+        results_.format = ResultSink::Format::Jsonl;
+      } else if (format != "cache") {
+        throw std::runtime_error("results.format must be \"cache\" or "
+                                 "\"jsonl\", not \"" +
+                                 format + "\"");
+      }
+      results_.file.dir = r.value("dir", std::string{});
+      if (results_.file.dir.empty())
+        results_.file.dir = data_dir_ / "results";
+      results_.file.max_bytes =
+        std::max<std::uint64_t>(
+          1, r.value("max_mb", results_.file.max_bytes >> 20))
+        << 20;
+      results_.file.max_age = std::chrono::seconds{std::max(
+        1LL,
+        r.value("max_age_s", (long long)results_.file.max_age.count()))};
+      results_.batch = std::max<size_t>(1, r.value("batch", results_.batch));
+    }
+
+    // WARC archive of every fetched response; dir defaults under data_dir
+    if (auto it = j.find("warc"); it != j.end() && it->is_object()) {
+      const auto& w = *it;
+      WarcWriter::Options opts;
+      opts.file.dir = w.value("dir", std::string{});
+      if (opts.file.dir.empty())
+        opts.file.dir = data_dir_ / "warc";
+      opts.file.max_bytes =
+        std::max<std::uint64_t>(
+          1, w.value("max_mb", opts.file.max_bytes >> 20))
+        << 20;
+      opts.cdx = w.value("cdx", opts.cdx);
+      warc_ = std::move(opts);
+    }
+
+    // URL rewriting ahead of de-duplication and caching
+    if (auto it = j.find("canonicalize"); it != j.end() && it->is_object()) {
+      const auto& c = *it;
+      auto& o = canonicalize_;
+      o.enabled = c.value("enabled", o.enabled);
+      o.lowercase_host = c.value("lowercase_host", o.lowercase_host);
+      o.drop_default_port = c.value("drop_default_port", o.drop_default_port);
+      o.normalize_path = c.value("normalize_path", o.normalize_path);
+      o.normalize_percent = c.value("normalize_percent", o.normalize_percent);
+      o.sort_query = c.value("sort_query", o.sort_query);
+      o.drop_fragment = c.value("drop_fragment", o.drop_fragment);
+      if (auto p = c.find("strip_params"); p != c.end())
+        o.strip_params = p->get<std::vector<std::string>>();
+      if (auto d = c.find("domains"); d != c.end() && d->is_object()) {
+        for (const auto& [domain, params] : d->items())
+          o.domain_params[domain] = params.get<std::vector<std::string>>();
+      }
+    }
+
+    // SimHash near-duplicates skip Lua; distances above 7 are not indexable
+    if (auto it = j.find("near_duplicates");
+        it != j.end() && it->is_object() && it->value("enabled", true)) {
+      const auto& n = *it;
+      SimHashIndex::Options opts;
+      opts.max_distance = n.value("max_distance", opts.max_distance);
+      if (opts.max_distance > SimHashIndex::kMaxDistance)
+        throw std::runtime_error("near_duplicates.max_distance must be at "
+                                 "most " +
+                                 std::to_string(SimHashIndex::kMaxDistance));
+      opts.shingle = std::max(1u, n.value("shingle", opts.shingle));
+      near_duplicates_ = opts;
+    }
 
     rate_limit_ms_.clear();
     const auto& rl = j.at("rate_limit_ms");
@@ -124,3 +381,59 @@ const std::chrono::milliseconds Config::GetRateLimit(const URL& domain) const {
     return kDefaultRateLimit;
   return rate_limit_ms_.at(domain);
 }
+
+std::uint32_t Config::GetMaxDepth() const {
+  return max_depth_;
+}
+
+size_t Config::GetFrontierHeadLimit() const {
+  return frontier_head_limit_;
+}
+
+Config::PipelineOptions Config::GetPipeline() const {
+  return pipeline_;
+}
+
+Resolver::Options Config::GetDns() const {
+  return dns_;
+}
+
+FetchEngine::Options Config::GetHttp() const {
+  return http_;
+}
+
+RetryPolicy::Options Config::GetRetry() const {
+  return retry_;
+}
+
+CircuitBreaker::Options Config::GetCircuitBreaker() const {
+  return breaker_;
+}
+
+std::filesystem::path Config::GetTraceFile() const {
+  return trace_file_;
+}
+
+std::optional<MetricsExporter::Options> Config::GetMetrics() const {
+  return metrics_;
+}
+
+std::optional<Checkpoint::Options> Config::GetCheckpoint() const {
+  return checkpoint_;
+}
+
+ResultSink::Options Config::GetResults() const {
+  return results_;
+}
+
+std::optional<WarcWriter::Options> Config::GetWarc() const {
+  return warc_;
+}
+
+Canonicalizer::Options Config::GetCanonicalize() const {
+  return canonicalize_;
+}
+
+std::optional<SimHashIndex::Options> Config::GetNearDuplicates() const {
+  return near_duplicates_;
+}
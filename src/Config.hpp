@@ -1,13 +1,33 @@
 #pragma once
 
+#include <cstdint>
 #include <filesystem>
+#include <optional>
 #include <unordered_map>
+#include "Canonicalizer.hpp"
+#include "Checkpoint.hpp"
+#include "CircuitBreaker.hpp"
+#include "FetchEngine.hpp"
+#include "MetricsExporter.hpp"
+#include "Resolver.hpp"
+#include "ResultSink.hpp"
+#include "RetryPolicy.hpp"
+#include "SimHash.hpp"
 #include "URL.hpp"
+#include "WarcWriter.hpp"
 
 class Config {
  public:
   const std::chrono::milliseconds kDefaultRateLimit{500};
 
+  // Per-domain crawl pipeline: workers per stage, capacity of each queue
+  struct PipelineOptions {
+    unsigned fetch_workers{1};
+    unsigned parse_workers{1};
+    unsigned store_workers{1};
+    size_t queue_capacity{64};
+  };
+
   Config();
   Config(const std::filesystem::path& conf_file);
 
@@ -29,6 +49,43 @@ class Config {
 
   const std::chrono::milliseconds GetRateLimit(const URL& domain) const;
 
+  std::uint32_t GetMaxDepth() const;
+
+  size_t GetFrontierHeadLimit() const;
+
+  PipelineOptions GetPipeline() const;
+
+  Resolver::Options GetDns() const;
+
+  FetchEngine::Options GetHttp() const;
+
+  RetryPolicy::Options GetRetry() const;
+
+  CircuitBreaker::Options GetCircuitBreaker() const;
+
+  /// JSONL per-page timing trace; empty when tracing is off
+  std::filesystem::path GetTraceFile() const;
+
+  /// nullopt when the config has no "metrics" block
+  std::optional<MetricsExporter::Options> GetMetrics() const;
+
+  /// nullopt when the config has no "checkpoint" block
+  std::optional<Checkpoint::Options> GetCheckpoint() const;
+
+  /// Where Lua results go; the cache directory unless "results" says
+  /// otherwise
+  ResultSink::Options GetResults() const;
+
+  /// nullopt when the config has no "warc" block
+  std::optional<WarcWriter::Options> GetWarc() const;
+
+  /// URL canonicalization rules; on with the defaults unless "canonicalize"
+  /// says otherwise
+  Canonicalizer::Options GetCanonicalize() const;
+
+  /// nullopt when the config has no "near_duplicates" block
+  std::optional<SimHashIndex::Options> GetNearDuplicates() const;
+
  private:
   std::filesystem::path config_file_;
   std::filesystem::path cache_dir_;
@@ -39,4 +96,18 @@ class Config {
   std::filesystem::path pem_dir_;
   std::filesystem::path user_agent_list_;
   std::unordered_map<URL, std::chrono::milliseconds> rate_limit_ms_;
+  std::uint32_t max_depth_{0};
+  size_t frontier_head_limit_{100000};
+  PipelineOptions pipeline_;
+  Resolver::Options dns_;
+  FetchEngine::Options http_;
+  RetryPolicy::Options retry_;
+  CircuitBreaker::Options breaker_;
+  std::optional<MetricsExporter::Options> metrics_;
+  std::filesystem::path trace_file_;
+  std::optional<Checkpoint::Options> checkpoint_;
+  ResultSink::Options results_;
+  std::optional<WarcWriter::Options> warc_;
+  Canonicalizer::Options canonicalize_;
+  std::optional<SimHashIndex::Options> near_duplicates_;
 };
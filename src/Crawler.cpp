@@ -1,92 +1,629 @@
 #include "Crawler.hpp"
+#include "LinkResolver.hpp"
 #include "Logger.hpp"
+#include "Resolver.hpp"
 #include "UAgent.hpp"
 
 #include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <curl/curl.h>
+#include <fstream>
 #include <iostream>
+#include <string_view>
 #include <thread>
-#include <thread>
-
-Crawler::Crawler(const std::set<URL>& batch, const URL& dom, Config& conf,
-                 CacheManager& cache, LuaProcessor& luap, URLManager& urlm)
-    : urls_{batch},
+#include <utility>
+
+namespace {
+// dead-letter detail for URLs of a host the circuit breaker gave up on
+constexpr const char* kHostGivenUp =
+  "host unreachable, circuit breaker gave up";
+
+// Lua `urls` entries are either "href" or { url = "href", priority = n };
+// the href is viewed in place
+std::optional<std::pair<std::string_view, double>> LinkFromJson(
+  const nlohmann::json& v) {
+  if (v.is_string())
+    return std::make_pair(std::string_view(v.get_ref<const std::string&>()),
+                          0.0);
+  if (v.is_object()) {
+    auto u = v.find("url");
+    if (u == v.end() || !u->is_string())
+      return std::nullopt;
+    double priority = 0;
+    if (auto p = v.find("priority"); p != v.end() && p->is_number())
+      priority = p->get<double>();
+    return std::make_pair(std::string_view(u->get_ref<const std::string&>()),
+                          priority);
+  }
+  return std::nullopt;
+}
+}  // namespace
+
+Crawler::Crawler(Frontier& frontier, const URL& dom, Config& conf,
+                 CacheManager& cache, LuaProcessor& luap, URLManager& urlm,
+                 ResultSink& results, WarcWriter* warc)
+    : frontier_{frontier},
+      domain_{dom},
+      max_depth_{conf.GetMaxDepth()},
+      pipeline_{conf.GetPipeline()},
+      script_dir_{conf.GetScriptDir()},
       rate_limit_{conf.GetRateLimit(dom)},
       agent_{conf.GetUserUAgentList()},
       cache_{cache},
       luap_{luap},
       urlm_{urlm},
-      cert_{conf.GetPemDir()} {
+      results_{results},
+      warc_{warc},
+      engine_{conf.GetHttp()},
+      retry_{conf.GetRetry()},
+      breaker_{conf.GetCircuitBreaker()},
+      dead_letter_{conf.GetDataDir() / "dead_letter.jsonl"},
+      duplicates_file_{conf.GetDataDir() / "duplicates" /
+                       (dom.ToString() + ".jsonl")},
+      canon_{conf.GetCanonicalize()},
+      metrics_{dom.ToString()},
+      tracing_{TraceLog::Instance().Enabled()} {
+  certs_.reserve(pipeline_.fetch_workers);
+  for (unsigned i = 0; i < pipeline_.fetch_workers; ++i) {
+    certs_.emplace_back(conf.GetPemDir());
+  }
   next_allowed_ = std::chrono::steady_clock::now();
+  if (auto opts = conf.GetNearDuplicates(); opts.has_value())
+    near_dups_.emplace(*opts);
+}
+
+Crawler::Instruments::Instruments(const std::string& domain)
+    : fetches{metrics::Registry::Instance().GetCounter(
+        "crawler_fetches_total", {{"domain", domain}},
+        "Network fetches started")},
+      bytes{metrics::Registry::Instance().GetCounter(
+        "crawler_response_bytes_total", {{"domain", domain}},
+        "Decoded response body bytes received")},
+      cache_hits{metrics::Registry::Instance().GetCounter(
+        "crawler_cache_hits_total", {{"domain", domain}},
+        "Pages served from the cache")},
+      cache_misses{metrics::Registry::Instance().GetCounter(
+        "crawler_cache_misses_total", {{"domain", domain}},
+        "Pages not in the cache")},
+      retries{metrics::Registry::Instance().GetCounter(
+        "crawler_retries_total", {{"domain", domain}},
+        "Failed fetches rescheduled")},
+      dead_letters{metrics::Registry::Instance().GetCounter(
+        "crawler_dead_letters_total", {{"domain", domain}},
+        "URLs given up on")},
+      circuit_trips{metrics::Registry::Instance().GetCounter(
+        "crawler_circuit_trips_total", {{"domain", domain}},
+        "Hosts parked by the circuit breaker")},
+      near_duplicates{metrics::Registry::Instance().GetCounter(
+        "crawler_near_duplicates_total", {{"domain", domain}},
+        "Pages skipped as near-duplicates of an earlier page")},
+      canonical_rewrites{metrics::Registry::Instance().GetCounter(
+        "crawler_canonical_rewrites_total", {{"domain", domain}},
+        "Links rewritten by URL canonicalization")},
+      canonical_duplicates{metrics::Registry::Instance().GetCounter(
+        "crawler_canonical_duplicates_total", {{"domain", domain}},
+        "Fetches avoided because a link canonicalized to a known URL")},
+      fetch_time{metrics::Registry::Instance().GetHistogram(
+        "crawler_fetch_seconds", {{"domain", domain}},
+        "Network fetch latency, including retries within one fetch")},
+      lua_time{metrics::Registry::Instance().GetHistogram(
+        "crawler_lua_seconds", {{"domain", domain}}, "Lua processing time")},
+      store_time{metrics::Registry::Instance().GetHistogram(
+        "crawler_store_seconds", {{"domain", domain}},
+        "Cache and URL list writes per page")} {
+  auto& reg = metrics::Registry::Instance();
+  static const char* const kClasses[] = {"other", "1xx", "2xx",
+                                         "3xx",   "4xx", "5xx"};
+  for (size_t i = 0; i < responses.size(); ++i) {
+    responses[i] = &reg.GetCounter("crawler_responses_total",
+                                   {{"domain", domain}, {"code", kClasses[i]}},
+                                   "HTTP responses by status class");
+  }
+  for (size_t i = 1; i < failures.size(); ++i) {
+    const auto outcome = static_cast<RetryPolicy::Outcome>(i);
+    failures[i] = &reg.GetCounter(
+      "crawler_fetch_failures_total",
+      {{"domain", domain}, {"outcome", RetryPolicy::Name(outcome)}},
+      "Failed fetches by retry class");
+  }
+  failures[0] = nullptr;  // Ok is not a failure
+  static const char* const kQueues[] = {"frontier", "parse", "store"};
+  for (size_t i = 0; i < queue_depth.size(); ++i) {
+    queue_depth[i] =
+      &reg.GetGauge("crawler_queue_depth",
+                    {{"domain", domain}, {"queue", kQueues[i]}},
+                    "Entries waiting for each pipeline stage");
+  }
+}
+
+const Crawler::StageStats& Crawler::GetStageStats(Stage stage) const {
+  return stats_[static_cast<size_t>(stage)];
 }
 
 void Crawler::Crawl() {
-  for (URL url : urls_) {
-    logr::debug;
-    for (size_t attempt = 1; attempt <= 3; attempt++) {
-      auto content = cache_.Fetch(url);
-      logr::debug << " Attempt: " << attempt;
-      logr::debug << "     URL: " << url;
-      logr::debug << "  SHA256: " << url.GetSha256();
-      if (!content.has_value()) {
-        auto response = Fetch(url);
-        if (!response.has_value()) {
-          break;
+  PageQueue parse_q(pipeline_.queue_capacity);
+  PageQueue store_q(pipeline_.queue_capacity);
+
+  // The caller's LuaProcessor serves the first parse worker; Lua states are
+  // single-threaded, so any others get their own.
+  std::vector<std::unique_ptr<LuaProcessor>> extra_luap;
+  for (unsigned i = 1; i < pipeline_.parse_workers; ++i) {
+    extra_luap.push_back(std::make_unique<LuaProcessor>(script_dir_, domain_));
+  }
+
+  std::vector<std::thread> fetchers, parsers, storers;
+  for (auto& cert : certs_) {
+    fetchers.emplace_back(
+      [this, c = &cert, &parse_q] { FetchStage(*c, parse_q); });
+  }
+  parsers.emplace_back(
+    [this, &parse_q, &store_q] { ParseStage(luap_, parse_q, store_q); });
+  for (auto& luap : extra_luap) {
+    parsers.emplace_back([this, lp = luap.get(), &parse_q, &store_q] {
+      ParseStage(*lp, parse_q, store_q);
+    });
+  }
+  for (unsigned i = 0; i < pipeline_.store_workers; ++i) {
+    storers.emplace_back([this, &store_q] { StoreStage(store_q); });
+  }
+
+  // Fetchers return once the frontier is empty and nothing is in flight;
+  // then each stage drains in turn.
+  for (auto& t : fetchers)
+    t.join();
+  parse_q.close();
+  for (auto& t : parsers)
+    t.join();
+  store_q.close();
+  for (auto& t : storers)
+    t.join();
+
+  static const char* const kNames[] = {"fetch", "parse", "store"};
+  for (size_t i = 0; i < 3; ++i) {
+    const auto& st = stats_[i];
+    logr::info << "[Crawler] " << domain_ << " " << kNames[i]
+               << " stage: " << st.processed.load() << " page(s), max queue "
+               << st.max_queue_depth.load() << "/" << pipeline_.queue_capacity
+               << ", producers blocked " << st.blocked_us.load() / 1000
+               << " ms";
+  }
+  logr::info << "[Crawler] " << domain_ << " retries scheduled: "
+             << retries_.load() << ", dead-lettered: " << dead_letters_.load();
+  for (const auto& r : breaker_.Report()) {
+    logr::info << "[Crawler] " << domain_ << " circuit " << r.host << ": "
+               << CircuitBreaker::Name(r.state) << ", tripped " << r.trips
+               << " time(s), " << r.rejected << " fetch(es) held back";
+  }
+  if (canon_.Enabled()) {
+    logr::info << "[Crawler] " << domain_ << " canonicalization: "
+               << canon_rewrites_.load() << " link(s) rewritten, "
+               << canon_eliminated_.load() << " fetch(es) eliminated";
+  }
+  ReportDuplicates();
+}
+
+void Crawler::ReportDuplicates() const {
+  if (!near_dups_.has_value())
+    return;
+  const auto clusters = near_dups_->Clusters();
+  logr::info << "[Crawler] " << domain_ << " near-duplicates: "
+             << near_dups_->Duplicates() << " page(s) skipped in "
+             << clusters.size() << " cluster(s) over " << near_dups_->Size()
+             << " distinct page(s)";
+  if (clusters.empty())
+    return;
+
+  // one line per cluster: the page Lua saw and the copies it stood in for
+  std::error_code ec;
+  std::filesystem::create_directories(duplicates_file_.parent_path(), ec);
+  std::ofstream out(duplicates_file_, std::ios::binary | std::ios::trunc);
+  for (const auto& c : clusters) {
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx",
+                  static_cast<unsigned long long>(c.fingerprint));
+    nlohmann::json line = {{"url", c.url},
+                           {"simhash", hex},
+                           {"duplicates", nlohmann::json::array()}};
+    for (const auto& d : c.duplicates)
+      line["duplicates"].push_back({{"url", d.url}, {"distance", d.distance}});
+    out << line.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace)
+        << '\n';
+  }
+  if (!out)
+    logr::error << "[Crawler] cannot write " << duplicates_file_;
+}
+
+void Crawler::Hand(PageQueue& queue, Stage stage, std::unique_ptr<Page> page) {
+  auto& st = stats_[static_cast<size_t>(stage)];
+  if (!queue.try_push(std::move(page))) {
+    // Backpressure: wait for the downstream stage to catch up
+    const auto t0 = std::chrono::steady_clock::now();
+    if (!queue.push(std::move(page))) {
+      Done();  // closed; cannot happen while producers are running
+      return;
+    }
+    st.blocked_us +=
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - t0)
+        .count();
+  }
+  Sample(stage, queue.size_approx());
+}
+
+void Crawler::Sample(Stage stage, size_t depth) {
+  auto& st = stats_[static_cast<size_t>(stage)];
+  metrics_.queue_depth[static_cast<size_t>(stage)]->Set(
+    static_cast<std::int64_t>(depth));
+  st.queue_depth = depth;
+  size_t seen = st.max_queue_depth.load(std::memory_order_relaxed);
+  while (depth > seen &&
+         !st.max_queue_depth.compare_exchange_weak(seen, depth)) {
+  }
+}
+
+void Crawler::Done() {
+  in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void Crawler::FetchStage(Cert& cert, PageQueue& out) {
+  using namespace std::chrono_literals;
+  for (;;) {
+    in_flight_.fetch_add(1, std::memory_order_acq_rel);
+    auto next = frontier_.Pop();
+    if (!next.has_value()) {
+      Done();
+      // Links from pages still in the pipeline may refill the frontier
+      if (in_flight_.load(std::memory_order_acquire) == 0 && frontier_.Empty())
+        return;
+      auto wake = std::chrono::steady_clock::now() + 10ms;
+      if (auto ready = frontier_.NextReadyTime(); ready.has_value())
+        wake = std::max(wake, std::min(*ready, wake + 990ms));
+      std::this_thread::sleep_until(wake);
+      continue;
+    }
+
+    auto page = std::make_unique<Page>(*next, URL{next->url});
+    auto& st = stats_[static_cast<size_t>(Stage::Fetch)];
+    st.processed++;
+    // the frontier is the fetch stage's queue
+    Sample(Stage::Fetch, frontier_.Size());
+
+    LOGR_DEBUG << "[Crawler] fetch" << logr::kv("url", page->url)
+               << logr::kv("sha256", page->url.GetSha256())
+               << logr::kv("attempt", page->entry.attempt + 1);
+
+    if (tracing_) {
+      page->trace.time_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+      page->trace.host = page->url.GetHost();
+      page->trace.url = page->url.ToString();
+      page->trace.attempt = page->entry.attempt;
+    }
+
+    page->cached = cache_.Fetch(page->url);
+    if (page->cached.has_value())
+      page->content = *page->cached;
+    page->trace.cached = page->content.has_value();
+    (page->content.has_value() ? metrics_.cache_hits : metrics_.cache_misses)
+      .Inc();
+    if (!page->content.has_value()) {
+      // A parked host's entries go back untouched; this is not an attempt.
+      // Those of a host the breaker gave up on go to the dead-letter file.
+      const std::string host = page->url.GetHost();
+      if (auto hold = breaker_.Admit(host); hold.has_value()) {
+        if (*hold == CircuitBreaker::kGiveUp) {
+          GiveUp(page->entry, RetryPolicy::Outcome::Connect,
+                 page->entry.attempt, kHostGivenUp);
+        } else {
+          frontier_.Defer(host, *hold);
+          frontier_.Retry(page->entry, *hold);
+        }
+        Done();
+        continue;
+      }
+
+      CURLcode code = CURLE_OK;
+      bool connected = false;
+      metrics_.fetches.Inc();
+      const auto started = std::chrono::system_clock::now();
+      const auto t0 = std::chrono::steady_clock::now();
+      auto response = Fetch(page->url, cert, code, connected,
+                            tracing_ ? &page->trace : nullptr, &page->arena);
+      const auto fetch_time = std::chrono::steady_clock::now() - t0;
+      metrics_.fetch_time.Record(fetch_time);
+      if (warc_ && response.has_value()) {
+        warc_->Write(
+          page->url, *response,
+          {started,
+           std::chrono::duration_cast<std::chrono::microseconds>(fetch_time),
+           page->entry.depth, page->entry.attempt});
+      }
+      const long status = response.has_value() ? response->GetStatusCode() : 0;
+      if (response.has_value()) {
+        metrics_.bytes.Inc(response->GetBody().size());
+        metrics_.responses[status >= 100 && status < 600 ? status / 100 : 0]
+          ->Inc();
+      }
+
+      // the last Retry-After wins: earlier ones belong to redirect hops
+      std::optional<std::chrono::seconds> retry_after;
+      if (response.has_value()) {
+        if (auto v = response->GetHeaders(HttpResponse::Header::RetryAfter);
+            !v.empty())
+          retry_after = RetryPolicy::ParseRetryAfter(std::string(v.back()));
+      }
+
+      const auto outcome = RetryPolicy::Classify(
+        code, status, retry_after.has_value(), connected);
+      // only a host that cannot be reached counts against the breaker; one
+      // that is slow or flaky mid-transfer retries on the transfer backoff
+      bool host_dead = false;
+      if (outcome == RetryPolicy::Outcome::Dns ||
+          outcome == RetryPolicy::Outcome::Connect) {
+        const auto until = breaker_.OnFailure(host);
+        if (until == CircuitBreaker::kGiveUp) {
+          host_dead = true;
+          metrics_.circuit_trips.Inc();
+          AbandonHost(host);
+        } else if (until.has_value()) {
+          logr::warning << "[Crawler] circuit open for " << host << " for "
+                        << std::chrono::duration_cast<std::chrono::seconds>(
+                             *until - std::chrono::steady_clock::now())
+                             .count()
+                        << " s";
+          frontier_.Defer(host, *until);
+          metrics_.circuit_trips.Inc();
         }
-        if (response->IsOkay()) {
-          logr::debug << "HTTP OK";
-          content.reset();
-          content = response->GetBody();
-          cache_.Store(url, *response);
+      } else {
+        // it connected, even if the transfer or the answer then failed
+        breaker_.OnSuccess(host);
+      }
+
+      if (outcome != RetryPolicy::Outcome::Ok) {
+        metrics_.failures[static_cast<size_t>(outcome)]->Inc();
+        if (tracing_)
+          TraceLog::Instance().Write(page->trace);
+        const std::string detail = code != CURLE_OK
+                                     ? curl_easy_strerror(code)
+                                     : "HTTP " + std::to_string(status);
+        if (host_dead) {
+          GiveUp(page->entry, outcome, page->entry.attempt + 1,
+                 detail + "; " + kHostGivenUp);
+        } else {
+          Reschedule(*page, outcome, retry_after, detail);
         }
+        Done();
+        continue;
       }
-      if (content.has_value()) {
-        if (auto result = luap_.Process(url, *content); result.has_value()) {
-          cache_.Store(url, *result);
-
-          if (auto it = result->find("urls");
-              it != result->end() && it->is_array()) {
-            std::unordered_set<URL> new_urls;
-            new_urls.reserve(it->size());
-            for (const auto& v : *it) {
-              if (v.is_string()) {
-                auto new_url = URL(v.get<std::string>()).Resolve(url);
-                if (new_url.GetDomain() == url.GetDomain()) {
-                  new_urls.insert(std::move(new_url));
-                }
-              }
-            }
-            urlm_.Store(url.GetDomain(), new_urls);
-          }
+      LOGR_DEBUG << "[Crawler] fetched" << logr::kv("url", page->url)
+                 << logr::kv("status", status);
+      page->response = std::move(response);
+      page->content = page->response->GetBody();  // a view, not a copy
+    }
 
-          auto redirect = luap_.GetClientRedirect();
+    Hand(out, Stage::Parse, std::move(page));
+  }
+}
 
-          if (redirect.has_value()) {
-            url = redirect->base.has_value()
-                    ? URL(*redirect->base).Resolve(redirect->url)
-                    : url.Resolve(redirect->url);
-            if (redirect->delay > 0) {
-              std::this_thread::sleep_for(
-                std::chrono::seconds(redirect->delay));
-            }
+void Crawler::ParseStage(LuaProcessor& luap, PageQueue& in,
+                         PageQueue& out) {
+  // reused across pages, so resolving links stops allocating once warm
+  LinkResolver resolver(&canon_);
+  std::vector<std::string_view> refs;
+  std::vector<double> priorities;
+
+  while (auto item = in.pop()) {
+    auto& page = *item;
+    stats_[static_cast<size_t>(Stage::Parse)].processed++;
+    const URL& url = page->url;
+
+    // A near-copy of a page already seen has nothing new for Lua
+    if (near_dups_.has_value()) {
+      if (auto match = near_dups_->Check(url.ToString(), *page->content)) {
+        metrics_.near_duplicates.Inc();
+        LOGR_DEBUG << "[Crawler] near-duplicate" << logr::kv("url", url)
+                   << logr::kv("of", match->url)
+                   << logr::kv("distance", match->distance);
+        Hand(out, Stage::Store, std::move(page));
+        continue;
+      }
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    page->result = luap.Process(url, *page->content);
+    const auto lua_time = std::chrono::steady_clock::now() - t0;
+    metrics_.lua_time.Record(lua_time);
+    page->trace.lua_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(lua_time).count();
+    if (page->result.has_value()) {
+      const auto& result = *page->result;
+      if (auto it = result.find("urls"); it != result.end() && it->is_array()) {
+        refs.clear();
+        priorities.clear();
+        for (const auto& v : *it) {
+          if (auto link = LinkFromJson(v); link.has_value()) {
+            refs.push_back(link->first);
+            priorities.push_back(link->second);
+          }
+        }
+
+        // one pass against this page; links to other schemes come back empty
+        resolver.Reset(url.ToString());
+        const auto& links = resolver.Resolve(refs);
+        const URL domain = url.GetDomain();
+        page->new_urls.reserve(links.size());
+        for (size_t i = 0; i < links.size(); ++i) {
+          const auto& link = links[i];
+          if (link.url.empty())
+            continue;
+          const URL new_url{std::string(link.url)};
+          if (new_url.GetDomain() != domain)
             continue;
+          if (link.url != link.raw) {
+            canon_rewrites_++;
+            metrics_.canonical_rewrites.Inc();
           }
-          break;
+          if (page->entry.depth < max_depth_) {
+            Enqueue(link.raw, new_url, priorities[i], page->entry.depth + 1,
+                    url.GetID());
+          }
+          page->new_urls.emplace_back(link.url);
+        }
+      }
+
+      // Client-side redirects go back through the frontier; a delay holds
+      // back the whole host, as sleeping the crawler used to.
+      if (auto redirect = luap.GetClientRedirect(); redirect.has_value()) {
+        const URL raw = redirect->base.has_value()
+                          ? URL(*redirect->base).Resolve(redirect->url)
+                          : url.Resolve(redirect->url);
+        const URL target = canon_.Canonicalize(raw);
+        if (target.GetDomain() == url.GetDomain() &&
+            Enqueue(raw.ToString(), target, page->entry.priority,
+                    page->entry.depth,
+                    url.GetID()) &&
+            redirect->delay > 0) {
+          frontier_.Defer(target.GetHost(),
+                          std::chrono::steady_clock::now() +
+                            std::chrono::seconds(redirect->delay));
         }
-        logr::debug;
       }
     }
+
+    Hand(out, Stage::Store, std::move(page));
+  }
+}
+
+// Without canonicalization, a link is fetched again whenever its raw
+// spelling is new. So a push refused because the canonical form is already
+// known saves a fetch if the raw spelling is new and differs from the
+// canonical form, or if it is the canonical form but that form was first
+// queued under another spelling.
+bool Crawler::Enqueue(std::string_view raw, const URL& url, double priority,
+                      std::uint32_t depth, std::uint64_t parent) {
+  const bool pushed = frontier_.Push(url, priority, depth, parent);
+  const std::string& canonical = url.ToString();
+  const bool rewritten = canonical != raw;
+  if (pushed && !rewritten)
+    return true;
+
+  bool saved = false;
+  {
+    std::lock_guard<std::mutex> lock(canon_mtx_);
+    if (rewritten) {
+      const bool fresh =
+        canon_raw_seen_.insert(std::hash<std::string_view>{}(raw)).second;
+      if (pushed)
+        canon_introduced_.insert(url.GetID());
+      else
+        saved = fresh;
+    } else {
+      saved = canon_introduced_.count(url.GetID()) &&
+              canon_raw_seen_
+                .insert(std::hash<std::string_view>{}(canonical))
+                .second;
+    }
+  }
+  if (saved) {
+    canon_eliminated_++;
+    metrics_.canonical_duplicates.Inc();
+  }
+  return pushed;
+}
+
+void Crawler::StoreStage(PageQueue& in) {
+  while (auto item = in.pop()) {
+    auto& page = *item;
+    stats_[static_cast<size_t>(Stage::Store)].processed++;
+
+    const auto t0 = std::chrono::steady_clock::now();
+    if (page->response.has_value()) {
+      cache_.Store(page->url, *page->response);
+    }
+    if (page->result.has_value()) {
+      results_.Write(page->url, *page->result);
+    }
+    urlm_.Store(page->url.GetDomain(), page->new_urls);
+    const auto store_time = std::chrono::steady_clock::now() - t0;
+    metrics_.store_time.Record(store_time);
+    if (tracing_) {
+      page->trace.store_us =
+        std::chrono::duration_cast<std::chrono::microseconds>(store_time)
+          .count();
+      TraceLog::Instance().Write(page->trace);
+    }
+    frontier_.Complete(page->entry);
+    Done();
   }
 }
 
+void Crawler::Reschedule(const Page& page, RetryPolicy::Outcome outcome,
+                         std::optional<std::chrono::seconds> retry_after,
+                         const std::string& detail) {
+  const unsigned attempts = page.entry.attempt + 1;
+  const auto delay = retry_.Delay(outcome, attempts, retry_after);
+  if (!delay.has_value()) {
+    logr::warning << "[Crawler] giving up on " << page.url << " after "
+                  << attempts << " attempt(s): "
+                  << RetryPolicy::Name(outcome) << ", " << detail;
+    GiveUp(page.entry, outcome, attempts, detail);
+    return;
+  }
+
+  logr::info << "[Crawler] " << RetryPolicy::Name(outcome) << " (" << detail
+             << ") for " << page.url << "; retry in " << delay->count()
+             << " ms";
+  const auto when = std::chrono::steady_clock::now() + *delay;
+  // Throttling applies to the whole host, not just this URL
+  if (outcome == RetryPolicy::Outcome::RateLimited)
+    frontier_.Defer(page.url.GetHost(), when);
+  Frontier::Entry entry = page.entry;
+  entry.attempt = attempts;
+  frontier_.Retry(std::move(entry), when);
+  retries_++;
+  metrics_.retries.Inc();
+}
+
+void Crawler::GiveUp(const Frontier::Entry& entry,
+                     RetryPolicy::Outcome outcome, unsigned attempts,
+                     const std::string& detail) {
+  dead_letter_.Record(entry, outcome, attempts, detail);
+  frontier_.Complete(entry);
+  dead_letters_++;
+  metrics_.dead_letters.Inc();
+}
+
+void Crawler::AbandonHost(const std::string& host) {
+  const auto entries = frontier_.Drain(host);
+  logr::warning << "[Crawler] giving up on host " << host
+                << ": unreachable after the longest circuit cool-down; "
+                << entries.size() << " queued URL(s) dead-lettered";
+  for (const auto& e : entries)
+    GiveUp(e, RetryPolicy::Outcome::Connect, e.attempt, kHostGivenUp);
+}
+
 std::optional<HttpResponse> Crawler::Fetch(const URL& url) {
+  CURLcode code;
+  bool connected;
+  return Fetch(url, certs_.front(), code, connected);
+}
+
+std::optional<HttpResponse> Crawler::Fetch(const URL& url, Cert& cert,
+                                           CURLcode& code, bool& connected,
+                                           TraceRecord* trace,
+                                           std::pmr::memory_resource* mr) {
+  // Start the lookup now so it overlaps the politeness delay
+  Resolver::Instance().ResolveAsync(url.GetHost());
   Dwell();
 
   CURL* curl = curl_easy_init();
 
   if (!curl) {
     logr::debug << "[Crawler] failed to init CURL";
+    code = CURLE_FAILED_INIT;
     return std::nullopt;
   }
 
@@ -100,10 +637,24 @@ std::optional<HttpResponse> Crawler::Fetch(const URL& url) {
   curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, 60L);
 
   // A sensible User-UAgent helps with some sites
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, agent_.c_str());
+  std::string user_agent;
+  {
+    std::lock_guard<std::mutex> lock(agent_mtx_);
+    user_agent = agent_.c_str();
+  }
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, user_agent.c_str());
 
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
 
+  // Hand curl the shared resolver's answer instead of letting it block in
+  // getaddrinfo for every handle
+  struct curl_slist* resolve = nullptr;
+  if (const auto entry = Resolver::Instance().CurlResolveEntry(url.ToString());
+      !entry.empty()) {
+    resolve = curl_slist_append(resolve, entry.c_str());
+    curl_easy_setopt(curl, CURLOPT_RESOLVE, resolve);
+  }
+
   // Follow 3xx redirects automatically
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
 
@@ -113,66 +664,101 @@ std::optional<HttpResponse> Crawler::Fetch(const URL& url) {
   // Set Referer automatically on redirects (optional)
   curl_easy_setopt(curl, CURLOPT_AUTOREFERER, 1L);
 
-  // Prefer HTTP/2 when available (optional but nice)
-  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+  // Prefer HTTP/2 unless this host has already failed with it. Transfers
+  // run on the engine's shared multi handle, so concurrent fetches from the
+  // other workers ride the same connection as extra streams; PIPEWAIT makes
+  // a new transfer wait for an in-progress connect to the origin instead of
+  // opening its own.
+  const std::string host = url.GetHost();
+  bool http1 = engine_.PrefersHttp1(host);
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION,
+                   http1 ? CURL_HTTP_VERSION_1_1 : CURL_HTTP_VERSION_2TLS);
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
 
   // Auto-decompress gzip/br (server dependent)
   curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
 
-  // Verbosity
-  curl_easy_setopt(curl, CURLOPT_VERBOSE, 0L);
+  // Verbosity; the WARC request record needs the request headers as sent,
+  // which curl only hands out through the debug callback
+  curl_easy_setopt(curl, CURLOPT_VERBOSE, warc_ ? 1L : 0L);
 
-  // Make sure TLS trust uses your CentOS CA bundle
-  const auto base = cert_.GetBaseCaPath();
-  if (!base.empty() && std::filesystem::exists(base)) {
-    curl_easy_setopt(curl, CURLOPT_CAINFO, base.c_str());
-  }
   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
 
-  // If we have a per-host bundle, this upgrades trust for this host
-  // transparently
-  cert_.ApplyHostBundle(curl, url.GetHost());
+  // TLS trust comes from the cached, pre-parsed store for this host (base CA
+  // bundle plus any intermediates found earlier), so setting up a handshake
+  // touches no files. A leaf that fails verification is kept for the repair
+  // path below.
+  Cert::PeerChain peer;
+  Cert::TlsHook tls{&cert, host, &peer};
+  Cert::InstallTlsHook(curl, &tls);
 
-  HttpResponse resp;
+  HttpResponse resp(mr);
 
   // Body & Header callbacks
   curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteBodyCallback);
   curl_easy_setopt(curl, CURLOPT_WRITEDATA, &resp);
   curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, WriteHeaderCallback);
   curl_easy_setopt(curl, CURLOPT_HEADERDATA, &resp);
+  if (warc_) {
+    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, DebugCallback);
+    curl_easy_setopt(curl, CURLOPT_DEBUGDATA, &resp);
+  }
 
   // Error buffer
   char errbuf[CURL_ERROR_SIZE] = {0};
   curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, errbuf);
 
   // Perform the request
-  CURLcode code = curl_easy_perform(curl);
-
-  if (code == CURLE_HTTP2_STREAM || code == CURLE_HTTP2 ||
-      code == CURLE_PARTIAL_FILE) {
+  code = engine_.Perform(curl);
+
+  // A truncated body only points at HTTP/2 when the transfer negotiated it;
+  // over HTTP/1.1 (plain http, or ALPN chose it) it is an ordinary failure
+  long negotiated = CURL_HTTP_VERSION_NONE;
+  if (code == CURLE_PARTIAL_FILE)
+    curl_easy_getinfo(curl, CURLINFO_HTTP_VERSION, &negotiated);
+  if (!http1 && (code == CURLE_HTTP2_STREAM || code == CURLE_HTTP2 ||
+                 (code == CURLE_PARTIAL_FILE &&
+                  negotiated == CURL_HTTP_VERSION_2_0))) {
     logr::warning << "[Crawler] HTTP 2.0 error; retry HTTP 1.1 for: "
                   << url.GetDomain();
+    engine_.MarkHttp1(host);
+    http1 = true;
     curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
-    code = curl_easy_perform(curl);
+    resp = HttpResponse(mr);  // drop what the failed attempt wrote
+    code = engine_.Perform(curl);
   } else if (code == CURLE_PEER_FAILED_VERIFICATION ||
              (errbuf[0] &&
               std::strstr(errbuf, "unable to get local issuer certificate"))) {
     TempPem hold;  // if we create a temp bundle, this keeps it alive until the
                    // retry returns
-    if (cert_.AugmentWithIntermediates(curl, url.ToString(), hold)) {
+    // After a redirect the failing handshake may belong to another host;
+    // then fall back to probing this one
+    const std::string leaf =
+      peer.host.empty() || peer.host == host ? peer.leaf_pem : "";
+    if (cert.AugmentWithIntermediates(curl, url.ToString(), hold, leaf)) {
       logr::info << "[Crawler] Fetched intermediate certs for: " << url;
-      // Re-enable strict verify (AugmentWithIntermediates uses a separate
-      // probe)
+      // Re-enable strict verify (the probe fallback turns it off on its own
+      // handle only; be explicit anyway)
       curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 1L);
       curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 2L);
-      code = curl_easy_perform(curl);
+      resp = HttpResponse(mr);
+      code = engine_.Perform(curl);
     } else {
       logr::error << "[Crawler] Failed to fetch intermediate certs for: "
                   << url;
     }
   }
 
+  // A reused connection reports no connect time but is past pre-transfer;
+  // both stay 0 when the connect itself never finished
+  {
+    curl_off_t connect_us = 0, pretransfer_us = 0;
+    curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect_us);
+    curl_easy_getinfo(curl, CURLINFO_PRETRANSFER_TIME_T, &pretransfer_us);
+    connected = connect_us > 0 || pretransfer_us > 0;
+  }
+
   // Get response meta data
   {
     long http_code = 0;
@@ -188,7 +774,29 @@ std::optional<HttpResponse> Crawler::Fetch(const URL& url) {
     resp.SetEffectiveUrl(effective_url);
   }
 
+  // Timings of the last perform, cumulative from its start (microseconds)
+  if (trace) {
+    auto get = [curl](CURLINFO info) {
+      curl_off_t v = -1;
+      return curl_easy_getinfo(curl, info, &v) == CURLE_OK
+               ? static_cast<std::int64_t>(v)
+               : std::int64_t{-1};
+    };
+    trace->curl_code = code;
+    trace->status = resp.GetStatusCode();
+    trace->namelookup_us = get(CURLINFO_NAMELOOKUP_TIME_T);
+    trace->connect_us = get(CURLINFO_CONNECT_TIME_T);
+    trace->appconnect_us = get(CURLINFO_APPCONNECT_TIME_T);
+    trace->pretransfer_us = get(CURLINFO_PRETRANSFER_TIME_T);
+    trace->starttransfer_us = get(CURLINFO_STARTTRANSFER_TIME_T);
+    trace->total_us = get(CURLINFO_TOTAL_TIME_T);
+    trace->redirect_us = get(CURLINFO_REDIRECT_TIME_T);
+    trace->download_bytes = get(CURLINFO_SIZE_DOWNLOAD_T);
+  }
+
   curl_easy_cleanup(curl);
+  if (resolve)
+    curl_slist_free_all(resolve);
 
   if (code != CURLE_OK) {
     logr::warning << "[Crawler] URL error: " << url;
@@ -207,14 +815,15 @@ void Crawler::Dwell() {
 
   using clock = std::chrono::steady_clock;
 
-  auto now = clock::now();
-  if (now < next_allowed_) {
-    std::this_thread::sleep_until(next_allowed_);
-    now = clock::now();
+  // Reserve the next slot under the lock, then sleep until ours comes up.
+  // max(..) avoids bunching if we were behind.
+  clock::time_point slot;
+  {
+    std::lock_guard<std::mutex> lock(dwell_mtx_);
+    slot = std::max(clock::now(), next_allowed_);
+    next_allowed_ = slot + rate_limit_;
   }
-
-  // Reserve the next slot. max(..) avoids bunching if we were behind.
-  next_allowed_ = std::max(now, next_allowed_) + rate_limit_;
+  std::this_thread::sleep_until(slot);
 }
 
 size_t Crawler::WriteBodyCallback(char* ptr, size_t size, size_t nmemb,
@@ -228,7 +837,15 @@ size_t Crawler::WriteHeaderCallback(char* ptr, size_t size, size_t nmemb,
                                     void* userdata) {
   auto* resp = static_cast<HttpResponse*>(userdata);
   // ptr may include the “\r\n” at the end
-  std::string line(ptr, size * nmemb);
-  resp->AddHeaderLine(line);
+  resp->AddHeaderLine({ptr, size * nmemb});
+  resp->AddRawHeaderLine(ptr, size * nmemb);
   return size * nmemb;
 }
+
+int Crawler::DebugCallback(CURL*, curl_infotype type, char* data,
+                           size_t size, void* userdata) {
+  // one call per request sent; the last belongs to the final redirect hop
+  if (type == CURLINFO_HEADER_OUT)
+    static_cast<HttpResponse*>(userdata)->SetRawRequest({data, size});
+  return 0;
+}
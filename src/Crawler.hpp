@@ -1,40 +1,197 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <string>
-#include <set>
+#include <string_view>
 #include <optional>
 #include <filesystem>
+#include <unordered_set>
+#include <vector>
 
 #include "UAgent.hpp"
 #include "URL.hpp"
 #include "Cert.hpp"
+#include "Canonicalizer.hpp"
 #include "Config.hpp"
 #include "CacheManager.hpp"
+#include "CircuitBreaker.hpp"
+#include "DeadLetter.hpp"
+#include "FetchEngine.hpp"
+#include "Frontier.hpp"
+#include "MPMCQueue.hpp"
+#include "Metrics.hpp"
+#include "ResultSink.hpp"
+#include "RetryPolicy.hpp"
+#include "SimHash.hpp"
+#include "TraceLog.hpp"
 #include "URLManager.hpp"
+#include "WarcWriter.hpp"
 #include "HttpResponse.hpp"
 #include "LuaProcessor.hpp"
 
+// Crawls one domain's frontier as a pipeline of three stages joined by
+// bounded queues:
+//
+//   fetch (cache lookup + network) -> parse (Lua, link expansion)
+//                                  -> store (cache, ResultSink, URL lists)
+//
+// Discovered links are canonicalized before they reach the frontier, so
+// spellings of a URL that differ only in case, default port, escaping,
+// parameter order, tracking parameters or fragment are fetched once.
+//
+// With a WarcWriter, every HTTP response is also archived from the fetch
+// stage as it arrives. With near-duplicate detection on, the parse stage
+// fingerprints each body first and passes near-copies of a page it has
+// already seen straight to the store stage, without Lua or link expansion;
+// the clusters are written to data_dir/duplicates/<domain>.jsonl at the end.
+//
+// Each stage runs its own worker threads, so the network never waits on Lua
+// and disk writes never hold up a fetch; a full queue pushes back on the
+// stage feeding it.
+//
+// A failed fetch never blocks its worker: RetryPolicy picks a delay and the
+// entry goes back to the frontier until then, or to the dead-letter file once
+// its outcome's retry budget is spent. Hosts that keep failing to connect
+// trip a CircuitBreaker, which parks them in the frontier and lets a single
+// probe through after each cool-down. A host whose probe still fails after
+// the longest cool-down is given up on: its queued URLs, and any found for it
+// later, go to the dead-letter file so the domain can finish.
 class Crawler {
  public:
-  Crawler(const std::set<URL>& batch, const URL& dom, Config& conf,
-          CacheManager& cache, LuaProcessor& luap, URLManager& urlm);
+  enum class Stage { Fetch = 0, Parse, Store };
+
+  // Counters for the queue feeding one stage (racy reads are fine)
+  struct StageStats {
+    std::atomic<std::uint64_t> processed{0};
+    std::atomic<size_t> queue_depth{0};      // last sampled
+    std::atomic<size_t> max_queue_depth{0};  // high-water mark
+    std::atomic<std::uint64_t> blocked_us{0};  // producers waiting on it
+  };
+
+  Crawler(Frontier& frontier, const URL& dom, Config& conf,
+          CacheManager& cache, LuaProcessor& luap, URLManager& urlm,
+          ResultSink& results, WarcWriter* warc = nullptr);
   void Crawl();
   std::optional<HttpResponse> Fetch(const URL& url);
 
+  const StageStats& GetStageStats(Stage stage) const;
+
  private:
+  // One frontier entry on its way through the pipeline. The response and
+  // the links found are allocated from the page's own arena, which is
+  // released in one go when the store stage drops the page; only one stage
+  // holds a page at a time, so the arena needs no lock.
+  struct Page {
+    static constexpr size_t kArenaBytes = 64 * 1024;  // first block
+
+    Page(const Frontier::Entry& e, URL u) : entry{e}, url{std::move(u)} {
+    }
+
+    std::pmr::monotonic_buffer_resource arena{kArenaBytes};  // outlives all
+    Frontier::Entry entry;
+    URL url;
+    std::optional<HttpResponse> response;  // set on a network fetch
+    std::optional<std::string> cached;     // set on a cache hit
+    std::optional<std::string_view> content;  // the body, in one of those
+    std::optional<nlohmann::json> result;
+    std::pmr::vector<std::pmr::string> new_urls{&arena};
+    TraceRecord trace;  // written after the store stage when tracing
+  };
+  using PageQueue = MPMCQueue<std::unique_ptr<Page>>;
+
+  // This domain's series in the metrics registry, looked up once
+  struct Instruments {
+    explicit Instruments(const std::string& domain);
+
+    metrics::Counter& fetches;
+    metrics::Counter& bytes;
+    metrics::Counter& cache_hits;
+    metrics::Counter& cache_misses;
+    metrics::Counter& retries;
+    metrics::Counter& dead_letters;
+    metrics::Counter& circuit_trips;
+    metrics::Counter& near_duplicates;
+    metrics::Counter& canonical_rewrites;
+    metrics::Counter& canonical_duplicates;
+    std::array<metrics::Counter*, 6> responses;  // by status class; 0: other
+    std::array<metrics::Counter*, RetryPolicy::kOutcomes> failures;
+    std::array<metrics::Gauge*, 3> queue_depth;  // by Stage
+    metrics::Histogram& fetch_time;
+    metrics::Histogram& lua_time;
+    metrics::Histogram& store_time;
+  };
+
+  void FetchStage(Cert& cert, PageQueue& out);
+  void ParseStage(LuaProcessor& luap, PageQueue& in, PageQueue& out);
+  void StoreStage(PageQueue& in);
+  void Hand(PageQueue& queue, Stage stage, std::unique_ptr<Page> page);
+  void Done();
+  void Sample(Stage stage, size_t depth);
+  void Reschedule(const Page& page, RetryPolicy::Outcome outcome,
+                  std::optional<std::chrono::seconds> retry_after,
+                  const std::string& detail);
+  void GiveUp(const Frontier::Entry& entry, RetryPolicy::Outcome outcome,
+              unsigned attempts, const std::string& detail);
+  void AbandonHost(const std::string& host);
+
+  void ReportDuplicates() const;
+  bool Enqueue(std::string_view raw, const URL& url, double priority,
+               std::uint32_t depth, std::uint64_t parent);
+
   void Dwell();
+  std::optional<HttpResponse> Fetch(
+    const URL& url, Cert& cert, CURLcode& code, bool& connected,
+    TraceRecord* trace = nullptr,
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource());
   std::string Fetch(const URL& url) const;
   static size_t WriteBodyCallback(char* ptr, size_t size, size_t nmemb,
                                   void* userdata);
   static size_t WriteHeaderCallback(char* ptr, size_t size, size_t nmemb,
                                     void* userdata);
+  static int DebugCallback(CURL* curl, curl_infotype type, char* data,
+                           size_t size, void* userdata);
 
-  std::set<URL> urls_;
+  Frontier& frontier_;
+  const URL domain_;
+  const std::uint32_t max_depth_;
+  const Config::PipelineOptions pipeline_;
+  const std::filesystem::path script_dir_;
   const std::chrono::milliseconds rate_limit_;
   UAgent agent_;
+  std::mutex agent_mtx_;
   CacheManager& cache_;
   LuaProcessor& luap_;
   URLManager& urlm_;
-  Cert cert_;
+  ResultSink& results_;
+  WarcWriter* const warc_;  // optional
+  std::vector<Cert> certs_;  // one per fetch worker
+  FetchEngine engine_;       // shared connections for all fetch workers
+  RetryPolicy retry_;
+  CircuitBreaker breaker_;
+  DeadLetter dead_letter_;
+  std::optional<SimHashIndex> near_dups_;
+  const std::filesystem::path duplicates_file_;
+  const Canonicalizer canon_;
+  // links whose raw spelling differed from the canonical one: hashes of the
+  // raw spellings seen, and canonical IDs such a link put in the frontier
+  std::mutex canon_mtx_;
+  std::unordered_set<std::uint64_t> canon_raw_seen_;
+  std::unordered_set<std::uint64_t> canon_introduced_;
+  std::atomic<std::uint64_t> canon_rewrites_{0};
+  std::atomic<std::uint64_t> canon_eliminated_{0};
+  std::mutex dwell_mtx_;
   std::chrono::steady_clock::time_point next_allowed_;
+
+  // pages popped from the frontier and not yet through the store stage
+  std::atomic<size_t> in_flight_{0};
+  StageStats stats_[3];
+  Instruments metrics_;
+  const bool tracing_;
+  std::atomic<std::uint64_t> retries_{0};
+  std::atomic<std::uint64_t> dead_letters_{0};
 };
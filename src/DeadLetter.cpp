@@ -0,0 +1,52 @@
+#include "DeadLetter.hpp"
+#include "Logger.hpp"
+
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <system_error>
+
+#include <nlohmann/json.hpp>
+
+namespace {
+std::mutex& FileMutex() {
+  static std::mutex mtx;
+  return mtx;
+}
+
+std::string UtcNow() {
+  const std::time_t t =
+    std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  std::tm tm{};
+  gmtime_r(&t, &tm);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &tm);
+  return buf;
+}
+}  // namespace
+
+DeadLetter::DeadLetter(std::filesystem::path file) : file_{std::move(file)} {
+}
+
+void DeadLetter::Record(const Frontier::Entry& entry,
+                        RetryPolicy::Outcome outcome, unsigned attempts,
+                        const std::string& detail) {
+  const nlohmann::json j = {{"time", UtcNow()},
+                            {"url", entry.url},
+                            {"depth", entry.depth},
+                            {"parent", entry.parent},
+                            {"attempts", attempts},
+                            {"outcome", RetryPolicy::Name(outcome)},
+                            {"detail", detail}};
+  // URLs may carry raw non-UTF-8 bytes; replace them rather than throw
+  const std::string line =
+    j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace) + '\n';
+
+  std::lock_guard<std::mutex> lock(FileMutex());
+  std::error_code ec;
+  std::filesystem::create_directories(file_.parent_path(), ec);
+  std::ofstream out(file_, std::ios::binary | std::ios::app);
+  out.write(line.data(), static_cast<std::streamsize>(line.size()));
+  if (!out)
+    logr::error << "[DeadLetter] failed to write " << file_;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+
+#include "Frontier.hpp"
+#include "RetryPolicy.hpp"
+
+// Append-only JSONL record of URLs the crawler gave up on, one object per
+// line:
+//
+//   {"time":"2025-01-01T00:00:00Z","url":"...","depth":1,"parent":123,
+//    "attempts":4,"outcome":"server","detail":"HTTP 503"}
+//
+// Crawlers for different domains may share one file; writes are serialised
+// process-wide and each line is appended whole.
+class DeadLetter {
+ public:
+  explicit DeadLetter(std::filesystem::path file);
+
+  void Record(const Frontier::Entry& entry, RetryPolicy::Outcome outcome,
+              unsigned attempts, const std::string& detail);
+
+  const std::filesystem::path& GetPath() const {
+    return file_;
+  }
+
+ private:
+  std::filesystem::path file_;
+};
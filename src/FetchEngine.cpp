@@ -0,0 +1,105 @@
+#include "FetchEngine.hpp"
+#include "Logger.hpp"
+
+#include <utility>
+
+FetchEngine::FetchEngine(Options opts) : multi_{curl_multi_init()} {
+  curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS,
+                    opts.max_host_connections);
+#if LIBCURL_VERSION_NUM >= 0x074300
+  curl_multi_setopt(multi_, CURLMOPT_MAX_CONCURRENT_STREAMS, opts.max_streams);
+#endif
+  driver_ = std::thread([this] { Run(); });
+}
+
+FetchEngine::~FetchEngine() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  curl_multi_wakeup(multi_);
+  driver_.join();
+  curl_multi_cleanup(multi_);
+}
+
+CURLcode FetchEngine::Perform(CURL* easy) {
+  Transfer t{easy, {}};
+  auto done = t.done.get_future();
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (stop_)
+      return CURLE_ABORTED_BY_CALLBACK;
+    incoming_.push_back(&t);
+  }
+  curl_multi_wakeup(multi_);
+  return done.get();
+}
+
+bool FetchEngine::PrefersHttp1(const std::string& host) const {
+  std::shared_lock<std::shared_mutex> lock(h1_mtx_);
+  return h1_hosts_.count(host) > 0;
+}
+
+void FetchEngine::MarkHttp1(const std::string& host) {
+  std::unique_lock<std::shared_mutex> lock(h1_mtx_);
+  if (h1_hosts_.insert(host).second)
+    logr::info << "[FetchEngine] using HTTP/1.1 for " << host;
+}
+
+void FetchEngine::Fulfil(Transfer& t, CURLcode result) {
+  // The Transfer lives on the waiting caller's stack and goes as soon as
+  // get() returns, possibly before set_value() does; fulfil a promise this
+  // thread owns instead
+  auto done = std::move(t.done);
+  done.set_value(result);
+}
+
+void FetchEngine::Run() {
+  int running = 0;
+  for (;;) {
+    std::vector<Transfer*> added;
+    bool stop;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      added.swap(incoming_);
+      stop = stop_;
+    }
+    for (auto* t : added) {
+      curl_easy_setopt(t->easy, CURLOPT_PRIVATE, t);
+      const CURLMcode mc = curl_multi_add_handle(multi_, t->easy);
+      if (mc != CURLM_OK) {
+        logr::error << "[FetchEngine] add handle: " << curl_multi_strerror(mc);
+        Fulfil(*t, CURLE_FAILED_INIT);
+      } else {
+        ++running;  // counted until its DONE message arrives
+      }
+    }
+
+    int still = 0;
+    curl_multi_perform(multi_, &still);
+
+    int queued = 0;
+    bool finished = false;
+    while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+      if (msg->msg != CURLMSG_DONE)
+        continue;
+      Transfer* t = nullptr;
+      curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &t);
+      const CURLcode result = msg->data.result;
+      curl_multi_remove_handle(multi_, msg->easy_handle);
+      --running;
+      finished = true;
+      if (t)
+        Fulfil(*t, result);
+    }
+
+    if (stop && running == 0)
+      break;
+    // A finished transfer frees a connection slot that queued transfers wait
+    // on; that shows up as no socket activity, so drive them before polling
+    if (finished)
+      continue;
+    curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+  }
+}
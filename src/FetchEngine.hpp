@@ -0,0 +1,59 @@
+#pragma once
+
+#include <curl/curl.h>
+
+#include <future>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Runs a Crawler's transfers on one curl multi handle driven by a single
+// thread. Easy handles submitted concurrently by the fetch workers share its
+// connection cache: HTTP/2 origins carry them as multiplexed streams on one
+// connection (CURLPIPE_MULTIPLEX), HTTP/1.1 origins get keep-alive reuse
+// instead of a new connection per request.
+//
+// Hosts whose HTTP/2 streams failed are remembered, so later requests go
+// straight to HTTP/1.1.
+class FetchEngine {
+ public:
+  struct Options {
+    long max_host_connections{2};  // per origin, across all workers
+    long max_streams{100};         // concurrent HTTP/2 streams per connection
+  };
+
+  explicit FetchEngine(Options opts);
+  ~FetchEngine();
+  FetchEngine(const FetchEngine&) = delete;
+  FetchEngine& operator=(const FetchEngine&) = delete;
+
+  /// Run `easy` to completion on the shared multi handle, blocking the
+  /// caller. The handle stays owned by the caller and may be reconfigured
+  /// and performed again once this returns.
+  CURLcode Perform(CURL* easy);
+
+  /// `host` failed over HTTP/2 before; request HTTP/1.1 up front
+  bool PrefersHttp1(const std::string& host) const;
+  void MarkHttp1(const std::string& host);
+
+ private:
+  struct Transfer {
+    CURL* easy;
+    std::promise<CURLcode> done;
+  };
+
+  static void Fulfil(Transfer& t, CURLcode result);
+  void Run();
+
+  CURLM* multi_;
+  std::mutex mtx_;
+  std::vector<Transfer*> incoming_;
+  bool stop_{false};
+  std::thread driver_;
+
+  mutable std::shared_mutex h1_mtx_;
+  std::unordered_set<std::string> h1_hosts_;
+};
@@ -0,0 +1,879 @@
+#include "Frontier.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+namespace {
+// keep letters, digits, '.', '-' ; replace others with '_'
+std::string HostDirName(std::string_view host) {
+  std::string out;
+  out.reserve(host.size());
+  for (unsigned char c : host)
+    out.push_back(std::isalnum(c) || c == '.' || c == '-' ? char(c) : '_');
+  return out.empty() ? "_" : out;
+}
+
+// Tail line: "<priority>\t<depth>\t<parent>\t<attempt>\t<seq>\t<url>\n"
+void AppendTailLine(std::string& out, const Frontier::Entry& e) {
+  char buf[64];
+  auto r = std::to_chars(buf, buf + sizeof(buf), e.priority);
+  out.append(buf, r.ptr);
+  out.push_back('\t');
+  r = std::to_chars(buf, buf + sizeof(buf), e.depth);
+  out.append(buf, r.ptr);
+  out.push_back('\t');
+  r = std::to_chars(buf, buf + sizeof(buf), e.parent);
+  out.append(buf, r.ptr);
+  out.push_back('\t');
+  r = std::to_chars(buf, buf + sizeof(buf), e.attempt);
+  out.append(buf, r.ptr);
+  out.push_back('\t');
+  r = std::to_chars(buf, buf + sizeof(buf), e.seq);
+  out.append(buf, r.ptr);
+  out.push_back('\t');
+  out.append(e.url);
+  out.push_back('\n');
+}
+
+// Snapshot encoding: fixed-width fields in host byte order, strings and
+// sequences prefixed with a u64 length
+template <typename T>
+void Put(std::string& out, T v) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  out.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+void PutString(std::string& out, std::string_view s) {
+  Put<std::uint64_t>(out, s.size());
+  out.append(s);
+}
+
+void PutEntry(std::string& out, const Frontier::Entry& e) {
+  PutString(out, e.url);
+  Put(out, e.priority);
+  Put(out, e.depth);
+  Put(out, e.parent);
+  Put(out, e.seq);
+  Put(out, e.attempt);
+}
+
+// Delay from `now` in ms; negative once due
+std::int64_t MillisFrom(Frontier::Clock::time_point t,
+                        Frontier::Clock::time_point now) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(t - now)
+    .count();
+}
+
+class Reader {
+ public:
+  explicit Reader(std::string_view in) : in_{in} {
+  }
+
+  template <typename T>
+  bool Get(T& v) {
+    if (in_.size() < sizeof(v))
+      return false;
+    std::memcpy(&v, in_.data(), sizeof(v));
+    in_.remove_prefix(sizeof(v));
+    return true;
+  }
+
+  bool GetString(std::string_view& s) {
+    std::uint64_t n;
+    if (!Get(n) || in_.size() < n)
+      return false;
+    s = in_.substr(0, n);
+    in_.remove_prefix(n);
+    return true;
+  }
+
+  bool GetEntry(Frontier::Entry& e) {
+    std::string_view url;
+    if (!GetString(url) || !Get(e.priority) || !Get(e.depth) ||
+        !Get(e.parent) || !Get(e.seq) || !Get(e.attempt))
+      return false;
+    e.url.assign(url);
+    return true;
+  }
+
+  // a count no larger than the bytes left could hold
+  bool GetCount(std::uint64_t& n, size_t min_item_bytes) {
+    return Get(n) && n <= in_.size() / std::max<size_t>(1, min_item_bytes);
+  }
+
+  bool Done() const {
+    return in_.empty();
+  }
+
+ private:
+  std::string_view in_;
+};
+
+bool ParseTailLine(std::string_view line, Frontier::Entry& e) {
+  const char* p = line.data();
+  const char* end = line.data() + line.size();
+  auto field = [&](auto& value) {
+    auto r = std::from_chars(p, end, value);
+    if (r.ec != std::errc{} || r.ptr == end || *r.ptr != '\t')
+      return false;
+    p = r.ptr + 1;
+    return true;
+  };
+  if (!field(e.priority) || !field(e.depth) || !field(e.parent) ||
+      !field(e.attempt) || !field(e.seq))
+    return false;
+  e.url.assign(p, end);
+  return !e.url.empty();
+}
+
+// Append the entries of newline-separated tail lines to `out`
+void ParseTail(std::string_view text, std::vector<Frontier::Entry>& out) {
+  while (!text.empty()) {
+    const auto nl = text.find('\n');
+    Frontier::Entry e;
+    if (ParseTailLine(text.substr(0, nl), e))
+      out.push_back(std::move(e));
+    text.remove_prefix(nl == std::string_view::npos ? text.size() : nl + 1);
+  }
+}
+
+// Max-min heap over a vector: levels alternate between holding the largest
+// (even levels, from the root) and the smallest (odd levels) element of
+// their subtrees, so both ends are at hand. `less(a, b)`: a ranks below b.
+bool MaxLevel(size_t i) {
+  return (std::bit_width(i + 1) - 1) % 2 == 0;
+}
+
+// Restore order after appending v[i]
+template <typename T, typename Less>
+void BubbleUp(std::vector<T>& v, size_t i, Less less) {
+  if (i == 0)
+    return;
+  bool max_level = MaxLevel(i);
+  // out of order with its parent: it belongs on the parent's levels
+  const size_t p = (i - 1) / 2;
+  if (max_level ? less(v[i], v[p]) : less(v[p], v[i])) {
+    std::swap(v[i], v[p]);
+    i = p;
+    max_level = !max_level;
+  }
+  while (i > 2) {
+    const size_t g = ((i - 1) / 2 - 1) / 2;
+    if (!(max_level ? less(v[g], v[i]) : less(v[i], v[g])))
+      break;
+    std::swap(v[i], v[g]);
+    i = g;
+  }
+}
+
+// Restore order after replacing v[i]
+template <typename T, typename Less>
+void TrickleDown(std::vector<T>& v, size_t i, Less less) {
+  const bool max_level = MaxLevel(i);
+  // `a` belongs above `b` on i's levels
+  auto above = [&](const T& a, const T& b) {
+    return max_level ? less(b, a) : less(a, b);
+  };
+  for (;;) {
+    const size_t c = 2 * i + 1;
+    if (c >= v.size())
+      return;
+    // the most extreme of the children and grandchildren
+    size_t m = c;
+    for (size_t k : {c + 1, 2 * c + 1, 2 * c + 2, 2 * c + 3, 2 * c + 4}) {
+      if (k < v.size() && above(v[k], v[m]))
+        m = k;
+    }
+    if (!above(v[m], v[i]))
+      return;
+    std::swap(v[m], v[i]);
+    if (m <= c + 1)
+      return;  // a child: nothing below it is out of order
+    const size_t p = (m - 1) / 2;
+    if (above(v[p], v[m]))
+      std::swap(v[m], v[p]);
+    i = m;
+  }
+}
+
+template <typename T, typename Less>
+void HeapInsert(std::vector<T>& v, T value, Less less) {
+  v.push_back(std::move(value));
+  BubbleUp(v, v.size() - 1, less);
+}
+
+// Index of the smallest element of a non-empty heap; the largest is at 0
+template <typename T, typename Less>
+size_t Smallest(const std::vector<T>& v, Less less) {
+  if (v.size() < 3)
+    return v.size() - 1;
+  return less(v[2], v[1]) ? 2 : 1;
+}
+
+template <typename T, typename Less>
+T HeapTake(std::vector<T>& v, size_t i, Less less) {
+  T out = std::move(v[i]);
+  if (i + 1 != v.size())
+    v[i] = std::move(v.back());
+  v.pop_back();
+  if (i < v.size())
+    TrickleDown(v, i, less);
+  return out;
+}
+}  // namespace
+
+Frontier::Frontier(const std::filesystem::path& spill_dir, size_t head_limit)
+    : spill_dir_{spill_dir},
+      head_limit_{head_limit},
+      segment_limit_{std::max<size_t>(1, head_limit / 2)} {
+  // A fresh frontier never resumes an old tail
+  std::error_code ec;
+  std::filesystem::remove_all(spill_dir_, ec);
+}
+
+// Ids are SHA-256 prefixes, so their low bits index the table as they are
+bool Frontier::IdSet::Insert(std::uint64_t id) {
+  if (id == 0) {
+    if (zero_)
+      return false;
+    zero_ = true;
+    ++size_;
+    return true;
+  }
+  if (2 * (size_ + 1) > slots_.size())
+    Grow();
+  const size_t mask = slots_.size() - 1;
+  for (size_t i = id & mask;; i = (i + 1) & mask) {
+    if (slots_[i] == id)
+      return false;
+    if (slots_[i] == 0) {
+      slots_[i] = id;
+      ++size_;
+      return true;
+    }
+  }
+}
+
+void Frontier::IdSet::Grow() {
+  std::vector<std::uint64_t> old(std::max<size_t>(64, 2 * slots_.size()));
+  old.swap(slots_);
+  const size_t mask = slots_.size() - 1;
+  for (const auto id : old) {
+    if (id == 0)
+      continue;
+    size_t i = id & mask;
+    while (slots_[i] != 0)
+      i = (i + 1) & mask;
+    slots_[i] = id;
+  }
+}
+
+bool Frontier::Below(Rank a, Rank b) {
+  if (a.score != b.score)
+    return a.score < b.score;
+  return a.seq > b.seq;  // older entries rank higher
+}
+
+bool Frontier::Lower(const Entry& a, const Entry& b) {
+  return Below(RankOf(a), RankOf(b));
+}
+
+bool Frontier::Later(const Delayed& a, const Delayed& b) {
+  return a.not_before > b.not_before;
+}
+
+void Frontier::HeapPush(Host& host, Entry entry) {
+  entry.seq = seq_++;
+  HeapInsert(host.heap, std::move(entry), Lower);
+}
+
+// Queue an entry that already has its seq; caller holds mtx_
+void Frontier::Enqueue(const std::string& name, Host& host, Entry entry) {
+  if (head_limit_ > 0 && host.heap.size() >= head_limit_) {
+    // The head keeps the best head_limit entries; the lower of the newcomer
+    // and the head's lowest goes to the tail
+    const size_t low = Smallest(host.heap, Lower);
+    if (Lower(entry, host.heap[low])) {
+      Spill(name, host, entry);
+      return;
+    }
+    Spill(name, host, HeapTake(host.heap, low, Lower));
+  }
+  HeapInsert(host.heap, std::move(entry), Lower);
+}
+
+bool Frontier::Push(const URL& url, double priority, std::uint32_t depth,
+                    std::uint64_t parent) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (!seen_.Insert(url.GetID()))
+    return false;
+
+  const auto name = url.GetHost();
+  Enqueue(name, hosts_[name],
+          {url.ToString(), priority, depth, parent, seq_++});
+  ++size_;
+  return true;
+}
+
+void Frontier::Spill(const std::string& name, Host& host, const Entry& entry) {
+  if (host.tail.empty() || Below(host.tail_best, RankOf(entry)))
+    host.tail_best = RankOf(entry);
+  if (host.tail.empty() || host.tail.back().count >= segment_limit_ ||
+      host.tail.back().adopted) {
+    FlushTail(host);  // the buffer belongs to the segment being closed
+    auto dir = spill_dir_ / HostDirName(name);
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    Segment& seg = host.tail.emplace_back();
+    seg.path = dir / (std::to_string(host.next_segment++) + ".seg");
+    seg.best = RankOf(entry);
+  }
+  AppendTailLine(host.tail_buffer, entry);
+  Segment& seg = host.tail.back();
+  ++seg.count;
+  if (Below(seg.best, RankOf(entry)))
+    seg.best = RankOf(entry);
+  if (host.tail_buffer.size() >= kTailBufferBytes)
+    FlushTail(host);
+}
+
+void Frontier::FlushTail(Host& host) {
+  if (host.tail_buffer.empty() || host.tail.empty())
+    return;
+  std::ofstream out(host.tail.back().path, std::ios::binary | std::ios::app);
+  out.write(host.tail_buffer.data(),
+            static_cast<std::streamsize>(host.tail_buffer.size()));
+  if (!out) {
+    logr::error << "[Frontier] failed to write " << host.tail.back().path;
+  } else {
+    host.tail.back().bytes += host.tail_buffer.size();
+  }
+  host.tail_buffer.clear();
+}
+
+// Index of the tail segment holding the best entry; caller holds mtx_
+size_t Frontier::BestSegment(const Host& host) {
+  size_t best = 0;
+  for (size_t i = 1; i < host.tail.size(); ++i) {
+    if (Below(host.tail[best].best, host.tail[i].best))
+      best = i;
+  }
+  return best;
+}
+
+// Remove the best segment from the tail; caller holds mtx_
+Frontier::Segment Frontier::TakeSegment(Host& host) {
+  const auto it = host.tail.begin() + BestSegment(host);
+  Segment seg = std::move(*it);
+  if (it + 1 == host.tail.end()) {
+    // the segment still being appended to: its unwritten lines go with it
+    seg.pending += host.tail_buffer;
+    host.tail_buffer.clear();
+  }
+  host.tail.erase(it);
+  if (!host.tail.empty())
+    host.tail_best = host.tail[BestSegment(host)].best;
+  return seg;
+}
+
+// Reads the file; called without mtx_
+std::vector<Frontier::Entry> Frontier::ReadSegment(const Segment& seg) {
+  std::vector<Entry> out;
+  out.reserve(seg.count);
+  std::string text(seg.bytes, '\0');
+  std::ifstream in(seg.path, std::ios::binary);
+  in.read(text.data(), static_cast<std::streamsize>(text.size()));
+  text.resize(static_cast<size_t>(std::max<std::streamsize>(in.gcount(), 0)));
+  ParseTail(text, out);
+  ParseTail(seg.pending, out);
+  return out;
+}
+
+void Frontier::PageIn(std::unique_lock<std::mutex>& lock,
+                      std::vector<std::pair<std::string, Segment>> segments) {
+  // In flight, the segments stay on their hosts for Save()
+  for (const auto& [name, seg] : segments)
+    hosts_[name].paging.push_back(seg);
+
+  lock.unlock();
+  std::vector<std::vector<Entry>> read;
+  read.reserve(segments.size());
+  for (const auto& [name, seg] : segments)
+    read.push_back(ReadSegment(seg));
+  lock.lock();
+
+  for (size_t i = 0; i < segments.size(); ++i) {
+    const auto& [name, seg] = segments[i];
+    auto& host = hosts_[name];
+    std::erase_if(host.paging,
+                  [&](const Segment& s) { return s.path == seg.path; });
+    if (read[i].size() < seg.count) {
+      logr::warning << "[Frontier] " << seg.path << ": expected " << seg.count
+                    << " entries, loaded " << read[i].size();
+      size_ -= seg.count - read[i].size();
+    }
+    for (auto& e : read[i])
+      Enqueue(name, host, std::move(e));
+  }
+
+  // Save() no longer names them
+  std::vector<std::filesystem::path> paths;
+  for (const auto& [name, seg] : segments)
+    paths.push_back(seg.path);
+  lock.unlock();
+  RemoveSegments(std::move(paths));
+  lock.lock();
+}
+
+void Frontier::RemoveSegments(std::vector<std::filesystem::path> paths) {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (saving_ > 0) {
+      // a Save() may still link them; the last one to finish removes them
+      std::move(paths.begin(), paths.end(), std::back_inserter(unused_));
+      return;
+    }
+  }
+  std::error_code ec;
+  for (const auto& path : paths)
+    std::filesystem::remove(path, ec);
+}
+
+void Frontier::Retry(Entry entry, Clock::time_point not_before) {
+  std::string host = URL(entry.url).GetHost();
+  std::lock_guard<std::mutex> lock(mtx_);
+  leased_.erase(entry.seq);
+  delayed_.push_back({not_before, std::move(host), std::move(entry)});
+  std::push_heap(delayed_.begin(), delayed_.end(), Later);
+  ++size_;
+}
+
+// Move retries that are due into their host heaps; caller holds mtx_
+void Frontier::ReleaseDelayed(Clock::time_point now) {
+  while (!delayed_.empty() && delayed_.front().not_before <= now) {
+    std::pop_heap(delayed_.begin(), delayed_.end(), Later);
+    Delayed d = std::move(delayed_.back());
+    delayed_.pop_back();
+    // straight into the head: retries are few and already counted in size_
+    HeapPush(hosts_[d.host], std::move(d.entry));
+  }
+}
+
+std::optional<Frontier::Entry> Frontier::Pop(Clock::time_point now) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  ReleaseDelayed(now);
+
+  // A spilled entry that outranks its head's best (or a head that ran dry)
+  // is paged in before hosts compete, so each host offers its best entry
+  for (;;) {
+    std::vector<std::pair<std::string, Segment>> due;
+    for (auto& [name, host] : hosts_) {
+      if (host.tail.empty())
+        continue;
+      if (host.heap.empty() || Below(RankOf(host.heap.front()), host.tail_best))
+        due.emplace_back(name, TakeSegment(host));
+    }
+    if (due.empty())
+      break;
+    PageIn(lock, std::move(due));
+  }
+
+  // Pick the ready host whose best entry outranks every other host's best
+  Host* best = nullptr;
+  const std::string* best_name = nullptr;
+  for (auto& [name, host] : hosts_) {
+    if (host.heap.empty() || host.ready_at > now)
+      continue;
+    if (!best || Lower(best->heap.front(), host.heap.front())) {
+      best = &host;
+      best_name = &name;
+    }
+  }
+  if (!best)
+    return std::nullopt;
+
+  Entry entry = HeapTake(best->heap, 0, Lower);
+  --size_;
+  leased_.emplace(entry.seq, entry);
+
+  // Keep the head at least half full while the tail has entries
+  if (head_limit_ > 0 && best->heap.size() <= head_limit_ / 2 &&
+      !best->tail.empty()) {
+    std::vector<std::pair<std::string, Segment>> refill;
+    refill.emplace_back(*best_name, TakeSegment(*best));
+    PageIn(lock, std::move(refill));
+  }
+  return entry;
+}
+
+void Frontier::Complete(const Entry& entry) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  leased_.erase(entry.seq);
+}
+
+void Frontier::Defer(const std::string& host, Clock::time_point until) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto& h = hosts_[host];
+  h.ready_at = std::max(h.ready_at, until);
+}
+
+std::vector<Frontier::Entry> Frontier::Drain(const std::string& name) {
+  std::vector<Entry> out;
+  std::vector<Segment> segments;  // read once the lock is released
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (auto it = hosts_.find(name); it != hosts_.end()) {
+      Host& host = it->second;
+      while (!host.tail.empty()) {
+        segments.push_back(TakeSegment(host));
+        size_ -= segments.back().count;
+      }
+      out = std::move(host.heap);
+      // segments a Pop() is reading come back to the host
+      if (host.paging.empty()) {
+        hosts_.erase(it);
+      } else {
+        host.heap.clear();
+        host.ready_at = {};
+      }
+    }
+    const auto mine =
+      std::partition(delayed_.begin(), delayed_.end(),
+                     [&](const Delayed& d) { return d.host != name; });
+    for (auto it = mine; it != delayed_.end(); ++it)
+      out.push_back(std::move(it->entry));
+    delayed_.erase(mine, delayed_.end());
+    std::make_heap(delayed_.begin(), delayed_.end(), Later);
+    size_ -= out.size();
+  }
+
+  std::vector<std::filesystem::path> paths;
+  for (const auto& seg : segments) {
+    auto entries = ReadSegment(seg);
+    std::move(entries.begin(), entries.end(), std::back_inserter(out));
+    paths.push_back(seg.path);
+  }
+  RemoveSegments(std::move(paths));
+  return out;
+}
+
+std::optional<Frontier::Clock::time_point> Frontier::NextReadyTime() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::optional<Clock::time_point> next;
+  for (const auto& [name, host] : hosts_) {
+    if (host.heap.empty())
+      continue;
+    if (!next || host.ready_at < *next)
+      next = host.ready_at;
+  }
+  if (!delayed_.empty() && (!next || delayed_.front().not_before < *next))
+    next = delayed_.front().not_before;
+  return next;
+}
+
+size_t Frontier::Size() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return size_;
+}
+
+bool Frontier::Empty() const {
+  return Size() == 0;
+}
+
+// Layout: seq, seen ids, hosts (name, ready_at, heap entries, tail segments
+// as file name, length, entry count, best rank and the lines not yet written
+// out), delayed retries, leased entries. Times are stored as ms from now, since steady_clock does
+// not survive a restart.
+void Frontier::Save(std::string& out,
+                    const std::filesystem::path& tail_dir) const {
+  const auto now = Clock::now();
+  // segment files to link into tail_dir once mtx_ is released
+  std::vector<std::pair<std::filesystem::path, std::string>> links;
+  std::unique_lock<std::mutex> lock(mtx_);
+
+  Put<std::uint64_t>(out, seq_);
+  Put<std::uint64_t>(out, seen_.Size());
+  seen_.ForEach([&out](std::uint64_t id) { Put(out, id); });
+
+  Put<std::uint64_t>(out, hosts_.size());
+  for (const auto& [name, host] : hosts_) {
+    PutString(out, name);
+    Put(out, MillisFrom(host.ready_at, now));
+    Put<std::uint64_t>(out, host.heap.size());
+    for (const auto& e : host.heap)
+      PutEntry(out, e);
+
+    // only the length recorded here is read back, later appends are
+    // ignored. Segments a Pop() is reading are still the host's.
+    std::vector<const Segment*> segments;
+    for (const auto& seg : host.paging)
+      segments.push_back(&seg);
+    for (const auto& seg : host.tail)
+      segments.push_back(&seg);
+    Put<std::uint64_t>(out, segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+      const Segment& seg = *segments[i];
+      std::string file;
+      if (seg.bytes > 0) {
+        if (tail_dir.empty()) {
+          logr::error << "[Frontier] no snapshot directory for "
+                      << seg.path;
+        } else {
+          file = std::to_string(links.size()) + ".seg";
+          links.emplace_back(seg.path, file);
+        }
+      }
+      // lines not written out: the tail buffer is the back segment's
+      std::string pending = seg.pending;
+      if (i + 1 == segments.size() && !host.tail.empty())
+        pending += host.tail_buffer;
+      PutString(out, file);
+      Put<std::uint64_t>(out, seg.bytes);
+      Put<std::uint64_t>(out, seg.count);
+      Put(out, seg.best.score);
+      Put(out, seg.best.seq);
+      PutString(out, pending);
+    }
+  }
+
+  Put<std::uint64_t>(out, delayed_.size());
+  for (const auto& d : delayed_) {
+    Put(out, MillisFrom(d.not_before, now));
+    PutString(out, d.host);
+    PutEntry(out, d.entry);
+  }
+
+  Put<std::uint64_t>(out, leased_.size());
+  for (const auto& [seq, e] : leased_)
+    PutEntry(out, e);
+  if (links.empty())
+    return;
+
+  // A link pins a segment's bytes even once PageIn() is done with it; until
+  // then segment files stay put, so each one named above is still there
+  ++saving_;
+  lock.unlock();
+  std::error_code ec;
+  std::filesystem::create_directories(tail_dir, ec);
+  for (const auto& [path, file] : links) {
+    std::filesystem::remove(tail_dir / file, ec);
+    std::filesystem::create_hard_link(path, tail_dir / file, ec);
+    if (ec) {
+      std::filesystem::copy_file(
+        path, tail_dir / file,
+        std::filesystem::copy_options::overwrite_existing, ec);
+    }
+    if (ec) {
+      logr::error << "[Frontier] cannot save " << path << " to " << tail_dir
+                  << ": " << ec.message();
+    }
+  }
+  lock.lock();
+  std::vector<std::filesystem::path> unused;
+  if (--saving_ == 0)
+    unused.swap(unused_);
+  lock.unlock();
+  for (const auto& path : unused)
+    std::filesystem::remove(path, ec);
+}
+
+bool Frontier::Load(std::string_view in,
+                    const std::filesystem::path& tail_dir) {
+  struct LoadedSegment {
+    std::filesystem::path file;  // in tail_dir; empty if nothing written
+    std::uint64_t bytes{0};
+    std::uint64_t count{0};
+    Rank best;
+    std::string pending;
+  };
+  struct LoadedHost {
+    std::string name;
+    std::int64_t ready_in_ms{0};
+    std::vector<Entry> entries;
+    std::vector<LoadedSegment> segments;
+  };
+  struct LoadedDelayed {
+    std::int64_t due_in_ms{0};
+    std::string host;
+    Entry entry;
+  };
+
+  // Decode everything before touching the frontier
+  Reader r(in);
+  constexpr size_t kMinEntry = 8 + 8 + 4 + 8 + 8 + 4;
+  std::uint64_t seq, n;
+  if (!r.Get(seq) || !r.GetCount(n, sizeof(std::uint64_t)))
+    return false;
+  std::vector<std::uint64_t> seen(n);
+  for (auto& id : seen) {
+    if (!r.Get(id))
+      return false;
+  }
+
+  std::vector<LoadedHost> hosts;
+  if (!r.GetCount(n, 8 + 8 + 8 + 8))
+    return false;
+  hosts.resize(n);
+  for (auto& h : hosts) {
+    std::string_view name;
+    std::uint64_t entries, segments;
+    if (!r.GetString(name) || !r.Get(h.ready_in_ms) ||
+        !r.GetCount(entries, kMinEntry))
+      return false;
+    h.name.assign(name);
+    h.entries.resize(entries);
+    for (auto& e : h.entries) {
+      if (!r.GetEntry(e))
+        return false;
+    }
+    if (!r.GetCount(segments, 8 + 8 + 8 + 8 + 8 + 8))
+      return false;
+    h.segments.resize(segments);
+    for (auto& seg : h.segments) {
+      std::string_view file, pending;
+      if (!r.GetString(file) || !r.Get(seg.bytes) || !r.Get(seg.count) ||
+          !r.Get(seg.best.score) || !r.Get(seg.best.seq) ||
+          !r.GetString(pending))
+        return false;
+      seg.pending.assign(pending);
+      if (seg.bytes == 0)
+        continue;
+      if (file.empty() || tail_dir.empty())
+        return false;
+      // only the length is checked: the lines are read when paged in
+      seg.file = tail_dir / file;
+      std::error_code ec;
+      const auto size = std::filesystem::file_size(seg.file, ec);
+      if (ec || size < seg.bytes) {
+        logr::warning << "[Frontier] missing or short segment " << seg.file;
+        return false;
+      }
+    }
+  }
+
+  std::vector<LoadedDelayed> delayed;
+  if (!r.GetCount(n, 8 + 8 + kMinEntry))
+    return false;
+  delayed.resize(n);
+  for (auto& d : delayed) {
+    std::string_view host;
+    if (!r.Get(d.due_in_ms) || !r.GetString(host) || !r.GetEntry(d.entry))
+      return false;
+    d.host.assign(host);
+  }
+
+  std::vector<std::pair<std::string, Entry>> leased;  // host, entry
+  if (!r.GetCount(n, kMinEntry))
+    return false;
+  leased.resize(n);
+  for (auto& [host, e] : leased) {
+    if (!r.GetEntry(e))
+      return false;
+    host = URL(e.url).GetHost();
+  }
+  if (!r.Done())
+    return false;
+
+  // Link the snapshot's segments into the spill dir as each host's tail;
+  // Pop() reads them as it would any other. A frontier that cannot spill
+  // reads them back now instead.
+  std::vector<std::vector<Segment>> tails(hosts.size());
+  std::vector<std::filesystem::path> linked;
+  auto unlink_all = [&] {
+    std::error_code ec;
+    for (const auto& path : linked)
+      std::filesystem::remove(path, ec);
+  };
+  for (size_t i = 0; i < hosts.size(); ++i) {
+    auto& h = hosts[i];
+    if (h.segments.empty())
+      continue;
+    const auto dir = spill_dir_ / HostDirName(h.name);
+    std::error_code ec;
+    if (!spill_dir_.empty())
+      std::filesystem::create_directories(dir, ec);
+    for (size_t k = 0; k < h.segments.size(); ++k) {
+      auto& loaded = h.segments[k];
+      Segment seg;
+      seg.count = loaded.count;
+      seg.bytes = loaded.bytes;
+      seg.best = loaded.best;
+      seg.pending = std::move(loaded.pending);
+      seg.adopted = true;
+      if (spill_dir_.empty()) {
+        seg.path = loaded.file;
+        auto entries = ReadSegment(seg);
+        std::move(entries.begin(), entries.end(),
+                  std::back_inserter(h.entries));
+        continue;
+      }
+      seg.path = dir / (std::to_string(k) + ".seg");
+      if (seg.bytes > 0) {
+        std::filesystem::remove(seg.path, ec);
+        std::filesystem::create_hard_link(loaded.file, seg.path, ec);
+        if (ec) {
+          std::filesystem::copy_file(
+            loaded.file, seg.path,
+            std::filesystem::copy_options::overwrite_existing, ec);
+        }
+        if (ec) {
+          logr::warning << "[Frontier] cannot adopt " << loaded.file << ": "
+                        << ec.message();
+          unlink_all();
+          return false;
+        }
+        linked.push_back(seg.path);
+      }
+      tails[i].push_back(std::move(seg));
+    }
+  }
+
+  const auto now = Clock::now();
+  std::lock_guard<std::mutex> lock(mtx_);
+  seq_ = std::max(seq_, seq);
+  for (const auto id : seen)
+    seen_.Insert(id);
+  // Entries keep their seq, so FIFO order among equal scores holds across
+  // the head, the tail and retries. Tails go in first: a head that overflows
+  // spills behind them, into new segments.
+  for (size_t i = 0; i < hosts.size(); ++i) {
+    auto& h = hosts[i];
+    auto& host = hosts_[h.name];
+    host.ready_at = std::max(host.ready_at,
+                             now + std::chrono::milliseconds(h.ready_in_ms));
+    for (auto& seg : tails[i]) {
+      size_ += seg.count;
+      host.tail.push_back(std::move(seg));
+    }
+    host.next_segment = std::max<std::uint64_t>(host.next_segment,
+                                                host.tail.size());
+    if (!host.tail.empty())
+      host.tail_best = host.tail[BestSegment(host)].best;
+    for (auto& e : h.entries) {
+      Enqueue(h.name, host, std::move(e));
+      ++size_;
+    }
+  }
+  // in progress when the snapshot was taken: pending again, ranked by score
+  // like the rest, their early seq only winning ties
+  for (auto& [host, e] : leased) {
+    Enqueue(host, hosts_[host], std::move(e));
+    ++size_;
+  }
+  for (auto& d : delayed) {
+    delayed_.push_back({now + std::chrono::milliseconds(d.due_in_ms),
+                        std::move(d.host), std::move(d.entry)});
+    std::push_heap(delayed_.begin(), delayed_.end(), Later);
+    ++size_;
+  }
+  return true;
+}
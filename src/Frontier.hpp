@@ -0,0 +1,218 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "URL.hpp"
+
+// Pending URLs for one crawl domain, bucketed by host. Each host keeps a
+// max-min heap over a vector ordered by Score(): its best and its lowest
+// entry are both at hand, Pop() is O(log n) per host and entries stay
+// compact at millions of URLs. Thread-safe; URLs are de-duplicated by
+// URL::GetID() for the frontier's lifetime.
+//
+// The de-duplication set is exact and is the one part of the frontier that
+// grows with the crawl rather than with what is pending: an open-addressed
+// table of ids, 8 to 16 bytes per URL ever pushed, written whole into every
+// snapshot. The head limit below bounds everything else.
+//
+// When constructed with a spill directory, each host's heap (the "head") is
+// capped at `head_limit` entries: a push to a full head spills whichever
+// ranks lower, the newcomer or the head's lowest, to a segmented on-disk tail
+// (<spill_dir>/<host>/<n>.seg). Each segment remembers its best entry. Pop()
+// pages in the segment holding the tail's best whenever that outranks the
+// head's best, and again as the head drains below half its limit, so a host
+// always offers its best entry. Segments are read with the lock released.
+//
+// Retry() holds an entry aside until its not_before time, then returns it to
+// its host's heap; held entries count towards Size().
+//
+// A popped entry stays leased until Complete() or Retry(), so Save() can
+// write out everything not yet finished: pending, delayed and leased entries,
+// host deferrals and the de-duplication set. Load() puts that state back into
+// a fresh frontier, leased entries becoming pending again. Tail segments are
+// not copied into a snapshot; Save() hard-links them into a directory of the
+// caller's and records their names, lengths, counts and best entries, and
+// Load() links them back in as each host's tail without reading them.
+class Frontier {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // Score penalty per link hop away from a seed
+  static constexpr double kDepthPenalty = 1.0;
+
+  // Pending tail bytes per host before they are written out
+  static constexpr size_t kTailBufferBytes = 64 * 1024;
+
+  struct Entry {
+    std::string url;
+    double priority{0};        // optional `priority` from the Lua result
+    std::uint32_t depth{0};    // link distance from a seed
+    std::uint64_t parent{0};   // URL::GetID() of the discovering page
+    std::uint64_t seq{0};      // insertion order; FIFO among equal scores
+    std::uint32_t attempt{0};  // failed fetches so far
+  };
+
+  /// Unbounded, memory-only frontier
+  Frontier() = default;
+
+  /// Spill beyond `head_limit` entries per host into `spill_dir`, which is
+  /// emptied first
+  Frontier(const std::filesystem::path& spill_dir, size_t head_limit);
+
+  Frontier(const Frontier&) = delete;
+  Frontier& operator=(const Frontier&) = delete;
+
+  /// Queue a URL; returns false if it was already seen
+  bool Push(const URL& url, double priority = 0, std::uint32_t depth = 0,
+            std::uint64_t parent = 0);
+
+  /// Re-queue a popped entry (bypassing de-duplication) once `not_before`
+  /// has passed; used to retry failed fetches without blocking a worker
+  void Retry(Entry entry, Clock::time_point not_before);
+
+  /// Highest-scoring entry among hosts that are ready at `now`
+  std::optional<Entry> Pop(Clock::time_point now = Clock::now());
+
+  /// Release a popped entry that will not come back through Retry()
+  void Complete(const Entry& entry);
+
+  /// Hold back every entry for `host` until `until`
+  void Defer(const std::string& host, Clock::time_point until);
+
+  /// Remove and return every entry waiting for `host` (queued, spilled or
+  /// delayed) and lift its deferral; leased entries and the seen set are
+  /// left alone
+  std::vector<Entry> Drain(const std::string& host);
+
+  /// Earliest time a deferred host or retry becomes ready (nullopt if empty)
+  std::optional<Clock::time_point> NextReadyTime() const;
+
+  size_t Size() const;
+  bool Empty() const;
+
+  /// Append a binary snapshot of the frontier to `out`. Spilled segments go
+  /// into `tail_dir` as hard links (copies if linking fails), made with the
+  /// lock released, so saving reads nothing from disk and holds up no
+  /// worker; a frontier that has spilled needs one.
+  void Save(std::string& out, const std::filesystem::path& tail_dir = {}) const;
+
+  /// Restore a snapshot written by Save() into this (empty) frontier, with
+  /// the segments it names in `tail_dir`; false, with nothing changed, if
+  /// `in` is malformed or a segment is missing or short
+  bool Load(std::string_view in, const std::filesystem::path& tail_dir = {});
+
+  static double Score(const Entry& e) {
+    return e.priority - kDepthPenalty * static_cast<double>(e.depth);
+  }
+
+ private:
+  // Score() with seq to break ties
+  struct Rank {
+    double score{0};
+    std::uint64_t seq{0};
+  };
+  static Rank RankOf(const Entry& e) {
+    return {Score(e), e.seq};
+  }
+  static bool Below(Rank a, Rank b);
+
+  struct Segment {
+    std::filesystem::path path;
+    size_t count{0};
+    size_t bytes{0};      // written out so far
+    std::string pending;  // lines not written out, once off the tail
+    Rank best;            // of the entries written to it
+    bool adopted{false};  // linked in by Load(): never appended to
+  };
+
+  struct Host {
+    std::vector<Entry> heap;
+    Clock::time_point ready_at{};
+
+    // on-disk tail; the back segment is the one being appended to
+    std::deque<Segment> tail;
+    std::string tail_buffer;  // appended lines not yet written out
+    std::uint64_t next_segment{0};
+    Rank tail_best;               // best of every segment, if any
+    std::vector<Segment> paging;  // off the tail, being read by a Pop()
+  };
+
+  // A retry waiting for its not_before time
+  struct Delayed {
+    Clock::time_point not_before;
+    std::string host;
+    Entry entry;
+  };
+
+  // URL ids seen so far, in an open-addressed table kept at most half full
+  class IdSet {
+   public:
+    /// false if `id` was already there
+    bool Insert(std::uint64_t id);
+    size_t Size() const {
+      return size_;
+    }
+    template <typename F>
+    void ForEach(F f) const {
+      if (zero_)
+        f(std::uint64_t{0});
+      for (const auto id : slots_) {
+        if (id != 0)
+          f(id);
+      }
+    }
+
+   private:
+    void Grow();
+
+    std::vector<std::uint64_t> slots_;  // 0: empty; power-of-two size
+    bool zero_{false};                  // id 0 has no slot of its own
+    size_t size_{0};
+  };
+
+  // heap comparator: "a ranks below b"
+  static bool Lower(const Entry& a, const Entry& b);
+  // delayed_ comparator: "a is due after b"
+  static bool Later(const Delayed& a, const Delayed& b);
+
+  void HeapPush(Host& host, Entry entry);
+  void Enqueue(const std::string& name, Host& host, Entry entry);
+  void Spill(const std::string& name, Host& host, const Entry& entry);
+  void FlushTail(Host& host);
+  static size_t BestSegment(const Host& host);
+  static Segment TakeSegment(Host& host);
+  static std::vector<Entry> ReadSegment(const Segment& seg);
+  // Read `segments` with mtx_ released, then queue their entries; `lock`
+  // holds mtx_ on entry and on return
+  void PageIn(std::unique_lock<std::mutex>& lock,
+              std::vector<std::pair<std::string, Segment>> segments);
+  // Delete segment files once no Save() is linking; called without mtx_
+  void RemoveSegments(std::vector<std::filesystem::path> paths);
+  void ReleaseDelayed(Clock::time_point now);
+
+  std::filesystem::path spill_dir_;
+  size_t head_limit_{0};  // 0: never spill
+  size_t segment_limit_{0};
+
+  mutable std::mutex mtx_;
+  std::unordered_map<std::string, Host> hosts_;
+  IdSet seen_;
+  std::vector<Delayed> delayed_;  // min-heap on not_before
+  std::unordered_map<std::uint64_t, Entry> leased_;  // popped, by seq
+  // Save() calls linking segments with mtx_ released, and the segment files
+  // paged in or drained meanwhile
+  mutable unsigned saving_{0};
+  mutable std::vector<std::filesystem::path> unused_;
+  std::uint64_t seq_{0};
+  size_t size_{0};
+};
@@ -1,94 +1,252 @@
 #include "HttpResponse.hpp"
 #include <algorithm>
-#include <cctype>
+#include <array>
+#include <charconv>
 
-void HttpResponse::AddHeaderLine(const std::string& line) {
+namespace {
+// Bodies are sized from Content-Length up to this; a larger or compressed
+// body grows as it arrives
+constexpr size_t kMaxReserve = 8 << 20;
+
+// In enum order
+constexpr std::array<std::string_view, HttpResponse::kKnownHeaders> kNames = {
+  "Age",           "Cache-Control", "Content-Encoding", "Content-Language",
+  "Content-Length", "Content-Type", "Date",             "ETag",
+  "Expires",       "Last-Modified", "Link",             "Location",
+  "Retry-After",   "Server",        "Set-Cookie",       "Transfer-Encoding",
+  "Vary",          "X-Robots-Tag"};
+
+char Lower(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c;
+}
+
+bool EqualsNoCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() &&
+         std::equal(a.begin(), a.end(), b.begin(),
+                    [](char x, char y) { return Lower(x) == Lower(y); });
+}
+
+// FNV-1a over the lower-cased name
+std::uint64_t HashNoCase(std::string_view s) {
+  std::uint64_t h = 14695981039346656037ull;
+  for (const char c : s) {
+    h ^= static_cast<unsigned char>(Lower(c));
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+std::string_view Trim(std::string_view s) {
+  const auto l = s.find_first_not_of(" \t\r\n");
+  if (l == std::string_view::npos)
+    return {};
+  const auto r = s.find_last_not_of(" \t\r\n");
+  return s.substr(l, r - l + 1);
+}
+}  // namespace
+
+HttpResponse::Header HttpResponse::Intern(std::string_view name) {
+  for (size_t i = 0; i < kNames.size(); ++i) {
+    if (EqualsNoCase(name, kNames[i]))
+      return static_cast<Header>(i);
+  }
+  return Header::Other;
+}
+
+std::string_view HttpResponse::Name(Header h) {
+  return h == Header::Other ? std::string_view{}
+                            : kNames[static_cast<size_t>(h)];
+}
+
+HttpResponse::HttpResponse(std::pmr::memory_resource* mr)
+    : fields_buf_{mr},
+      fields_{mr},
+      other_{mr},
+      body_{mr},
+      raw_headers_{mr},
+      raw_request_{mr} {
+  known_.fill(kNone);
+}
+
+void HttpResponse::AddHeaderLine(std::string_view line) {
   auto colon = line.find(':');
-  if (colon == std::string::npos)
+  if (colon == std::string_view::npos)
     return;  // skip non‑header lines
 
-  std::string name = line.substr(0, colon);
-  std::string value = line.substr(colon + 1);
+  const std::string_view name = Trim(line.substr(0, colon));
+  const std::string_view value = Trim(line.substr(colon + 1));
+  if (fields_.empty()) {
+    fields_buf_.reserve(1024);
+    fields_.reserve(32);
+  }
+
+  const auto at = static_cast<std::uint32_t>(fields_buf_.size());
+  Field f{.id = Intern(name),
+          .name = at,
+          .name_len = static_cast<std::uint32_t>(name.size()),
+          .value = at + static_cast<std::uint32_t>(name.size()),
+          .value_len = static_cast<std::uint32_t>(value.size())};
+  fields_buf_.append(name);
+  fields_buf_.append(value);
+
+  const auto index = static_cast<std::uint32_t>(fields_.size());
+  std::uint32_t& head = f.id == Header::Other
+                          ? Slot(name)
+                          : known_[static_cast<size_t>(f.id)];
+  if (head == kNone) {
+    head = index;
+    f.last = index;
+    if (f.id == Header::Other)
+      ++other_names_;
+  } else {
+    fields_[fields_[head].last].next = index;
+    fields_[head].last = index;
+  }
+  fields_.push_back(f);
+
+  if (f.id == Header::ContentLength) {
+    size_t n = 0;
+    const auto [end, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), n);
+    if (ec == std::errc{} && end == value.data() + value.size())
+      body_.reserve(body_.size() + std::min(n, kMaxReserve));
+  }
+}
 
-  // trim leading/trailing whitespace
-  auto trim = [](std::string& s) {
-    auto l = s.find_first_not_of(" \t\r\n");
-    auto r = s.find_last_not_of(" \t\r\n");
-    if (l == std::string::npos) {
-      s.clear();
-      return;
-    }
-    s = s.substr(l, r - l + 1);
-  };
-  trim(name);
-  trim(value);
+std::string_view HttpResponse::NameOf(const Field& f) const {
+  return std::string_view(fields_buf_).substr(f.name, f.name_len);
+}
 
-  headers_.emplace_back(std::move(name), std::move(value));
+std::string_view HttpResponse::ValueOf(const Field& f) const {
+  return std::string_view(fields_buf_).substr(f.value, f.value_len);
+}
+
+// Index of the slot holding `name`'s first field, or of the free slot it
+// would take; the table must not be empty
+size_t HttpResponse::Probe(std::string_view name) const {
+  const size_t mask = other_.size() - 1;
+  size_t i = HashNoCase(name) & mask;
+  while (other_[i] != kNone && !EqualsNoCase(NameOf(fields_[other_[i]]), name))
+    i = (i + 1) & mask;
+  return i;
+}
+
+// As Probe(), keeping the table at most half full
+std::uint32_t& HttpResponse::Slot(std::string_view name) {
+  if ((other_names_ + 1) * 2 > other_.size())
+    Rehash();
+  return other_[Probe(name)];
+}
+
+void HttpResponse::Rehash() {
+  std::pmr::vector<std::uint32_t> old(std::max<size_t>(16, other_.size() * 2),
+                                      kNone, other_.get_allocator());
+  old.swap(other_);
+  const size_t mask = other_.size() - 1;
+  for (const auto head : old) {
+    if (head == kNone)
+      continue;
+    size_t i = HashNoCase(NameOf(fields_[head])) & mask;
+    while (other_[i] != kNone)
+      i = (i + 1) & mask;
+    other_[i] = head;
+  }
+}
+
+std::uint32_t HttpResponse::First(Header id, std::string_view name) const {
+  if (id != Header::Other)
+    return known_[static_cast<size_t>(id)];
+  return other_.empty() ? kNone : other_[Probe(name)];
+}
+
+void HttpResponse::AddRawHeaderLine(const char* data, size_t len) {
+  if (len >= 5 && std::equal(data, data + 5, "HTTP/"))
+    raw_headers_.clear();
+  raw_headers_.append(data, len);
+}
+
+std::string_view HttpResponse::GetRawHeaders() const {
+  return raw_headers_;
+}
+
+void HttpResponse::SetRawRequest(std::string_view request) {
+  raw_request_.assign(request);
+}
+
+std::string_view HttpResponse::GetRawRequest() const {
+  return raw_request_;
 }
 
 void HttpResponse::AppendBody(const char* data, size_t len) {
   body_.append(data, len);
 }
 
-std::optional<std::string> HttpResponse::GetHeader(
-  const std::string& key) const {
-  auto lowercase = [](std::string s) {
-    std::transform(s.begin(), s.end(), s.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
-    return s;
-  };
-  std::string want = lowercase(key);
-  for (auto const& [name, val] : headers_) {
-    if (lowercase(name) == want) {
-      return val;
-    }
-  }
-  return std::nullopt;
-}
-
-std::vector<std::string> HttpResponse::GetHeaders(
-  const std::string& key) const {
-  std::vector<std::string> out;
-  auto lowercase = [](std::string s) {
-    std::transform(s.begin(), s.end(), s.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
-    return s;
-  };
-  std::string want = lowercase(key);
-  for (auto const& [name, val] : headers_) {
-    if (lowercase(name) == want) {
-      out.push_back(val);
-    }
-  }
+std::optional<std::string_view> HttpResponse::GetHeader(Header key) const {
+  if (key == Header::Other)
+    return std::nullopt;
+  const auto first = known_[static_cast<size_t>(key)];
+  if (first == kNone)
+    return std::nullopt;
+  return ValueOf(fields_[first]);
+}
+
+std::optional<std::string_view> HttpResponse::GetHeader(
+  std::string_view key) const {
+  const auto first = First(Intern(key), key);
+  if (first == kNone)
+    return std::nullopt;
+  return ValueOf(fields_[first]);
+}
+
+std::vector<std::string_view> HttpResponse::GetHeaders(Header key) const {
+  std::vector<std::string_view> out;
+  if (key == Header::Other)
+    return out;
+  for (auto i = known_[static_cast<size_t>(key)]; i != kNone;
+       i = fields_[i].next)
+    out.push_back(ValueOf(fields_[i]));
+  return out;
+}
+
+std::vector<std::string_view> HttpResponse::GetHeaders(
+  std::string_view key) const {
+  std::vector<std::string_view> out;
+  for (auto i = First(Intern(key), key); i != kNone; i = fields_[i].next)
+    out.push_back(ValueOf(fields_[i]));
   return out;
 }
 
-const std::vector<std::pair<std::string, std::string>>&
+std::vector<std::pair<std::string_view, std::string_view>>
 HttpResponse::GetHeaders() const {
-  return headers_;
+  std::vector<std::pair<std::string_view, std::string_view>> out;
+  out.reserve(fields_.size());
+  for (const auto& f : fields_)
+    out.emplace_back(NameOf(f), ValueOf(f));
+  return out;
 }
 
-const std::string& HttpResponse::GetBody() const {
+std::string_view HttpResponse::GetBody() const {
   return body_;
 }
 
 void HttpResponse::SetStatusCode(long http_status) {
   status_code_ = http_status;
-  headers_.emplace_back("X-HTTP-Status", std::to_string(status_code_));
 }
 
 void HttpResponse::SetRedirectCount(long count) {
   redirect_count_ = count;
-  headers_.emplace_back("X-Redirect-Count", std::to_string(redirect_count_));
 }
 
 /// Set the effective URL (after any redirects)
 void HttpResponse::SetEffectiveUrl(const std::string url) {
   effective_url_ = std::make_unique<URL>(url);
-  headers_.emplace_back("X-Effective-URL", effective_url_->ToString());
 }
 
 /// Get the number of redirects
+long HttpResponse::GetStatusCode() const {
+  return status_code_;
+}
+
 long HttpResponse::GetRedirectCount() const {
   return redirect_count_;
 }
@@ -98,6 +256,10 @@ const URL& HttpResponse::GetEffectiveUrl() const {
   return *effective_url_.get();
 }
 
+bool HttpResponse::HasEffectiveUrl() const {
+  return effective_url_ != nullptr;
+}
+
 const bool HttpResponse::IsOkay() const {
   return status_code_ >= 200 && status_code_ < 300;
 }
@@ -1,7 +1,11 @@
 #pragma once
 
 #include "URL.hpp"
+#include <array>
+#include <cstdint>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <utility>
@@ -9,25 +13,75 @@
 
 class HttpResponse {
  public:
-  HttpResponse() = default;
-
-  /// Parse one raw header line (e.g. "Content-Type: text/html")
-  void AddHeaderLine(const std::string& line);
+  // Header names the crawler reads, interned when a line is added so that
+  // looking one up is an array index; any other name is Header::Other
+  enum class Header : std::uint8_t {
+    Age,
+    CacheControl,
+    ContentEncoding,
+    ContentLanguage,
+    ContentLength,
+    ContentType,
+    Date,
+    ETag,
+    Expires,
+    LastModified,
+    Link,
+    Location,
+    RetryAfter,
+    Server,
+    SetCookie,
+    TransferEncoding,
+    Vary,
+    XRobotsTag,
+    Other
+  };
+  static constexpr size_t kKnownHeaders = static_cast<size_t>(Header::Other);
+
+  /// The well-known header `name` names (case-insensitive), or Other
+  static Header Intern(std::string_view name);
+
+  /// Canonical spelling of a well-known header ("" for Other)
+  static std::string_view Name(Header h);
+
+  /// Body, headers and raw blocks are allocated from `mr`; the crawler
+  /// passes the page's arena so they all go at once when the page is done
+  explicit HttpResponse(
+    std::pmr::memory_resource* mr = std::pmr::get_default_resource());
+
+  /// Parse one raw header line (e.g. "Content-Type: text/html"); a
+  /// Content-Length sizes the body up front
+  void AddHeaderLine(std::string_view line);
+
+  /// Keep the raw header block of the final response: a status line starts
+  /// a new block, dropping those of interim and redirect responses
+  void AddRawHeaderLine(const char* data, size_t len);
+
+  /// The final response's status line and headers as received, ending in
+  /// the blank line
+  std::string_view GetRawHeaders() const;
+
+  /// The request line and headers sent for the final response
+  void SetRawRequest(std::string_view request);
+  std::string_view GetRawRequest() const;
 
   /// Append to the response body
   void AppendBody(const char* data, size_t len);
 
   /// Return the first header value matching `key` (case‑insensitive)
-  std::optional<std::string> GetHeader(const std::string& key) const;
+  std::optional<std::string_view> GetHeader(Header key) const;
+  std::optional<std::string_view> GetHeader(std::string_view key) const;
 
-  /// Return all header values matching `key` (case‑insensitive)
-  std::vector<std::string> GetHeaders(const std::string& key) const;
+  /// Return all header values matching `key` (case‑insensitive), in order
+  std::vector<std::string_view> GetHeaders(Header key) const;
+  std::vector<std::string_view> GetHeaders(std::string_view key) const;
 
   /// The accumulated body text
-  const std::string& GetBody() const;
+  std::string_view GetBody() const;
 
-  /// All parsed header (name,value) pairs in order received
-  const std::vector<std::pair<std::string, std::string>>& GetHeaders() const;
+  /// All parsed header (name,value) pairs in order received, names as sent
+  std::vector<std::pair<std::string_view, std::string_view>> GetHeaders()
+    const;
 
   /// Set the HTTP status code
   void SetStatusCode(long http_status);
@@ -38,12 +92,18 @@ class HttpResponse {
   /// Set the effective URL (after any redirects)
   void SetEffectiveUrl(const std::string url);
 
+  /// Get the HTTP status code (0 if none was received)
+  long GetStatusCode() const;
+
   /// Get the number of redirects
   long GetRedirectCount() const;
 
   /// Get the effective URL
   const URL& GetEffectiveUrl() const;
 
+  /// An effective URL was set
+  bool HasEffectiveUrl() const;
+
   /// HTTP status code is 200 to 299
   const bool IsOkay() const;
 
@@ -51,8 +111,36 @@ class HttpResponse {
   const bool IsRedirect() const;
 
  private:
-  std::vector<std::pair<std::string, std::string>> headers_;
-  std::string body_;
+  static constexpr std::uint32_t kNone = ~std::uint32_t{0};
+
+  // One header line; name and value are offsets into fields_buf_. Fields of
+  // one name are chained in arrival order; the first also knows the last.
+  struct Field {
+    Header id;
+    std::uint32_t name, name_len;
+    std::uint32_t value, value_len;
+    std::uint32_t next{kNone};
+    std::uint32_t last{kNone};
+  };
+
+  std::string_view NameOf(const Field& f) const;
+  std::string_view ValueOf(const Field& f) const;
+  std::uint32_t First(Header id, std::string_view name) const;
+  size_t Probe(std::string_view name) const;
+  std::uint32_t& Slot(std::string_view name);
+  void Rehash();
+
+  std::pmr::string fields_buf_;  // names and values, back to back
+  std::pmr::vector<Field> fields_;
+  std::array<std::uint32_t, kKnownHeaders> known_;  // first field, by name
+  // first field of each other name, open addressing on a case-insensitive
+  // hash; kNone marks a free slot
+  std::pmr::vector<std::uint32_t> other_;
+  size_t other_names_{0};
+
+  std::pmr::string body_;
+  std::pmr::string raw_headers_;
+  std::pmr::string raw_request_;
   long status_code_{0};
   long redirect_count_{0};
   std::unique_ptr<URL> effective_url_;
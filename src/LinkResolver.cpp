@@ -0,0 +1,201 @@
+#include "LinkResolver.hpp"
+
+namespace {
+bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+bool IsAlpha(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool IsSchemeChar(char c) {
+  return IsAlpha(c) || (c >= '0' && c <= '9') || c == '+' || c == '-' ||
+         c == '.';
+}
+
+bool EqualsNoCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    char c = a[i];
+    if (c >= 'A' && c <= 'Z')
+      c = static_cast<char>(c + 32);
+    if (c != b[i])
+      return false;
+  }
+  return true;
+}
+
+// Split "authority/path?query#fragment" (what follows "//")
+struct Parts {
+  std::string_view authority, path, query, fragment;  // query keeps '?'
+};
+
+Parts Split(std::string_view s) {
+  Parts p;
+  const auto auth_end = s.find_first_of("/?#");
+  p.authority = s.substr(0, auth_end);
+  s.remove_prefix(p.authority.size());
+  p.path = s.substr(0, s.find_first_of("?#"));
+  s.remove_prefix(p.path.size());
+  p.query = s.substr(0, s.find('#'));
+  s.remove_prefix(p.query.size());
+  p.fragment = s;
+  return p;
+}
+}  // namespace
+
+LinkResolver::LinkResolver(const Canonicalizer* canon) : canon_{canon} {
+}
+
+void LinkResolver::Reset(std::string_view base) {
+  base_.assign(base);
+  scheme_ = authority_ = path_ = query_ = {};
+  const auto sep = std::string_view(base_).find("://");
+  if (sep == std::string_view::npos)
+    return;
+  const Parts parts = Split(std::string_view(base_).substr(sep + 3));
+  scheme_ = std::string_view(base_).substr(0, sep);
+  authority_ = parts.authority;
+  path_ = parts.path;
+  query_ = parts.query;
+}
+
+const std::vector<LinkResolver::Link>& LinkResolver::Resolve(
+  std::span<const std::string_view> refs) {
+  arena_.clear();
+  spans_.clear();
+  spans_.reserve(refs.size());
+  for (const auto ref : refs) {
+    Span span{};
+    const size_t start = arena_.size();
+    if (!ResolveInto(ref, arena_)) {
+      arena_.resize(start);
+      spans_.push_back(span);
+      continue;
+    }
+    span.raw = span.url = start;
+    span.raw_len = span.url_len = arena_.size() - start;
+    if (canon_ && canon_->Enabled()) {
+      const size_t at = arena_.size();
+      // reads the raw form from the arena while appending to it
+      scratch_.assign(arena_, start, span.raw_len);
+      canon_->Canonicalize(scratch_, arena_);
+      const std::string_view raw(arena_.data() + start, span.raw_len);
+      if (raw == std::string_view(arena_).substr(at)) {
+        arena_.resize(at);  // already canonical: share the bytes
+      } else {
+        span.url = at;
+        span.url_len = arena_.size() - at;
+      }
+    }
+    spans_.push_back(span);
+  }
+
+  links_.clear();
+  links_.reserve(spans_.size());
+  const std::string_view arena = arena_;
+  for (const auto& s : spans_)
+    links_.push_back({arena.substr(s.url, s.url_len),
+                      arena.substr(s.raw, s.raw_len)});
+  return links_;
+}
+
+bool LinkResolver::ResolveInto(std::string_view ref, std::string& out) {
+  while (!ref.empty() && IsSpace(ref.front()))
+    ref.remove_prefix(1);
+  while (!ref.empty() && IsSpace(ref.back()))
+    ref.remove_suffix(1);
+
+  // scheme ":" ...
+  size_t colon = 0;
+  if (!ref.empty() && IsAlpha(ref[0])) {
+    while (colon < ref.size() && IsSchemeChar(ref[colon]))
+      ++colon;
+    if (colon == ref.size() || ref[colon] != ':')
+      colon = 0;
+  }
+
+  std::string_view scheme = scheme_;
+  if (colon > 0) {
+    scheme = ref.substr(0, colon);
+    if (!EqualsNoCase(scheme, "http") && !EqualsNoCase(scheme, "https"))
+      return false;  // mailto:, javascript:, data:, ...
+    ref.remove_prefix(colon + 1);
+    if (ref.substr(0, 2) != "//")
+      return false;  // "http:path" has no host to go to
+  }
+  if (scheme.empty())
+    return false;  // no usable base
+
+  // network-path reference: everything but the scheme comes from `ref`
+  if (ref.substr(0, 2) == "//") {
+    const Parts p = Split(ref.substr(2));
+    if (p.authority.empty())
+      return false;
+    out.append(scheme).append("://").append(p.authority);
+    if (!p.path.empty())
+      AppendPath({}, p.path, out);
+    out.append(p.query).append(p.fragment);
+    return true;
+  }
+
+  const auto frag_at = ref.find('#');
+  const std::string_view fragment =
+    frag_at == std::string_view::npos ? std::string_view{}
+                                      : ref.substr(frag_at);
+  ref = ref.substr(0, frag_at);
+  const auto query_at = ref.find('?');
+  const std::string_view query =
+    query_at == std::string_view::npos ? std::string_view{}
+                                       : ref.substr(query_at);
+  const std::string_view path = ref.substr(0, query_at);
+
+  out.append(scheme).append("://").append(authority_);
+  if (path.empty()) {
+    out.append(path_.empty() ? std::string_view("/") : path_);
+    out.append(query.empty() ? query_ : query);
+  } else {
+    if (path[0] == '/')
+      AppendPath({}, path, out);
+    else if (path_.empty())
+      AppendPath("/", path, out);
+    else
+      AppendPath(path_.substr(0, path_.rfind('/') + 1), path, out);
+    out.append(query);
+  }
+  out.append(fragment);
+  return true;
+}
+
+// RFC 3986 remove_dot_segments of dir + path, appended to `out`. Segments are
+// pushed onto and popped off the end of `out` itself, so nothing is allocated
+// once the buffers have grown.
+void LinkResolver::AppendPath(std::string_view dir, std::string_view path,
+                              std::string& out) {
+  scratch_.assign(dir).append(path);
+  std::string_view rest = scratch_;
+  if (!rest.empty() && rest.front() == '/')
+    rest.remove_prefix(1);
+  const size_t root = out.size();
+  for (;;) {
+    const auto slash = rest.find('/');
+    const std::string_view seg = rest.substr(0, slash);
+    const bool last = slash == std::string_view::npos;
+    if (seg == "." || seg == "..") {
+      if (seg == ".." && out.size() > root)
+        out.resize(out.rfind('/'));
+      if (last)
+        out += '/';
+    } else {
+      out += '/';
+      out.append(seg);
+    }
+    if (last)
+      break;
+    rest.remove_prefix(slash + 1);
+  }
+  if (out.size() == root)
+    out += '/';
+}
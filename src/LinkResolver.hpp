@@ -0,0 +1,62 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Canonicalizer.hpp"
+
+// Resolves a page's links as one batch. The base URL is split once per page;
+// each reference is resolved per RFC 3986 section 5.2 (dot segments removed,
+// empty segments and trailing slashes kept) straight into a single arena
+// string, then canonicalized when a Canonicalizer is given. The arena keeps
+// its capacity across pages, so a parse worker stops allocating per link
+// once it has seen its largest page.
+//
+// Results are views into the arena, index-aligned with the input and valid
+// until the next Reset() or Resolve(). A reference to a scheme other than
+// http or https (mailto:, javascript:, data:, ...) resolves to empty views.
+// Not thread-safe: one resolver per worker.
+class LinkResolver {
+ public:
+  struct Link {
+    std::string_view url;  // canonical (or resolved, without a canonicalizer)
+    std::string_view raw;  // resolved, before canonicalization
+  };
+
+  explicit LinkResolver(const Canonicalizer* canon = nullptr);
+  LinkResolver(const LinkResolver&) = delete;
+  LinkResolver& operator=(const LinkResolver&) = delete;
+
+  /// Resolve against `base` (an absolute http or https URL) from now on
+  void Reset(std::string_view base);
+
+  const std::vector<Link>& Resolve(std::span<const std::string_view> refs);
+
+  /// Bytes the arena can hold without growing
+  size_t ArenaCapacity() const {
+    return arena_.capacity();
+  }
+
+ private:
+  bool ResolveInto(std::string_view ref, std::string& out);
+  void AppendPath(std::string_view dir, std::string_view path,
+                  std::string& out);
+
+  const Canonicalizer* const canon_;
+
+  // the base and views of its parts
+  std::string base_;
+  std::string_view scheme_, authority_, path_, query_;
+
+  // offsets into the arena, which may move while a batch is resolved
+  struct Span {
+    size_t url, url_len, raw, raw_len;
+  };
+
+  std::string arena_;
+  std::string scratch_;  // merged path before dot removal
+  std::vector<Span> spans_;
+  std::vector<Link> links_;
+};
@@ -1,41 +1,74 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <cstdio>  // for fileno()
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <nlohmann/json.hpp>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <unistd.h>  // for isatty()
+#include <utility>
+#include <vector>
 
 namespace logr {
 
 enum class Level { Debug = 0, Info, Warning, Error, None };
 
-inline Level CurrentLevel() {
-  static Level lvl = [] {
-    Level base = Level::Info;
+// Statements below LOGR_MIN_LEVEL (0 debug, 1 info, 2 warning, 3 error) are
+// discarded at compile time when written with the LOGR_* macros below.
+#ifndef LOGR_MIN_LEVEL
+#define LOGR_MIN_LEVEL 0
+#endif
+inline constexpr Level kMinLevel = static_cast<Level>(LOGR_MIN_LEVEL);
+
+// Text is the human-readable form; Json writes one object per line
+enum class Format { Text, Json };
+
+// ~/.logging.json, read once: {"level": "debug", "format": "json"}
+inline const nlohmann::json& Settings() {
+  static const nlohmann::json j = [] {
     if (auto* home = std::getenv("HOME")) {
       std::ifstream in{std::string(home) + "/.logging.json"};
       if (in) {
         try {
-          auto j = nlohmann::json::parse(in);
-          if (auto it = j.find("level"); it != j.end() && it->is_string()) {
-            auto s = it->get<std::string>();
-            if (s == "debug")
-              base = Level::Debug;
-            else if (s == "info")
-              base = Level::Info;
-            else if (s == "warning")
-              base = Level::Warning;
-            else if (s == "error")
-              base = Level::Error;
-          }
+          auto parsed = nlohmann::json::parse(in);
+          if (parsed.is_object())
+            return parsed;
         } catch (...) {
         }
       }
     }
+    return nlohmann::json::object();
+  }();
+  return j;
+}
+
+inline Level CurrentLevel() {
+  static Level lvl = [] {
+    Level base = Level::Info;
+    const auto& j = Settings();
+    if (auto it = j.find("level"); it != j.end() && it->is_string()) {
+      auto s = it->get<std::string>();
+      if (s == "debug")
+        base = Level::Debug;
+      else if (s == "info")
+        base = Level::Info;
+      else if (s == "warning")
+        base = Level::Warning;
+      else if (s == "error")
+        base = Level::Error;
+    }
     if (auto* dbg = std::getenv("DEBUG")) {
       try {
         int d = std::stoi(dbg);
@@ -55,8 +88,49 @@ inline Level CurrentLevel() {
   return lvl;
 }
 
+namespace detail {
+// LOGR_FORMAT overrides the "format" setting
+inline std::atomic<Format>& FormatSetting() {
+  static std::atomic<Format> fmt{[] {
+    std::string s;
+    const auto& j = Settings();
+    if (auto it = j.find("format"); it != j.end() && it->is_string())
+      s = it->get<std::string>();
+    if (auto* env = std::getenv("LOGR_FORMAT"))
+      s = env;
+    return s == "json" ? Format::Json : Format::Text;
+  }()};
+  return fmt;
+}
+}  // namespace detail
+
+inline Format CurrentFormat() {
+  return detail::FormatSetting().load(std::memory_order_relaxed);
+}
+
+inline void SetFormat(Format f) {
+  detail::FormatSetting().store(f, std::memory_order_relaxed);
+}
+
+inline constexpr char const* levelName(Level L) {
+  switch (L) {
+    case Level::Debug:
+      return "debug";
+    case Level::Info:
+      return "info";
+    case Level::Warning:
+      return "warning";
+    case Level::Error:
+      return "error";
+    default:
+      return "none";
+  }
+}
+
 // returns true if a message at level `msg` should be suppressed
 inline bool ShouldMute(Level msg) {
+  if (msg < kMinLevel)
+    return true;
   auto lvl = CurrentLevel();
   switch (msg) {
     case Level::Debug:
@@ -78,7 +152,8 @@ inline bool ShouldMute(Level msg) {
 }
 
 inline bool is_tty() {
-  return ::isatty(::fileno(stderr)) != 0;
+  static const bool tty = ::isatty(::fileno(stderr)) != 0;
+  return tty;
 }
 
 // ANSI escape sequences
@@ -103,29 +178,270 @@ inline constexpr char const* colorCode(Level L) {
   }
 }
 
-// A tiny RAII proxy that does prefix in ctor, suffix in dtor,
-// and funnels every << through itself.
-class LogEntry {
+namespace detail {
+
+struct Record {
+  std::uint64_t seq{0};  // global order across threads
+  Level lvl{Level::Info};
+  std::string text;
+};
+
+// Fixed-size single-producer/single-consumer ring: the owning thread pushes,
+// the writer thread drains. Neither side takes a lock.
+class Ring {
+ public:
+  static constexpr size_t kSlots = 1024;  // power of two
+
+  bool TryPush(Record& r) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == kSlots)
+      return false;
+    slots_[tail & (kSlots - 1)] = std::move(r);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+
+  template <typename F>
+  void Drain(F&& f) {
+    auto head = head_.load(std::memory_order_relaxed);
+    const auto tail = tail_.load(std::memory_order_acquire);
+    for (; head != tail; ++head)
+      f(std::move(slots_[head & (kSlots - 1)]));
+    head_.store(head, std::memory_order_release);
+  }
+
+ private:
+  std::array<Record, kSlots> slots_;
+  alignas(64) std::atomic<std::uint64_t> head_{0};
+  alignas(64) std::atomic<std::uint64_t> tail_{0};
+};
+
+// Owns the background thread that drains every thread's ring, restores the
+// global order of the batch and writes it to stderr in one call. Records are
+// written at least every kInterval; a warning, an error, a half-full ring or
+// Flush() wakes the writer early.
+class AsyncWriter {
  public:
-  LogEntry(Level L) : lvl(L), muted(ShouldMute(L)), lock(log_mutex()) {
-    if (!muted) {
-      if (is_tty()) {
-        std::cerr << colorCode(lvl);
+  static constexpr auto kInterval = std::chrono::milliseconds(20);
+
+  // Never destroyed, so static destructors can still log; the atexit hook
+  // stops the thread and anything logged after that is written directly.
+  static AsyncWriter& Instance() {
+    static AsyncWriter* w = [] {
+      auto* p = new AsyncWriter;
+      std::atexit([] { Instance().Stop(); });
+      return p;
+    }();
+    return *w;
+  }
+
+  void Submit(Level lvl, std::string text) {
+    if (stopped_.load(std::memory_order_acquire)) {
+      std::string out;
+      Format(out, lvl, text);
+      WriteOut(out);
+      return;
+    }
+    Record r{seq_.fetch_add(1, std::memory_order_relaxed), lvl,
+             std::move(text)};
+    Ring& ring = LocalRing();
+    while (!ring.TryPush(r)) {
+      Wake();
+      std::this_thread::yield();
+    }
+    if (lvl >= Level::Warning || ring.Size() >= Ring::kSlots / 2)
+      Wake();
+  }
+
+  // Block until everything this thread logged so far has been written
+  void Flush() {
+    if (stopped_.load(std::memory_order_acquire)) {
+      std::fflush(stderr);
+      return;
+    }
+    std::unique_lock<std::mutex> lock(pass_mtx_);
+    // the pass in progress may already be past this thread's ring
+    const auto target = passes_ + 2;
+    Wake();
+    pass_cv_.wait(lock, [&] {
+      return passes_ >= target || stopped_.load(std::memory_order_acquire);
+    });
+  }
+
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(wake_mtx_);
+      if (stopping_)
+        return;
+      stopping_ = true;
+    }
+    wake_cv_.notify_one();
+    thread_.join();
+    stopped_.store(true, std::memory_order_release);
+    DrainAll();  // anything pushed during the final pass
+    pass_cv_.notify_all();
+  }
+
+ private:
+  AsyncWriter() : thread_([this] { Run(); }) {
+  }
+
+  Ring& LocalRing() {
+    thread_local std::shared_ptr<Ring> ring = [this] {
+      auto r = std::make_shared<Ring>();
+      std::lock_guard<std::mutex> lock(rings_mtx_);
+      rings_.push_back(r);
+      return r;
+    }();
+    return *ring;
+  }
+
+  void Wake() {
+    if (!wake_.exchange(true, std::memory_order_acq_rel)) {
+      std::lock_guard<std::mutex> lock(wake_mtx_);
+      wake_cv_.notify_one();
+    }
+  }
+
+  void Run() {
+    for (;;) {
+      bool stopping;
+      {
+        std::unique_lock<std::mutex> lock(wake_mtx_);
+        wake_cv_.wait_for(lock, kInterval, [this] {
+          return stopping_ || wake_.load(std::memory_order_acquire);
+        });
+        stopping = stopping_;
+      }
+      wake_.store(false, std::memory_order_release);
+      DrainAll();
+      {
+        std::lock_guard<std::mutex> lock(pass_mtx_);
+        ++passes_;
       }
+      pass_cv_.notify_all();
+      if (stopping)
+        return;
     }
   }
 
-  ~LogEntry() {
-    if (!muted) {
-      if (is_tty()) {
-        std::cerr << RESET;
+  void DrainAll() {
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+      std::lock_guard<std::mutex> lock(rings_mtx_);
+      rings = rings_;
+    }
+    for (auto& r : rings) {
+      // a ring whose thread has exited can be dropped once drained
+      const bool orphan = r.use_count() == 2;
+      r->Drain([this](Record&& rec) { batch_.push_back(std::move(rec)); });
+      if (orphan) {
+        std::lock_guard<std::mutex> lock(rings_mtx_);
+        rings_.erase(std::find(rings_.begin(), rings_.end(), r));
       }
-      std::cerr << std::endl;
     }
+    if (batch_.empty())
+      return;
+    std::sort(batch_.begin(), batch_.end(),
+              [](const Record& a, const Record& b) { return a.seq < b.seq; });
+    out_.clear();
+    for (const auto& rec : batch_)
+      Format(out_, rec.lvl, rec.text);
+    batch_.clear();
+    WriteOut(out_);
+  }
+
+  static void Format(std::string& out, Level lvl, const std::string& text) {
+    if (is_tty() && CurrentFormat() == logr::Format::Text) {
+      out += colorCode(lvl);
+      out += text;
+      out += RESET;
+    } else {
+      out += text;
+    }
+    out += '\n';
   }
 
-  LogEntry(LogEntry&&) noexcept = default;
-  LogEntry& operator=(LogEntry&&) noexcept = default;
+  static void WriteOut(const std::string& out) {
+    std::fwrite(out.data(), 1, out.size(), stderr);
+    std::fflush(stderr);
+  }
+
+  std::atomic<std::uint64_t> seq_{0};
+  std::atomic<bool> stopped_{false};
+
+  std::mutex rings_mtx_;
+  std::vector<std::shared_ptr<Ring>> rings_;
+
+  std::atomic<bool> wake_{false};
+  std::mutex wake_mtx_;
+  std::condition_variable wake_cv_;
+  bool stopping_{false};
+
+  std::mutex pass_mtx_;
+  std::condition_variable pass_cv_;
+  std::uint64_t passes_{0};
+
+  // writer thread only
+  std::vector<Record> batch_;
+  std::string out_;
+
+  std::thread thread_;
+};
+
+}  // namespace detail
+
+/// A key/value pair attached to an entry: `logr::info << "msg" << kv("k", v)`
+struct Field {
+  std::string key;
+  nlohmann::json value;
+};
+
+template <typename T>
+Field kv(std::string key, const T& value) {
+  if constexpr (std::is_constructible_v<nlohmann::json, const T&>) {
+    return Field{std::move(key), nlohmann::json(value)};
+  } else {
+    std::ostringstream os;
+    os << value;
+    return Field{std::move(key), os.str()};
+  }
+}
+
+/// Block until every entry the calling thread has logged is on stderr
+inline void Flush() {
+  detail::AsyncWriter::Instance().Flush();
+}
+
+// A tiny RAII proxy: every << formats into a per-thread buffer and the
+// destructor hands the finished line to the async writer. A muted entry
+// never touches the buffer, a lock or the writer.
+class LogEntry {
+ public:
+  LogEntry(Level L) : lvl(L) {
+    if (!ShouldMute(L))
+      Acquire();
+  }
+
+  ~LogEntry() {
+    if (!out)
+      return;
+    detail::AsyncWriter::Instance().Submit(lvl, Render());
+    Release();
+  }
+
+  LogEntry(LogEntry&& o) noexcept
+      : lvl(o.lvl),
+        out(std::exchange(o.out, nullptr)),
+        owned(std::move(o.owned)),
+        fields(std::move(o.fields)) {
+  }
+  LogEntry& operator=(LogEntry&&) = delete;
 
   // (and to be explicit)
   LogEntry(const LogEntry&) = delete;
@@ -134,28 +450,90 @@ class LogEntry {
   // payload insertion
   template <typename T>
   LogEntry& operator<<(T const& v) {
-    if (!muted) {
-      std::cerr << v;
+    if (out) {
+      *out << v;
     }
     return *this;
   }
 
   LogEntry& operator<<(std::ostream& (*m)(std::ostream&)) {
-    if (!muted) {
-      m(std::cerr);
+    if (out) {
+      m(*out);
+    }
+    return *this;
+  }
+
+  LogEntry& operator<<(Field f) {
+    if (out) {
+      fields.push_back(std::move(f));
     }
     return *this;
   }
 
  private:
   Level lvl;
-  bool muted;
-  std::unique_lock<std::mutex> lock;
+  std::ostringstream* out{nullptr};
+  std::unique_ptr<std::ostringstream> owned;  // when the buffer is taken
+  std::vector<Field> fields;
 
-  // one mutex for all entries, to prevent interleaving
-  static std::mutex& log_mutex() {
-    static std::mutex m;
-    return m;
+  // text: "msg k=v k=v"; json: {"ts":..,"level":..,"msg":..,"k":v,..}
+  std::string Render() const {
+    if (CurrentFormat() == Format::Json) {
+      nlohmann::json j = nlohmann::json::object();
+      const auto now = std::chrono::system_clock::now();
+      j["ts"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  now.time_since_epoch())
+                  .count();
+      j["level"] = levelName(lvl);
+      j["msg"] = out->str();
+      for (const auto& f : fields)
+        j[f.key] = f.value;
+      return j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+    }
+    std::string line = out->str();
+    for (const auto& f : fields) {
+      line += ' ';
+      line += f.key;
+      line += '=';
+      line += f.value.is_string()
+                ? f.value.get_ref<const std::string&>()
+                : f.value.dump(-1, ' ', false,
+                               nlohmann::json::error_handler_t::replace);
+    }
+    return line;
+  }
+
+  struct Buffer {
+    std::ostringstream stream;
+    bool busy{false};
+  };
+
+  static Buffer& LocalBuffer() {
+    thread_local Buffer buf;
+    return buf;
+  }
+
+  void Acquire() {
+    auto& buf = LocalBuffer();
+    if (buf.busy) {
+      // an entry logged while formatting another one
+      owned = std::make_unique<std::ostringstream>();
+      out = owned.get();
+      return;
+    }
+    buf.busy = true;
+    buf.stream.str(std::string());
+    buf.stream.clear();
+    buf.stream.flags(std::ios_base::dec | std::ios_base::skipws);
+    buf.stream.precision(6);
+    buf.stream.fill(' ');
+    out = &buf.stream;
+  }
+
+  void Release() {
+    if (!owned)
+      LocalBuffer().busy = false;
+    out = nullptr;
   }
 };
 
@@ -192,7 +570,30 @@ inline constexpr Logger error{Level::Error};
 //                 << expensive_function();
 //   }
 
-#define IF_DEBUG if (logr::CurrentLevel() <= logr::Level::Debug)
-#define IF_INFO if (logr::CurrentLevel() <= logr::Level::Info)
-#define IF_WARNING if (logr::CurrentLevel() <= logr::Level::Warning)
-#define IF_ERROR if (logr::CurrentLevel() <= logr::Level::Error)
+#define IF_DEBUG                                       \
+  if constexpr (logr::Level::Debug >= logr::kMinLevel) \
+    if (logr::CurrentLevel() <= logr::Level::Debug)
+#define IF_INFO                                       \
+  if constexpr (logr::Level::Info >= logr::kMinLevel) \
+    if (logr::CurrentLevel() <= logr::Level::Info)
+#define IF_WARNING                                       \
+  if constexpr (logr::Level::Warning >= logr::kMinLevel) \
+    if (logr::CurrentLevel() <= logr::Level::Warning)
+#define IF_ERROR                                       \
+  if constexpr (logr::Level::Error >= logr::kMinLevel) \
+    if (logr::CurrentLevel() <= logr::Level::Error)
+
+// ─── statement macros
+// Unlike `logr::debug << f(x)`, the operands are not evaluated when the level
+// is muted, and no code is emitted for them below LOGR_MIN_LEVEL:
+//   LOGR_DEBUG << "fetch" << logr::kv("url", url.ToString());
+#define LOGR_AT(L)                                  \
+  if constexpr (logr::Level::L < logr::kMinLevel) { \
+  } else if (logr::ShouldMute(logr::Level::L)) {    \
+  } else                                            \
+    logr::LogEntry(logr::Level::L)
+
+#define LOGR_DEBUG LOGR_AT(Debug)
+#define LOGR_INFO LOGR_AT(Info)
+#define LOGR_WARNING LOGR_AT(Warning)
+#define LOGR_ERROR LOGR_AT(Error)
@@ -56,7 +56,7 @@ bool LuaProcessor::HasScript() const {
 }
 
 std::optional<nlohmann::json> LuaProcessor::Process(
-  const URL& url, const std::string& content) const {
+  const URL& url, std::string_view content) const {
   const auto domain = url.GetDomain();
 
   last_client_redirect_ = {};
@@ -5,6 +5,7 @@
 #include <optional>
 #include <sol/sol.hpp>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -33,7 +34,7 @@ class LuaProcessor {
   /// Run all the preloaded `process` functions for this URL's domain.
   /// Returns a vector of result‐tables (one per script).
   std::optional<nlohmann::json> Process(const URL& url,
-                                        const std::string& content) const;
+                                        std::string_view content) const;
 
   std::optional<ClientRedirect> GetClientRedirect() const;
 
@@ -0,0 +1,235 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Bounded lock-free multi-producer/multi-consumer queue (Vyukov's ring of
+// sequenced cells). Items are moved in and out; nothing is copied. The
+// try_* calls never block. push()/pop() spin briefly and then sleep on a
+// C++20 atomic wait until space/items appear or the queue is closed.
+//
+// close() rejects further pushes and wakes every waiter; consumers keep
+// draining what is left and then see std::nullopt. For a lossless shutdown,
+// close only after all producers have returned.
+template <typename T>
+class MPMCQueue {
+ public:
+  explicit MPMCQueue(size_t capacity)
+      : mask_{RoundUp(capacity) - 1}, cells_{new Cell[mask_ + 1]} {
+    for (size_t i = 0; i <= mask_; ++i)
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  ~MPMCQueue() {
+    while (try_pop()) {
+    }
+  }
+
+  MPMCQueue(const MPMCQueue&) = delete;
+  MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+  size_t capacity() const {
+    return mask_ + 1;
+  }
+
+  /// Items currently queued (racy snapshot, for metrics)
+  size_t size_approx() const {
+    const size_t enq = enqueue_pos_.load(std::memory_order_relaxed);
+    const size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+    return enq > deq ? enq - deq : 0;
+  }
+
+  bool closed() const {
+    return closed_.load(std::memory_order_acquire);
+  }
+
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    Signal(not_empty_, true);
+    Signal(not_full_, true);
+  }
+
+  /// Enqueue without blocking; `item` is left untouched on failure
+  bool try_push(T&& item) {
+    if (closed() || !Enqueue(item))
+      return false;
+    Signal(not_empty_, false);
+    return true;
+  }
+
+  /// Enqueue, waiting for space; false (item untouched) once closed
+  bool push(T&& item) {
+    for (unsigned spin = 0;; ++spin) {
+      const auto epoch = not_full_.load(std::memory_order_acquire);
+      if (closed())
+        return false;
+      if (Enqueue(item)) {
+        Signal(not_empty_, false);
+        return true;
+      }
+      Pause(not_full_, epoch, spin);
+    }
+  }
+
+  /// Dequeue without blocking
+  std::optional<T> try_pop() {
+    auto item = Dequeue();
+    if (item)
+      Signal(not_full_, false);
+    return item;
+  }
+
+  /// Dequeue, waiting for an item; nullopt once closed and drained
+  std::optional<T> pop() {
+    for (unsigned spin = 0;; ++spin) {
+      const auto epoch = not_empty_.load(std::memory_order_acquire);
+      if (auto item = Dequeue()) {
+        Signal(not_full_, false);
+        return item;
+      }
+      if (closed())
+        return Dequeue();  // a racing push may have landed
+      Pause(not_empty_, epoch, spin);
+    }
+  }
+
+  /// Move [first, last) in, waiting for space; returns how many went in
+  /// (fewer than requested only if the queue was closed)
+  template <typename It>
+  size_t push_bulk(It first, It last) {
+    size_t n = 0;
+    for (; first != last; ++first, ++n) {
+      if (!push(std::move(*first)))
+        break;
+    }
+    return n;
+  }
+
+  /// Move up to `max` items into `out` without blocking
+  template <typename OutIt>
+  size_t try_pop_bulk(OutIt out, size_t max) {
+    size_t n = 0;
+    while (n < max) {
+      auto item = Dequeue();
+      if (!item)
+        break;
+      *out++ = std::move(*item);
+      ++n;
+    }
+    if (n > 0)
+      Signal(not_full_, n > 1);
+    return n;
+  }
+
+  /// Wait for at least one item, then take up to `max`; 0 once closed and
+  /// drained
+  template <typename OutIt>
+  size_t pop_bulk(OutIt out, size_t max) {
+    if (max == 0)
+      return 0;
+    auto first = pop();
+    if (!first)
+      return 0;
+    *out++ = std::move(*first);
+    return 1 + try_pop_bulk(out, max - 1);
+  }
+
+ private:
+  static constexpr size_t kCacheLine = 64;
+  static constexpr unsigned kSpins = 64;
+
+  struct Cell {
+    std::atomic<size_t> seq;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  static size_t RoundUp(size_t n) {
+    size_t cap = 2;
+    while (cap < n)
+      cap <<= 1;
+    return cap;
+  }
+
+  bool Enqueue(T& item) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto dif =
+        static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+      if (dif == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+      } else if (dif < 0) {
+        return false;  // full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    ::new (static_cast<void*>(cell->storage)) T(std::move(item));
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::optional<T> Dequeue() {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      const size_t seq = cell->seq.load(std::memory_order_acquire);
+      const auto dif = static_cast<std::intptr_t>(seq) -
+                       static_cast<std::intptr_t>(pos + 1);
+      if (dif == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+          break;
+      } else if (dif < 0) {
+        return std::nullopt;  // empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* p = std::launder(reinterpret_cast<T*>(cell->storage));
+    std::optional<T> item{std::move(*p)};
+    p->~T();
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return item;
+  }
+
+  static void Signal(std::atomic<std::uint32_t>& epoch, bool all) {
+    epoch.fetch_add(1, std::memory_order_release);
+    if (all)
+      epoch.notify_all();
+    else
+      epoch.notify_one();
+  }
+
+  static void Pause(std::atomic<std::uint32_t>& epoch, std::uint32_t seen,
+                    unsigned spin) {
+    if (spin < kSpins)
+      std::this_thread::yield();
+    else
+      epoch.wait(seen, std::memory_order_acquire);
+  }
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  alignas(kCacheLine) std::atomic<size_t> enqueue_pos_{0};
+  alignas(kCacheLine) std::atomic<size_t> dequeue_pos_{0};
+  alignas(kCacheLine) std::atomic<std::uint32_t> not_empty_{0};
+  alignas(kCacheLine) std::atomic<std::uint32_t> not_full_{0};
+  std::atomic<bool> closed_{false};
+};
+
+#endif  // MPMC_QUEUE_HPP
@@ -0,0 +1,218 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace metrics {
+
+unsigned Histogram::Index(std::uint64_t us) {
+  if (us < kSubBuckets)
+    return static_cast<unsigned>(us);
+  const unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(us));
+  const unsigned octave = msb - kSubBits + 1;
+  const unsigned sub =
+    static_cast<unsigned>(us >> (msb - kSubBits)) & (kSubBuckets - 1);
+  return std::min(octave * kSubBuckets + sub, kBuckets - 1);
+}
+
+std::uint64_t Histogram::UpperBound(unsigned i) {
+  const unsigned octave = i / kSubBuckets;
+  const std::uint64_t sub = i % kSubBuckets;
+  if (octave == 0)
+    return sub + 1;
+  return (kSubBuckets + sub + 1) << (octave - 1);
+}
+
+std::uint64_t Histogram::ValueAt(double q) const {
+  const std::uint64_t total = Count();
+  if (total == 0)
+    return 0;
+  const auto rank = static_cast<std::uint64_t>(
+    std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(total)));
+  std::uint64_t seen = 0;
+  for (unsigned i = 0; i < kBuckets; ++i) {
+    seen += BucketCount(i);
+    if (seen >= std::max<std::uint64_t>(rank, 1))
+      return UpperBound(i);
+  }
+  return UpperBound(kBuckets - 1);
+}
+
+Registry& Registry::Instance() {
+  static Registry instance;
+  return instance;
+}
+
+std::string Registry::RenderLabels(const Labels& labels) {
+  std::string out;
+  for (const auto& [k, v] : labels) {
+    out += out.empty() ? "" : ",";
+    out += k;
+    out += "=\"";
+    for (char c : v) {
+      if (c == '\\' || c == '"')
+        out += '\\';
+      if (c == '\n') {
+        out += "\\n";
+        continue;
+      }
+      out += c;
+    }
+    out += '"';
+  }
+  return out;
+}
+
+Registry::Family& Registry::GetFamily(const std::string& name, Type type,
+                                      const std::string& help) {
+  auto [it, fresh] =
+    families_.try_emplace(name, Family{type, help, {}, {}, {}});
+  if (!fresh && it->second.help.empty())
+    it->second.help = help;
+  return it->second;
+}
+
+// Labelled series hang off the unlabelled one so updates roll up
+Counter& Registry::GetCounter(const std::string& name, const Labels& labels,
+                              const std::string& help) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto& fam = GetFamily(name, Type::Counter, help);
+  auto& total = fam.counters[""];
+  if (!total)
+    total = std::make_unique<Counter>();
+  if (labels.empty())
+    return *total;
+  auto& series = fam.counters[RenderLabels(labels)];
+  if (!series) {
+    series = std::make_unique<Counter>();
+    series->parent_ = total.get();
+  }
+  return *series;
+}
+
+Gauge& Registry::GetGauge(const std::string& name, const Labels& labels,
+                          const std::string& help) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto& fam = GetFamily(name, Type::Gauge, help);
+  auto& total = fam.gauges[""];
+  if (!total)
+    total = std::make_unique<Gauge>();
+  if (labels.empty())
+    return *total;
+  auto& series = fam.gauges[RenderLabels(labels)];
+  if (!series) {
+    series = std::make_unique<Gauge>();
+    series->parent_ = total.get();
+  }
+  return *series;
+}
+
+Histogram& Registry::GetHistogram(const std::string& name,
+                                  const Labels& labels,
+                                  const std::string& help) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto& fam = GetFamily(name, Type::Histogram, help);
+  auto& total = fam.histograms[""];
+  if (!total)
+    total = std::make_unique<Histogram>();
+  if (labels.empty())
+    return *total;
+  auto& series = fam.histograms[RenderLabels(labels)];
+  if (!series) {
+    series = std::make_unique<Histogram>();
+    series->parent_ = total.get();
+  }
+  return *series;
+}
+
+std::string Registry::Prometheus() const {
+  auto braces = [](const std::string& labels, const std::string& extra = "") {
+    if (labels.empty() && extra.empty())
+      return std::string();
+    std::string out = "{" + labels;
+    if (!labels.empty() && !extra.empty())
+      out += ",";
+    return out + extra + "}";
+  };
+  auto seconds = [](std::uint64_t us) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", static_cast<double>(us) / 1e6);
+    return std::string(buf);
+  };
+
+  // The unlabelled series of a labelled family is the in-process rollup of
+  // the others; exporting it too would double any sum() or rate() over the
+  // family, so it is only exported when it is the family's sole series
+  auto exported = [](const auto& series, const std::string& labels) {
+    return !labels.empty() || series.size() == 1;
+  };
+
+  std::string out;
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (const auto& [name, fam] : families_) {
+    if (!fam.help.empty())
+      out += "# HELP " + name + " " + fam.help + "\n";
+    switch (fam.type) {
+      case Type::Counter:
+        out += "# TYPE " + name + " counter\n";
+        for (const auto& [labels, c] : fam.counters) {
+          if (!exported(fam.counters, labels))
+            continue;
+          out += name + braces(labels) + " " + std::to_string(c->Value()) +
+                 "\n";
+        }
+        break;
+      case Type::Gauge:
+        out += "# TYPE " + name + " gauge\n";
+        for (const auto& [labels, g] : fam.gauges) {
+          if (!exported(fam.gauges, labels))
+            continue;
+          out += name + braces(labels) + " " + std::to_string(g->Value()) +
+                 "\n";
+        }
+        break;
+      case Type::Histogram:
+        out += "# TYPE " + name + " histogram\n";
+        for (const auto& [labels, h] : fam.histograms) {
+          if (!exported(fam.histograms, labels))
+            continue;
+          // one cumulative bucket per power of two, up to the last in use;
+          // buckets are read once so the series stays monotonic under writes
+          std::array<std::uint64_t, Histogram::kBuckets> counts;
+          unsigned last = 0;
+          std::uint64_t total = 0;
+          for (unsigned i = 0; i < Histogram::kBuckets; ++i) {
+            counts[i] = h->BucketCount(i);
+            total += counts[i];
+            if (counts[i])
+              last = i;
+          }
+          std::uint64_t cumulative = 0;
+          for (unsigned i = 0; i < Histogram::kBuckets; ++i) {
+            cumulative += counts[i];
+            if (i % Histogram::kSubBuckets != Histogram::kSubBuckets - 1)
+              continue;
+            // le is inclusive and values are whole microseconds, so the
+            // bucket's bound is one below the value that no longer fits
+            const auto le =
+              "le=\"" + seconds(Histogram::UpperBound(i) - 1) + "\"";
+            out += name + "_bucket" + braces(labels, le) + " " +
+                   std::to_string(cumulative) + "\n";
+            if (i >= last)
+              break;
+          }
+          out += name + "_bucket" + braces(labels, "le=\"+Inf\"") + " " +
+                 std::to_string(total) + "\n";
+          out += name + "_sum" + braces(labels) + " " +
+                 seconds(h->SumMicros()) + "\n";
+          out += name + "_count" + braces(labels) + " " +
+                 std::to_string(total) + "\n";
+        }
+        break;
+    }
+  }
+  return out;
+}
+
+}  // namespace metrics
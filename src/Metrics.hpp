@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Process-wide registry of counters, gauges and latency histograms, rendered
+// in the Prometheus text exposition format.
+//
+// Registration takes a lock; updates never do. Callers look a series up once
+// (e.g. per Crawler) and keep the reference, which stays valid for the life
+// of the registry. A labelled series rolls up into the unlabelled series of
+// the same name, so every per-domain update also moves the global total. The
+// rollup is for in-process readers: Prometheus() leaves it out of a family
+// that has labelled series, and aggregation is left to PromQL.
+namespace metrics {
+
+using Labels = std::vector<std::pair<std::string, std::string>>;
+
+class Counter {
+ public:
+  void Inc(std::uint64_t n = 1) {
+    value_.fetch_add(n, std::memory_order_relaxed);
+    if (parent_)
+      parent_->Inc(n);
+  }
+  std::uint64_t Value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class Registry;
+  std::atomic<std::uint64_t> value_{0};
+  Counter* parent_{nullptr};
+};
+
+class Gauge {
+ public:
+  void Set(std::int64_t v) {
+    const auto old = value_.exchange(v, std::memory_order_relaxed);
+    if (parent_)
+      parent_->Add(v - old);
+  }
+  void Add(std::int64_t d) {
+    value_.fetch_add(d, std::memory_order_relaxed);
+    if (parent_)
+      parent_->Add(d);
+  }
+  std::int64_t Value() const {
+    return value_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class Registry;
+  std::atomic<std::int64_t> value_{0};
+  Gauge* parent_{nullptr};
+};
+
+// HDR-style log-linear histogram of microsecond values: each power of two is
+// split into kSubBuckets linear buckets, so any recorded value is known to
+// within 1/kSubBuckets (25%) of itself from 1us up to ~25 days.
+class Histogram {
+ public:
+  static constexpr unsigned kSubBits = 2;
+  static constexpr unsigned kSubBuckets = 1u << kSubBits;
+  static constexpr unsigned kOctaves = 40;
+  static constexpr unsigned kBuckets = kSubBuckets * kOctaves;
+
+  void Record(std::uint64_t us) {
+    buckets_[Index(us)].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    if (parent_)
+      parent_->Record(us);
+  }
+  void Record(std::chrono::steady_clock::duration d) {
+    Record(static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(d).count()));
+  }
+
+  std::uint64_t Count() const {
+    return count_.load(std::memory_order_relaxed);
+  }
+  std::uint64_t SumMicros() const {
+    return sum_us_.load(std::memory_order_relaxed);
+  }
+  std::uint64_t BucketCount(unsigned i) const {
+    return buckets_[i].load(std::memory_order_relaxed);
+  }
+
+  /// Upper bound (exclusive) of the value at quantile `q` in [0, 1]
+  std::uint64_t ValueAt(double q) const;
+
+  static unsigned Index(std::uint64_t us);
+  /// Smallest value that does not fit in bucket `i`
+  static std::uint64_t UpperBound(unsigned i);
+
+ private:
+  friend class Registry;
+  std::array<std::atomic<std::uint64_t>, kBuckets> buckets_{};
+  std::atomic<std::uint64_t> sum_us_{0};
+  std::atomic<std::uint64_t> count_{0};
+  Histogram* parent_{nullptr};
+};
+
+class Registry {
+ public:
+  static Registry& Instance();
+
+  Counter& GetCounter(const std::string& name, const Labels& labels = {},
+                      const std::string& help = "");
+  Gauge& GetGauge(const std::string& name, const Labels& labels = {},
+                  const std::string& help = "");
+  /// Recorded in microseconds, exposed in seconds
+  Histogram& GetHistogram(const std::string& name, const Labels& labels = {},
+                          const std::string& help = "");
+
+  /// Every series in the Prometheus text format (version 0.0.4), without
+  /// the rollup of families that have labelled series
+  std::string Prometheus() const;
+
+ private:
+  enum class Type { Counter, Gauge, Histogram };
+
+  struct Family {
+    Type type;
+    std::string help;
+    // rendered label set ("" for the unlabelled series) -> series
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Family& GetFamily(const std::string& name, Type type,
+                    const std::string& help);
+  static std::string RenderLabels(const Labels& labels);
+
+  mutable std::mutex mtx_;
+  std::map<std::string, Family> families_;
+};
+
+}  // namespace metrics
@@ -0,0 +1,140 @@
+#include "MetricsExporter.hpp"
+#include "Logger.hpp"
+
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+MetricsExporter::MetricsExporter(Options opts, metrics::Registry& registry)
+    : opts_{std::move(opts)}, registry_{registry} {
+  if (opts_.listen_port.has_value()) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    const int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sa.sin_port = htons(*opts_.listen_port);
+    socklen_t len = sizeof(sa);
+    if (listen_fd_ < 0 ||
+        ::bind(listen_fd_, reinterpret_cast<sockaddr*>(&sa), len) != 0 ||
+        ::listen(listen_fd_, 8) != 0 ||
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&sa), &len) !=
+          0) {
+      logr::error << "[Metrics] cannot listen on 127.0.0.1:"
+                  << *opts_.listen_port;
+      if (listen_fd_ >= 0)
+        ::close(listen_fd_);
+      listen_fd_ = -1;
+    } else {
+      port_ = ntohs(sa.sin_port);
+      logr::info << "[Metrics] serving http://127.0.0.1:" << port_
+                 << "/metrics";
+      listen_thread_ = std::thread([this] { Listen(); });
+    }
+  }
+  if (!opts_.file.empty())
+    file_thread_ = std::thread([this] { FileLoop(); });
+}
+
+MetricsExporter::~MetricsExporter() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  if (file_thread_.joinable())
+    file_thread_.join();
+  if (listen_thread_.joinable())
+    listen_thread_.join();
+  if (listen_fd_ >= 0)
+    ::close(listen_fd_);
+  if (!opts_.file.empty())
+    WriteFile();  // final totals
+}
+
+bool MetricsExporter::WriteFile() const {
+  const std::string text = registry_.Prometheus();
+  std::error_code ec;
+  if (opts_.file.has_parent_path())
+    std::filesystem::create_directories(opts_.file.parent_path(), ec);
+  const auto tmp = opts_.file.string() + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out << text;
+    if (!out) {
+      logr::error << "[Metrics] failed to write " << tmp;
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp, opts_.file, ec);
+  return !ec;
+}
+
+void MetricsExporter::FileLoop() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!stop_) {
+    lock.unlock();
+    WriteFile();
+    lock.lock();
+    cv_.wait_for(lock, opts_.interval, [this] { return stop_; });
+  }
+}
+
+void MetricsExporter::Listen() {
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      if (stop_)
+        return;
+    }
+    pollfd p{listen_fd_, POLLIN, 0};
+    if (::poll(&p, 1, 100) <= 0)
+      continue;
+    const int fd = ::accept(listen_fd_, nullptr, nullptr);
+    if (fd < 0)
+      continue;
+    Serve(fd);
+    ::close(fd);
+  }
+}
+
+// One request per connection; scrapes are rare and small
+void MetricsExporter::Serve(int fd) const {
+  std::string req;
+  char buf[1024];
+  while (req.find("\r\n\r\n") == std::string::npos && req.size() < 8192) {
+    pollfd p{fd, POLLIN, 0};
+    if (::poll(&p, 1, 1000) <= 0)
+      return;
+    const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0)
+      return;
+    req.append(buf, n);
+  }
+
+  std::string status = "200 OK";
+  std::string body;
+  if (req.rfind("GET /metrics ", 0) == 0 || req.rfind("GET /metrics?", 0) == 0)
+    body = registry_.Prometheus();
+  else
+    status = "404 Not Found";
+  const std::string resp = "HTTP/1.1 " + status +
+                           "\r\nContent-Type: text/plain; version=0.0.4"
+                           "\r\nContent-Length: " +
+                           std::to_string(body.size()) +
+                           "\r\nConnection: close\r\n\r\n" + body;
+  for (size_t off = 0; off < resp.size();) {
+    const ssize_t n =
+      ::send(fd, resp.data() + off, resp.size() - off, MSG_NOSIGNAL);
+    if (n <= 0)
+      return;
+    off += static_cast<size_t>(n);
+  }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "Metrics.hpp"
+
+// Publishes a metrics::Registry for scraping, either or both of:
+//   - a text file rewritten every `interval` (via rename, so readers such as
+//     node_exporter's textfile collector never see a partial file)
+//   - a loopback HTTP listener answering GET /metrics
+// Stops and writes the file a final time on destruction.
+class MetricsExporter {
+ public:
+  struct Options {
+    std::filesystem::path file;  // empty: no file
+    std::chrono::seconds interval{10};
+    std::optional<std::uint16_t> listen_port;  // 0 picks a free port
+  };
+
+  explicit MetricsExporter(
+    Options opts, metrics::Registry& registry = metrics::Registry::Instance());
+  ~MetricsExporter();
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+  /// Rewrite the file now
+  bool WriteFile() const;
+
+  /// Port the listener is bound to (0 if not listening)
+  std::uint16_t Port() const {
+    return port_;
+  }
+
+ private:
+  void FileLoop();
+  void Listen();
+  void Serve(int fd) const;
+
+  const Options opts_;
+  metrics::Registry& registry_;
+  int listen_fd_{-1};
+  std::uint16_t port_{0};
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  bool stop_{false};
+  std::thread file_thread_;
+  std::thread listen_thread_;
+};
@@ -0,0 +1,251 @@
+#include "Resolver.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#include <arpa/inet.h>  // inet_pton, inet_ntop
+#include <arpa/nameser.h>
+#include <netinet/in.h>
+#include <resolv.h>
+
+namespace {
+// Split "scheme://host[:port]/..." into host and port (default by scheme)
+bool HostPortFromUrl(const std::string& url, std::string& host, int& port) {
+  const auto scheme_end = url.find("://");
+  const std::string scheme =
+    scheme_end == std::string::npos ? "" : url.substr(0, scheme_end);
+  const size_t begin = scheme_end == std::string::npos ? 0 : scheme_end + 3;
+  const size_t end = url.find_first_of("/?#", begin);
+  std::string hostport = url.substr(begin, end - begin);
+  if (auto at = hostport.rfind('@'); at != std::string::npos)
+    hostport.erase(0, at + 1);  // userinfo
+
+  port = scheme == "http" ? 80 : 443;
+  if (!hostport.empty() && hostport.front() == '[') {
+    return false;  // IPv6 literal; nothing to resolve
+  }
+  if (auto colon = hostport.rfind(':'); colon != std::string::npos) {
+    try {
+      port = std::stoi(hostport.substr(colon + 1));
+    } catch (...) {
+      return false;
+    }
+    hostport.erase(colon);
+  }
+  host = std::move(hostport);
+  return !host.empty();
+}
+
+bool IsIpLiteral(const std::string& host) {
+  unsigned char buf[sizeof(struct in6_addr)];
+  return ::inet_pton(AF_INET, host.c_str(), buf) == 1 ||
+         ::inet_pton(AF_INET6, host.c_str(), buf) == 1;
+}
+}  // namespace
+
+Resolver::Resolver(Options opts) : opts_{std::move(opts)}, jobs_{1024} {
+  const unsigned n = std::max(1u, opts_.threads);
+  workers_.reserve(n);
+  for (unsigned i = 0; i < n; ++i)
+    workers_.emplace_back([this] { Worker(); });
+}
+
+Resolver::~Resolver() {
+  jobs_.close();
+  for (auto& t : workers_)
+    t.join();
+}
+
+std::optional<Resolver::Options>& Resolver::PendingOptions() {
+  static std::optional<Options> opts;
+  return opts;
+}
+
+void Resolver::Configure(Options opts) {
+  PendingOptions() = std::move(opts);
+}
+
+Resolver& Resolver::Instance() {
+  static Resolver instance(PendingOptions().value_or(Options{}));
+  return instance;
+}
+
+std::shared_future<Resolver::Result> Resolver::ResolveAsync(
+  const std::string& host) {
+  auto ready = [](Result r) {
+    std::promise<Result> p;
+    p.set_value(std::move(r));
+    return p.get_future().share();
+  };
+
+  const auto now = Clock::now();
+  if (IsIpLiteral(host))
+    return ready(Result{{host}, Clock::time_point::max()});
+
+  {
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+    if (auto it = cache_.find(host);
+        it != cache_.end() && it->second.expires > now)
+      return ready(it->second);
+    if (auto it = pending_.find(host); it != pending_.end())
+      return it->second;
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mtx_);
+  if (auto it = cache_.find(host);
+      it != cache_.end() && it->second.expires > now)
+    return ready(it->second);
+  if (auto it = pending_.find(host); it != pending_.end())
+    return it->second;
+
+  auto promise = std::make_shared<std::promise<Result>>();
+  auto future = promise->get_future().share();
+  pending_.emplace(host, future);
+  lock.unlock();
+
+  if (!jobs_.push(Job{host, promise})) {
+    // shutting down; answer negatively rather than hang the caller
+    {
+      std::lock_guard<std::shared_mutex> relock(mtx_);
+      pending_.erase(host);
+    }
+    promise->set_value(Result{{}, now});
+  }
+  return future;
+}
+
+Resolver::Result Resolver::Resolve(const std::string& host) {
+  return ResolveAsync(host).get();
+}
+
+std::optional<Resolver::Result> Resolver::Cached(
+  const std::string& host) const {
+  std::shared_lock<std::shared_mutex> lock(mtx_);
+  if (auto it = cache_.find(host);
+      it != cache_.end() && it->second.expires > Clock::now())
+    return it->second;
+  return std::nullopt;
+}
+
+std::string Resolver::CurlResolveEntry(const std::string& url) {
+  std::string host;
+  int port = 0;
+  if (!HostPortFromUrl(url, host, port) || IsIpLiteral(host))
+    return {};
+
+  const auto result = Resolve(host);
+  if (!result.Ok())
+    return {};
+
+  std::string entry = host + ":" + std::to_string(port) + ":";
+  for (size_t i = 0; i < result.addresses.size(); ++i) {
+    if (i)
+      entry += ',';
+    entry += result.addresses[i];
+  }
+  return entry;
+}
+
+void Resolver::Worker() {
+  struct __res_state state;
+  std::memset(&state, 0, sizeof(state));
+  if (::res_ninit(&state) != 0) {
+    logr::error << "[Resolver] res_ninit failed";
+  }
+  state.retrans = static_cast<int>(opts_.timeout.count());
+  state.retry = 2;
+
+  if (!opts_.nameservers.empty()) {
+    int n = 0;
+    for (const auto& [addr, port] : opts_.nameservers) {
+      if (n >= MAXNS)
+        break;
+      sockaddr_in sa{};
+      sa.sin_family = AF_INET;
+      sa.sin_port = htons(port);
+      if (::inet_pton(AF_INET, addr.c_str(), &sa.sin_addr) != 1) {
+        logr::warning << "[Resolver] ignoring nameserver " << addr;
+        continue;
+      }
+      state.nsaddr_list[n++] = sa;
+    }
+    state.nscount = n;
+  }
+
+  while (auto job = jobs_.pop()) {
+    Result result = Lookup(&state, job->host);
+    {
+      std::lock_guard<std::shared_mutex> lock(mtx_);
+      if (cache_.size() >= opts_.max_entries) {
+        const auto now = Clock::now();
+        std::erase_if(cache_, [&](const auto& kv) {
+          return kv.second.expires <= now;
+        });
+        if (!cache_.empty() && cache_.size() >= opts_.max_entries) {
+          // still full of live answers: drop the eighth closest to expiry
+          std::vector<Clock::time_point> expiries;
+          expiries.reserve(cache_.size());
+          for (const auto& [name, r] : cache_)
+            expiries.push_back(r.expires);
+          const size_t drop = std::max<size_t>(1, cache_.size() / 8);
+          std::nth_element(expiries.begin(), expiries.begin() + (drop - 1),
+                           expiries.end());
+          const auto cutoff = expiries[drop - 1];
+          std::erase_if(cache_, [&](const auto& kv) {
+            return kv.second.expires <= cutoff;
+          });
+        }
+      }
+      cache_[job->host] = result;
+      pending_.erase(job->host);
+    }
+    job->promise->set_value(std::move(result));
+  }
+
+  ::res_nclose(&state);
+}
+
+Resolver::Result Resolver::Lookup(void* res_state, const std::string& host) {
+  auto* statp = static_cast<struct __res_state*>(res_state);
+  Result result;
+  std::uint32_t ttl = std::numeric_limits<std::uint32_t>::max();
+
+  for (int type : {ns_t_a, ns_t_aaaa}) {
+    unsigned char answer[4096];
+    queries_.fetch_add(1, std::memory_order_relaxed);
+    const int len = ::res_nquery(statp, host.c_str(), ns_c_in, type, answer,
+                                 sizeof(answer));
+    if (len < 0)
+      continue;  // NXDOMAIN, NODATA, SERVFAIL or timeout
+
+    ns_msg msg;
+    if (::ns_initparse(answer, len, &msg) < 0)
+      continue;
+    for (int i = 0; i < ns_msg_count(msg, ns_s_an); ++i) {
+      ns_rr rr;
+      if (::ns_parserr(&msg, ns_s_an, i, &rr) < 0 || ns_rr_type(rr) != type)
+        continue;
+      char buf[INET6_ADDRSTRLEN] = {0};
+      const int af = type == ns_t_a ? AF_INET : AF_INET6;
+      if (!::inet_ntop(af, ns_rr_rdata(rr), buf, sizeof(buf)))
+        continue;
+      result.addresses.push_back(af == AF_INET6 ? "[" + std::string(buf) + "]"
+                                                : std::string(buf));
+      ttl = std::min<std::uint32_t>(ttl, ns_rr_ttl(rr));
+    }
+  }
+
+  const auto now = Clock::now();
+  if (result.addresses.empty()) {
+    result.expires = now + opts_.negative_ttl;
+    LOGR_DEBUG << "[Resolver] no address for " << host;
+  } else {
+    auto keep = std::chrono::seconds(ttl);
+    keep = std::clamp(keep, opts_.min_ttl, opts_.max_ttl);
+    result.expires = now + keep;
+  }
+  return result;
+}
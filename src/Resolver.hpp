@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "MPMCQueue.hpp"
+
+// Process-wide DNS resolver: a small pool of threads issuing A/AAAA queries
+// with res_nquery(3), so answers carry their TTLs, in front of a shared
+// positive/negative cache. Concurrent lookups of one name share a single
+// query. Results feed libcurl through CURLOPT_RESOLVE (CurlResolveEntry), so
+// easy handles never run their own blocking lookups.
+class Resolver {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    unsigned threads{4};
+    std::chrono::seconds min_ttl{5};
+    std::chrono::seconds max_ttl{3600};
+    std::chrono::seconds negative_ttl{60};
+    std::chrono::seconds timeout{2};  // per query attempt
+    size_t max_entries{65536};
+    // IPv4 "addr" / port pairs; empty means /etc/resolv.conf
+    std::vector<std::pair<std::string, std::uint16_t>> nameservers;
+  };
+
+  struct Result {
+    std::vector<std::string> addresses;  // IPv4 dotted, IPv6 bracketed
+    Clock::time_point expires{};
+    bool Ok() const {
+      return !addresses.empty();
+    }
+  };
+
+  explicit Resolver(Options opts);
+  ~Resolver();
+  Resolver(const Resolver&) = delete;
+  Resolver& operator=(const Resolver&) = delete;
+
+  /// Set the options of the shared instance; only effective before its
+  /// first use
+  static void Configure(Options opts);
+
+  /// The shared instance
+  static Resolver& Instance();
+
+  /// Start (or join) a lookup; cached answers are returned ready
+  std::shared_future<Result> ResolveAsync(const std::string& host);
+
+  /// Blocking lookup
+  Result Resolve(const std::string& host);
+
+  /// Cached, unexpired answer (positive or negative) if any
+  std::optional<Result> Cached(const std::string& host) const;
+
+  /// "host:port:addr,addr" for CURLOPT_RESOLVE, or "" if `url` has an IP
+  /// literal host or the name did not resolve
+  std::string CurlResolveEntry(const std::string& url);
+
+  /// Number of DNS queries sent (A and AAAA count separately)
+  std::uint64_t QueryCount() const {
+    return queries_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Job {
+    std::string host;
+    std::shared_ptr<std::promise<Result>> promise;
+  };
+
+  void Worker();
+  Result Lookup(void* res_state, const std::string& host);
+
+  static std::optional<Options>& PendingOptions();
+
+  Options opts_;
+  mutable std::shared_mutex mtx_;
+  std::unordered_map<std::string, Result> cache_;
+  std::unordered_map<std::string, std::shared_future<Result>> pending_;
+  MPMCQueue<Job> jobs_;
+  std::vector<std::thread> workers_;
+  std::atomic<std::uint64_t> queries_{0};
+};
@@ -0,0 +1,115 @@
+#include "ResultSink.hpp"
+#include "Logger.hpp"
+
+std::unique_ptr<ResultSink> ResultSink::Create(const Options& opts,
+                                               CacheManager& cache) {
+  switch (opts.format) {
+    case Format::Jsonl:
+      return std::make_unique<JsonlResultSink>(opts);
+    case Format::Cache:
+    default:
+      return std::make_unique<CacheResultSink>(cache);
+  }
+}
+
+void CacheResultSink::Write(const URL& url, const nlohmann::json& result) {
+  cache_.Store(url, result);
+}
+
+JsonlResultSink::JsonlResultSink(Options opts)
+    : opts_{std::move(opts)}, writer_{opts_.file} {
+  thread_ = std::thread([this] { Run(); });
+}
+
+JsonlResultSink::~JsonlResultSink() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+
+  const auto stats = GetStats();
+  logr::info << "[ResultSink] " << stats.records << " result(s), "
+             << stats.bytes / 1024 << " KiB in " << stats.batches
+             << " batch(es), " << writer_.FilesClosed() << " file(s)";
+}
+
+void JsonlResultSink::Write(const URL& url, const nlohmann::json& result) {
+  nlohmann::json line = {
+    {"url", url.ToString()},
+    {"time", std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+               .count()},
+    {"result", result}};
+  std::string text =
+    line.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+  text.push_back('\n');
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  drained_.wait(lock, [this] {
+    return pending_.size() < opts_.max_pending || stop_;
+  });
+  pending_.push_back(std::move(text));
+  ++enqueued_;
+  if (pending_.size() == opts_.batch)
+    wake_.notify_one();
+}
+
+void JsonlResultSink::Flush() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  const auto target = enqueued_;
+  flush_ = true;
+  wake_.notify_one();
+  drained_.wait(lock, [&] { return flushed_ >= target || stop_; });
+}
+
+void JsonlResultSink::Run() {
+  std::vector<std::string> batch;
+  std::string blob;
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    wake_.wait_for(lock, opts_.flush_interval, [this] {
+      return stop_ || flush_ || pending_.size() >= opts_.batch;
+    });
+    const bool stopping = stop_;
+    const bool flush = flush_;
+    flush_ = false;
+    batch.swap(pending_);
+    lock.unlock();
+    drained_.notify_all();  // room again
+
+    // Write in slices of `batch` records so rotation stays fine-grained
+    for (size_t i = 0; i < batch.size(); i += opts_.batch) {
+      blob.clear();
+      const size_t end = std::min(batch.size(), i + opts_.batch);
+      for (size_t k = i; k < end; ++k)
+        blob += batch[k];
+      writer_.Write(blob);
+      std::lock_guard<std::mutex> stats_lock(mtx_);
+      stats_.records += end - i;
+      stats_.bytes += blob.size();
+      stats_.batches++;
+    }
+    if (flush || stopping)
+      writer_.Flush();
+    writer_.RotateIfStale();
+    const size_t n = batch.size();
+    batch.clear();
+
+    lock.lock();
+    written_ += n;
+    if (flush || stopping)
+      flushed_ = written_;
+    drained_.notify_all();
+    if (stopping && pending_.empty())
+      break;
+  }
+  lock.unlock();
+  writer_.Rotate();
+}
+
+JsonlResultSink::Stats JsonlResultSink::GetStats() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return stats_;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CacheManager.hpp"
+#include "ResultWriter.hpp"
+#include "URL.hpp"
+
+// Destination for Lua results, shared by every Crawler. Write() is called
+// from the store stage's workers and must be thread-safe.
+class ResultSink {
+ public:
+  enum class Format { Cache, Jsonl };
+
+  struct Options {
+    Format format{Format::Cache};
+    ResultWriter::Options file;  // Jsonl
+    size_t batch{512};           // records per write
+    std::chrono::milliseconds flush_interval{1000};
+    size_t max_pending{65536};  // Write() blocks beyond this
+  };
+
+  virtual ~ResultSink() = default;
+
+  virtual void Write(const URL& url, const nlohmann::json& result) = 0;
+
+  /// Block until everything written so far has reached the OS
+  virtual void Flush() {
+  }
+
+  static std::unique_ptr<ResultSink> Create(const Options& opts,
+                                            CacheManager& cache);
+};
+
+// One pretty-printed <sha256(url)>.json per URL in the cache directory
+class CacheResultSink : public ResultSink {
+ public:
+  explicit CacheResultSink(CacheManager& cache) : cache_{cache} {
+  }
+
+  void Write(const URL& url, const nlohmann::json& result) override;
+
+ private:
+  CacheManager& cache_;
+};
+
+// Compact JSONL, one {"url", "time", "result"} object per line, through a
+// rotating ResultWriter. Callers only serialise and enqueue; a background
+// thread writes the queue out in batches of up to `batch` records, at least
+// every `flush_interval`, and closes stale files.
+class JsonlResultSink : public ResultSink {
+ public:
+  explicit JsonlResultSink(Options opts);
+  ~JsonlResultSink() override;
+
+  void Write(const URL& url, const nlohmann::json& result) override;
+  void Flush() override;
+
+  struct Stats {
+    std::uint64_t records{0};
+    std::uint64_t batches{0};
+    std::uint64_t bytes{0};
+  };
+  Stats GetStats() const;
+
+ private:
+  void Run();
+
+  const Options opts_;
+  ResultWriter writer_;  // writer thread only
+
+  mutable std::mutex mtx_;
+  std::condition_variable wake_;     // writer: work or stop
+  std::condition_variable drained_;  // callers: room, or a batch written
+  std::vector<std::string> pending_;
+  std::uint64_t enqueued_{0};
+  std::uint64_t written_{0};
+  std::uint64_t flushed_{0};  // written_ as of the last writer flush
+  bool flush_{false};
+  bool stop_{false};
+  Stats stats_;
+  std::thread thread_;
+};
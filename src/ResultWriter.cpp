@@ -1,7 +1,78 @@
 #include "ResultWriter.hpp"
-#include <fstream>
+#include "Logger.hpp"
 
-void ResultWriter::save(const std::string& filename, const std::string& data) {
-  std::ofstream file("results/" + filename);
-  file << data;
+#include <ctime>
+#include <system_error>
+
+ResultWriter::ResultWriter(Options opts) : opts_{std::move(opts)} {
+}
+
+ResultWriter::~ResultWriter() {
+  Rotate();
+}
+
+bool ResultWriter::Open() {
+  std::error_code ec;
+  std::filesystem::create_directories(opts_.dir, ec);
+
+  char stamp[32];
+  const std::time_t now = std::time(nullptr);
+  std::tm tm{};
+  ::gmtime_r(&now, &tm);
+  std::strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%SZ", &tm);
+  path_ = opts_.dir / (opts_.prefix + "-" + stamp + "-" +
+                       std::to_string(next_++) + opts_.ext);
+
+  out_.open(path_.string() + ".part", std::ios::binary | std::ios::trunc);
+  if (!out_) {
+    logr::error << "[ResultWriter] cannot open " << path_ << ".part";
+    return false;
+  }
+  bytes_ = 0;
+  opened_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+std::optional<ResultWriter::Location> ResultWriter::Write(
+  std::string_view data) {
+  if (out_.is_open() && bytes_ > 0 &&
+      bytes_ + data.size() > opts_.max_bytes)
+    Rotate();
+  RotateIfStale();
+  if (!out_.is_open() && !Open())
+    return std::nullopt;
+
+  Location at{path_, bytes_};
+  out_.write(data.data(), static_cast<std::streamsize>(data.size()));
+  if (!out_) {
+    logr::error << "[ResultWriter] write failed on " << path_ << ".part";
+    return std::nullopt;
+  }
+  bytes_ += data.size();
+  return at;
+}
+
+void ResultWriter::Flush() {
+  if (out_.is_open())
+    out_.flush();
+}
+
+void ResultWriter::RotateIfStale() {
+  if (out_.is_open() &&
+      std::chrono::steady_clock::now() - opened_ >= opts_.max_age)
+    Rotate();
+}
+
+void ResultWriter::Rotate() {
+  if (!out_.is_open())
+    return;
+  out_.close();
+  std::error_code ec;
+  std::filesystem::rename(path_.string() + ".part", path_, ec);
+  if (ec) {
+    logr::error << "[ResultWriter] cannot rename " << path_
+                << ".part: " << ec.message();
+    return;
+  }
+  ++closed_;
 }
@@ -1,11 +1,72 @@
 #ifndef RESULT_WRITER_HPP
 #define RESULT_WRITER_HPP
 
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
 #include <string>
+#include <string_view>
 
+// Appends records to a series of output files
+//
+//   <dir>/<prefix>-<UTC yyyymmddThhmmssZ>-<n><ext>
+//
+// starting the next file once the current one would pass `max_bytes` or has
+// been open for `max_age`. A record is never split across files. Each file
+// is written as <name>.part and renamed when it is closed, so a reader that
+// ignores *.part only ever sees complete files. Not thread-safe: one thread
+// owns a writer.
 class ResultWriter {
  public:
-  void save(const std::string& filename, const std::string& data);
+  struct Options {
+    std::filesystem::path dir;
+    std::string prefix{"results"};
+    std::string ext{".jsonl"};
+    std::uint64_t max_bytes{256ull << 20};
+    std::chrono::seconds max_age{3600};
+  };
+
+  // Where a record landed: the file's final name and its byte offset
+  struct Location {
+    std::filesystem::path file;
+    std::uint64_t offset{0};
+  };
+
+  explicit ResultWriter(Options opts);
+  ~ResultWriter();
+  ResultWriter(const ResultWriter&) = delete;
+  ResultWriter& operator=(const ResultWriter&) = delete;
+
+  /// Append one record (or a batch that must stay together)
+  std::optional<Location> Write(std::string_view data);
+
+  /// Push buffered bytes to the OS
+  void Flush();
+
+  /// Close the current file, if any; the next Write() opens a new one
+  void Rotate();
+
+  /// Rotate() if the current file has been open for max_age, so an idle
+  /// stream still hands over its last file
+  void RotateIfStale();
+
+  /// Files closed so far
+  std::uint64_t FilesClosed() const {
+    return closed_;
+  }
+
+ private:
+  bool Open();
+
+  const Options opts_;
+  std::ofstream out_;
+  std::filesystem::path path_;  // final name of the open file
+  std::uint64_t bytes_{0};
+  std::chrono::steady_clock::time_point opened_{};
+  std::uint64_t next_{0};
+  std::uint64_t closed_{0};
 };
 
 #endif  // RESULT_WRITER_HPP
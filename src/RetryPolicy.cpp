@@ -0,0 +1,130 @@
+#include "RetryPolicy.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+RetryPolicy::RetryPolicy(Options opts, std::uint64_t seed)
+    : opts_{std::move(opts)}, rng_{seed} {
+  opts_.jitter = std::clamp(opts_.jitter, 0.0, 1.0);
+}
+
+const char* RetryPolicy::Name(Outcome o) {
+  static const char* const kNames[kOutcomes] = {
+    "ok",     "dns",          "connect", "transfer", "tls",
+    "server", "rate_limited", "client",  "other"};
+  return kNames[static_cast<size_t>(o)];
+}
+
+RetryPolicy::Outcome RetryPolicy::Classify(CURLcode code, long http_status,
+                                           bool retry_after, bool connected) {
+  switch (code) {
+    case CURLE_OK:
+      break;
+    case CURLE_COULDNT_RESOLVE_HOST:
+    case CURLE_COULDNT_RESOLVE_PROXY:
+      return Outcome::Dns;
+    case CURLE_COULDNT_CONNECT:
+      return Outcome::Connect;
+    case CURLE_OPERATION_TIMEDOUT:
+      return connected ? Outcome::Transfer : Outcome::Connect;
+    case CURLE_SEND_ERROR:
+    case CURLE_RECV_ERROR:
+    case CURLE_GOT_NOTHING:
+    case CURLE_PARTIAL_FILE:
+    case CURLE_HTTP2:
+    case CURLE_HTTP2_STREAM:
+      return Outcome::Transfer;
+    case CURLE_SSL_CONNECT_ERROR:
+    case CURLE_PEER_FAILED_VERIFICATION:
+    case CURLE_SSL_CERTPROBLEM:
+    case CURLE_SSL_CIPHER:
+    case CURLE_SSL_CACERT_BADFILE:
+    case CURLE_SSL_ISSUER_ERROR:
+    case CURLE_SSL_INVALIDCERTSTATUS:
+    case CURLE_SSL_PINNEDPUBKEYNOTMATCH:
+      return Outcome::Tls;
+    case CURLE_TOO_MANY_REDIRECTS:
+    case CURLE_URL_MALFORMAT:
+    case CURLE_UNSUPPORTED_PROTOCOL:
+      return Outcome::Client;
+    default:
+      return Outcome::Other;
+  }
+
+  if (http_status >= 200 && http_status < 300)
+    return Outcome::Ok;
+  if (http_status == 429 || (http_status == 503 && retry_after))
+    return Outcome::RateLimited;
+  if (http_status >= 500 || http_status == 408)
+    return Outcome::Server;
+  if (http_status >= 300)
+    return Outcome::Client;
+  return Outcome::Other;  // no status line at all
+}
+
+std::optional<std::chrono::seconds> RetryPolicy::ParseRetryAfter(
+  const std::string& value, Clock::time_point now) {
+  // header bytes may be >= 0x80: negative as char, undefined for <cctype>
+  auto space = [](char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+  };
+  auto digit = [](char c) {
+    return std::isdigit(static_cast<unsigned char>(c)) != 0;
+  };
+  auto first = std::find_if_not(value.begin(), value.end(), space);
+  auto last = std::find_if_not(value.rbegin(), value.rend(), space).base();
+  if (first >= last)
+    return std::nullopt;
+
+  // delta-seconds
+  if (std::all_of(first, last, digit)) {
+    long long secs = 0;
+    auto r = std::from_chars(&*first, &*first + (last - first), secs);
+    if (r.ec != std::errc{})
+      return std::nullopt;
+    return std::chrono::seconds(secs);
+  }
+
+  // HTTP-date (IMF-fixdate and the obsolete forms curl_getdate accepts)
+  const std::string date(first, last);
+  const time_t when = curl_getdate(date.c_str(), nullptr);
+  if (when < 0)
+    return std::nullopt;
+  const auto delta = std::chrono::duration_cast<std::chrono::seconds>(
+    Clock::from_time_t(when) - now);
+  return std::max(delta, std::chrono::seconds(0));
+}
+
+std::optional<std::chrono::milliseconds> RetryPolicy::Delay(
+  Outcome outcome, unsigned attempt,
+  std::optional<std::chrono::seconds> retry_after) {
+  if (outcome == Outcome::Ok || attempt == 0)
+    return std::nullopt;
+  const Backoff& b = opts_.For(outcome);
+  if (attempt > b.max_retries)
+    return std::nullopt;
+  if (retry_after.has_value() && *retry_after > opts_.max_retry_after)
+    return std::nullopt;
+
+  // base * 2^(attempt-1), saturating at cap
+  auto delay = b.base;
+  for (unsigned i = 1; i < attempt && delay < b.cap; ++i)
+    delay *= 2;
+  delay = std::min(delay, b.cap);
+
+  if (opts_.jitter > 0 && delay.count() > 0) {
+    double u;
+    {
+      std::lock_guard<std::mutex> lock(rng_mtx_);
+      u = std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+    }
+    delay = std::chrono::milliseconds(static_cast<long long>(
+      static_cast<double>(delay.count()) * (1.0 - opts_.jitter * u)));
+  }
+
+  // the server's word is a floor; jitter never undercuts it
+  if (retry_after.has_value())
+    delay = std::max<std::chrono::milliseconds>(delay, *retry_after);
+  return delay;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <curl/curl.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+
+// Decides whether and when a failed fetch is tried again. Outcomes are
+// classified from the curl result and HTTP status; each class has its own
+// retry budget and exponential backoff (base * 2^(attempt-1), capped), with
+// jitter so retries against one host do not arrive in lockstep. A 429/503
+// Retry-After is honoured as a lower bound.
+class RetryPolicy {
+ public:
+  using Clock = std::chrono::system_clock;
+
+  enum class Outcome {
+    Ok = 0,
+    Dns,          // name did not resolve
+    Connect,      // refused, or timed out before connecting
+    Transfer,     // connected, then reset, cut short or timed out
+    Tls,          // handshake or verification failed
+    Server,       // 5xx, 408
+    RateLimited,  // 429, or 503 with Retry-After
+    Client,       // other 4xx and unfollowed 3xx: permanent
+    Other,        // any other curl error
+  };
+  static constexpr size_t kOutcomes = 9;
+
+  struct Backoff {
+    unsigned max_retries{0};
+    std::chrono::milliseconds base{0};
+    std::chrono::milliseconds cap{0};
+  };
+
+  struct Options {
+    // indexed by Outcome; the Ok entry is unused
+    std::array<Backoff, kOutcomes> backoff{{
+      {},
+      {2, std::chrono::seconds(60), std::chrono::seconds(300)},   // Dns
+      {3, std::chrono::seconds(2), std::chrono::seconds(60)},     // Connect
+      {3, std::chrono::seconds(5), std::chrono::seconds(120)},    // Transfer
+      {1, std::chrono::seconds(5), std::chrono::seconds(5)},      // Tls
+      {3, std::chrono::seconds(5), std::chrono::seconds(120)},    // Server
+      {5, std::chrono::seconds(30), std::chrono::seconds(600)},   // RateLimited
+      {0, {}, {}},                                                // Client
+      {1, std::chrono::seconds(5), std::chrono::seconds(5)},      // Other
+    }};
+    // fraction of each delay that is randomised: delay * (1 - jitter * U[0,1))
+    double jitter{0.5};
+    // a longer Retry-After gives up rather than parking the URL
+    std::chrono::seconds max_retry_after{3600};
+
+    Backoff& For(Outcome o) {
+      return backoff[static_cast<size_t>(o)];
+    }
+    const Backoff& For(Outcome o) const {
+      return backoff[static_cast<size_t>(o)];
+    }
+  };
+
+  explicit RetryPolicy(Options opts,
+                       std::uint64_t seed = std::random_device{}());
+
+  /// Lower-case name used in config keys, logs and the dead-letter file
+  static const char* Name(Outcome o);
+
+  /// Classify a finished transfer; `http_status` is ignored unless `code`
+  /// is CURLE_OK. `retry_after` says whether the response carried one;
+  /// `connected` whether the transfer got a connection, which tells a
+  /// timeout mid-body from one while connecting.
+  static Outcome Classify(CURLcode code, long http_status,
+                          bool retry_after = false, bool connected = false);
+
+  /// Parse a Retry-After value: delta-seconds or an HTTP-date
+  static std::optional<std::chrono::seconds> ParseRetryAfter(
+    const std::string& value, Clock::time_point now = Clock::now());
+
+  /// Delay before retry number `attempt` (1-based, counting failed fetches
+  /// so far) or nullopt once the class's budget is spent
+  std::optional<std::chrono::milliseconds> Delay(
+    Outcome outcome, unsigned attempt,
+    std::optional<std::chrono::seconds> retry_after = std::nullopt);
+
+  const Options& GetOptions() const {
+    return opts_;
+  }
+
+ private:
+  Options opts_;
+  std::mutex rng_mtx_;
+  std::mt19937_64 rng_;
+};
@@ -0,0 +1,243 @@
+#include "SimHash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <utility>
+
+namespace {
+constexpr std::uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr std::uint64_t kFnvPrime = 0x100000001b3ull;
+
+// splitmix64 finaliser: spreads a combined shingle hash over all 64 bits
+std::uint64_t Mix(std::uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+bool IsWordByte(unsigned char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+         (c >= 'A' && c <= 'Z') || c >= 0x80;
+}
+
+bool IEquals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size())
+    return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    const auto c = static_cast<unsigned char>(a[i]);
+    if ((c >= 'A' && c <= 'Z' ? c + 32 : c) != b[i])
+      return false;
+  }
+  return true;
+}
+
+// Index just past the markup starting at body[i] == '<': a comment, a tag,
+// or a whole <script>/<style> element through its end tag. A '<' that does
+// not open a tag ("a < b") is one byte of text.
+size_t SkipMarkup(std::string_view body, size_t i) {
+  if (body.substr(i, 4) == "<!--") {
+    const size_t end = body.find("-->", i + 4);
+    return end == std::string_view::npos ? body.size() : end + 3;
+  }
+  size_t j = i + 1;
+  const bool closing = j < body.size() && body[j] == '/';
+  if (closing)
+    ++j;
+  const size_t name_start = j;
+  while (j < body.size() &&
+         std::isalpha(static_cast<unsigned char>(body[j])))
+    ++j;
+  const std::string_view name = body.substr(name_start, j - name_start);
+  if (name.empty() && !closing && j < body.size() && body[j] != '!' &&
+      body[j] != '?')
+    return i + 1;
+
+  const size_t tag_end = body.find('>', j);
+  if (tag_end == std::string_view::npos)
+    return body.size();
+  if (closing || !(IEquals(name, "script") || IEquals(name, "style")))
+    return tag_end + 1;
+
+  // raw text up to the matching end tag is not page text
+  for (size_t k = body.find("</", tag_end); k != std::string_view::npos;
+       k = body.find("</", k + 2)) {
+    if (IEquals(body.substr(k + 2, name.size()), name)) {
+      const size_t end = body.find('>', k);
+      return end == std::string_view::npos ? body.size() : end + 1;
+    }
+  }
+  return body.size();
+}
+
+// Index just past a character reference (&amp; &#39; &#x2014;) at
+// body[i] == '&', or i when there is none
+size_t SkipEntity(std::string_view body, size_t i) {
+  size_t j = i + 1;
+  while (j < body.size() && j - i <= 32 &&
+         (std::isalnum(static_cast<unsigned char>(body[j])) || body[j] == '#'))
+    ++j;
+  return j > i + 1 && j < body.size() && body[j] == ';' ? j + 1 : i;
+}
+
+constexpr size_t kBlock = 64;
+
+// votes[b] += number of hashes in the block with bit b set
+void Vote(const std::uint64_t* hashes, size_t n,
+          std::array<std::uint32_t, 64>& votes) {
+  for (unsigned b = 0; b < 64; ++b) {
+    std::uint32_t ones = 0;
+    for (size_t i = 0; i < n; ++i)
+      ones += static_cast<std::uint32_t>((hashes[i] >> b) & 1);
+    votes[b] += ones;
+  }
+}
+}  // namespace
+
+std::optional<std::uint64_t> SimHash::Fingerprint(std::string_view body,
+                                                  unsigned shingle) {
+  shingle = std::max(1u, shingle);
+  std::vector<std::uint64_t> window(shingle);  // ring of word hashes
+  std::array<std::uint64_t, kBlock> block;
+  std::array<std::uint32_t, 64> votes{};
+  size_t words = 0, pending = 0;
+  std::uint64_t shingles = 0;
+
+  auto add_word = [&](std::uint64_t word) {
+    window[words % shingle] = word;
+    if (++words < shingle)
+      return;
+    // oldest word first, so the shingle hash depends on word order
+    std::uint64_t h = kFnvOffset;
+    for (unsigned k = 0; k < shingle; ++k)
+      h = (h ^ window[(words + k) % shingle]) * kFnvPrime;
+    block[pending++] = Mix(h);
+    ++shingles;
+    if (pending == kBlock) {
+      Vote(block.data(), pending, votes);
+      pending = 0;
+    }
+  };
+
+  std::uint64_t word = kFnvOffset;
+  bool in_word = false;
+  for (size_t i = 0; i < body.size(); ++i) {
+    const auto c = static_cast<unsigned char>(body[i]);
+    if (c == '<' || c == '&') {
+      // markup separates words like whitespace does
+      if (in_word) {
+        add_word(word);
+        word = kFnvOffset;
+        in_word = false;
+      }
+      const size_t next = c == '<' ? SkipMarkup(body, i) : SkipEntity(body, i);
+      i = std::max(next, i + 1) - 1;
+      continue;
+    }
+    if (IsWordByte(c)) {
+      const unsigned char lower = c >= 'A' && c <= 'Z' ? c + 32 : c;
+      word = (word ^ lower) * kFnvPrime;
+      in_word = true;
+    } else if (in_word) {
+      add_word(word);
+      word = kFnvOffset;
+      in_word = false;
+    }
+  }
+  if (in_word)
+    add_word(word);
+  if (shingles == 0)
+    return std::nullopt;
+  Vote(block.data(), pending, votes);
+
+  // a bit is set when most shingles set it
+  std::uint64_t fingerprint = 0;
+  for (unsigned b = 0; b < 64; ++b) {
+    if (2ull * votes[b] > shingles)
+      fingerprint |= 1ull << b;
+  }
+  return fingerprint;
+}
+
+SimHashIndex::SimHashIndex(Options opts) : opts_{std::move(opts)} {
+  const unsigned n = std::min(opts_.max_distance, kMaxDistance) + 1;
+  unsigned shift = 0;
+  for (unsigned i = 0; i < n; ++i) {
+    const unsigned bits = 64 / n + (i < 64 % n ? 1 : 0);
+    band_shift_.push_back(shift);
+    band_bits_.push_back(bits);
+    shift += bits;
+  }
+  bands_.resize(n);
+}
+
+std::uint64_t SimHashIndex::Band(std::uint64_t fingerprint,
+                                 unsigned band) const {
+  const unsigned bits = band_bits_[band];
+  const std::uint64_t mask = bits >= 64 ? ~0ull : (1ull << bits) - 1;
+  return (fingerprint >> band_shift_[band]) & mask;
+}
+
+std::optional<SimHashIndex::Match> SimHashIndex::Check(
+  const std::string& url, std::string_view body) {
+  const auto fingerprint = SimHash::Fingerprint(body, opts_.shingle);
+  if (!fingerprint.has_value())
+    return std::nullopt;
+  return Insert(url, *fingerprint);
+}
+
+std::optional<SimHashIndex::Match> SimHashIndex::Insert(
+  const std::string& url, std::uint64_t fingerprint) {
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  // closest earlier page sharing a band, first seen on ties
+  std::optional<std::uint32_t> best;
+  unsigned best_distance = static_cast<unsigned>(bands_.size());
+  for (unsigned b = 0; b < bands_.size(); ++b) {
+    auto it = bands_[b].find(Band(fingerprint, b));
+    if (it == bands_[b].end())
+      continue;
+    for (const std::uint32_t i : it->second) {
+      const unsigned d = SimHash::Distance(fingerprint, pages_[i].fingerprint);
+      if (d < best_distance || (d == best_distance && best && i < *best)) {
+        best = i;
+        best_distance = d;
+      }
+    }
+  }
+
+  if (best.has_value()) {
+    auto& page = pages_[*best];
+    page.duplicates.push_back({url, best_distance});
+    ++duplicates_;
+    return Match{page.url, best_distance};
+  }
+
+  const auto index = static_cast<std::uint32_t>(pages_.size());
+  pages_.push_back({fingerprint, url, {}});
+  for (unsigned b = 0; b < bands_.size(); ++b)
+    bands_[b][Band(fingerprint, b)].push_back(index);
+  return std::nullopt;
+}
+
+std::vector<SimHashIndex::Cluster> SimHashIndex::Clusters() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  std::vector<Cluster> out;
+  for (const auto& page : pages_) {
+    if (!page.duplicates.empty())
+      out.push_back({page.url, page.fingerprint, page.duplicates});
+  }
+  return out;
+}
+
+size_t SimHashIndex::Size() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return pages_.size();
+}
+
+std::uint64_t SimHashIndex::Duplicates() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return duplicates_;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 64-bit SimHash of a page's visible text over word shingles. Tags,
+// comments, character references and whole <script>/<style> elements are
+// skipped, so a shared template's markup does not outvote the text. Words
+// are runs of ASCII letters and digits (any byte >= 0x80 counts as a
+// letter, so UTF-8 text tokenises too), folded to lower case; every window
+// of `shingle` words is hashed and votes on each fingerprint bit. Pages
+// that differ only in a few words (a timestamp, a link label) land a few
+// bits apart.
+//
+// Votes are counted bit-major over blocks of shingle hashes, so the inner
+// loop is a fixed shift and add across the block that the compiler
+// vectorises at -O2.
+class SimHash {
+ public:
+  static constexpr unsigned kDefaultShingle = 4;
+
+  /// nullopt if the body has fewer than `shingle` words of text
+  static std::optional<std::uint64_t> Fingerprint(
+    std::string_view body, unsigned shingle = kDefaultShingle);
+
+  static unsigned Distance(std::uint64_t a, std::uint64_t b) {
+    return static_cast<unsigned>(std::popcount(a ^ b));
+  }
+};
+
+// Fingerprints of one domain's pages, for spotting near-duplicates. The
+// 64 bits are cut into max_distance + 1 bands; two fingerprints within
+// max_distance bits agree on at least one whole band, so a lookup only
+// compares against pages sharing a band value. A near-duplicate joins the
+// cluster of the first page it matched and is not indexed itself.
+// Thread-safe.
+class SimHashIndex {
+ public:
+  static constexpr unsigned kMaxDistance = 7;
+
+  struct Options {
+    unsigned shingle{SimHash::kDefaultShingle};
+    unsigned max_distance{3};  // at most kMaxDistance
+  };
+
+  struct Match {
+    std::string url;  // the cluster's first page
+    unsigned distance{0};
+  };
+
+  struct Cluster {
+    std::string url;
+    std::uint64_t fingerprint{0};
+    std::vector<Match> duplicates;  // url, distance from the first page
+  };
+
+  explicit SimHashIndex(Options opts);
+
+  /// Fingerprint `body` and look it up; a page with no match is added and
+  /// nullopt returned. A page too short to fingerprint is not added and also
+  /// gives nullopt.
+  std::optional<Match> Check(const std::string& url, std::string_view body);
+
+  /// As Check(), for a fingerprint computed elsewhere
+  std::optional<Match> Insert(const std::string& url,
+                              std::uint64_t fingerprint);
+
+  /// Clusters with at least one duplicate, in order of first sighting
+  std::vector<Cluster> Clusters() const;
+
+  size_t Size() const;                // distinct pages indexed
+  std::uint64_t Duplicates() const;  // pages matched
+
+  const Options& GetOptions() const {
+    return opts_;
+  }
+
+ private:
+  struct Page {
+    std::uint64_t fingerprint;
+    std::string url;
+    std::vector<Match> duplicates;
+  };
+
+  std::uint64_t Band(std::uint64_t fingerprint, unsigned band) const;
+
+  const Options opts_;
+  std::vector<unsigned> band_shift_;  // low bit of each band
+  std::vector<unsigned> band_bits_;
+
+  mutable std::mutex mtx_;
+  std::vector<Page> pages_;
+  // per band: band value -> indexes into pages_
+  std::vector<std::unordered_map<std::uint64_t, std::vector<std::uint32_t>>>
+    bands_;
+  std::uint64_t duplicates_{0};
+};
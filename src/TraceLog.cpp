@@ -0,0 +1,142 @@
+#include "TraceLog.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <system_error>
+
+std::vector<std::pair<const char*, std::int64_t>> TraceRecord::Phases()
+  const {
+  std::vector<std::pair<const char*, std::int64_t>> out;
+  auto add = [&](const char* name, std::int64_t us) {
+    if (us >= 0)
+      out.emplace_back(name, us);
+  };
+  if (HasFetch()) {
+    // Cumulative marks in order; libcurl leaves marks it never reached at 0,
+    // and a reused connection skips dns/connect/tls (also 0)
+    const bool tls = appconnect_us > 0 || url.rfind("https:", 0) == 0;
+    std::vector<std::pair<const char*, std::int64_t>> marks = {
+      {"dns", namelookup_us}, {"connect", connect_us}};
+    if (tls)
+      marks.emplace_back("tls", appconnect_us);
+    marks.emplace_back("request", pretransfer_us);
+    marks.emplace_back("server", starttransfer_us);
+
+    int reached = -1;
+    for (int i = 0; i < static_cast<int>(marks.size()); ++i)
+      if (marks[i].second > 0)
+        reached = i;
+
+    std::int64_t prev = 0;
+    for (int i = 0; i <= reached; ++i) {
+      const std::int64_t at = std::max(marks[i].second, prev);
+      add(marks[i].first, at - prev);
+      prev = at;
+    }
+    if (reached + 1 < static_cast<int>(marks.size()))
+      add(marks[reached + 1].first, std::max(total_us - prev, std::int64_t{0}));
+    else
+      add("transfer", std::max(total_us - prev, std::int64_t{0}));
+    if (redirect_us > 0)
+      add("redirect", redirect_us);
+    add("fetch", total_us);
+  }
+  add("lua", lua_us);
+  add("store", store_us);
+  return out;
+}
+
+nlohmann::json TraceRecord::ToJson() const {
+  nlohmann::json j = {{"t", time_ms},      {"host", host},
+                      {"url", url},        {"curl", curl_code},
+                      {"status", status},  {"attempt", attempt},
+                      {"cached", cached}};
+  auto opt = [&](const char* key, std::int64_t v) {
+    if (v >= 0)
+      j[key] = v;
+  };
+  opt("namelookup_us", namelookup_us);
+  opt("connect_us", connect_us);
+  opt("appconnect_us", appconnect_us);
+  opt("pretransfer_us", pretransfer_us);
+  opt("starttransfer_us", starttransfer_us);
+  opt("total_us", total_us);
+  opt("redirect_us", redirect_us);
+  opt("bytes", download_bytes);
+  opt("lua_us", lua_us);
+  opt("store_us", store_us);
+  return j;
+}
+
+std::optional<TraceRecord> TraceRecord::FromJson(const nlohmann::json& j) {
+  if (!j.is_object() || !j.contains("host"))
+    return std::nullopt;
+  TraceRecord r;
+  try {
+    r.time_ms = j.value("t", std::int64_t{0});
+    r.host = j.at("host").get<std::string>();
+    r.url = j.value("url", std::string{});
+    r.curl_code = j.value("curl", 0);
+    r.status = j.value("status", 0L);
+    r.attempt = j.value("attempt", 0u);
+    r.cached = j.value("cached", false);
+    r.namelookup_us = j.value("namelookup_us", std::int64_t{-1});
+    r.connect_us = j.value("connect_us", std::int64_t{-1});
+    r.appconnect_us = j.value("appconnect_us", std::int64_t{-1});
+    r.pretransfer_us = j.value("pretransfer_us", std::int64_t{-1});
+    r.starttransfer_us = j.value("starttransfer_us", std::int64_t{-1});
+    r.total_us = j.value("total_us", std::int64_t{-1});
+    r.redirect_us = j.value("redirect_us", std::int64_t{-1});
+    r.download_bytes = j.value("bytes", std::int64_t{-1});
+    r.lua_us = j.value("lua_us", std::int64_t{-1});
+    r.store_us = j.value("store_us", std::int64_t{-1});
+  } catch (const nlohmann::json::exception&) {
+    return std::nullopt;
+  }
+  return r;
+}
+
+void TraceLog::Configure(const std::filesystem::path& file) {
+  auto& log = Instance();
+  std::lock_guard<std::mutex> lock(log.mtx_);
+  log.out_.reset();
+  if (file.empty())
+    return;
+  std::error_code ec;
+  if (file.has_parent_path())
+    std::filesystem::create_directories(file.parent_path(), ec);
+  auto out = std::make_unique<std::ofstream>(
+    file, std::ios::binary | std::ios::app);
+  if (!*out) {
+    logr::error << "[TraceLog] cannot open " << file;
+    return;
+  }
+  log.out_ = std::move(out);
+}
+
+TraceLog& TraceLog::Instance() {
+  static TraceLog instance;
+  return instance;
+}
+
+bool TraceLog::Enabled() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return out_ != nullptr;
+}
+
+void TraceLog::Write(const TraceRecord& rec) {
+  // hosts and URLs may carry raw non-UTF-8 bytes; replace them, not throw
+  const std::string line =
+    rec.ToJson().dump(-1, ' ', false,
+                      nlohmann::json::error_handler_t::replace) +
+    '\n';
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (out_)
+    out_->write(line.data(), static_cast<std::streamsize>(line.size()));
+}
+
+void TraceLog::Flush() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (out_)
+    out_->flush();
+}
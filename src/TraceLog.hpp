@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+// Where one page's crawl time went. Curl timings are libcurl's cumulative
+// CURLINFO_*_TIME_T values (microseconds from the start of the transfer);
+// Phases() turns them into per-phase durations. -1 means "not measured"
+// (e.g. no network fetch for a cached page, no Lua for a failed one).
+struct TraceRecord {
+  std::int64_t time_ms{0};  // wall clock at fetch start, Unix ms
+  std::string host;
+  std::string url;
+  int curl_code{0};
+  long status{0};
+  unsigned attempt{0};
+  bool cached{false};
+
+  std::int64_t namelookup_us{-1};
+  std::int64_t connect_us{-1};
+  std::int64_t appconnect_us{-1};  // 0 for plain HTTP
+  std::int64_t pretransfer_us{-1};
+  std::int64_t starttransfer_us{-1};
+  std::int64_t total_us{-1};
+  std::int64_t redirect_us{-1};
+  std::int64_t download_bytes{-1};
+
+  std::int64_t lua_us{-1};
+  std::int64_t store_us{-1};
+
+  bool HasFetch() const {
+    return total_us >= 0;
+  }
+
+  /// (phase, microseconds) for every measured phase, in crawl order:
+  /// dns, connect, tls, request, server (time to first byte after the
+  /// request), transfer, redirect, fetch (curl total), lua, store. A fetch
+  /// that failed part-way charges its remaining time to the phase it was
+  /// stuck in.
+  std::vector<std::pair<const char*, std::int64_t>> Phases() const;
+
+  nlohmann::json ToJson() const;
+  static std::optional<TraceRecord> FromJson(const nlohmann::json& j);
+};
+
+// Append-only JSONL trace, one TraceRecord per line. Shared by every
+// Crawler; writes are buffered and serialised, and flushed on destruction.
+class TraceLog {
+ public:
+  /// Start tracing to `file` (appending); an empty path turns tracing off
+  static void Configure(const std::filesystem::path& file);
+  static TraceLog& Instance();
+
+  bool Enabled() const;
+  void Write(const TraceRecord& rec);
+  void Flush();
+
+ private:
+  TraceLog() = default;
+
+  mutable std::mutex mtx_;
+  std::unique_ptr<std::ofstream> out_;
+};
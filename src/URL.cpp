@@ -7,8 +7,8 @@
 #include <iomanip>
 #include <iostream>
 #include <openssl/sha.h>
-#include <regex>
 #include <sstream>
+#include <string_view>
 #include <unordered_set>
 
 namespace {
@@ -173,23 +173,36 @@ URL URL::Resolve(const std::string& ref) const {
 }
 
 void URL::Parse() {
-  // Simplified parser for starter purposes.
-  static const std::regex url_regex(
-    // 1: optional “scheme://”   → group 1 = entire “https://”, group 2 =
-    // “https” 2: host                   → group 3 3: path                   →
-    // group 4 (optional) 4: query (including '?')  → group 5 (optional) 5:
-    // fragment (including '#') → group 6 (optional)
-    R"(^((https?)://)?([^/?#]+)(/[^?#]*)?(\?[^#]*)?(#.*)?$)",
-    std::regex::extended);
-  std::smatch match;
-  if (std::regex_match(raw_url_, match, url_regex)) {
-    scheme_ = match[2].matched ? match[2].str() : "";
-    host_ = match[3];
-    path_ = match[4].matched ? match[4].str() : "";
-    query_ = match[5].matched ? match[5].str() : "";
-    fragment_ = match[6].matched ? match[6].str().substr(1) : "";
+  // Split by hand along the grammar
+  //   ^((https?)://)?([^/?#]+)(/[^?#]*)?(\?[^#]*)?(#.*)?$
+  // which a std::regex used to match; the scheme is taken whenever what
+  // follows it still has a host.
+  auto split = [this](std::string_view scheme, std::string_view rest) {
+    const auto host_end = rest.find_first_of("/?#");
+    const auto host = rest.substr(0, host_end);
+    if (host.empty())
+      return false;
+    rest.remove_prefix(host.size());
+    const auto path = rest.substr(0, rest.find_first_of("?#"));
+    rest.remove_prefix(path.size());
+    const auto query = rest.substr(0, rest.find('#'));
+    rest.remove_prefix(query.size());
+
+    scheme_ = scheme;
+    host_ = host;
+    path_ = path;
+    query_ = query;
+    fragment_ = rest.empty() ? "" : rest.substr(1);
     props_.Clear();
-  } else {
+    return true;
+  };
+
+  const std::string_view s = raw_url_;
+  const bool ok = (s.rfind("http://", 0) == 0 && split("http", s.substr(7))) ||
+                  (s.rfind("https://", 0) == 0 &&
+                   split("https", s.substr(8))) ||
+                  split("", s);
+  if (!ok) {
     logr::warning << "INVALID URL: " << raw_url_;
   }
 }
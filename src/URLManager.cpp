@@ -3,14 +3,90 @@
 #include "URLManager.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
 #include <filesystem>
 #include <fstream>
-#include <fstream>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <system_error>
+#include <thread>
 #include <vector>
 
+#include <fcntl.h>  // open
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>  // close, write
+
+namespace {
+// Read-only mapping of one seed file; empty on failure
+class MappedFile {
+ public:
+  explicit MappedFile(const std::filesystem::path& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return;
+    struct stat st {};
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+      void* p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                       MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        ::madvise(p, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(p);
+        size_ = static_cast<size_t>(st.st_size);
+      }
+    }
+    ::close(fd);
+  }
+  ~MappedFile() {
+    if (data_)
+      ::munmap(const_cast<char*>(data_), size_);
+  }
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  std::string_view View() const {
+    return {data_, size_};
+  }
+
+ private:
+  const char* data_{nullptr};
+  size_t size_{0};
+};
+
+// Cut `text` into pieces of roughly `target` bytes that end on a newline
+void SplitOnLines(std::string_view text, size_t target,
+                  std::vector<std::string_view>& out) {
+  while (!text.empty()) {
+    size_t cut = std::min(target, text.size());
+    if (cut < text.size()) {
+      auto nl = text.find('\n', cut);
+      cut = (nl == std::string_view::npos) ? text.size() : nl + 1;
+    }
+    out.push_back(text.substr(0, cut));
+    text.remove_prefix(cut);
+  }
+}
+
+std::string_view TrimLine(std::string_view line) {
+  auto issp = [](char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+  };
+  while (!line.empty() && issp(line.front()))
+    line.remove_prefix(1);
+  while (!line.empty() && issp(line.back()))
+    line.remove_suffix(1);
+  return line;
+}
+}  // namespace
+
 URLManager::URLManager(const std::filesystem::path& dir) : dir_{dir} {
   if (!std::filesystem::exists(dir_)) {
     throw std::runtime_error("URLManager: directory does not exist: " +
@@ -29,100 +105,307 @@ URLManager::URLManager(const std::filesystem::path& dir) : dir_{dir} {
       continue;
     }
     logr::info << "FILE: " << entry;
+    lists_.push_back(entry.path());
+  }
+  std::sort(lists_.begin(), lists_.end());
+}
+
+size_t URLManager::LoadSeeds(const SeedSink& sink, unsigned threads) const {
+  return Load(lists_, sink, threads);
+}
+
+size_t URLManager::LoadFromFile(const std::filesystem::path& filename,
+                                const SeedSink& sink, unsigned threads) const {
+  return Load({filename}, sink, threads);
+}
+
+size_t URLManager::Load(const std::vector<std::filesystem::path>& files,
+                        const SeedSink& sink, unsigned threads) const {
+  const auto started = std::chrono::steady_clock::now();
+
+  // Map every file up front and carve them into line-aligned chunks
+  std::vector<std::unique_ptr<MappedFile>> maps;
+  std::vector<std::string_view> chunks;
+  for (const auto& file : files) {
+    auto map = std::make_unique<MappedFile>(file);
+    if (map->View().empty()) {
+      std::error_code ec;
+      if (std::filesystem::file_size(file, ec) != 0 || ec) {
+        logr::warning << "Warning: URLManager failed to map \""
+                      << file.string() << "\"";
+      }
+      continue;
+    }
+    SplitOnLines(map->View(), kSeedChunkBytes, chunks);
+    maps.push_back(std::move(map));
+  }
+
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(
+    std::min<size_t>(threads, std::max<size_t>(1, chunks.size())));
+
+  std::mutex sink_mtx;
+  std::atomic<size_t> next_chunk{0};
+  std::atomic<size_t> total{0};
+
+  auto flush = [&](const URL& domain, std::vector<URL>& urls) {
+    std::lock_guard<std::mutex> lock(sink_mtx);
+    sink(domain, urls);
+    urls.clear();
+  };
+
+  auto worker = [&]() {
+    // host -> registrable domain; saves a second regex parse per line
+    std::unordered_map<std::string, URL> domain_by_host;
+    std::unordered_map<URL, std::vector<URL>> buckets;
+    std::string line_buf;
+    size_t loaded = 0;
+
     try {
-      LoadFromFile(entry.path());
+      for (size_t i; (i = next_chunk.fetch_add(1)) < chunks.size();) {
+        std::string_view rest = chunks[i];
+        while (!rest.empty()) {
+          auto nl = rest.find('\n');
+          auto line = TrimLine(rest.substr(0, nl));
+          rest.remove_prefix(nl == std::string_view::npos ? rest.size()
+                                                          : nl + 1);
+          if (line.empty())
+            continue;
+
+          line_buf.assign(line);
+          URL url{line_buf};
+          if (!url.IsValid())
+            continue;
+
+          auto host = url.GetHost();
+          auto d = domain_by_host.find(host);
+          if (d == domain_by_host.end()) {
+            if (domain_by_host.size() >= 65536)
+              domain_by_host.clear();
+            d = domain_by_host.emplace(host, url.GetDomain()).first;
+          }
+
+          auto& bucket = buckets[d->second];
+          bucket.push_back(std::move(url));
+          ++loaded;
+          if (bucket.size() >= kSeedBatch)
+            flush(d->second, bucket);
+        }
+
+        // Hand over what this chunk produced; memory stays per-chunk
+        for (auto& [domain, bucket] : buckets) {
+          if (!bucket.empty())
+            flush(domain, bucket);
+        }
+        buckets.clear();
+      }
     } catch (const std::exception& ex) {
-      logr::warning << "Warning: URLManager failed to load \""
-                    << entry.path().string() << "\": " << ex.what();
+      logr::error << "URLManager seed loader failed: " << ex.what();
     }
+    total += loaded;
+  };
+
+  if (threads <= 1) {
+    worker();
+  } else {
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t)
+      pool.emplace_back(worker);
+    for (auto& t : pool)
+      t.join();
   }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now() - started);
+  logr::info << "Loaded " << total.load() << " seed URL(s) from "
+             << maps.size() << " file(s) in " << elapsed.count() << " ms ("
+             << threads << " thread(s))";
+  return total.load();
 }
 
-void URLManager::LoadFromFile(const std::filesystem::path& filename) {
-  std::ifstream infile(filename);
-  std::string line;
-  while (std::getline(infile, line)) {
-    if (!line.empty()) {
-      URL url{line};
-      if (url.IsValid()) {
-        urls_.push_back(std::move(url));
-      }
-    }
+URLManager::~URLManager() {
+  {
+    std::lock_guard<std::mutex> lock(stop_mtx_);
+    stop_ = true;
+  }
+  stop_cv_.notify_all();
+  if (committer_.joinable())
+    committer_.join();
+  Flush();
+
+  const auto stats = GetStats();
+  if (stats.stored || stats.duplicates) {
+    logr::info << "[URLManager] stored " << stats.stored << " URL(s), "
+               << stats.duplicates << " duplicate(s) dropped, "
+               << stats.commits << " append(s)";
   }
 }
 
-const std::vector<URL>& URLManager::GetURLs() const {
-  return urls_;
+URLManager::Journal& URLManager::GetJournal(const URL& domain) {
+  const std::string name = domain.GetSha256();
+  std::lock_guard<std::mutex> lock(journals_mtx_);
+  auto& j = journals_[name];
+  if (!j) {
+    j = std::make_unique<Journal>();
+    j->path = dir_ / (name + ".list");
+    if (!committer_.joinable())
+      committer_ = std::thread([this] { CommitLoop(); });
+  }
+  return *j;
 }
 
-std::unordered_map<URL, std::set<URL>> URLManager::GetBatchesByDomain() const {
-  std::unordered_map<URL, std::set<URL>> batches;
-  for (const auto& url : urls_) {
-    auto domain = url.GetDomain();
-    batches[domain].insert(url);
+// Seed the de-duplication set with the lines already in the file
+void URLManager::LoadJournal(Journal& j) {
+  j.loaded = true;
+  MappedFile map(j.path);
+  std::string_view rest = map.View();
+  if (rest.empty())
+    return;
+  j.need_leading_nl = rest.back() != '\n';
+  while (!rest.empty()) {
+    auto nl = rest.find('\n');
+    auto line = TrimLine(rest.substr(0, nl));
+    rest.remove_prefix(nl == std::string_view::npos ? rest.size() : nl + 1);
+    if (!line.empty())
+      j.written.insert(std::hash<std::string_view>{}(line));
   }
-  return batches;
 }
 
 void URLManager::Store(const URL& domain,
-                       const std::unordered_set<URL>& urls) const {
+                       const std::unordered_set<URL>& urls) {
+  std::pmr::monotonic_buffer_resource arena;
+  std::pmr::vector<std::pmr::string> strings(&arena);
+  strings.reserve(urls.size());
+  for (const auto& u : urls)
+    strings.emplace_back(u.ToString());
+  Store(domain, strings);
+}
+
+void URLManager::Store(const URL& domain,
+                       std::span<const std::pmr::string> urls) {
   if (urls.empty())
     return;  // append nothing; never remove
 
+  Journal& j = GetJournal(domain);
+  std::uint64_t stored = 0, duplicates = 0;
+  {
+    std::lock_guard<std::mutex> lock(j.mtx);
+    if (!j.loaded)
+      LoadJournal(j);
+
+    std::string clean;
+    for (const auto& u : urls) {
+      std::string_view s = u;
+      // sanitize: guard against embedded newlines
+      if (s.find_first_of("\r\n") != std::string_view::npos) {
+        clean.assign(s);
+        clean.erase(std::remove_if(clean.begin(), clean.end(),
+                                   [](unsigned char c) {
+                                     return c == '\r' || c == '\n';
+                                   }),
+                    clean.end());
+        s = clean;
+      }
+      if (s.empty())
+        continue;
+      if (!j.written.insert(std::hash<std::string_view>{}(s)).second) {
+        ++duplicates;
+        continue;
+      }
+      if (j.buffer.empty())
+        j.oldest = std::chrono::steady_clock::now();
+      j.buffer.append(s);
+      j.buffer.push_back('\n');
+      ++stored;
+    }
+
+    if (j.buffer.size() >= kCommitBytes)
+      Commit(j);
+  }
+
+  std::lock_guard<std::mutex> lock(stats_mtx_);
+  stats_.stored += stored;
+  stats_.duplicates += duplicates;
+}
+
+void URLManager::Commit(Journal& j) {
+  if (j.buffer.empty())
+    return;
+
   std::error_code ec;
   std::filesystem::create_directories(dir_, ec);  // best-effort
 
-  std::filesystem::path filename = dir_ / domain.GetSha256();
-  filename += ".list";
-
-  // Build batch (deterministic order, newline-sanitized)
-  std::vector<std::string> lines;
-  lines.reserve(urls.size());
-  for (const auto& u : urls) {
-    std::string s = u.ToString();
-    // sanitize: guard against embedded newlines
-    s.erase(
-      std::remove_if(s.begin(), s.end(),
-                     [](unsigned char c) { return c == '\r' || c == '\n'; }),
-      s.end());
-    if (!s.empty())
-      lines.emplace_back(std::move(s));
-  }
-  if (lines.empty())
-    return;
-  std::sort(lines.begin(), lines.end());
-  lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
-
-  // Check if we need to prepend a newline (to avoid sticking to last line)
-  bool need_leading_nl = false;
-  if (std::filesystem::exists(filename, ec)) {
-    auto sz = std::filesystem::file_size(filename, ec);
-    if (!ec && sz > 0) {
-      std::ifstream fin(filename, std::ios::binary);
-      if (fin) {
-        fin.seekg(-1, std::ios::end);
-        char last = '\n';
-        fin.read(&last, 1);
-        need_leading_nl = (fin && last != '\n');
-      }
+  // one append per commit; O_APPEND keeps concurrent writers whole
+  int fd = ::open(j.path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                  0644);
+  if (fd < 0) {
+    logr::warning << "[URLManager] cannot append to " << j.path.string();
+    return;  // keep the buffer; the next commit retries
+  }
+  if (j.need_leading_nl) {
+    j.buffer.insert(j.buffer.begin(), '\n');
+    j.need_leading_nl = false;  // now part of the buffer
+  }
+  size_t done = 0;
+  int err = 0;
+  while (done < j.buffer.size()) {
+    const ssize_t n =
+      ::write(fd, j.buffer.data() + done, j.buffer.size() - done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      err = errno;
+      break;
     }
+    done += static_cast<size_t>(n);
+  }
+  ::close(fd);
+  if (done < j.buffer.size()) {
+    // keep what did not make it: the next commit finishes any torn line
+    logr::warning << "[URLManager] short append to " << j.path.string()
+                  << ": " << std::strerror(err) << "; "
+                  << j.buffer.size() - done << " byte(s) kept for retry";
+    j.buffer.erase(0, done);
+    return;
   }
+  j.buffer.clear();
 
-  // Build one contiguous buffer (reduces interleaving risk under concurrent
-  // appends)
-  std::string blob;
-  blob.reserve((need_leading_nl ? 1 : 0) + lines.size() * 64);
-  if (need_leading_nl)
-    blob.push_back('\n');
-  for (const auto& line : lines) {
-    blob.append(line);
-    blob.push_back('\n');
+  std::lock_guard<std::mutex> lock(stats_mtx_);
+  stats_.commits++;
+}
+
+void URLManager::Flush() {
+  CommitBuffered(std::chrono::steady_clock::time_point::max());
+}
+
+void URLManager::CommitBuffered(std::chrono::steady_clock::time_point due) {
+  std::vector<Journal*> journals;
+  {
+    std::lock_guard<std::mutex> lock(journals_mtx_);
+    for (auto& [name, j] : journals_)
+      journals.push_back(j.get());
+  }
+  for (auto* j : journals) {
+    std::lock_guard<std::mutex> lock(j->mtx);
+    if (!j->buffer.empty() && j->oldest <= due)
+      Commit(*j);
   }
+}
+
+// Commit buffers that have waited kCommitInterval
+void URLManager::CommitLoop() {
+  std::unique_lock<std::mutex> lock(stop_mtx_);
+  while (!stop_cv_.wait_for(lock, kCommitInterval / 4,
+                            [this] { return stop_; })) {
+    lock.unlock();
+    CommitBuffered(std::chrono::steady_clock::now() - kCommitInterval);
+    lock.lock();
+  }
+}
 
-  // Append
-  std::ofstream out(filename, std::ios::binary | std::ios::app);
-  if (!out)
-    return;  // optionally log
-  out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
-  out.flush();
+URLManager::Stats URLManager::GetStats() const {
+  std::lock_guard<std::mutex> lock(stats_mtx_);
+  return stats_;
 }
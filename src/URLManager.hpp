@@ -1,26 +1,109 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <filesystem>
-#include <set>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <span>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include "URL.hpp"
 #include <vector>
 
+// Loads seed lists from a directory and appends discovered URLs back to it,
+// one <sha256(domain)>.list file per domain.
+//
+// Store() only buffers: each domain's URLs are de-duplicated against what is
+// already in its file (read once, on first use) and against earlier Store()
+// calls, then appended in group commits of about kCommitBytes. A background
+// thread commits buffers older than kCommitInterval; Flush() and the
+// destructor commit the rest. Thread-safe.
 class URLManager {
  public:
+  // Receives seed URLs bucketed by registrable domain. Calls are serialized,
+  // so the sink may touch unsynchronized state; `urls` may be moved from.
+  using SeedSink =
+    std::function<void(const URL& domain, std::vector<URL>& urls)>;
+
+  // Seeds handed to the sink per call, per domain
+  static constexpr size_t kSeedBatch = 1024;
+
+  // Bytes of a .list file parsed per loader task
+  static constexpr size_t kSeedChunkBytes = 8 << 20;
+
+  // Buffered bytes per domain that trigger an append
+  static constexpr size_t kCommitBytes = 256 * 1024;
+
+  // Longest a stored URL waits in memory before it is appended
+  static constexpr auto kCommitInterval = std::chrono::seconds(2);
+
   URLManager(const std::filesystem::path& dir);
+  ~URLManager();
+
+  URLManager(const URLManager&) = delete;
+  URLManager& operator=(const URLManager&) = delete;
+
+  /// Stream every .list file through `sink` using `threads` loaders
+  /// (0: hardware concurrency); returns the number of valid seeds.
+  size_t LoadSeeds(const SeedSink& sink, unsigned threads = 0) const;
 
-  void LoadFromFile(const std::filesystem::path& filename);
+  size_t LoadFromFile(const std::filesystem::path& filename,
+                      const SeedSink& sink, unsigned threads = 0) const;
 
-  const std::vector<URL>& GetURLs() const;
+  /// Queue `urls` for appending to `domain`'s list; never removes
+  void Store(const URL& domain, const std::unordered_set<URL>& urls);
+  void Store(const URL& domain, std::span<const std::pmr::string> urls);
 
-  std::unordered_map<URL, std::set<URL>> GetBatchesByDomain() const;
+  /// Append everything buffered so far
+  void Flush();
 
-  void Store(const URL& domain, const std::unordered_set<URL>& urls) const;
+  struct Stats {
+    std::uint64_t stored{0};      // URLs buffered for appending
+    std::uint64_t duplicates{0};  // URLs dropped as already listed
+    std::uint64_t commits{0};     // appends to a list file
+  };
+  Stats GetStats() const;
 
  private:
-  std::vector<URL> urls_;
+  // One domain's list file and the URLs waiting to be appended to it
+  struct Journal {
+    std::mutex mtx;
+    std::filesystem::path path;
+    bool loaded{false};  // `written` reflects the file
+    bool need_leading_nl{false};
+    std::unordered_set<std::uint64_t> written;  // line hashes, incl. buffered
+    std::string buffer;
+    std::chrono::steady_clock::time_point oldest{};  // first buffered line
+  };
+
+  size_t Load(const std::vector<std::filesystem::path>& files,
+              const SeedSink& sink, unsigned threads) const;
+
+  Journal& GetJournal(const URL& domain);
+  static void LoadJournal(Journal& j);
+  // Caller holds j.mtx
+  void Commit(Journal& j);
+  // Commit every buffer whose oldest line was stored at or before `due`
+  void CommitBuffered(std::chrono::steady_clock::time_point due);
+  void CommitLoop();
+
+  std::vector<std::filesystem::path> lists_;
   std::filesystem::path dir_;
+
+  mutable std::mutex journals_mtx_;
+  std::unordered_map<std::string, std::unique_ptr<Journal>> journals_;
+
+  mutable std::mutex stats_mtx_;
+  Stats stats_;
+
+  std::mutex stop_mtx_;
+  std::condition_variable stop_cv_;
+  bool stop_{false};
+  std::thread committer_;
 };
@@ -0,0 +1,413 @@
+#include "WarcWriter.hpp"
+#include "Logger.hpp"
+
+#include <openssl/sha.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <random>
+#include <system_error>
+#include <utility>
+
+namespace {
+std::string Lower(std::string s) {
+  std::transform(s.begin(), s.end(), s.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+  return s;
+}
+
+std::string Trim(std::string_view s) {
+  const auto l = s.find_first_not_of(" \t\r\n");
+  if (l == std::string_view::npos)
+    return {};
+  const auto r = s.find_last_not_of(" \t\r\n");
+  return std::string(s.substr(l, r - l + 1));
+}
+
+// "<urn:uuid:...>", version 4
+std::string NewRecordId() {
+  thread_local std::mt19937_64 rng{std::random_device{}()};
+  std::uint64_t hi = rng(), lo = rng();
+  hi = (hi & ~0xf000ull) | 0x4000ull;
+  lo = (lo & ~(3ull << 62)) | (2ull << 62);
+  char buf[64];
+  std::snprintf(buf, sizeof(buf),
+                "<urn:uuid:%08llx-%04llx-%04llx-%04llx-%012llx>",
+                (unsigned long long)(hi >> 32),
+                (unsigned long long)((hi >> 16) & 0xffff),
+                (unsigned long long)(hi & 0xffff),
+                (unsigned long long)(lo >> 48),
+                (unsigned long long)(lo & 0xffffffffffffull));
+  return buf;
+}
+
+std::string Utc(std::chrono::system_clock::time_point t, const char* fmt) {
+  const std::time_t secs = std::chrono::system_clock::to_time_t(t);
+  std::tm tm{};
+  ::gmtime_r(&secs, &tm);
+  char buf[32];
+  std::strftime(buf, sizeof(buf), fmt, &tm);
+  return buf;
+}
+
+// CDX fields are space-separated
+std::string CdxField(std::string s) {
+  if (s.empty())
+    return "-";
+  std::string out;
+  for (char c : s) {
+    if (c == ' ')
+      out += "%20";
+    else if (c != '\r' && c != '\n')
+      out += c;
+  }
+  return out;
+}
+
+using Fields = std::vector<std::pair<std::string, std::string>>;
+
+std::string Record(const char* type, const std::string& id,
+                   const std::string& date, const std::string& target,
+                   const Fields& extra, const char* content_type,
+                   std::string_view block) {
+  std::string out = "WARC/1.1\r\n";
+  auto field = [&](std::string_view name, std::string_view value) {
+    out.append(name).append(": ").append(value).append("\r\n");
+  };
+  field("WARC-Type", type);
+  field("WARC-Record-ID", id);
+  field("WARC-Date", date);
+  field("WARC-Target-URI", target);
+  for (const auto& [name, value] : extra)
+    field(name, value);
+  field("WARC-Block-Digest", WarcWriter::Sha1Digest(block));
+  field("Content-Type", content_type);
+  field("Content-Length", std::to_string(block.size()));
+  out += "\r\n";
+  out.append(block);
+  out += "\r\n\r\n";
+  return out;
+}
+
+// The response's header block as received, made to describe the body we
+// hold: curl has already undone any content and transfer encoding
+struct HttpHead {
+  std::string block;
+  std::string content_type;
+  std::string content_encoding;  // dropped from the block
+};
+
+HttpHead BuildHead(const HttpResponse& response) {
+  HttpHead head;
+  const std::string_view raw = response.GetRawHeaders();
+  bool status_line = true;
+  for (size_t pos = 0; pos < raw.size();) {
+    auto eol = raw.find('\n', pos);
+    if (eol == std::string_view::npos)
+      eol = raw.size();
+    std::string_view line(raw.data() + pos, eol - pos);
+    pos = eol + 1;
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    if (line.empty())
+      continue;
+    if (status_line) {
+      head.block.append(line).append("\r\n");
+      status_line = false;
+      continue;
+    }
+    const auto colon = line.find(':');
+    const std::string name = Lower(Trim(line.substr(0, colon)));
+    const std::string value =
+      colon == std::string_view::npos ? "" : Trim(line.substr(colon + 1));
+    if (name == "content-encoding") {
+      head.content_encoding = value;
+      continue;
+    }
+    if (name == "transfer-encoding" || name == "content-length")
+      continue;
+    if (name == "content-type")
+      head.content_type = value;
+    head.block.append(line).append("\r\n");
+  }
+  if (status_line)
+    head.block =
+      "HTTP/1.1 " + std::to_string(response.GetStatusCode()) + "\r\n";
+  head.block +=
+    "Content-Length: " + std::to_string(response.GetBody().size()) + "\r\n";
+  head.block += "\r\n";
+  return head;
+}
+}  // namespace
+
+WarcWriter::WarcWriter(Options opts)
+    : opts_{std::move(opts)}, writer_{opts_.file} {
+  thread_ = std::thread([this] { Run(); });
+}
+
+WarcWriter::~WarcWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+
+  const auto stats = GetStats();
+  logr::info << "[WarcWriter] " << stats.captures << " capture(s), "
+             << stats.bytes / 1024 << " KiB as " << stats.stored_bytes / 1024
+             << " KiB in " << writer_.FilesClosed() << " file(s), "
+             << indexes_ << " index(es)";
+}
+
+bool WarcWriter::Write(const URL& url, const HttpResponse& response,
+                       const Capture& capture) {
+  const std::string requested = url.ToString();
+  const std::string target = response.GetRedirectCount() > 0
+                               ? response.GetEffectiveUrl().ToString()
+                               : requested;
+  const std::string date = Utc(capture.time, "%Y-%m-%dT%H:%M:%SZ");
+  const std::string_view body = response.GetBody();
+  const HttpHead head = BuildHead(response);
+  const std::string payload_digest = Sha1Digest(body);
+
+  const std::string response_id = NewRecordId();
+  std::uint64_t bytes = 0;
+  std::string response_member;
+  {
+    std::string http = head.block;
+    http += body;
+    const auto record = Record("response", response_id, date, target,
+                               {{"WARC-Payload-Digest", payload_digest}},
+                               "application/http;msgtype=response", http);
+    bytes += record.size();
+    response_member = Gzip(record, opts_.level);
+  }
+
+  std::string blob = response_member;
+  if (const auto request = response.GetRawRequest(); !request.empty()) {
+    const auto record =
+      Record("request", NewRecordId(), date, target,
+             {{"WARC-Concurrent-To", response_id}},
+             "application/http;msgtype=request", request);
+    bytes += record.size();
+    blob += Gzip(record, opts_.level);
+  }
+
+  std::string meta;
+  auto add = [&meta](const char* name, const std::string& value) {
+    meta.append(name).append(": ").append(value).append("\r\n");
+  };
+  if (target != requested)
+    add("requestedURI", requested);
+  add("redirectCount", std::to_string(response.GetRedirectCount()));
+  add("fetchTimeMs", std::to_string(capture.duration.count() / 1000));
+  add("depth", std::to_string(capture.depth));
+  add("attempt", std::to_string(capture.attempt + 1));
+  if (!head.content_encoding.empty())
+    add("contentEncoding", head.content_encoding);
+  const auto meta_record = Record("metadata", NewRecordId(), date, target,
+                                  {{"WARC-Concurrent-To", response_id}},
+                                  "application/warc-fields", meta);
+  bytes += meta_record.size();
+  blob += Gzip(meta_record, opts_.level);
+
+  if (response_member.empty())
+    return false;  // Gzip() failed
+
+  // the offset and file name are only known once the writer appends it
+  std::string cdx;
+  if (opts_.cdx) {
+    std::string mime = head.content_type.substr(
+      0, head.content_type.find(';'));
+    cdx =
+      Surt(target) + ' ' + Utc(capture.time, "%Y%m%d%H%M%S") + ' ' +
+      CdxField(target) + ' ' + CdxField(Lower(Trim(mime))) + ' ' +
+      std::to_string(response.GetStatusCode()) + ' ' +
+      payload_digest.substr(5) + " - - " +
+      std::to_string(response_member.size());
+  }
+
+  std::unique_lock<std::mutex> lock(mtx_);
+  drained_.wait(lock, [this] {
+    return pending_.size() < opts_.max_pending || stop_;
+  });
+  pending_.push_back({std::move(blob), bytes, std::move(cdx)});
+  ++enqueued_;
+  wake_.notify_one();
+  return true;
+}
+
+void WarcWriter::Flush() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  const auto target = enqueued_;
+  flush_ = true;
+  wake_.notify_one();
+  drained_.wait(lock, [&] { return flushed_ >= target || stop_; });
+}
+
+void WarcWriter::Run() {
+  std::vector<Pending> batch;
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (;;) {
+    wake_.wait(lock, [this] { return stop_ || flush_ || !pending_.empty(); });
+    const bool stopping = stop_;
+    const bool flush = flush_;
+    flush_ = false;
+    batch.swap(pending_);
+    lock.unlock();
+    drained_.notify_all();  // room again
+
+    Stats done;
+    for (auto& p : batch) {
+      const auto at = writer_.Write(p.blob);
+      if (!at.has_value())
+        continue;
+      done.captures++;
+      done.bytes += p.bytes;
+      done.stored_bytes += p.blob.size();
+      if (p.cdx.empty())
+        continue;
+      if (at->file != file_) {
+        CloseIndex();
+        file_ = at->file;
+      }
+      index_.push_back(std::move(p.cdx) + ' ' + std::to_string(at->offset) +
+                       ' ' + at->file.filename().string());
+    }
+    if (flush || stopping)
+      writer_.Flush();
+    const size_t n = batch.size();
+    batch.clear();
+
+    lock.lock();
+    stats_.captures += done.captures;
+    stats_.bytes += done.bytes;
+    stats_.stored_bytes += done.stored_bytes;
+    written_ += n;
+    if (flush || stopping)
+      flushed_ = written_;
+    drained_.notify_all();
+    if (stopping && pending_.empty())
+      break;
+  }
+  lock.unlock();
+  writer_.Rotate();
+  CloseIndex();
+}
+
+WarcWriter::Stats WarcWriter::GetStats() const {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return stats_;
+}
+
+void WarcWriter::CloseIndex() {
+  if (index_.empty())
+    return;
+  std::sort(index_.begin(), index_.end());
+
+  std::string name = file_.filename().string();
+  const std::string& ext = opts_.file.ext;
+  if (name.size() > ext.size() &&
+      name.compare(name.size() - ext.size(), ext.size(), ext) == 0)
+    name.resize(name.size() - ext.size());
+  const auto path = file_.parent_path() / (name + ".cdx");
+  const auto part = path.string() + ".part";
+  {
+    std::ofstream out(part, std::ios::binary | std::ios::trunc);
+    out << " CDX N b a m s k r M S V g\n";
+    for (const auto& line : index_)
+      out << line << '\n';
+    if (!out)
+      logr::error << "[WarcWriter] cannot write " << part;
+  }
+  std::error_code ec;
+  std::filesystem::rename(part, path, ec);
+  if (ec)
+    logr::error << "[WarcWriter] cannot rename " << part << ": "
+                << ec.message();
+  else
+    ++indexes_;
+  index_.clear();
+}
+
+std::string WarcWriter::Gzip(std::string_view data, int level) {
+  z_stream zs{};
+  // 16 + window bits: a gzip header and trailer around the deflate stream
+  if (deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK)
+    return {};
+  std::string out(deflateBound(&zs, data.size()) + 32, '\0');
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  zs.next_out = reinterpret_cast<Bytef*>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  const int rc = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  return rc == Z_STREAM_END ? out : std::string{};
+}
+
+std::string WarcWriter::Surt(const std::string& url) {
+  std::string_view rest(url);
+  if (const auto scheme = rest.find("://"); scheme != std::string_view::npos)
+    rest.remove_prefix(scheme + 3);
+  const auto end = rest.find_first_of("/?#");
+  std::string_view authority = rest.substr(0, end);
+  rest.remove_prefix(end == std::string_view::npos ? rest.size() : end);
+  if (const auto at = authority.rfind('@'); at != std::string_view::npos)
+    authority.remove_prefix(at + 1);
+
+  std::string host = Lower(std::string(authority));
+  std::string port;
+  if (const auto colon = host.rfind(':'); colon != std::string::npos) {
+    port = host.substr(colon + 1);
+    host.resize(colon);
+    if (port == "80" || port == "443")
+      port.clear();
+  }
+  if (host.rfind("www.", 0) == 0)
+    host.erase(0, 4);
+
+  std::string key;
+  for (size_t last = host.size();;) {
+    const auto dot = host.rfind('.', last - 1);
+    const size_t from = dot == std::string::npos ? 0 : dot + 1;
+    key.append(host, from, last - from);
+    if (dot == std::string::npos || dot == 0)
+      break;
+    key += ',';
+    last = dot;
+  }
+  if (!port.empty())
+    key += ':' + port;
+  key += ')';
+
+  std::string path(rest.substr(0, rest.find('#')));
+  key += path.empty() ? "/" : Lower(path);
+  return CdxField(key);
+}
+
+std::string WarcWriter::Sha1Digest(std::string_view data) {
+  unsigned char hash[SHA_DIGEST_LENGTH];
+  SHA1(reinterpret_cast<const unsigned char*>(data.data()), data.size(), hash);
+
+  // RFC 4648 base32: 160 bits are exactly 32 characters, no padding
+  static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+  std::string out = "sha1:";
+  std::uint64_t buffer = 0;
+  int bits = 0;
+  for (unsigned char byte : hash) {
+    buffer = (buffer << 8) | byte;
+    bits += 8;
+    while (bits >= 5) {
+      out += kAlphabet[(buffer >> (bits - 5)) & 31];
+      bits -= 5;
+    }
+  }
+  return out;
+}
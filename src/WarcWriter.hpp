@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "HttpResponse.hpp"
+#include "ResultWriter.hpp"
+#include "URL.hpp"
+
+// Archives fetched responses as WARC/1.1. Each fetch becomes a request, a
+// response and a metadata record, each compressed as its own gzip member so
+// readers can seek straight to any record. The three go to the current file
+// in one write, which a rotating ResultWriter never splits, so a fetch's
+// records always share a file (<prefix>-<UTC stamp>-<n>.warc.gz).
+//
+// With `cdx` set, each closed WARC file gets a <same name>.cdx index beside
+// it: one sorted CDX 11 line ("N b a m s k r M S V g") per response record.
+//
+// Thread-safe. Records are built and compressed on the calling thread, which
+// then only enqueues the finished blob; a background thread appends it,
+// rotates files and writes each closed file's index. Write() blocks once
+// `max_pending` captures are queued. Besides that queue, only the current
+// file's index lines are held in memory.
+class WarcWriter {
+ public:
+  struct Options {
+    ResultWriter::Options file{
+      {}, "crawl", ".warc.gz", 1ull << 30, std::chrono::hours(24)};
+    bool cdx{true};
+    int level{6};              // zlib compression level
+    size_t max_pending{256};  // queued captures before Write() blocks
+  };
+
+  // What the crawler knows about a fetch beyond the response itself
+  struct Capture {
+    std::chrono::system_clock::time_point time;  // fetch start
+    std::chrono::microseconds duration{0};
+    std::uint32_t depth{0};
+    std::uint32_t attempt{0};
+  };
+
+  struct Stats {
+    std::uint64_t captures{0};
+    std::uint64_t bytes{0};         // uncompressed records
+    std::uint64_t stored_bytes{0};  // gzip members
+  };
+
+  explicit WarcWriter(Options opts);
+  ~WarcWriter();
+  WarcWriter(const WarcWriter&) = delete;
+  WarcWriter& operator=(const WarcWriter&) = delete;
+
+  /// Queue the records for one fetch of `url`; false if they could not be
+  /// compressed
+  bool Write(const URL& url, const HttpResponse& response,
+             const Capture& capture);
+
+  /// Block until every capture queued so far has reached the OS
+  void Flush();
+
+  Stats GetStats() const;
+
+  /// One gzip member holding `data`
+  static std::string Gzip(std::string_view data, int level = 6);
+
+  /// Sort-friendly URL key: "com,example)/path?query"
+  static std::string Surt(const std::string& url);
+
+  /// "sha1:" digest in base32, as WARC-*-Digest fields carry it
+  static std::string Sha1Digest(std::string_view data);
+
+ private:
+  // One fetch's gzip members, ready to append
+  struct Pending {
+    std::string blob;
+    std::uint64_t bytes{0};  // uncompressed
+    std::string cdx;         // index line up to the offset; empty without cdx
+  };
+
+  void Run();
+  void CloseIndex();
+
+  const Options opts_;
+
+  // writer thread only
+  ResultWriter writer_;
+  std::filesystem::path file_;     // WARC file the index lines belong to
+  std::vector<std::string> index_;  // its CDX lines, unsorted
+  std::uint64_t indexes_{0};
+
+  mutable std::mutex mtx_;
+  std::condition_variable wake_;     // writer: work or stop
+  std::condition_variable drained_;  // callers: room, or captures written
+  std::vector<Pending> pending_;
+  std::uint64_t enqueued_{0};
+  std::uint64_t written_{0};
+  std::uint64_t flushed_{0};  // written_ as of the last writer flush
+  bool flush_{false};
+  bool stop_{false};
+  Stats stats_;
+  std::thread thread_;
+};
@@ -1,19 +1,31 @@
+#include <atomic>
 #include <algorithm>
 #include <chrono>
 #include <future>
 #include <iostream>
+#include <optional>
 #include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "CacheManager.hpp"
+#include "Canonicalizer.hpp"
+#include "CertCache.hpp"
+#include "Checkpoint.hpp"
 #include "Config.hpp"
 #include "Crawler.hpp"
+#include "Frontier.hpp"
 #include "Gate.hpp"
 #include "Logger.hpp"
 #include "LuaProcessor.hpp"
+#include "Metrics.hpp"
+#include "MetricsExporter.hpp"
+#include "Resolver.hpp"
+#include "ResultSink.hpp"
+#include "TraceLog.hpp"
 #include "URLManager.hpp"
+#include "WarcWriter.hpp"
 
 int main(int argc, char* argv[]) {
   // Build an allow-list from any command-line args, all lower-cased
@@ -40,43 +52,114 @@ int main(int argc, char* argv[]) {
   logr::info << "plugin dir: " << conf.GetPluginsDir();
   logr::info << "script dir: " << conf.GetScriptDir();
 
+  Resolver::Configure(conf.GetDns());
+  TraceLog::Configure(conf.GetTraceFile());
+  if (!conf.GetPemDir().empty()) {
+    auto& certs = CertCache::Instance();
+    const auto n = certs.SetIssuerDir(conf.GetPemDir() / "issuers");
+    const auto h = certs.LoadHostIssuers(conf.GetPemDir());
+    logr::info << "Loaded " << n << " cached issuer certificates, " << h
+               << " per-host";
+  }
+
+  std::optional<MetricsExporter> exporter;
+  if (auto opts = conf.GetMetrics(); opts.has_value())
+    exporter.emplace(std::move(*opts));
+  auto& active = metrics::Registry::Instance().GetGauge(
+    "crawler_domains_active", {}, "Domains being crawled");
+
   CacheManager cache(conf.GetCacheDir(), conf.GetCacheAgeLimit());
   URLManager urlm(conf.GetDataDir());
+  auto results = ResultSink::Create(conf.GetResults(), cache);
+  std::optional<WarcWriter> warc;
+  if (auto opts = conf.GetWarc(); opts.has_value())
+    warc.emplace(std::move(*opts));
+
+  // One priority frontier per registrable domain, seeded at depth 0. Each
+  // spills past its in-memory budget into data_dir/frontier/<domain>, so
+  // none is made for a domain outside the allow-list: building one would
+  // wipe the spill dir of another process crawling it.
+  std::unordered_map<URL, Frontier> frontiers;
+  auto frontier_for = [&](const URL& domain) -> Frontier* {
+    if (!allowed.empty() && !allowed.count(domain))
+      return nullptr;
+    auto it = frontiers.find(domain);
+    if (it == frontiers.end()) {
+      it = frontiers
+             .try_emplace(domain,
+                          conf.GetDataDir() / "frontier" / domain.ToString(),
+                          conf.GetFrontierHeadLimit())
+             .first;
+    }
+    return &it->second;
+  };
+
+  // A checkpoint left by an interrupted run restores its pending URLs and
+  // visited set first, so the seeds below only add what it has not seen.
+  const auto checkpoint_opts = conf.GetCheckpoint();
+  if (checkpoint_opts.has_value())
+    Checkpoint::Restore(checkpoint_opts->dir, frontier_for);
+
+  // Seeds go in under the same canonical form as the links found later
+  const Canonicalizer canon(conf.GetCanonicalize());
+  urlm.LoadSeeds([&](const URL& domain, std::vector<URL>& urls) {
+    Frontier* frontier = frontier_for(domain);
+    if (frontier == nullptr)
+      return;
+    for (const auto& url : urls) {
+      frontier->Push(canon.Canonicalize(url));
+    }
+  });
 
-  auto batches = urlm.GetBatchesByDomain();
-
-  if (batches.size() == 0) {
+  if (frontiers.size() == 0) {
     logr::warning << "No URLs configured in: " << conf.GetDataDir();
     return 1;
   }
 
+  // Snapshots cover the domains crawled this run; URL lists and results are
+  // flushed first so they never lag the visited set.
+  std::optional<Checkpoint> checkpoint;
+  if (checkpoint_opts.has_value()) {
+    checkpoint.emplace(*checkpoint_opts, frontiers, [&urlm, &results, &warc] {
+      urlm.Flush();
+      results->Flush();
+      if (warc.has_value())
+        warc->Flush();
+    });
+  }
+
   // concurrency cap (can make this a Config option later)
   const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
   Gate gate(hw);
 
   // Pair each future with its domain for diagnostic logging
   std::vector<std::pair<URL, std::future<void>>> futures;
-  futures.reserve(batches.size());
+  futures.reserve(frontiers.size());
 
-  for (auto& [domain, batch] : batches) {
-    if (!allowed.empty() && !allowed.count(domain))
-      continue;
+  // Domains whose crawl has not returned with an empty frontier; one that
+  // failed, had no script or never started keeps its checkpoint
+  std::atomic<size_t> undrained{frontiers.size()};
 
+  for (auto& [domain, frontier] : frontiers) {
     gate.acquire();  // throttle
 
-    // move the batch into the task to avoid copying
+    // frontiers outlive every task (futures are drained below)
     try {
       futures.emplace_back(
         domain,
-        std::async(std::launch::async, [dom = domain, bat = std::move(batch),
-                                        &cache, &conf, &urlm, &gate]() mutable {
+        std::async(std::launch::async, [dom = domain, &frontier, &cache, &conf,
+                                        &urlm, &results, &warc, &gate,
+                                        &active, &undrained]() mutable {
           // RAII release to ensure the permit is returned even on exceptions
           struct Release {
             Gate& g;
+            metrics::Gauge& active;
             ~Release() {
+              active.Add(-1);
               g.release();
             }
-          } _{gate};
+          } _{gate, active};
+          active.Add(1);
 
           try {
             logr::info << "Crawler starting: " << dom;
@@ -87,8 +170,11 @@ int main(int argc, char* argv[]) {
               return;
             }
 
-            Crawler crawler(bat, dom, conf, cache, luap, urlm);
+            Crawler crawler(frontier, dom, conf, cache, luap, urlm,
+                            *results, warc.has_value() ? &*warc : nullptr);
             crawler.Crawl();
+            if (frontier.Empty())
+              --undrained;
 
             logr::info << "Crawler finished: " << dom;
           } catch (const std::exception& e) {
@@ -144,5 +230,19 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  // Nothing to resume once every frontier drained; otherwise leave a final
+  // snapshot for the next run to pick up
+  if (checkpoint.has_value()) {
+    if (undrained == 0) {
+      checkpoint->Clear();
+    } else {
+      checkpoint->Write();
+      logr::info << "Checkpoint kept: " << undrained
+                 << " domain(s) did not finish";
+    }
+  }
+
+  TraceLog::Instance().Flush();
+  logr::Flush();
   return 0;
 }
@@ -0,0 +1,104 @@
+#include <gtest/gtest.h>
+#include "Canonicalizer.hpp"
+#include "URL.hpp"
+
+#include <set>
+#include <string>
+
+TEST(CanonicalizerTest, EquivalentSpellingsCollapse) {
+  SCOPED_TRACE("Spellings of one page share a canonical form and cache key.");
+  RecordProperty("description",
+                 "Case, default port, dot segments, escaping of unreserved "
+                 "characters, parameter order, tracking parameters and the "
+                 "fragment all canonicalize away.");
+
+  const Canonicalizer canon;
+  const std::string want = "https://www.example.com/a/c~?a=1&b=2";
+  for (const std::string variant :
+       {"https://www.example.com/a/c~?a=1&b=2",
+        "HTTPS://WWW.Example.COM:443/a/c~?a=1&b=2",
+        "https://www.example.com/a/./b/../c%7e?a=1&b=2",
+        "https://www.example.com/a/c~?b=2&a=1",
+        "https://www.example.com/a/c~?utm_source=x&a=1&gclid=y&b=2",
+        "https://www.example.com/a/c~?a=1&&b=2#section",
+        "https://www.example.com./a/c%7E?a=1&b=2&UTM_MEDIUM=z"}) {
+    EXPECT_EQ(canon.Canonicalize(variant), want) << variant;
+  }
+
+  std::set<std::string> keys;
+  keys.insert(canon.Canonicalize(URL("http://example.com")).GetSha256());
+  keys.insert(canon.Canonicalize(URL("http://example.com:80/")).GetSha256());
+  keys.insert(canon.Canonicalize(URL("http://example.com/#top")).GetSha256());
+  EXPECT_EQ(keys.size(), 1u);
+}
+
+TEST(CanonicalizerTest, KeepsWhatChangesTheResource) {
+  SCOPED_TRACE("Only spellings that cannot change the response are merged.");
+  RecordProperty("description",
+                 "Path case, reserved escapes, repeated keys, non-default "
+                 "ports and trailing slashes are preserved; hex digits of "
+                 "reserved escapes are upper-cased and raw spaces escaped.");
+
+  const Canonicalizer canon;
+  EXPECT_EQ(canon.Canonicalize("http://example.com:8080/A/B/"),
+            "http://example.com:8080/A/B/");
+  EXPECT_EQ(canon.Canonicalize("https://example.com/a%2fb?q=x%3d1&q=0"),
+            "https://example.com/a%2Fb?q=x%3D1&q=0");
+  EXPECT_EQ(canon.Canonicalize("https://example.com/a b?k"),
+            "https://example.com/a%20b?k");
+  EXPECT_EQ(canon.Canonicalize("https://example.com/a/.."),
+            "https://example.com/");
+  EXPECT_EQ(canon.Canonicalize("https://example.com?utm_id=1"),
+            "https://example.com/");
+}
+
+TEST(CanonicalizerTest, PerDomainParamsAndSwitches) {
+  SCOPED_TRACE("Strip lists extend per domain; each step can be turned off.");
+  RecordProperty("description",
+                 "A domain's own parameters are dropped on it and its "
+                 "subdomains only; disabled steps leave the URL alone.");
+
+  Canonicalizer::Options opts;
+  opts.domain_params["example.com"] = {"sessionid", "ref*"};
+  const Canonicalizer canon(opts);
+  EXPECT_EQ(canon.Canonicalize("https://shop.example.com/p?sessionid=9&id=4"
+                               "&referrer=x"),
+            "https://shop.example.com/p?id=4");
+  EXPECT_EQ(canon.Canonicalize("https://notexample.com/p?sessionid=9"),
+            "https://notexample.com/p?sessionid=9");
+
+  opts.sort_query = false;
+  opts.drop_fragment = false;
+  EXPECT_EQ(Canonicalizer(opts).Canonicalize("https://a.org/?b=1&a=2#f"),
+            "https://a.org/?b=1&a=2#f");
+
+  opts.enabled = false;
+  const URL raw("https://A.org/x?utm_source=1#f");
+  EXPECT_EQ(Canonicalizer(opts).Canonicalize(raw), raw);
+  EXPECT_FALSE(Canonicalizer(opts).Enabled());
+}
+
+TEST(CanonicalizerTest, MostSpecificDomainListWins) {
+  SCOPED_TRACE("A subdomain's own list applies over its parent's.");
+  RecordProperty("description",
+                 "With a domain and its subdomains configured, a host uses "
+                 "the list of the longest domain it falls under, whatever "
+                 "the map's iteration order.");
+
+  Canonicalizer::Options opts;
+  opts.domain_params["example.com"] = {"sessionid"};
+  opts.domain_params["shop.example.com"] = {"cart"};
+  opts.domain_params["eu.shop.example.com"] = {"lang"};
+  opts.domain_params["blog.example.com"] = {"src"};
+  const Canonicalizer canon(opts);
+  const std::string query = "?cart=1&lang=de&sessionid=9&src=x";
+
+  EXPECT_EQ(canon.Canonicalize("https://example.com/" + query),
+            "https://example.com/?cart=1&lang=de&src=x");
+  EXPECT_EQ(canon.Canonicalize("https://www.shop.example.com/" + query),
+            "https://www.shop.example.com/?lang=de&sessionid=9&src=x");
+  EXPECT_EQ(canon.Canonicalize("https://eu.shop.example.com/" + query),
+            "https://eu.shop.example.com/?cart=1&sessionid=9&src=x");
+  EXPECT_EQ(canon.Canonicalize("https://blog.example.com/" + query),
+            "https://blog.example.com/?cart=1&lang=de&sessionid=9");
+}
@@ -3,20 +3,29 @@
 #include <sstream>
 #include <filesystem>
 #include <fstream>
+#include <thread>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 #include <openssl/bn.h>
 #include <openssl/ec.h>
 #include <openssl/evp.h>
 #include <openssl/pem.h>
+#include <openssl/ssl.h>
 #include <openssl/x509.h>
 #include <openssl/x509v3.h>
 
 namespace fs = std::filesystem;
 
 // --- Test helper: generate a real, tiny self-signed PEM (EC P-256,
-// CN=IssuerName) ---
-static std::string MakeSelfSignedPem(const std::string& cn = "IssuerName") {
+// CN=IssuerName), optionally with an AIA extension ("caIssuers;URI:...") and
+// handing back the private key ---
+static std::string MakeSelfSignedPem(const std::string& cn = "IssuerName",
+                                     const std::string& aia = "",
+                                     EVP_PKEY** key_out = nullptr) {
   std::string pem;
   EVP_PKEY* pkey = nullptr;
   X509* x = nullptr;
@@ -82,6 +91,15 @@ static std::string MakeSelfSignedPem(const std::string& cn = "IssuerName") {
   X509_set_issuer_name(x, name);
   X509_NAME_free(name);
 
+  if (!aia.empty()) {
+    X509_EXTENSION* ext =
+      X509V3_EXT_conf_nid(nullptr, nullptr, NID_info_access, aia.c_str());
+    if (ext) {
+      X509_add_ext(x, ext, -1);
+      X509_EXTENSION_free(ext);
+    }
+  }
+
   // Sign (sha256)
   if (X509_sign(x, pkey, EVP_sha256()) == 0) {
     cleanup();
@@ -101,6 +119,8 @@ static std::string MakeSelfSignedPem(const std::string& cn = "IssuerName") {
     pem.assign(bptr->data, bptr->length);
   }
   BIO_free(mem);
+  if (key_out && EVP_PKEY_up_ref(pkey) == 1)
+    *key_out = pkey;
   cleanup();
   return pem;
 }
@@ -346,3 +366,187 @@ TEST_F(CertTest, EnsurePemConvertsDerToPem) {
   // Bonus: issuer CN still parses correctly
   EXPECT_EQ(Cert::ExtractIssuerCNFromPem(converted), "IssuerName");
 }
+
+TEST_F(CertTest, ExtractAiaUrlsUsesCapturedLeaf) {
+  SCOPED_TRACE(
+    "A leaf captured from the failed handshake is parsed directly; the probe "
+    "connection is never made.");
+  RecordProperty("description",
+                 "With the probe forced to fail, ExtractAiaUrls still returns "
+                 "the AIA URLs of the supplied leaf PEM.");
+  const std::string leaf =
+    MakeSelfSignedPem("leaf.invalid",
+                      "caIssuers;URI:http://ca.invalid/a.crt,"
+                      "caIssuers;URI:http://ca.invalid/b.crt");
+  ASSERT_FALSE(leaf.empty());
+
+  Cert::TestHooks::force_perform_result = CURLE_COULDNT_CONNECT;
+  CertCache cache;
+  Cert cert(tmpdir, "/etc/pki/tls/certs/ca-bundle.crt", cache);
+  auto urls = cert.ExtractAiaUrls("https://leaf.invalid/", leaf);
+  Cert::TestHooks::force_perform_result.reset();
+
+  const std::vector<std::string> expected{"http://ca.invalid/a.crt",
+                                          "http://ca.invalid/b.crt"};
+  EXPECT_EQ(urls, expected);
+}
+
+TEST_F(CertTest, AugmentWithCapturedLeafFetchesIssuers) {
+  SCOPED_TRACE(
+    "Issuer downloads for a captured leaf run and land in the host bundle.");
+  RecordProperty("description",
+                 "Both AIA issuers are downloaded (stubbed), de-duplicated by "
+                 "CN, persisted and applied to the handle.");
+  const auto base = WritePemFile(kDummyPem, tmpdir, "base.pem");
+  const std::string leaf =
+    MakeSelfSignedPem("leaf.invalid",
+                      "caIssuers;URI:http://ca.invalid/a.crt,"
+                      "caIssuers;URI:http://ca.invalid/b.crt");
+  Cert::TestHooks::fake_http_response = MakeSelfSignedPem("Intermediate CA");
+
+  CertCache cache;
+  Cert cert(tmpdir / "pem", base, cache);
+  CURL* curl = curl_easy_init();
+  ASSERT_NE(curl, nullptr);
+  TempPem hold;
+  EXPECT_TRUE(
+    cert.AugmentWithIntermediates(curl, "https://leaf.invalid/", hold, leaf));
+  EXPECT_TRUE(fs::exists(tmpdir / "pem" / "leaf.invalid__Intermediate_CA.pem"));
+  EXPECT_EQ(cache.IssuerCount(), 2u);
+
+  Cert::TestHooks::fake_http_response.reset();
+  curl_easy_cleanup(curl);
+}
+
+// --- Test helper: TLS server on 127.0.0.1 presenting a self-signed
+// "localhost" leaf; serves one connection with an empty 200 response ---
+class OneShotTlsServer {
+ public:
+  OneShotTlsServer() {
+    pem_ = MakeSelfSignedPem("localhost", "", &key_);
+    BIO* bio = BIO_new_mem_buf(pem_.data(), (int)pem_.size());
+    cert_ = PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+    BIO_free(bio);
+    ctx_ = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(ctx_, cert_);
+    SSL_CTX_use_PrivateKey(ctx_, key_);
+
+    lfd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(lfd_, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    socklen_t len = sizeof(sa);
+    ::getsockname(lfd_, reinterpret_cast<sockaddr*>(&sa), &len);
+    port_ = ntohs(sa.sin_port);
+    ::listen(lfd_, 1);
+
+    thread_ = std::thread([this] {
+      int fd = ::accept(lfd_, nullptr, nullptr);
+      if (fd < 0)
+        return;
+      SSL* ssl = SSL_new(ctx_);
+      SSL_set_fd(ssl, fd);
+      if (SSL_accept(ssl) == 1) {  // fails if the client rejects the cert
+        char buf[4096];
+        SSL_read(ssl, buf, sizeof(buf));
+        static const char kResp[] =
+          "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n"
+          "Connection: close\r\n\r\n";
+        SSL_write(ssl, kResp, sizeof(kResp) - 1);
+        SSL_shutdown(ssl);
+      }
+      SSL_free(ssl);
+      ::close(fd);
+    });
+  }
+
+  ~OneShotTlsServer() {
+    ::shutdown(lfd_, SHUT_RDWR);  // unblock accept() if nobody connected
+    thread_.join();
+    ::close(lfd_);
+    SSL_CTX_free(ctx_);
+    X509_free(cert_);
+    EVP_PKEY_free(key_);
+  }
+
+  const std::string& Pem() const {
+    return pem_;
+  }
+
+  std::string Url() const {
+    return "https://localhost:" + std::to_string(port_) + "/";
+  }
+
+  // for CURLOPT_RESOLVE, so the test never consults DNS
+  std::string ResolveEntry() const {
+    return "localhost:" + std::to_string(port_) + ":127.0.0.1";
+  }
+
+ private:
+  std::string pem_;
+  EVP_PKEY* key_{nullptr};
+  X509* cert_{nullptr};
+  SSL_CTX* ctx_{nullptr};
+  int lfd_{-1};
+  int port_{0};
+  std::thread thread_;
+};
+
+static CURLcode PerformAgainst(const OneShotTlsServer& server,
+                               Cert::TlsHook* hook,
+                               const fs::path& cainfo = {}) {
+  curl_slist* resolve =
+    curl_slist_append(nullptr, server.ResolveEntry().c_str());
+  CURL* curl = curl_easy_init();
+  const auto url = server.Url();
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_RESOLVE, resolve);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 5000L);
+  if (!cainfo.empty())
+    curl_easy_setopt(curl, CURLOPT_CAINFO, cainfo.c_str());
+  Cert::InstallTlsHook(curl, hook);
+  const CURLcode code = curl_easy_perform(curl);
+  curl_easy_cleanup(curl);
+  curl_slist_free_all(resolve);
+  return code;
+}
+
+TEST_F(CertTest, TlsHookRecordsFailedLeaf) {
+  SCOPED_TRACE(
+    "A handshake against an untrusted self-signed server leaves its leaf in "
+    "the PeerChain.");
+  RecordProperty("description",
+                 "The SSL_CTX hook records the leaf PEM and SNI name when "
+                 "verification fails.");
+  OneShotTlsServer server;
+  const auto base = WritePemFile(kDummyPem, tmpdir, "base.pem");
+
+  Cert::PeerChain peer;
+  Cert::TlsHook hook{nullptr, "", &peer};
+  EXPECT_NE(PerformAgainst(server, &hook, base), CURLE_OK);
+
+  EXPECT_EQ(peer.leaf_pem, server.Pem());
+  EXPECT_EQ(peer.host, "localhost");
+}
+
+TEST_F(CertTest, TlsHookInstallsCachedHostStore) {
+  SCOPED_TRACE(
+    "Trust comes from the cached per-host store, not from a CA file.");
+  RecordProperty("description",
+                 "With the server's certificate recorded as an issuer for "
+                 "'localhost', the handshake verifies through the hook's "
+                 "store; without it, it fails.");
+  OneShotTlsServer first, second;
+  const auto base = WritePemFile(kDummyPem, tmpdir, "base.pem");
+  CertCache cache;
+  Cert cert(tmpdir, base, cache);
+
+  Cert::TlsHook hook{&cert, "localhost", nullptr};
+  EXPECT_NE(PerformAgainst(first, &hook), CURLE_OK);
+
+  cache.SetHostIssuers("localhost", {second.Pem()});
+  EXPECT_EQ(PerformAgainst(second, &hook), CURLE_OK);
+  EXPECT_NE(cert.HostStore("localhost"), cache.BaseStore(base));
+  EXPECT_EQ(cert.HostStore("elsewhere"), cache.BaseStore(base));
+}
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include "CertCache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static const std::string kPem =
+  "-----BEGIN CERTIFICATE-----\nMIIB\n-----END CERTIFICATE-----\n";
+
+class CertCacheTest : public ::testing::Test {
+ protected:
+  fs::path tmpdir;
+
+  void SetUp() override {
+    tmpdir = fs::temp_directory_path() / "cert_cache_test";
+    fs::remove_all(tmpdir);
+  }
+
+  void TearDown() override {
+    fs::remove_all(tmpdir);
+  }
+};
+
+TEST_F(CertCacheTest, AiaEntriesExpire) {
+  SCOPED_TRACE("AIA entries are served by host and fingerprint until expiry.");
+  RecordProperty("description",
+                 "PutAia indexes an entry under host and leaf fingerprint; "
+                 "expired entries are not returned.");
+
+  CertCache cache;
+  CertCache::AiaEntry fresh{{"http://ca/x.crt"}, false,
+                            CertCache::Clock::now() + std::chrono::hours(1)};
+  cache.PutAia("a.example", "fp1", fresh);
+  ASSERT_TRUE(cache.AiaForHost("a.example").has_value());
+  EXPECT_EQ(cache.AiaForLeaf("fp1")->urls, fresh.urls);
+
+  CertCache::AiaEntry stale{{}, true, CertCache::Clock::now()};
+  cache.PutAia("b.example", "", stale);
+  EXPECT_FALSE(cache.AiaForHost("b.example").has_value());
+  EXPECT_FALSE(cache.AiaForLeaf("").has_value());
+}
+
+TEST_F(CertCacheTest, EvictsLeastRecentlyUsed) {
+  SCOPED_TRACE("Past its limit a table drops its coldest entries.");
+  RecordProperty("description",
+                 "With room for 8 issuers, inserting more evicts the least "
+                 "recently used ones while a recently read entry survives.");
+
+  CertCache cache({.aia_hosts = 8, .aia_leaves = 8, .issuers = 8,
+                   .host_stores = 8});
+  for (int i = 0; i < 8; ++i)
+    cache.PutIssuer("http://ca/" + std::to_string(i), kPem);
+  EXPECT_EQ(cache.IssuerCount(), 8u);
+
+  // touch the oldest so it is no longer the coldest
+  ASSERT_TRUE(cache.Issuer("http://ca/0").has_value());
+  cache.PutIssuer("http://ca/8", kPem);
+
+  EXPECT_LE(cache.IssuerCount(), 8u);
+  EXPECT_TRUE(cache.Issuer("http://ca/0").has_value());
+  EXPECT_TRUE(cache.Issuer("http://ca/8").has_value());
+  EXPECT_FALSE(cache.Issuer("http://ca/1").has_value());
+}
+
+TEST_F(CertCacheTest, IssuersPersistAcrossInstances) {
+  SCOPED_TRACE("Issuers written under the issuer dir load into a new cache.");
+  RecordProperty("description",
+                 "SetIssuerDir makes PutIssuer write files that a later "
+                 "SetIssuerDir on a fresh cache reads back.");
+
+  {
+    CertCache first;
+    EXPECT_EQ(first.SetIssuerDir(tmpdir), 0u);
+    first.PutIssuer("http://ca.example/int.crt", kPem);
+  }
+  CertCache second;
+  EXPECT_EQ(second.SetIssuerDir(tmpdir), 1u);
+  auto pem = second.Issuer("http://ca.example/int.crt");
+  ASSERT_TRUE(pem.has_value());
+  EXPECT_EQ(*pem, kPem);
+}
+
+TEST_F(CertCacheTest, HostIssuersAndStores) {
+  SCOPED_TRACE("Per-host issuers load from pem_dir; stores are per host.");
+  RecordProperty("description",
+                 "LoadHostIssuers indexes '<host>__<issuer>.pem' files; "
+                 "setting issuers drops the host's built store; an unreadable "
+                 "base bundle yields no store.");
+
+  fs::create_directories(tmpdir);
+  std::ofstream(tmpdir / "a.example__Some_CA.pem") << kPem;
+  std::ofstream(tmpdir / "a.example__Other_CA.pem") << kPem;
+  std::ofstream(tmpdir / "unrelated.pem") << kPem;
+
+  CertCache cache;
+  EXPECT_EQ(cache.LoadHostIssuers(tmpdir), 2u);
+  EXPECT_EQ(cache.HostIssuers("a.example").size(), 2u);
+  EXPECT_TRUE(cache.HostIssuers("b.example").empty());
+
+  EXPECT_EQ(cache.BaseStore(tmpdir / "missing.pem"), nullptr);
+
+  CertCache::StorePtr store(X509_STORE_new(), X509_STORE_free);
+  cache.PutHostStore("a.example", store);
+  EXPECT_EQ(cache.HostStore("a.example"), store);
+  cache.SetHostIssuers("a.example", {kPem});
+  EXPECT_EQ(cache.HostStore("a.example"), nullptr);
+}
+
+TEST_F(CertCacheTest, ConcurrentReadersAndWriters) {
+  SCOPED_TRACE("Shared lookups race with inserts and evictions.");
+  RecordProperty("description",
+                 "Threads reading and writing one small cache never see a "
+                 "torn value.");
+
+  CertCache cache({.aia_hosts = 64, .aia_leaves = 64, .issuers = 64,
+                   .host_stores = 64});
+  std::atomic<int> bad{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < 2000; ++i) {
+        const std::string key =
+          "http://ca/" + std::to_string((i * 7 + t) % 200);
+        if (i % 3 == 0)
+          cache.PutIssuer(key, kPem);
+        else if (auto pem = cache.Issuer(key); pem && *pem != kPem)
+          ++bad;
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+  EXPECT_EQ(bad.load(), 0);
+  EXPECT_LE(cache.IssuerCount(), 64u);
+}
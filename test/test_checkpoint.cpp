@@ -0,0 +1,181 @@
+#include <gtest/gtest.h>
+#include "Checkpoint.hpp"
+#include "Frontier.hpp"
+#include "URL.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+TEST(CheckpointTest, WriteRestoreAndClear) {
+  SCOPED_TRACE("Checkpoints round-trip each domain's frontier through disk.");
+  RecordProperty("description",
+                 "Write() stores one file per domain after running the "
+                 "before-hook; Restore() rebuilds the frontiers by domain; "
+                 "Clear() removes the files.");
+
+  const auto dir = fs::temp_directory_path() / "checkpoint_test";
+  fs::remove_all(dir);
+
+  Checkpoint::Frontiers frontiers;
+  frontiers[URL("https://a.example/")].Push(URL("https://a.example/1"));
+  frontiers[URL("https://b.example/")].Push(URL("https://b.example/1"));
+  frontiers[URL("https://b.example/")].Push(URL("https://b.example/2"));
+
+  int flushed = 0;
+  Checkpoint ckpt({dir, std::chrono::seconds(3600)}, frontiers,
+                  [&] { ++flushed; });
+  EXPECT_EQ(ckpt.Write(), 2u);
+  EXPECT_EQ(flushed, 1);
+  EXPECT_TRUE(fs::exists(dir / (URL("https://a.example/").GetSha256() +
+                                ".ckpt")));
+
+  Checkpoint::Frontiers restored;
+  const size_t n = Checkpoint::Restore(
+    dir, [&](const URL& domain) -> Frontier* { return &restored[domain]; });
+  EXPECT_EQ(n, 2u);
+  EXPECT_EQ(restored[URL("https://a.example/")].Size(), 1u);
+  EXPECT_EQ(restored[URL("https://b.example/")].Size(), 2u);
+  EXPECT_FALSE(restored[URL("https://b.example/")].Push(
+    URL("https://b.example/2")));
+
+  ckpt.Clear();
+  EXPECT_TRUE(fs::is_empty(dir));
+  fs::remove_all(dir);
+}
+
+TEST(CheckpointTest, RestoreSkipsDomainsWithoutFrontier) {
+  SCOPED_TRACE("Domains outside this run are left on disk, not loaded.");
+  RecordProperty("description",
+                 "frontier_for returns nullptr for b.example: only a.example "
+                 "is restored and b.example's file is kept.");
+
+  const auto dir = fs::temp_directory_path() / "checkpoint_skip_test";
+  fs::remove_all(dir);
+
+  Checkpoint::Frontiers frontiers;
+  frontiers[URL("https://a.example/")].Push(URL("https://a.example/1"));
+  frontiers[URL("https://b.example/")].Push(URL("https://b.example/1"));
+  Checkpoint ckpt({dir, std::chrono::seconds(3600)}, frontiers);
+  ASSERT_EQ(ckpt.Write(), 2u);
+
+  Checkpoint::Frontiers restored;
+  const size_t n =
+    Checkpoint::Restore(dir, [&](const URL& domain) -> Frontier* {
+      if (domain == URL("https://b.example/"))
+        return nullptr;
+      return &restored[domain];
+    });
+  EXPECT_EQ(n, 1u);
+  EXPECT_EQ(restored.size(), 1u);
+  EXPECT_EQ(restored[URL("https://a.example/")].Size(), 1u);
+  EXPECT_TRUE(fs::exists(dir / (URL("https://b.example/").GetSha256() +
+                                ".ckpt")));
+  fs::remove_all(dir);
+}
+
+TEST(CheckpointTest, DamagedFileIsIgnored) {
+  SCOPED_TRACE("A corrupt checkpoint is skipped rather than half-loaded.");
+  RecordProperty("description",
+                 "Flipping one byte breaks the checksum: Decode() rejects it "
+                 "and Restore() loads nothing from that file.");
+
+  const auto dir = fs::temp_directory_path() / "checkpoint_damaged_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  Frontier f;
+  f.Push(URL("https://a.example/1"));
+  std::string data = Checkpoint::Encode("https://a.example/", f);
+
+  std::string domain, tail;
+  std::string_view payload;
+  ASSERT_TRUE(Checkpoint::Decode(data, domain, tail, payload));
+  EXPECT_EQ(domain, "https://a.example/");
+  EXPECT_TRUE(tail.empty());
+
+  data[data.size() / 2] ^= 0x40;
+  EXPECT_FALSE(Checkpoint::Decode(data, domain, tail, payload));
+  std::ofstream(dir / "bad.ckpt", std::ios::binary) << data;
+
+  int asked = 0;
+  Frontier unused;
+  EXPECT_EQ(Checkpoint::Restore(dir,
+                                [&](const URL&) -> Frontier* {
+                                  ++asked;
+                                  return &unused;
+                                }),
+            0u);
+  EXPECT_EQ(asked, 0);
+  EXPECT_TRUE(unused.Empty());
+  fs::remove_all(dir);
+}
+
+TEST(CheckpointTest, SpilledSegmentsAreLinkedNotCopied) {
+  SCOPED_TRACE("Tail segments go into a tail dir beside the checkpoint.");
+  RecordProperty("description",
+                 "A frontier that has spilled is saved with its segments "
+                 "hard-linked into <sha>.<ms>.tail, so the file itself stays "
+                 "small; Restore() reads them back after the spill dir is "
+                 "gone, the next Write() replaces the tail dir and Clear() "
+                 "removes it.");
+
+  const auto dir = fs::temp_directory_path() / "checkpoint_tail_test";
+  const auto spill = fs::temp_directory_path() / "checkpoint_tail_spill";
+  fs::remove_all(dir);
+
+  const URL domain("https://a.example/");
+  const std::string padding(200, 'x');
+  Checkpoint::Frontiers frontiers;
+  auto& f = frontiers.try_emplace(domain, spill, 4).first->second;
+  for (int i = 0; i < 500; ++i)
+    f.Push(URL("https://a.example/" + std::to_string(i) + "?" + padding));
+
+  auto tails = [&] {
+    std::vector<fs::path> out;
+    for (const auto& e : fs::directory_iterator(dir)) {
+      if (e.path().extension() == ".tail")
+        out.push_back(e.path());
+    }
+    return out;
+  };
+
+  Checkpoint ckpt({dir, std::chrono::seconds(3600)}, frontiers);
+  ASSERT_EQ(ckpt.Write(), 1u);
+  const auto first = tails();
+  ASSERT_EQ(first.size(), 1u);
+  EXPECT_FALSE(fs::is_empty(first[0]));
+  for (const auto& seg : fs::directory_iterator(first[0]))
+    EXPECT_EQ(fs::hard_link_count(seg.path()), 2u) << seg.path();
+  // 500 URLs of 200+ bytes each stay in the tail dir, not the file
+  EXPECT_LT(fs::file_size(dir / (domain.GetSha256() + ".ckpt")), 32u * 1024);
+
+  // the links keep the segments even once the files they came from go
+  const auto respill = fs::temp_directory_path() / "checkpoint_tail_respill";
+  Checkpoint::Frontiers restored;
+  Frontier& g = restored.try_emplace(domain, respill, 4).first->second;
+  ASSERT_EQ(Checkpoint::Restore(
+              dir, [&](const URL&) -> Frontier* { return &g; }),
+            1u);
+  EXPECT_EQ(g.Size(), 500u);
+  size_t popped = 0;
+  while (g.Pop())
+    ++popped;
+  EXPECT_EQ(popped, 500u);
+
+  f.Pop();
+  ASSERT_EQ(ckpt.Write(), 1u);
+  const auto second = tails();
+  ASSERT_EQ(second.size(), 1u);
+  EXPECT_NE(second[0], first[0]);
+
+  ckpt.Clear();
+  EXPECT_TRUE(fs::is_empty(dir));
+  fs::remove_all(dir);
+  fs::remove_all(spill);
+  fs::remove_all(respill);
+}
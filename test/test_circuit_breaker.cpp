@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "CircuitBreaker.hpp"
+
+#include <chrono>
+
+using namespace std::chrono_literals;
+using State = CircuitBreaker::State;
+
+TEST(CircuitBreakerTest, TripsAfterConsecutiveFailures) {
+  SCOPED_TRACE("Only an unbroken run of failures opens the breaker.");
+  RecordProperty("description",
+                 "A success resets the count; the third failure in a row "
+                 "opens it and Admit() holds fetches until the cool-down.");
+
+  CircuitBreaker cb({.failure_threshold = 3, .open = 30s, .max_open = 600s});
+  const auto t0 = CircuitBreaker::Clock::now();
+
+  EXPECT_FALSE(cb.OnFailure("a.example", t0).has_value());
+  EXPECT_FALSE(cb.OnFailure("a.example", t0).has_value());
+  cb.OnSuccess("a.example");
+  EXPECT_FALSE(cb.OnFailure("a.example", t0).has_value());
+  EXPECT_FALSE(cb.OnFailure("a.example", t0).has_value());
+  auto until = cb.OnFailure("a.example", t0);
+  ASSERT_TRUE(until.has_value());
+  EXPECT_EQ(*until, t0 + 30s);
+  EXPECT_EQ(cb.GetState("a.example"), State::Open);
+
+  EXPECT_EQ(cb.Admit("a.example", t0 + 10s), t0 + 30s);
+  EXPECT_FALSE(cb.Admit("b.example", t0 + 10s).has_value());
+}
+
+TEST(CircuitBreakerTest, HalfOpenLetsOneProbeThrough) {
+  SCOPED_TRACE("After the cool-down a single probe decides the state.");
+  RecordProperty("description",
+                 "The first Admit() after open_until is the probe, others "
+                 "wait; a successful probe closes the breaker.");
+
+  CircuitBreaker cb({.failure_threshold = 1, .open = 30s, .max_open = 600s});
+  const auto t0 = CircuitBreaker::Clock::now();
+  ASSERT_TRUE(cb.OnFailure("a.example", t0).has_value());
+
+  EXPECT_FALSE(cb.Admit("a.example", t0 + 31s).has_value());
+  EXPECT_EQ(cb.GetState("a.example"), State::HalfOpen);
+  auto wait = cb.Admit("a.example", t0 + 31s);
+  ASSERT_TRUE(wait.has_value());
+  EXPECT_GT(*wait, t0 + 31s);
+
+  cb.OnSuccess("a.example");
+  EXPECT_EQ(cb.GetState("a.example"), State::Closed);
+  EXPECT_FALSE(cb.Admit("a.example", t0 + 31s).has_value());
+}
+
+TEST(CircuitBreakerTest, FailedProbesDoubleTheCoolDown) {
+  SCOPED_TRACE("Each failed probe re-opens for longer, up to max_open.");
+  RecordProperty("description",
+                 "Cool-downs go 30s, 60s, 120s and stop at max_open; the "
+                 "report lists the host with its trip count.");
+
+  CircuitBreaker cb({.failure_threshold = 1, .open = 30s, .max_open = 100s});
+  auto now = CircuitBreaker::Clock::now();
+  auto until = cb.OnFailure("a.example", now);
+  EXPECT_EQ(*until - now, 30s);
+
+  for (auto expect : {60s, 100s}) {
+    now = *until;
+    ASSERT_FALSE(cb.Admit("a.example", now).has_value());  // the probe
+    until = cb.OnFailure("a.example", now);
+    ASSERT_TRUE(until.has_value());
+    EXPECT_EQ(*until - now, expect);
+  }
+
+  cb.OnSuccess("ok.example");
+  auto report = cb.Report();
+  ASSERT_EQ(report.size(), 1u);
+  EXPECT_EQ(report[0].host, "a.example");
+  EXPECT_EQ(report[0].state, State::Open);
+  EXPECT_EQ(report[0].trips, 3u);
+}
+
+TEST(CircuitBreakerTest, GivesUpAfterLongestCoolDown) {
+  SCOPED_TRACE("A probe that fails after max_open kills the host.");
+  RecordProperty("description",
+                 "With open equal to max_open the second failed probe "
+                 "returns kGiveUp; the host is dead and Admit() turns every "
+                 "later fetch away with kGiveUp instead of a reopen time.");
+
+  CircuitBreaker cb({.failure_threshold = 1, .open = 10s, .max_open = 10s});
+  auto now = CircuitBreaker::Clock::now();
+  auto until = cb.OnFailure("a.example", now);
+  ASSERT_TRUE(until.has_value());
+  EXPECT_EQ(*until - now, 10s);
+
+  now = *until;
+  ASSERT_FALSE(cb.Admit("a.example", now).has_value());  // the probe
+  EXPECT_EQ(cb.OnFailure("a.example", now), CircuitBreaker::kGiveUp);
+  EXPECT_EQ(cb.GetState("a.example"), State::Dead);
+
+  EXPECT_EQ(cb.Admit("a.example", now + 1h), CircuitBreaker::kGiveUp);
+  EXPECT_FALSE(cb.OnFailure("a.example", now + 1h).has_value());
+  EXPECT_FALSE(cb.Admit("b.example", now).has_value());
+
+  auto report = cb.Report();
+  ASSERT_EQ(report.size(), 1u);
+  EXPECT_EQ(report[0].state, State::Dead);
+  EXPECT_EQ(report[0].trips, 2u);
+  EXPECT_EQ(report[0].rejected, 1u);
+}
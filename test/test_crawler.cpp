@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include "CacheManager.hpp"
+#include "Config.hpp"
+#include "Crawler.hpp"
+#include "Frontier.hpp"
+#include "LuaProcessor.hpp"
+#include "ResultSink.hpp"
+#include "URL.hpp"
+#include "URLManager.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+using namespace std::chrono_literals;
+
+namespace {
+// A loopback port nothing listens on: bound, then closed again
+std::uint16_t ClosedPort() {
+  const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+  ::close(fd);
+  return ntohs(addr.sin_port);
+}
+}  // namespace
+
+TEST(CrawlerTest, CrawlReturnsWhenHostNeverConnects) {
+  SCOPED_TRACE("A dead host is given up on instead of holding its domain.");
+  RecordProperty("description",
+                 "Every fetch to a closed loopback port is refused. With a "
+                 "one-second breaker cool-down the probe after it fails, the "
+                 "host is given up on, Crawl() returns and every queued URL "
+                 "is in the dead-letter file.");
+
+  const auto dir = fs::temp_directory_path() / "crawler_dead_host_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "scripts");
+  fs::create_directories(dir / "data");
+  std::ofstream(dir / "ua.list") << "test-agent/1.0\n";
+  std::ofstream(dir / "conf.json") << R"({
+    "cache_dir": ")" << (dir / "cache").string() << R"(",
+    "data_dir": ")" << (dir / "data").string() << R"(",
+    "plugins_dir": ")" << (dir / "plugins").string() << R"(",
+    "script_dir": ")" << (dir / "scripts").string() << R"(",
+    "pem_dir": ")" << (dir / "pem").string() << R"(",
+    "user_agent_list": ")" << (dir / "ua.list").string() << R"(",
+    "rate_limit_ms": {},
+    "retry": { "jitter": 0, "connect": { "max_retries": 1000,
+                                         "base_ms": 10, "cap_ms": 10 } },
+    "circuit_breaker": { "failure_threshold": 1, "open_s": 1,
+                         "max_open_s": 1 }
+  })";
+
+  Config conf(dir / "conf.json");
+  CacheManager cache(conf.GetCacheDir(), conf.GetCacheAgeLimit());
+  URLManager urlm(conf.GetDataDir());
+  auto results = ResultSink::Create(conf.GetResults(), cache);
+
+  const std::string origin =
+    "http://127.0.0.1:" + std::to_string(ClosedPort());
+  const URL domain(origin + "/");
+  LuaProcessor luap(conf.GetScriptDir(), domain);
+  Frontier frontier;
+  for (int i = 0; i < 5; ++i)
+    frontier.Push(URL(origin + "/" + std::to_string(i)));
+
+  Crawler crawler(frontier, domain, conf, cache, luap, urlm, *results);
+  std::promise<void> finished;
+  std::thread crawl([&] {
+    crawler.Crawl();
+    finished.set_value();
+  });
+  if (finished.get_future().wait_for(60s) != std::future_status::ready) {
+    ADD_FAILURE() << "Crawl() did not return for a host that never connects";
+    std::_Exit(1);  // the crawl thread still uses this frame
+  }
+  crawl.join();
+
+  EXPECT_TRUE(frontier.Empty());
+  std::ifstream in(conf.GetDataDir() / "dead_letter.jsonl");
+  std::string line;
+  size_t lines = 0, given_up = 0;
+  while (std::getline(in, line)) {
+    ++lines;
+    if (line.find("circuit breaker gave up") != std::string::npos)
+      ++given_up;
+  }
+  EXPECT_EQ(lines, 5u);
+  EXPECT_EQ(given_up, 5u);
+  fs::remove_all(dir);
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include "FetchEngine.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// --- Test helper: a keep-alive HTTP/1.1 server on 127.0.0.1 that answers
+// every request with its path as the body and counts accepted connections ---
+class KeepAliveServer {
+ public:
+  KeepAliveServer() {
+    lfd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(lfd_, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    socklen_t len = sizeof(sa);
+    ::getsockname(lfd_, reinterpret_cast<sockaddr*>(&sa), &len);
+    port_ = ntohs(sa.sin_port);
+    ::listen(lfd_, 16);
+    thread_ = std::thread([this] { Accept(); });
+  }
+
+  ~KeepAliveServer() {
+    stop_ = true;
+    thread_.join();
+    for (auto& t : conns_)
+      t.join();
+    ::close(lfd_);
+  }
+
+  std::uint16_t Port() const {
+    return port_;
+  }
+
+  std::string Url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(port_) + path;
+  }
+
+  int Connections() const {
+    return accepted_.load();
+  }
+
+ private:
+  void Accept() {
+    while (!stop_) {
+      pollfd p{lfd_, POLLIN, 0};
+      if (::poll(&p, 1, 20) <= 0)
+        continue;
+      const int fd = ::accept(lfd_, nullptr, nullptr);
+      if (fd < 0)
+        continue;
+      ++accepted_;
+      conns_.emplace_back([this, fd] { Serve(fd); });
+    }
+  }
+
+  void Serve(int fd) {
+    std::string in;
+    while (!stop_) {
+      pollfd p{fd, POLLIN, 0};
+      if (::poll(&p, 1, 20) <= 0)
+        continue;
+      char buf[4096];
+      const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+      if (n <= 0)
+        break;
+      in.append(buf, n);
+      // requests carry no body, so each ends at the blank line
+      for (auto end = in.find("\r\n\r\n"); end != std::string::npos;
+           end = in.find("\r\n\r\n")) {
+        const auto sp = in.find(' ');
+        const std::string path =
+          in.substr(sp + 1, in.find(' ', sp + 1) - sp - 1);
+        in.erase(0, end + 4);
+        const std::string resp = "HTTP/1.1 200 OK\r\nContent-Length: " +
+                                 std::to_string(path.size()) + "\r\n\r\n" +
+                                 path;
+        ::send(fd, resp.data(), resp.size(), MSG_NOSIGNAL);
+      }
+    }
+    ::close(fd);
+  }
+
+  int lfd_{-1};
+  std::uint16_t port_{0};
+  std::atomic<bool> stop_{false};
+  std::atomic<int> accepted_{0};
+  std::thread thread_;
+  std::vector<std::thread> conns_;  // touched by the accept thread only
+};
+
+static size_t AppendBody(char* ptr, size_t size, size_t nmemb,
+                         void* userdata) {
+  static_cast<std::string*>(userdata)->append(ptr, size * nmemb);
+  return size * nmemb;
+}
+
+static CURL* MakeEasy(const std::string& url, std::string* body) {
+  CURL* easy = curl_easy_init();
+  curl_easy_setopt(easy, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, 10000L);
+  curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, AppendBody);
+  curl_easy_setopt(easy, CURLOPT_WRITEDATA, body);
+  return easy;
+}
+
+TEST(FetchEngineTest, ConcurrentPerformsComplete) {
+  SCOPED_TRACE("Callers on many threads each get their own transfer back.");
+  RecordProperty("description",
+                 "16 threads performing distinct handles on one engine all "
+                 "complete with CURLE_OK and their own response body.");
+
+  KeepAliveServer server;
+  FetchEngine engine({.max_host_connections = 4, .max_streams = 100});
+
+  constexpr int kThreads = 16;
+  std::vector<std::string> bodies(kThreads);
+  std::vector<CURLcode> codes(kThreads, CURLE_FAILED_INIT);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      CURL* easy = MakeEasy(server.Url("/p" + std::to_string(i)), &bodies[i]);
+      codes[i] = engine.Perform(easy);
+      curl_easy_cleanup(easy);
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+
+  for (int i = 0; i < kThreads; ++i) {
+    EXPECT_EQ(codes[i], CURLE_OK) << curl_easy_strerror(codes[i]);
+    EXPECT_EQ(bodies[i], "/p" + std::to_string(i));
+  }
+  EXPECT_LE(server.Connections(), 4);
+}
+
+TEST(FetchEngineTest, ReusesConnectionsAcrossHandles) {
+  SCOPED_TRACE("The multi handle's connection cache outlives each handle.");
+  RecordProperty("description",
+                 "Fresh easy handles performed one after another share a "
+                 "single keep-alive connection to the origin.");
+
+  KeepAliveServer server;
+  FetchEngine engine({.max_host_connections = 1, .max_streams = 100});
+
+  long new_connects = 0;
+  for (int i = 0; i < 5; ++i) {
+    std::string body;
+    CURL* easy = MakeEasy(server.Url("/seq"), &body);
+    ASSERT_EQ(engine.Perform(easy), CURLE_OK);
+    long n = 0;
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &n);
+    new_connects += n;
+    // the caller may perform its handle again once Perform returns
+    body.clear();
+    ASSERT_EQ(engine.Perform(easy), CURLE_OK);
+    EXPECT_EQ(body, "/seq");
+    curl_easy_cleanup(easy);
+  }
+  EXPECT_EQ(new_connects, 1);
+  EXPECT_EQ(server.Connections(), 1);
+}
+
+TEST(FetchEngineTest, ReportsTransferErrors) {
+  SCOPED_TRACE("A failing transfer resolves its caller with the curl code.");
+  RecordProperty("description",
+                 "A connection refused by a closed port comes back as "
+                 "CURLE_COULDNT_CONNECT rather than hanging the caller.");
+
+  std::uint16_t port;
+  {
+    KeepAliveServer gone;
+    port = gone.Port();
+  }
+  FetchEngine engine({});
+  std::string body;
+  CURL* easy =
+    MakeEasy("http://127.0.0.1:" + std::to_string(port) + "/", &body);
+  EXPECT_EQ(engine.Perform(easy), CURLE_COULDNT_CONNECT);
+  curl_easy_cleanup(easy);
+}
+
+TEST(FetchEngineTest, RemembersHttp1Hosts) {
+  SCOPED_TRACE("Hosts that failed over HTTP/2 stay on HTTP/1.1.");
+  RecordProperty("description",
+                 "MarkHttp1 is per host and sticks for the engine's lifetime.");
+
+  FetchEngine engine({});
+  EXPECT_FALSE(engine.PrefersHttp1("a.example"));
+  engine.MarkHttp1("a.example");
+  engine.MarkHttp1("a.example");
+  EXPECT_TRUE(engine.PrefersHttp1("a.example"));
+  EXPECT_FALSE(engine.PrefersHttp1("b.example"));
+}
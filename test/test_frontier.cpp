@@ -0,0 +1,455 @@
+#include <gtest/gtest.h>
+#include "Frontier.hpp"
+#include "URL.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+TEST(FrontierTest, PopsHighestPriorityFirst) {
+  SCOPED_TRACE("Entries come out in descending priority order.");
+  RecordProperty("description",
+                 "Pushes three URLs with different Lua priorities and expects "
+                 "Pop() to return them highest first.");
+
+  Frontier f;
+  f.Push(URL("https://example.com/low"), 1);
+  f.Push(URL("https://example.com/high"), 10);
+  f.Push(URL("https://example.com/mid"), 5);
+
+  EXPECT_EQ(f.Pop()->url, "https://example.com/high");
+  EXPECT_EQ(f.Pop()->url, "https://example.com/mid");
+  EXPECT_EQ(f.Pop()->url, "https://example.com/low");
+  EXPECT_FALSE(f.Pop().has_value());
+  EXPECT_TRUE(f.Empty());
+}
+
+TEST(FrontierTest, DepthLowersScoreAndTiesAreFifo) {
+  SCOPED_TRACE("Deeper links rank below shallower ones; equal scores are FIFO.");
+  RecordProperty("description",
+                 "Verifies the depth penalty in Score() and that entries with "
+                 "equal scores keep insertion order.");
+
+  Frontier f;
+  f.Push(URL("https://example.com/deep"), 0, 3);
+  f.Push(URL("https://example.com/a"), 0, 0);
+  f.Push(URL("https://example.com/b"), 0, 0);
+
+  EXPECT_EQ(f.Pop()->url, "https://example.com/a");
+  EXPECT_EQ(f.Pop()->url, "https://example.com/b");
+
+  auto deep = f.Pop();
+  ASSERT_TRUE(deep.has_value());
+  EXPECT_EQ(deep->url, "https://example.com/deep");
+  EXPECT_EQ(deep->depth, 3u);
+}
+
+TEST(FrontierTest, RejectsDuplicates) {
+  SCOPED_TRACE("A URL is only queued once, even after it has been popped.");
+  RecordProperty("description",
+                 "Push() returns false for URLs already seen by the frontier.");
+
+  Frontier f;
+  EXPECT_TRUE(f.Push(URL("https://example.com/x")));
+  EXPECT_FALSE(f.Push(URL("https://example.com/x"), 100));
+  EXPECT_EQ(f.Size(), 1u);
+  f.Pop();
+  EXPECT_FALSE(f.Push(URL("https://example.com/x")));
+}
+
+TEST(FrontierTest, DeferredHostIsSkipped) {
+  SCOPED_TRACE("A deferred host yields to ready hosts until its time passes.");
+  RecordProperty("description",
+                 "Defer() holds back a host's best entry; NextReadyTime() "
+                 "reports when it becomes available.");
+
+  using namespace std::chrono_literals;
+  const auto now = Frontier::Clock::now();
+
+  Frontier f;
+  f.Push(URL("https://a.example.com/"), 10);
+  f.Push(URL("https://b.example.com/"), 1);
+  f.Defer("a.example.com", now + 1h);
+
+  auto first = f.Pop(now);
+  ASSERT_TRUE(first.has_value());
+  EXPECT_EQ(first->url, "https://b.example.com/");
+  EXPECT_FALSE(f.Pop(now).has_value());
+
+  auto ready = f.NextReadyTime();
+  ASSERT_TRUE(ready.has_value());
+  EXPECT_EQ(*ready, now + 1h);
+  EXPECT_EQ(f.Pop(now + 2h)->url, "https://a.example.com/");
+}
+
+TEST(FrontierTest, SpillsBeyondHeadLimitAndPagesBackIn) {
+  SCOPED_TRACE("Entries past the per-host head limit go to disk and return.");
+  RecordProperty("description",
+                 "With a head limit of 4, pushing 20 URLs writes tail segments "
+                 "under the spill dir; every URL is still popped exactly once.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "frontier_test";
+
+  std::set<std::string> popped;
+  {
+    Frontier f(dir, 4);
+    for (int i = 0; i < 20; ++i) {
+      f.Push(URL("https://example.com/" + std::to_string(i)));
+    }
+    EXPECT_EQ(f.Size(), 20u);
+    EXPECT_TRUE(fs::exists(dir / "example.com"));
+
+    while (auto e = f.Pop()) {
+      EXPECT_TRUE(popped.insert(e->url).second) << "duplicate " << e->url;
+    }
+    EXPECT_TRUE(f.Empty());
+  }
+  EXPECT_EQ(popped.size(), 20u);
+  fs::remove_all(dir);
+}
+
+TEST(FrontierTest, SpilledEntriesKeepScoreOrder) {
+  SCOPED_TRACE("A full head never hides a better entry in the tail.");
+  RecordProperty("description",
+                 "With a head limit of 4, URLs pushed with scattered "
+                 "priorities, some while pages are popped, still come out in "
+                 "descending score order, FIFO among equal scores.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "frontier_order_test";
+
+  Frontier f(dir, 4);
+  std::vector<double> popped;
+  std::uint32_t x = 12345;
+  auto next = [&] {
+    x = x * 1103515245 + 12345;
+    return static_cast<double>((x >> 16) % 7);
+  };
+  for (int i = 0; i < 40; ++i)
+    f.Push(URL("https://example.com/a" + std::to_string(i)), next());
+  for (int i = 0; i < 10; ++i)
+    popped.push_back(f.Pop()->priority);
+  // everything from here on ranks below what has already been popped
+  const double floor = *std::min_element(popped.begin(), popped.end());
+  for (int i = 0; i < 40; ++i) {
+    f.Push(URL("https://example.com/b" + std::to_string(i)),
+           std::min(floor, next()));
+  }
+  popped.clear();
+  std::vector<std::uint64_t> seqs;
+  while (auto e = f.Pop()) {
+    if (!popped.empty() && e->priority == popped.back()) {
+      EXPECT_GT(e->seq, seqs.back()) << e->url;
+    }
+    popped.push_back(e->priority);
+    seqs.push_back(e->seq);
+  }
+  EXPECT_EQ(popped.size(), 70u);
+  EXPECT_TRUE(std::is_sorted(popped.rbegin(), popped.rend()));
+
+  // a late high-priority link jumps every spilled entry
+  for (int i = 0; i < 20; ++i)
+    f.Push(URL("https://example.com/c" + std::to_string(i)));
+  f.Push(URL("https://example.com/urgent"), 10);
+  EXPECT_EQ(f.Pop()->url, "https://example.com/urgent");
+  fs::remove_all(dir);
+}
+
+TEST(FrontierTest, ConcurrentPushAndPopWithSpill) {
+  SCOPED_TRACE("Paging in outside the lock loses and repeats nothing.");
+  RecordProperty("description",
+                 "Threads push to several spilling hosts while others pop; "
+                 "every URL is popped exactly once.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "frontier_concurrent_test";
+
+  Frontier f(dir, 8);
+  constexpr int kPushers = 4, kPerPusher = 500;
+  std::atomic<int> pushing{kPushers};
+  std::mutex mtx;
+  std::multiset<std::string> popped;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kPushers; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerPusher; ++i) {
+        f.Push(URL("https://h" + std::to_string(i % 3) + ".example/" +
+                   std::to_string(t) + "-" + std::to_string(i)),
+               i % 5);
+      }
+      --pushing;
+    });
+  }
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (;;) {
+        const bool done = pushing == 0;
+        if (auto e = f.Pop()) {
+          f.Complete(*e);
+          std::lock_guard<std::mutex> lock(mtx);
+          popped.insert(e->url);
+        } else if (done && f.Empty()) {
+          return;
+        }
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+
+  EXPECT_EQ(popped.size(), size_t{kPushers * kPerPusher});
+  EXPECT_EQ(std::set<std::string>(popped.begin(), popped.end()).size(),
+            popped.size());
+  EXPECT_TRUE(f.Empty());
+  fs::remove_all(dir);
+}
+
+TEST(FrontierTest, RetryWaitsForNotBefore) {
+  SCOPED_TRACE("A retried entry stays counted but is held until not_before.");
+  RecordProperty("description",
+                 "Retry() re-queues a popped entry despite de-duplication; it "
+                 "is not popped early and keeps its attempt count.");
+
+  using namespace std::chrono_literals;
+  const auto now = Frontier::Clock::now();
+
+  Frontier f;
+  f.Push(URL("https://example.com/flaky"), 0, 2);
+  auto e = f.Pop(now);
+  ASSERT_TRUE(e.has_value());
+  e->attempt = 1;
+  f.Retry(*e, now + 30s);
+
+  EXPECT_EQ(f.Size(), 1u);
+  EXPECT_FALSE(f.Empty());
+  EXPECT_FALSE(f.Pop(now).has_value());
+  ASSERT_TRUE(f.NextReadyTime().has_value());
+  EXPECT_EQ(*f.NextReadyTime(), now + 30s);
+
+  auto again = f.Pop(now + 31s);
+  ASSERT_TRUE(again.has_value());
+  EXPECT_EQ(again->url, "https://example.com/flaky");
+  EXPECT_EQ(again->depth, 2u);
+  EXPECT_EQ(again->attempt, 1u);
+  EXPECT_TRUE(f.Empty());
+}
+
+TEST(FrontierTest, SaveAndLoadRoundTrip) {
+  SCOPED_TRACE("A snapshot restores pending, spilled, delayed and leased "
+               "entries, deferrals and the seen set.");
+  RecordProperty("description",
+                 "Save() on a frontier with spilled tail segments, a retry, "
+                 "a deferred host and an unfinished popped entry; Load() into "
+                 "a fresh frontier links the segments back in unread, yields "
+                 "the same pending URLs, still rejects URLs seen before, and "
+                 "rejects truncated input.");
+
+  namespace fs = std::filesystem;
+  using namespace std::chrono_literals;
+  const auto dir = fs::temp_directory_path() / "frontier_snapshot_test";
+  const auto tails = fs::temp_directory_path() / "frontier_snapshot_tails";
+  const auto now = Frontier::Clock::now();
+  fs::remove_all(tails);
+
+  std::string snapshot;
+  {
+    Frontier f(dir, 4);
+    for (int i = 0; i < 12; ++i)
+      f.Push(URL("https://a.example/" + std::to_string(i)), 0, 1);
+    f.Push(URL("https://b.example/x"), 5);
+    f.Push(URL("https://b.example/done"), 9);
+    f.Push(URL("https://b.example/flaky"), 8);
+    f.Push(URL("https://b.example/leased"), 7);
+
+    auto done = f.Pop(now);
+    ASSERT_EQ(done->url, "https://b.example/done");
+    f.Complete(*done);
+    auto flaky = f.Pop(now);
+    ASSERT_EQ(flaky->url, "https://b.example/flaky");
+    flaky->attempt = 2;
+    f.Retry(*flaky, now + 1h);
+    auto leased = f.Pop(now);
+    ASSERT_EQ(leased->url, "https://b.example/leased");
+    f.Defer("b.example", now + 1h);
+
+    f.Save(snapshot, tails);
+  }
+
+  Frontier g(dir, 4);
+  EXPECT_FALSE(
+    g.Load(std::string_view(snapshot).substr(0, snapshot.size() / 2), tails));
+  EXPECT_TRUE(g.Empty());
+  EXPECT_FALSE(g.Load(snapshot)) << "segments without their tail dir";
+  EXPECT_TRUE(g.Empty());
+  ASSERT_TRUE(g.Load(snapshot, tails));
+
+  // the tail is linked back into the spill dir, not read
+  size_t adopted = 0;
+  for (const auto& seg : fs::directory_iterator(dir / "a.example")) {
+    EXPECT_EQ(fs::hard_link_count(seg.path()), 2u) << seg.path();
+    ++adopted;
+  }
+  EXPECT_GT(adopted, 0u);
+
+  // 12 on a.example, x + leased on b.example, flaky delayed
+  EXPECT_EQ(g.Size(), 15u);
+  EXPECT_FALSE(g.Push(URL("https://b.example/done")));
+  EXPECT_FALSE(g.Push(URL("https://a.example/3")));
+  EXPECT_TRUE(g.Push(URL("https://a.example/new")));
+
+  // b.example is still deferred, so a.example drains first, in FIFO order
+  std::vector<std::string> order;
+  while (auto e = g.Pop())
+    order.push_back(e->url);
+  ASSERT_EQ(order.size(), 13u);
+  std::vector<std::string> seeded;
+  for (const auto& url : order) {
+    if (url != "https://a.example/new")
+      seeded.push_back(url);
+  }
+  for (int i = 0; i < 12; ++i)
+    EXPECT_EQ(seeded[i], "https://a.example/" + std::to_string(i));
+
+  // then b.example, with the retry still carrying its attempt count
+  std::vector<std::string> rest;
+  while (auto e = g.Pop(Frontier::Clock::now() + 2h))
+    rest.push_back(e->url + "#" + std::to_string(e->attempt));
+  EXPECT_EQ(rest, (std::vector<std::string>{"https://b.example/flaky#2",
+                                            "https://b.example/leased#0",
+                                            "https://b.example/x#0"}));
+  EXPECT_TRUE(g.Empty());
+  fs::remove_all(dir);
+  fs::remove_all(tails);
+}
+
+TEST(FrontierTest, SaveWhilePoppingKeepsEverySegment) {
+  SCOPED_TRACE("Segments paged in while Save() links them are not lost.");
+  RecordProperty("description",
+                 "Snapshots taken while another thread pops a spilling "
+                 "frontier dry all load back, and each loaded frontier pops "
+                 "exactly the entries it counts.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "frontier_save_race_test";
+  const auto tails = fs::temp_directory_path() / "frontier_save_race_tails";
+  const auto respill = fs::temp_directory_path() / "frontier_save_race_load";
+
+  Frontier f(dir, 4);
+  for (int i = 0; i < 2000; ++i)
+    f.Push(URL("https://a.example/" + std::to_string(i)), i % 7);
+
+  std::thread popper([&] {
+    while (auto e = f.Pop())
+      f.Complete(*e);
+  });
+  std::vector<std::string> snapshots;
+  for (int i = 0; i < 20; ++i) {
+    fs::remove_all(tails / std::to_string(i));
+    f.Save(snapshots.emplace_back(), tails / std::to_string(i));
+  }
+  popper.join();
+
+  for (size_t i = 0; i < snapshots.size(); ++i) {
+    Frontier g(respill, 4);
+    ASSERT_TRUE(g.Load(snapshots[i], tails / std::to_string(i))) << i;
+    const size_t size = g.Size();
+    size_t popped = 0;
+    while (g.Pop())
+      ++popped;
+    EXPECT_EQ(popped, size) << i;
+  }
+  fs::remove_all(dir);
+  fs::remove_all(tails);
+  fs::remove_all(respill);
+}
+
+TEST(FrontierTest, SpilledEntryKeepsAttemptCount) {
+  SCOPED_TRACE("An entry that spills to the tail keeps its retry count.");
+  RecordProperty("description",
+                 "A retried entry with attempt 3 is saved, loaded into a "
+                 "frontier whose head is already full so it is written to a "
+                 "tail segment, and still has attempt 3 when popped.");
+
+  namespace fs = std::filesystem;
+  using namespace std::chrono_literals;
+  const auto dir = fs::temp_directory_path() / "frontier_attempt_test";
+  const auto now = Frontier::Clock::now();
+
+  std::string snapshot;
+  {
+    Frontier f;
+    f.Push(URL("https://example.com/flaky"));
+    auto flaky = f.Pop(now);
+    ASSERT_TRUE(flaky.has_value());
+    flaky->attempt = 3;
+    f.Retry(*flaky, now);
+    for (int i = 0; i < 6; ++i)
+      f.Push(URL("https://example.com/" + std::to_string(i)), 10);
+    // releases the retry into the head, behind the newer pushes
+    auto first = f.Pop(now);
+    ASSERT_EQ(first->url, "https://example.com/0");
+    f.Complete(*first);
+    f.Save(snapshot);
+  }
+
+  Frontier g(dir, 2);
+  ASSERT_TRUE(g.Load(snapshot));
+  EXPECT_TRUE(fs::exists(dir / "example.com"));
+  std::vector<std::string> order;
+  while (auto e = g.Pop())
+    order.push_back(e->url + "#" + std::to_string(e->attempt));
+  ASSERT_EQ(order.size(), 6u);
+  EXPECT_EQ(order.back(), "https://example.com/flaky#3");
+  fs::remove_all(dir);
+}
+
+TEST(FrontierTest, DrainTakesEveryEntryForOneHost) {
+  SCOPED_TRACE("Drain() empties one host's heap, tail and retries.");
+  RecordProperty("description",
+                 "A deferred host with spilled and delayed entries is "
+                 "drained in one call; other hosts keep theirs and the "
+                 "drained URLs stay seen.");
+
+  namespace fs = std::filesystem;
+  using namespace std::chrono_literals;
+  const auto dir = fs::temp_directory_path() / "frontier_drain_test";
+  const auto now = Frontier::Clock::now();
+
+  Frontier f(dir, 2);
+  f.Push(URL("https://dead.example/retry"));
+  auto e = f.Pop(now);
+  ASSERT_TRUE(e.has_value());
+  f.Retry(*e, now + 1h);
+  for (int i = 0; i < 6; ++i)
+    f.Push(URL("https://dead.example/" + std::to_string(i)));
+  f.Push(URL("https://ok.example/"));
+  f.Defer("dead.example", now + 1h);
+  ASSERT_EQ(f.Size(), 8u);
+
+  std::set<std::string> drained;
+  for (const auto& d : f.Drain("dead.example"))
+    drained.insert(d.url);
+  EXPECT_EQ(drained.size(), 7u);
+  EXPECT_TRUE(drained.count("https://dead.example/retry"));
+  EXPECT_TRUE(drained.count("https://dead.example/5"));
+  EXPECT_EQ(f.Size(), 1u);
+  EXPECT_FALSE(f.Push(URL("https://dead.example/3")));
+
+  // no deferral survives: a new URL for the host is ready at once
+  EXPECT_TRUE(f.Push(URL("https://dead.example/new")));
+  std::set<std::string> rest;
+  while (auto r = f.Pop(now))
+    rest.insert(r->url);
+  EXPECT_EQ(rest, (std::set<std::string>{"https://dead.example/new",
+                                         "https://ok.example/"}));
+  EXPECT_TRUE(f.Empty());
+  fs::remove_all(dir);
+}
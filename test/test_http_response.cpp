@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "HttpResponse.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+// Counts what reaches the upstream of an arena
+class CountingResource : public std::pmr::memory_resource {
+ public:
+  size_t allocations{0};
+  size_t bytes{0};
+
+ private:
+  void* do_allocate(size_t n, size_t align) override {
+    ++allocations;
+    bytes += n;
+    return std::pmr::new_delete_resource()->allocate(n, align);
+  }
+  void do_deallocate(void* p, size_t n, size_t align) override {
+    std::pmr::new_delete_resource()->deallocate(p, n, align);
+  }
+  bool do_is_equal(const memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+}  // namespace
+
+TEST(HttpResponseTest, AllocatesFromTheGivenArena) {
+  SCOPED_TRACE("A page's response lives in the page's arena.");
+  RecordProperty("description",
+                 "Headers, raw blocks and the body are allocated from the "
+                 "arena passed in; a Content-Length sizes the body once, so "
+                 "a body arriving in 16 KiB pieces takes a few arena blocks, "
+                 "not one per piece.");
+
+  CountingResource upstream;
+  std::pmr::monotonic_buffer_resource arena(4096, &upstream);
+  HttpResponse r(&arena);
+  const std::string body(200 * 1024, 'x');
+  const std::string length =
+    "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  for (const std::string line :
+       {"HTTP/1.1 200 OK\r\n", "Content-Type: text/html\r\n",
+        length.c_str(), "\r\n"}) {
+    r.AddHeaderLine(line);
+    r.AddRawHeaderLine(line.data(), line.size());
+  }
+  for (size_t at = 0; at < body.size(); at += 16 * 1024)
+    r.AppendBody(body.data() + at,
+                 std::min<size_t>(16 * 1024, body.size() - at));
+  r.SetStatusCode(200);
+
+  EXPECT_EQ(r.GetBody(), body);
+  EXPECT_GE(upstream.bytes, body.size());
+  EXPECT_LT(upstream.bytes, 2 * body.size()) << "body regrown in the arena";
+  EXPECT_LE(upstream.allocations, 4u);
+}
+
+TEST(HttpResponseTest, HeadersAndMetadata) {
+  SCOPED_TRACE("Header lookups and typed metadata.");
+  RecordProperty("description",
+                 "Lookups ignore case and return every match in order; a "
+                 "new status line restarts the raw header block; status, "
+                 "redirects and effective URL are typed fields, not "
+                 "headers.");
+
+  HttpResponse r;
+  for (const std::string line :
+       {"HTTP/1.1 301 Moved\r\n", "Location: /b\r\n", "\r\n",
+        "HTTP/1.1 200 OK\r\n", "set-cookie: a=1\r\n", "Set-Cookie: b=2\r\n",
+        "Content-Type:  text/html \r\n", "\r\n"}) {
+    r.AddHeaderLine(line);
+    r.AddRawHeaderLine(line.data(), line.size());
+  }
+  r.SetStatusCode(200);
+  r.SetRedirectCount(1);
+  EXPECT_FALSE(r.HasEffectiveUrl());
+  r.SetEffectiveUrl("https://example.com/b");
+
+  EXPECT_EQ(r.GetHeader("CONTENT-TYPE"), "text/html");
+  EXPECT_EQ(r.GetHeader(HttpResponse::Header::ContentType), "text/html");
+  EXPECT_EQ(r.GetHeaders("Set-Cookie"),
+            (std::vector<std::string_view>{"a=1", "b=2"}));
+  EXPECT_FALSE(r.GetHeader("Retry-After").has_value());
+  EXPECT_EQ(r.GetRawHeaders().substr(0, 15), "HTTP/1.1 200 OK");
+
+  EXPECT_FALSE(r.GetHeader("X-HTTP-Status").has_value());
+  EXPECT_EQ(r.GetHeaders().size(), 4u);
+  EXPECT_EQ(r.GetHeaders().front().first, "Location");
+  EXPECT_EQ(r.GetStatusCode(), 200);
+  EXPECT_EQ(r.GetRedirectCount(), 1);
+  EXPECT_TRUE(r.IsOkay());
+  EXPECT_EQ(r.GetEffectiveUrl().ToString(), "https://example.com/b");
+}
+
+TEST(HttpResponseTest, InternsKnownNamesAndHashesTheRest) {
+  SCOPED_TRACE("Well-known names are enums; others are found by hash.");
+  RecordProperty("description",
+                 "Known names intern in any case and round-trip through "
+                 "Name(); many custom headers, repeated in mixed case, are "
+                 "all found with their values in arrival order.");
+
+  using H = HttpResponse::Header;
+  EXPECT_EQ(HttpResponse::Intern("etag"), H::ETag);
+  EXPECT_EQ(HttpResponse::Intern("X-ROBOTS-TAG"), H::XRobotsTag);
+  EXPECT_EQ(HttpResponse::Intern("X-Request-Id"), H::Other);
+  for (size_t i = 0; i < HttpResponse::kKnownHeaders; ++i) {
+    const auto h = static_cast<H>(i);
+    EXPECT_EQ(HttpResponse::Intern(HttpResponse::Name(h)), h);
+  }
+
+  HttpResponse r;
+  r.AddHeaderLine("ETag: \"v1\"\r\n");
+  r.AddHeaderLine("Last-Modified: Sun, 11 Oct 2026 08:00:00 GMT\r\n");
+  for (int i = 0; i < 100; ++i) {
+    r.AddHeaderLine("X-Custom-" + std::to_string(i) + ": " +
+                    std::to_string(i) + "\r\n");
+  }
+  for (int i = 0; i < 100; ++i)
+    r.AddHeaderLine("x-custom-" + std::to_string(i) + ": again\r\n");
+
+  EXPECT_EQ(r.GetHeader(H::ETag), "\"v1\"");
+  EXPECT_TRUE(r.GetHeader(H::LastModified).has_value());
+  EXPECT_FALSE(r.GetHeader(H::CacheControl).has_value());
+  EXPECT_FALSE(r.GetHeader(H::Other).has_value());
+  for (int i = 0; i < 100; ++i) {
+    const std::string name = "X-CUSTOM-" + std::to_string(i);
+    EXPECT_EQ(r.GetHeaders(name),
+              (std::vector<std::string_view>{std::to_string(i), "again"}))
+      << name;
+  }
+  EXPECT_FALSE(r.GetHeader("X-Custom-100").has_value());
+  EXPECT_EQ(r.GetHeaders().size(), 202u);
+}
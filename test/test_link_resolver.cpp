@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include "Canonicalizer.hpp"
+#include "LinkResolver.hpp"
+#include "URL.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+TEST(LinkResolverTest, ResolvesPerRfc3986) {
+  SCOPED_TRACE("References resolve against the base as RFC 3986 5.4 says.");
+  RecordProperty("description",
+                 "The normal and abnormal examples of RFC 3986 section 5.4 "
+                 "that name an http URL resolve as specified, and results "
+                 "line up with the references.");
+
+  LinkResolver resolver;
+  resolver.Reset("http://a/b/c/d;p?q");
+  const std::vector<std::pair<std::string_view, std::string_view>> cases = {
+    {"g", "http://a/b/c/g"},
+    {"./g", "http://a/b/c/g"},
+    {"g/", "http://a/b/c/g/"},
+    {"/g", "http://a/g"},
+    {"//g", "http://g"},
+    {"?y", "http://a/b/c/d;p?y"},
+    {"g?y", "http://a/b/c/g?y"},
+    {"#s", "http://a/b/c/d;p?q#s"},
+    {"g?y#s", "http://a/b/c/g?y#s"},
+    {";x", "http://a/b/c/;x"},
+    {"", "http://a/b/c/d;p?q"},
+    {".", "http://a/b/c/"},
+    {"./", "http://a/b/c/"},
+    {"..", "http://a/b/"},
+    {"../g", "http://a/b/g"},
+    {"../..", "http://a/"},
+    {"../../g", "http://a/g"},
+    {"../../../g", "http://a/g"},
+    {"/./g", "http://a/g"},
+    {"/../g", "http://a/g"},
+    {"g.", "http://a/b/c/g."},
+    {"..g", "http://a/b/c/..g"},
+    {"./../g", "http://a/b/g"},
+    {"g/./h", "http://a/b/c/g/h"},
+    {"g/../h", "http://a/b/c/h"},
+    {"g;x=1/../y", "http://a/b/c/y"},
+    {"g?y/../x", "http://a/b/c/g?y/../x"},
+    {"g#s/../x", "http://a/b/c/g#s/../x"},
+    {"a//b/../c", "http://a/b/c/a//c"},
+    {"  g \n", "http://a/b/c/g"},
+    {"HTTPS://Other.org/x/../y", "HTTPS://Other.org/y"},
+  };
+  std::vector<std::string_view> refs;
+  for (const auto& [ref, want] : cases)
+    refs.push_back(ref);
+
+  const auto& links = resolver.Resolve(refs);
+  ASSERT_EQ(links.size(), cases.size());
+  for (size_t i = 0; i < cases.size(); ++i) {
+    EXPECT_EQ(links[i].url, cases[i].second) << "ref: " << cases[i].first;
+    EXPECT_EQ(links[i].raw, links[i].url);
+  }
+}
+
+TEST(LinkResolverTest, SkipsOtherSchemesAndCanonicalizes) {
+  SCOPED_TRACE("Only http(s) targets come out, in canonical form.");
+  RecordProperty("description",
+                 "mailto:, javascript:, data: and host-less references give "
+                 "empty results in place; with a Canonicalizer each link "
+                 "carries its canonical and resolved spellings.");
+
+  const Canonicalizer canon;
+  LinkResolver resolver(&canon);
+  resolver.Reset("https://Example.com/dir/page.html?x=1");
+  const std::vector<std::string_view> refs = {
+    "mailto:a@example.com", "javascript:void(0)", "data:text/plain,hi",
+    "http:relative",        "//",                 "next.html?utm_source=x#top",
+    "/same",                "tel:123"};
+
+  const auto& links = resolver.Resolve(refs);
+  ASSERT_EQ(links.size(), refs.size());
+  for (size_t i : {0, 1, 2, 3, 4, 7}) {
+    EXPECT_TRUE(links[i].url.empty()) << refs[i];
+    EXPECT_TRUE(links[i].raw.empty()) << refs[i];
+  }
+  EXPECT_EQ(links[5].url, "https://example.com/dir/next.html");
+  EXPECT_EQ(links[5].raw, "https://Example.com/dir/next.html?utm_source=x#top");
+  EXPECT_EQ(links[6].url, "https://example.com/same");
+
+  // the arena is reused: a second, smaller page does not grow it
+  const size_t capacity = resolver.ArenaCapacity();
+  resolver.Reset("https://example.com/");
+  const std::vector<std::string_view> more = {"a", "b"};
+  const auto& again = resolver.Resolve(more);
+  EXPECT_EQ(again[1].url, "https://example.com/b");
+  EXPECT_EQ(resolver.ArenaCapacity(), capacity);
+}
+
+TEST(LinkResolverTest, AgreesWithUrlResolve) {
+  SCOPED_TRACE("Batch and per-link resolution agree after canonicalization.");
+  RecordProperty("description",
+                 "For common link shapes the batch resolver matches "
+                 "URL::Resolve followed by Canonicalizer::Canonicalize.");
+
+  const Canonicalizer canon;
+  const std::string base = "https://www.example.com/section/page/index.html";
+  const std::vector<std::string_view> refs = {
+    "../other/p1.html", "/a/b/c?id=2&utm_source=x", "sub/item?b=2&a=1",
+    "https://www.example.com/q?id=4#frag", "//cdn.example.com/x/./y.js",
+    "?page=2", "#top", "https://other.org"};
+
+  LinkResolver resolver(&canon);
+  resolver.Reset(base);
+  const auto& links = resolver.Resolve(refs);
+  const URL base_url(base);
+  for (size_t i = 0; i < refs.size(); ++i) {
+    const URL want = canon.Canonicalize(base_url.Resolve(std::string(refs[i])));
+    EXPECT_EQ(links[i].url, want.ToString()) << refs[i];
+  }
+}
+
+TEST(URLTest, ParsesWithoutRegex) {
+  SCOPED_TRACE("The hand-written splitter keeps the old grammar.");
+  RecordProperty("description",
+                 "Scheme, host, path, query and fragment split as before; a "
+                 "missing host is invalid.");
+
+  const URL url("https://h.example.com:8443/p/q?x=1&y#frag?#");
+  EXPECT_EQ(url.GetScheme(), "https");
+  EXPECT_EQ(url.GetHost(), "h.example.com:8443");
+  EXPECT_EQ(url.GetPath(), "/p/q");
+  EXPECT_EQ(url.GetQuery(), "?x=1&y");
+  EXPECT_TRUE(url.IsValid());
+
+  const URL bare("example.com");
+  EXPECT_EQ(bare.GetScheme(), "");
+  EXPECT_EQ(bare.GetHost(), "example.com");
+
+  // "https://" with nothing after it: "https:" is the host
+  EXPECT_EQ(URL("https:///x").GetHost(), "https:");
+}
@@ -0,0 +1,131 @@
+// Debug statements are compiled out of this binary
+#define LOGR_MIN_LEVEL 1
+
+#include <gtest/gtest.h>
+#include "Logger.hpp"
+
+#include <nlohmann/json.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(LoggerTest, ThreadsKeepTheirOrder) {
+  SCOPED_TRACE("Entries from many threads all arrive, each thread in order.");
+  RecordProperty("description",
+                 "Warnings logged concurrently from several threads are all "
+                 "written by the background writer after Flush(), and each "
+                 "thread's lines appear in the order it logged them.");
+
+  constexpr int kThreads = 4;
+  constexpr int kLines = 3000;  // more than one ring's worth per thread
+
+  testing::internal::CaptureStderr();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < kLines; ++i)
+        logr::warning << "t" << t << " " << i;
+      logr::Flush();
+    });
+  }
+  for (auto& th : threads)
+    th.join();
+  logr::Flush();
+  const std::string out = testing::internal::GetCapturedStderr();
+
+  std::vector<int> next(kThreads, 0);
+  std::istringstream in(out);
+  std::string line;
+  while (std::getline(in, line)) {
+    const auto at = line.find('t');
+    if (at == std::string::npos)
+      continue;
+    int t = -1, i = -1;
+    std::istringstream fields(line.substr(at + 1));
+    fields >> t >> i;
+    ASSERT_GE(t, 0);
+    ASSERT_LT(t, kThreads);
+    EXPECT_EQ(i, next[t]) << line;
+    next[t] = i + 1;
+  }
+  for (int t = 0; t < kThreads; ++t)
+    EXPECT_EQ(next[t], kLines) << "thread " << t;
+}
+
+TEST(LoggerTest, MutedLevelsWriteNothing) {
+  SCOPED_TRACE("A muted entry produces no output.");
+  RecordProperty("description",
+                 "Below LOGR_MIN_LEVEL an entry is dropped whatever the "
+                 "runtime level, and LOGR_* never evaluates its operands.");
+
+  EXPECT_TRUE(logr::ShouldMute(logr::Level::Debug));
+
+  int evaluated = 0;
+  auto expensive = [&] {
+    ++evaluated;
+    return std::string("costly");
+  };
+  testing::internal::CaptureStderr();
+  for (int i = 0; i < 1000; ++i) {
+    logr::debug << "hidden " << i;
+    LOGR_DEBUG << "hidden " << expensive();
+  }
+  logr::Flush();
+  EXPECT_EQ(testing::internal::GetCapturedStderr(), "");
+  EXPECT_EQ(evaluated, 0);
+}
+
+TEST(LoggerTest, FieldsRenderAsTextAndJson) {
+  SCOPED_TRACE("kv() fields follow the message in either format.");
+  RecordProperty("description",
+                 "Text output appends key=value pairs; JSON output is one "
+                 "object per line carrying ts, level, msg and each field.");
+
+  testing::internal::CaptureStderr();
+  logr::SetFormat(logr::Format::Text);
+  LOGR_WARNING << "fetch failed" << logr::kv("url", "https://a.example/")
+               << logr::kv("code", 7);
+  logr::Flush();
+  logr::SetFormat(logr::Format::Json);
+  LOGR_ERROR << "fetch \"failed\"" << logr::kv("url", "https://a.example/")
+             << logr::kv("code", 7) << logr::kv("retry", true);
+  logr::Flush();
+  logr::SetFormat(logr::Format::Text);
+  const std::string out = testing::internal::GetCapturedStderr();
+
+  std::istringstream in(out);
+  std::string text, json;
+  std::getline(in, text);
+  std::getline(in, json);
+  EXPECT_NE(text.find("fetch failed url=https://a.example/ code=7"),
+            std::string::npos)
+    << text;
+
+  const auto j = nlohmann::json::parse(json);
+  EXPECT_EQ(j.at("level"), "error");
+  EXPECT_EQ(j.at("msg"), "fetch \"failed\"");
+  EXPECT_EQ(j.at("url"), "https://a.example/");
+  EXPECT_EQ(j.at("code"), 7);
+  EXPECT_EQ(j.at("retry"), true);
+  EXPECT_TRUE(j.at("ts").is_number_integer());
+}
+
+TEST(LoggerTest, NestedEntryDoesNotClobberOuter) {
+  SCOPED_TRACE("Logging while formatting another entry keeps both intact.");
+  RecordProperty("description",
+                 "An operator<< that logs on its own gets a private buffer, "
+                 "so the outer entry's text is not overwritten.");
+
+  auto inner = [] {
+    logr::warning << "inner";
+    return std::string("value");
+  };
+
+  testing::internal::CaptureStderr();
+  logr::warning << "outer " << inner() << " done";
+  logr::Flush();
+  const std::string out = testing::internal::GetCapturedStderr();
+  EXPECT_NE(out.find("inner"), std::string::npos);
+  EXPECT_NE(out.find("outer value done"), std::string::npos);
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include "Metrics.hpp"
+#include "MetricsExporter.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+TEST(MetricsTest, LabelledSeriesRollUp) {
+  SCOPED_TRACE("Per-domain updates also move the unlabelled total.");
+  RecordProperty("description",
+                 "Counters and gauges registered with labels feed the series "
+                 "of the same name without labels; lookups are stable.");
+
+  metrics::Registry reg;
+  auto& a = reg.GetCounter("fetches_total", {{"domain", "a.example"}});
+  auto& b = reg.GetCounter("fetches_total", {{"domain", "b.example"}});
+  a.Inc();
+  a.Inc(2);
+  b.Inc();
+  EXPECT_EQ(&a, &reg.GetCounter("fetches_total", {{"domain", "a.example"}}));
+  EXPECT_EQ(a.Value(), 3u);
+  EXPECT_EQ(reg.GetCounter("fetches_total").Value(), 4u);
+
+  auto& qa = reg.GetGauge("depth", {{"domain", "a.example"}});
+  auto& qb = reg.GetGauge("depth", {{"domain", "b.example"}});
+  qa.Set(10);
+  qb.Set(5);
+  qa.Set(7);
+  EXPECT_EQ(reg.GetGauge("depth").Value(), 12);
+}
+
+TEST(MetricsTest, HistogramBucketsAreLogLinear) {
+  SCOPED_TRACE("Each value lands in a bucket whose bounds bracket it.");
+  RecordProperty("description",
+                 "Index/UpperBound agree for values across many octaves, with "
+                 "at most 25% relative bucket width; ValueAt finds quantiles.");
+
+  for (std::uint64_t v : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 9ull,
+                          1000ull, 123456ull, 1ull << 30, (1ull << 30) + 7}) {
+    const unsigned i = metrics::Histogram::Index(v);
+    EXPECT_LT(v, metrics::Histogram::UpperBound(i)) << v;
+    if (i > 0) {
+      EXPECT_GE(v, metrics::Histogram::UpperBound(i - 1)) << v;
+      EXPECT_LE(metrics::Histogram::UpperBound(i) -
+                  metrics::Histogram::UpperBound(i - 1),
+                std::max<std::uint64_t>(1, v / 4))
+        << v;
+    }
+  }
+
+  metrics::Histogram h;
+  for (int i = 1; i <= 100; ++i)
+    h.Record(static_cast<std::uint64_t>(i) * 1000);  // 1ms .. 100ms
+  EXPECT_EQ(h.Count(), 100u);
+  const auto p50 = h.ValueAt(0.5), p99 = h.ValueAt(0.99);
+  EXPECT_GE(p50, 50000u);
+  EXPECT_LE(p50, 50000u * 5 / 4);
+  EXPECT_GE(p99, 99000u);
+  EXPECT_LE(p99, 99000u * 5 / 4);
+}
+
+TEST(MetricsTest, PrometheusText) {
+  SCOPED_TRACE("Exposition follows the Prometheus text format.");
+  RecordProperty("description",
+                 "HELP/TYPE lines, escaped labels, cumulative histogram "
+                 "buckets in seconds with +Inf, _sum and _count; the "
+                 "rollup of a labelled family is not exported.");
+
+  metrics::Registry reg;
+  reg.GetCounter("pages_total", {{"domain", "a\"b"}}, "Pages seen").Inc(5);
+  auto& h = reg.GetHistogram("fetch_seconds", {{"domain", "a"}});
+  h.Record(3us);
+  h.Record(2ms);
+
+  const std::string text = reg.Prometheus();
+  EXPECT_NE(text.find("# HELP pages_total Pages seen\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE pages_total counter\n"), std::string::npos);
+  EXPECT_NE(text.find("pages_total{domain=\"a\\\"b\"} 5\n"), std::string::npos);
+  // the rollup stays in process; exported, sum() would count pages twice
+  EXPECT_EQ(text.find("pages_total 5\n"), std::string::npos);
+  EXPECT_EQ(reg.GetCounter("pages_total").Value(), 5u);
+  EXPECT_NE(text.find("# TYPE fetch_seconds histogram\n"), std::string::npos);
+  EXPECT_NE(text.find("fetch_seconds_bucket{domain=\"a\",le=\"3e-06\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("fetch_seconds_bucket{domain=\"a\",le=\"+Inf\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("fetch_seconds_count{domain=\"a\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("fetch_seconds_sum{domain=\"a\"} 0.002003\n"),
+            std::string::npos);
+  EXPECT_EQ(text.find("fetch_seconds_sum 0.002003\n"), std::string::npos);
+  EXPECT_EQ(text.find("fetch_seconds_bucket{le="), std::string::npos);
+
+  // a family with no labelled series is exported as is
+  reg.GetCounter("up_total").Inc();
+  EXPECT_NE(reg.Prometheus().find("\nup_total 1\n"), std::string::npos);
+}
+
+TEST(MetricsTest, BucketEdgesAreInclusive) {
+  SCOPED_TRACE("A value equal to a bucket's le is counted in that bucket.");
+  RecordProperty("description",
+                 "Recording 3us, 7us and 8us gives le=3e-06 a count of 1 and "
+                 "le=7e-06 a count of 2, as Prometheus reads le as <=.");
+
+  metrics::Registry reg;
+  auto& h = reg.GetHistogram("edge_seconds");
+  h.Record(3us);
+  h.Record(7us);
+  h.Record(8us);
+
+  const std::string text = reg.Prometheus();
+  EXPECT_NE(text.find("edge_seconds_bucket{le=\"3e-06\"} 1\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("edge_seconds_bucket{le=\"7e-06\"} 2\n"),
+            std::string::npos);
+  EXPECT_NE(text.find("edge_seconds_bucket{le=\"1.5e-05\"} 3\n"),
+            std::string::npos);
+}
+
+TEST(MetricsTest, ConcurrentUpdatesAreNotLost) {
+  SCOPED_TRACE("Updates from many threads all land.");
+  RecordProperty("description",
+                 "8 threads each add 10000 to a labelled counter and "
+                 "histogram; both series and their totals add up.");
+
+  metrics::Registry reg;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&reg, t] {
+      auto& c = reg.GetCounter("n", {{"t", std::to_string(t % 2)}});
+      auto& h = reg.GetHistogram("h", {{"t", std::to_string(t % 2)}});
+      for (int i = 0; i < 10000; ++i) {
+        c.Inc();
+        h.Record(static_cast<std::uint64_t>(i));
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+  EXPECT_EQ(reg.GetCounter("n").Value(), 80000u);
+  EXPECT_EQ(reg.GetCounter("n", {{"t", "0"}}).Value(), 40000u);
+  EXPECT_EQ(reg.GetHistogram("h").Count(), 80000u);
+}
+
+TEST(MetricsTest, ExporterWritesFileAndServesHttp) {
+  SCOPED_TRACE("The exporter publishes the registry as a file and over HTTP.");
+  RecordProperty("description",
+                 "The file is written on start and on shutdown; GET /metrics "
+                 "on the loopback listener returns the same text.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "metrics_test";
+  fs::remove_all(dir);
+
+  metrics::Registry reg;
+  reg.GetCounter("up_total").Inc();
+  {
+    MetricsExporter exporter({dir / "crawler.prom", 1h, 0}, reg);
+    ASSERT_NE(exporter.Port(), 0);
+
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sa.sin_port = htons(exporter.Port());
+    ASSERT_EQ(::connect(fd, reinterpret_cast<sockaddr*>(&sa), sizeof(sa)), 0);
+    const std::string req = "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n";
+    ::send(fd, req.data(), req.size(), 0);
+    std::string resp;
+    char buf[4096];
+    for (ssize_t n; (n = ::recv(fd, buf, sizeof(buf), 0)) > 0;)
+      resp.append(buf, n);
+    ::close(fd);
+    EXPECT_EQ(resp.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+    EXPECT_NE(resp.find("\r\n\r\n# TYPE up_total counter\nup_total 1\n"),
+              std::string::npos);
+
+    reg.GetCounter("up_total").Inc();
+  }
+  std::ifstream in(dir / "crawler.prom");
+  const std::string text((std::istreambuf_iterator<char>(in)), {});
+  EXPECT_NE(text.find("up_total 2\n"), std::string::npos);
+  fs::remove_all(dir);
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include "MPMCQueue.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(MPMCQueueTest, FifoAndCapacity) {
+  SCOPED_TRACE("Single-threaded FIFO order, power-of-two capacity, full ring.");
+  RecordProperty("description",
+                 "Capacity rounds up to a power of two; try_push fails when "
+                 "full and items come out in insertion order.");
+
+  MPMCQueue<int> q(5);
+  EXPECT_EQ(q.capacity(), 8u);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(q.try_push(int{i}));
+  }
+  EXPECT_FALSE(q.try_push(99));
+  EXPECT_EQ(q.size_approx(), 8u);
+
+  for (int i = 0; i < 8; ++i) {
+    auto v = q.try_pop();
+    ASSERT_TRUE(v.has_value());
+    EXPECT_EQ(*v, i);
+  }
+  EXPECT_FALSE(q.try_pop().has_value());
+}
+
+TEST(MPMCQueueTest, MoveOnlyItems) {
+  SCOPED_TRACE("Move-only payloads pass through without copies.");
+  RecordProperty("description",
+                 "std::unique_ptr values are moved in and out; a failed "
+                 "try_push leaves the caller's value intact.");
+
+  MPMCQueue<std::unique_ptr<int>> q(2);
+  auto a = std::make_unique<int>(1);
+  auto b = std::make_unique<int>(2);
+  auto c = std::make_unique<int>(3);
+  EXPECT_TRUE(q.push(std::move(a)));
+  EXPECT_TRUE(q.push(std::move(b)));
+  EXPECT_FALSE(q.try_push(std::move(c)));
+  ASSERT_NE(c, nullptr) << "rejected item must not be moved from";
+
+  auto out = q.pop();
+  ASSERT_TRUE(out.has_value());
+  EXPECT_EQ(**out, 1);
+}
+
+TEST(MPMCQueueTest, BulkOperations) {
+  SCOPED_TRACE("push_bulk and try_pop_bulk move ranges in and out.");
+  RecordProperty("description",
+                 "Bulk calls report how many items moved and keep order.");
+
+  MPMCQueue<int> q(16);
+  std::vector<int> in{1, 2, 3, 4, 5};
+  EXPECT_EQ(q.push_bulk(in.begin(), in.end()), 5u);
+
+  std::vector<int> out;
+  EXPECT_EQ(q.try_pop_bulk(std::back_inserter(out), 3), 3u);
+  EXPECT_EQ(q.pop_bulk(std::back_inserter(out), 10), 2u);
+  EXPECT_EQ(out, in);
+}
+
+TEST(MPMCQueueTest, CloseWakesBlockedConsumers) {
+  SCOPED_TRACE("close() releases consumers blocked in pop().");
+  RecordProperty("description",
+                 "A consumer waiting on an empty queue returns nullopt after "
+                 "close(); pushes after close are rejected.");
+
+  MPMCQueue<int> q(4);
+  std::atomic<bool> done{false};
+  std::thread consumer([&] {
+    EXPECT_FALSE(q.pop().has_value());
+    done = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(done.load());
+  q.close();
+  consumer.join();
+  EXPECT_TRUE(done.load());
+  EXPECT_FALSE(q.push(1));
+}
+
+TEST(MPMCQueueTest, ManyProducersManyConsumers) {
+  SCOPED_TRACE("Every item pushed by 4 producers is popped exactly once.");
+  RecordProperty("description",
+                 "Concurrent producers and consumers through a small ring; "
+                 "the sum of popped values matches the sum pushed.");
+
+  constexpr int kProducers = 4, kConsumers = 4, kPerProducer = 20000;
+  MPMCQueue<int> q(64);
+  std::atomic<long long> sum{0};
+  std::atomic<int> count{0};
+
+  std::vector<std::thread> consumers;
+  for (int c = 0; c < kConsumers; ++c) {
+    consumers.emplace_back([&] {
+      while (auto v = q.pop()) {
+        sum += *v;
+        ++count;
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&] {
+      for (int i = 1; i <= kPerProducer; ++i) {
+        q.push(int{i});
+      }
+    });
+  }
+  for (auto& t : producers)
+    t.join();
+  q.close();
+  for (auto& t : consumers)
+    t.join();
+
+  EXPECT_EQ(count.load(), kProducers * kPerProducer);
+  EXPECT_EQ(sum.load(),
+            kProducers * (long long)kPerProducer * (kPerProducer + 1) / 2);
+}
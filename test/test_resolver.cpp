@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+#include "Resolver.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// --- Test helper: a UDP DNS server on 127.0.0.1 that answers A queries from
+// a fixed table, NXDOMAIN for unknown names and NODATA for anything else ---
+class StubDns {
+ public:
+  struct Record {
+    std::string ipv4;
+    std::uint32_t ttl;
+  };
+
+  explicit StubDns(std::map<std::string, Record> records)
+      : records_{std::move(records)} {
+    fd_ = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in sa{};
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd_, reinterpret_cast<sockaddr*>(&sa), sizeof(sa));
+    socklen_t len = sizeof(sa);
+    ::getsockname(fd_, reinterpret_cast<sockaddr*>(&sa), &len);
+    port_ = ntohs(sa.sin_port);
+    thread_ = std::thread([this] { Serve(); });
+  }
+
+  ~StubDns() {
+    stop_ = true;
+    thread_.join();
+    ::close(fd_);
+  }
+
+  std::uint16_t Port() const {
+    return port_;
+  }
+
+  // A/AAAA queries seen for `name`
+  int Queries(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return queries_[name];
+  }
+
+ private:
+  void Serve() {
+    while (!stop_) {
+      pollfd p{fd_, POLLIN, 0};
+      if (::poll(&p, 1, 20) <= 0)
+        continue;
+      unsigned char buf[512];
+      sockaddr_in from{};
+      socklen_t flen = sizeof(from);
+      const ssize_t n = ::recvfrom(fd_, buf, sizeof(buf), 0,
+                                   reinterpret_cast<sockaddr*>(&from), &flen);
+      if (n < 12)
+        continue;
+
+      // question: labels, qtype, qclass
+      std::string name;
+      size_t pos = 12;
+      while (pos < size_t(n) && buf[pos]) {
+        if (!name.empty())
+          name += '.';
+        name.append(reinterpret_cast<char*>(buf + pos + 1), buf[pos]);
+        pos += buf[pos] + 1;
+      }
+      pos += 1;
+      const int qtype = (buf[pos] << 8) | buf[pos + 1];
+      pos += 4;
+      {
+        std::lock_guard<std::mutex> lock(mtx_);
+        ++queries_[name];
+      }
+
+      std::vector<unsigned char> out(buf, buf + pos);
+      out[2] = 0x80 | (buf[2] & 0x01);  // QR, keep RD
+      out[3] = 0x80;                    // RA, NOERROR
+      out[6] = out[7] = 0;              // ANCOUNT
+      out[8] = out[9] = out[10] = out[11] = 0;
+
+      auto it = records_.find(name);
+      if (it == records_.end()) {
+        out[3] |= 3;  // NXDOMAIN
+      } else if (qtype == 1) {
+        out[7] = 1;
+        const unsigned char rr[] = {0xc0, 0x0c, 0, 1, 0, 1};
+        out.insert(out.end(), rr, rr + sizeof(rr));
+        const std::uint32_t ttl = it->second.ttl;
+        out.push_back(ttl >> 24);
+        out.push_back(ttl >> 16);
+        out.push_back(ttl >> 8);
+        out.push_back(ttl);
+        out.push_back(0);
+        out.push_back(4);
+        in_addr a{};
+        ::inet_pton(AF_INET, it->second.ipv4.c_str(), &a);
+        const auto* b = reinterpret_cast<unsigned char*>(&a);
+        out.insert(out.end(), b, b + 4);
+      }
+      ::sendto(fd_, out.data(), out.size(), 0,
+               reinterpret_cast<sockaddr*>(&from), flen);
+    }
+  }
+
+  std::map<std::string, Record> records_;
+  int fd_{-1};
+  std::uint16_t port_{0};
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+  std::mutex mtx_;
+  std::map<std::string, int> queries_;
+};
+
+static Resolver::Options StubOptions(const StubDns& dns) {
+  Resolver::Options opts;
+  opts.threads = 2;
+  opts.min_ttl = std::chrono::seconds(0);
+  opts.timeout = std::chrono::seconds(1);
+  opts.nameservers = {{"127.0.0.1", dns.Port()}};
+  return opts;
+}
+
+TEST(ResolverTest, ResolvesAndCaches) {
+  SCOPED_TRACE("A second lookup of a fresh name is served from the cache.");
+  RecordProperty("description",
+                 "The stub answers one A record; repeated Resolve calls hit "
+                 "the nameserver only once per record type.");
+
+  StubDns dns({{"www.example.test", {"10.1.2.3", 300}}});
+  Resolver resolver(StubOptions(dns));
+
+  auto r = resolver.Resolve("www.example.test");
+  ASSERT_TRUE(r.Ok());
+  ASSERT_EQ(r.addresses.size(), 1u);
+  EXPECT_EQ(r.addresses[0], "10.1.2.3");
+  const int first = dns.Queries("www.example.test");
+  EXPECT_GE(first, 1);
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(resolver.Resolve("www.example.test").Ok());
+  }
+  EXPECT_EQ(dns.Queries("www.example.test"), first);
+  EXPECT_TRUE(resolver.Cached("www.example.test").has_value());
+}
+
+TEST(ResolverTest, NegativeAnswersAreCached) {
+  SCOPED_TRACE("NXDOMAIN is remembered for negative_ttl.");
+  RecordProperty("description",
+                 "A missing name fails once and is not queried again while "
+                 "the negative entry is fresh.");
+
+  StubDns dns({});
+  Resolver resolver(StubOptions(dns));
+
+  EXPECT_FALSE(resolver.Resolve("missing.example.test").Ok());
+  const int first = dns.Queries("missing.example.test");
+  EXPECT_GE(first, 1);
+  EXPECT_FALSE(resolver.Resolve("missing.example.test").Ok());
+  EXPECT_EQ(dns.Queries("missing.example.test"), first);
+}
+
+TEST(ResolverTest, ExpiredEntriesAreRefetched) {
+  SCOPED_TRACE("Answers are dropped once their TTL has passed.");
+  RecordProperty("description",
+                 "With a 1 s record TTL, a lookup after 1.1 s queries the "
+                 "nameserver again.");
+
+  StubDns dns({{"short.example.test", {"10.0.0.9", 1}}});
+  Resolver resolver(StubOptions(dns));
+
+  EXPECT_TRUE(resolver.Resolve("short.example.test").Ok());
+  const int first = dns.Queries("short.example.test");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  EXPECT_FALSE(resolver.Cached("short.example.test").has_value());
+  EXPECT_TRUE(resolver.Resolve("short.example.test").Ok());
+  EXPECT_GT(dns.Queries("short.example.test"), first);
+}
+
+TEST(ResolverTest, CurlResolveEntry) {
+  SCOPED_TRACE("CURLOPT_RESOLVE strings carry the scheme's default port.");
+  RecordProperty("description",
+                 "https defaults to 443, explicit ports are kept, IP literals "
+                 "and unresolvable names yield an empty string.");
+
+  StubDns dns({{"www.example.test", {"10.1.2.3", 300}}});
+  Resolver resolver(StubOptions(dns));
+
+  EXPECT_EQ(resolver.CurlResolveEntry("https://www.example.test/a?b"),
+            "www.example.test:443:10.1.2.3");
+  EXPECT_EQ(resolver.CurlResolveEntry("http://www.example.test:8080/"),
+            "www.example.test:8080:10.1.2.3");
+  EXPECT_EQ(resolver.CurlResolveEntry("https://192.0.2.1/"), "");
+  EXPECT_EQ(resolver.CurlResolveEntry("https://nope.example.test/"), "");
+}
+
+TEST(ResolverTest, ConcurrentLookupsShareOneQuery) {
+  SCOPED_TRACE("Callers racing on one name wait on the same future.");
+  RecordProperty("description",
+                 "Many threads resolving one uncached name produce a single "
+                 "A query.");
+
+  StubDns dns({{"busy.example.test", {"10.9.9.9", 300}}});
+  Resolver resolver(StubOptions(dns));
+
+  std::vector<std::shared_future<Resolver::Result>> futures;
+  for (int i = 0; i < 16; ++i) {
+    futures.push_back(resolver.ResolveAsync("busy.example.test"));
+  }
+  for (auto& f : futures) {
+    EXPECT_TRUE(f.get().Ok());
+  }
+  // one A and one AAAA
+  EXPECT_EQ(dns.Queries("busy.example.test"), 2);
+}
+
+TEST(ResolverTest, FullCacheEvictsSoonestExpiring) {
+  SCOPED_TRACE("A full cache of live answers sheds the shortest TTLs.");
+  RecordProperty("description",
+                 "With max_entries 4 and one short-lived answer among three "
+                 "long ones, a fifth name evicts only the short one.");
+
+  StubDns dns({{"a.example.test", {"10.0.0.1", 3000}},
+               {"b.example.test", {"10.0.0.2", 3000}},
+               {"c.example.test", {"10.0.0.3", 3000}},
+               {"short.example.test", {"10.0.0.4", 100}},
+               {"e.example.test", {"10.0.0.5", 3000}}});
+  auto opts = StubOptions(dns);
+  opts.max_entries = 4;
+  Resolver resolver(opts);
+
+  for (const char* name : {"a.example.test", "short.example.test",
+                           "b.example.test", "c.example.test"}) {
+    EXPECT_TRUE(resolver.Resolve(name).Ok()) << name;
+  }
+  EXPECT_TRUE(resolver.Resolve("e.example.test").Ok());
+
+  EXPECT_FALSE(resolver.Cached("short.example.test").has_value());
+  for (const char* name : {"a.example.test", "b.example.test",
+                           "c.example.test", "e.example.test"}) {
+    EXPECT_TRUE(resolver.Cached(name).has_value()) << name;
+  }
+}
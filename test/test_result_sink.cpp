@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include "ResultSink.hpp"
+#include "ResultWriter.hpp"
+#include "URL.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+fs::path FreshDir(const std::string& name) {
+  auto dir = fs::temp_directory_path() /
+             (name + "_" + std::to_string(::getpid()));
+  fs::remove_all(dir);
+  return dir;
+}
+
+std::vector<fs::path> Files(const fs::path& dir, const std::string& ext) {
+  std::vector<fs::path> out;
+  for (const auto& f : fs::directory_iterator(dir)) {
+    if (f.path().extension() == ext)
+      out.push_back(f.path());
+  }
+  return out;
+}
+}  // namespace
+
+TEST(ResultWriterTest, RotatesBySizeWithoutSplittingRecords) {
+  SCOPED_TRACE("Each file stays under max_bytes and holds whole records.");
+  RecordProperty("description",
+                 "Writing 10 records of 40 bytes with a 100-byte limit gives "
+                 "files of two records each; open files carry .part until "
+                 "they are closed, and Write() reports each record's offset.");
+
+  const auto dir = FreshDir("result_writer_test");
+  const std::string record(39, 'x');
+  {
+    ResultWriter w({dir, "r", ".txt", 100, std::chrono::hours(1)});
+    for (int i = 0; i < 10; ++i) {
+      auto at = w.Write(record + "\n");
+      ASSERT_TRUE(at.has_value());
+      EXPECT_EQ(at->offset, i % 2 ? 40u : 0u);
+    }
+    EXPECT_EQ(Files(dir, ".txt").size(), 4u);
+    EXPECT_EQ(Files(dir, ".part").size(), 1u);
+  }
+  const auto files = Files(dir, ".txt");
+  EXPECT_EQ(files.size(), 5u);
+  EXPECT_TRUE(Files(dir, ".part").empty());
+  for (const auto& f : files)
+    EXPECT_EQ(fs::file_size(f), 80u) << f;
+  fs::remove_all(dir);
+}
+
+TEST(ResultSinkTest, JsonlCollectsConcurrentWritesIntoFewFiles) {
+  SCOPED_TRACE("Results from many threads end up as JSONL lines.");
+  RecordProperty("description",
+                 "Four threads write 500 results each through the JSONL "
+                 "sink; Flush() makes them readable and, after the sink is "
+                 "destroyed, every result appears once in closed files.");
+
+  const auto dir = FreshDir("result_sink_test");
+  ResultSink::Options opts;
+  opts.format = ResultSink::Format::Jsonl;
+  opts.file.dir = dir;
+  opts.file.max_bytes = 64 * 1024;
+  opts.batch = 64;
+  opts.max_pending = 256;  // exercise backpressure
+  CacheManager cache(dir / "cache", std::chrono::seconds(60));
+
+  constexpr int kThreads = 4, kPerThread = 500;
+  {
+    auto sink = ResultSink::Create(opts, cache);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kPerThread; ++i) {
+          URL url("https://example.com/" + std::to_string(t) + "/" +
+                  std::to_string(i));
+          sink->Write(url, {{"title", "page"}, {"n", t * kPerThread + i}});
+        }
+      });
+    }
+    for (auto& th : threads)
+      th.join();
+    sink->Flush();
+
+    size_t bytes = 0;
+    for (const auto& f : fs::directory_iterator(dir)) {
+      if (f.is_regular_file())
+        bytes += f.file_size();
+    }
+    EXPECT_GT(bytes, 0u);
+  }
+
+  EXPECT_TRUE(Files(dir, ".part").empty());
+  const auto files = Files(dir, ".jsonl");
+  EXPECT_GT(files.size(), 1u);
+  EXPECT_LT(files.size(), 20u);
+
+  std::set<int> seen;
+  for (const auto& f : files) {
+    std::ifstream in(f);
+    for (std::string line; std::getline(in, line);) {
+      auto j = nlohmann::json::parse(line);
+      EXPECT_EQ(j.at("url").get<std::string>().rfind("https://example.com/",
+                                                     0),
+                0u);
+      EXPECT_TRUE(j.at("time").is_number_integer());
+      EXPECT_TRUE(seen.insert(j.at("result").at("n").get<int>()).second);
+    }
+  }
+  EXPECT_EQ(seen.size(), static_cast<size_t>(kThreads * kPerThread));
+  EXPECT_FALSE(fs::exists(dir / "cache"));
+  fs::remove_all(dir);
+}
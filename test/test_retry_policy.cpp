@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include "DeadLetter.hpp"
+#include "RetryPolicy.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+using namespace std::chrono_literals;
+using Outcome = RetryPolicy::Outcome;
+
+TEST(RetryPolicyTest, ClassifiesCurlCodesAndStatuses) {
+  SCOPED_TRACE("Transport errors and HTTP statuses map to retry classes.");
+  RecordProperty("description",
+                 "DNS, connect, mid-transfer, TLS, 5xx, 429/503+Retry-After "
+                 "and permanent 4xx are told apart.");
+
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OK, 200), Outcome::Ok);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_COULDNT_RESOLVE_HOST, 0), Outcome::Dns);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OPERATION_TIMEDOUT, 0),
+            Outcome::Connect);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OPERATION_TIMEDOUT, 0, false, true),
+            Outcome::Transfer);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_COULDNT_CONNECT, 0), Outcome::Connect);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_RECV_ERROR, 0), Outcome::Transfer);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_PARTIAL_FILE, 0), Outcome::Transfer);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_HTTP2_STREAM, 0), Outcome::Transfer);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_PEER_FAILED_VERIFICATION, 0),
+            Outcome::Tls);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OK, 500), Outcome::Server);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OK, 503), Outcome::Server);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OK, 503, true), Outcome::RateLimited);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OK, 429), Outcome::RateLimited);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OK, 408), Outcome::Server);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_OK, 404), Outcome::Client);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_TOO_MANY_REDIRECTS, 0),
+            Outcome::Client);
+  EXPECT_EQ(RetryPolicy::Classify(CURLE_WRITE_ERROR, 0), Outcome::Other);
+}
+
+TEST(RetryPolicyTest, BackoffDoublesToCapWithinBudget) {
+  SCOPED_TRACE("Without jitter delays are base * 2^(n-1), capped.");
+  RecordProperty("description",
+                 "A class with 4 retries, base 1s and cap 5s yields 1, 2, 4, "
+                 "5 seconds, then gives up; permanent errors never retry.");
+
+  RetryPolicy::Options opts;
+  opts.jitter = 0;
+  opts.For(Outcome::Server) = {4, 1s, 5s};
+  RetryPolicy policy(opts, 1);
+
+  EXPECT_EQ(policy.Delay(Outcome::Server, 1), 1000ms);
+  EXPECT_EQ(policy.Delay(Outcome::Server, 2), 2000ms);
+  EXPECT_EQ(policy.Delay(Outcome::Server, 3), 4000ms);
+  EXPECT_EQ(policy.Delay(Outcome::Server, 4), 5000ms);
+  EXPECT_FALSE(policy.Delay(Outcome::Server, 5).has_value());
+  EXPECT_FALSE(policy.Delay(Outcome::Client, 1).has_value());
+  EXPECT_FALSE(policy.Delay(Outcome::Ok, 1).has_value());
+}
+
+TEST(RetryPolicyTest, JitterStaysWithinBounds) {
+  SCOPED_TRACE("Jittered delays spread over [d * (1 - jitter), d].");
+  RecordProperty("description",
+                 "With jitter 0.5 every delay for a 10s step lies between 5s "
+                 "and 10s, and not all of them are equal.");
+
+  RetryPolicy::Options opts;
+  opts.jitter = 0.5;
+  opts.For(Outcome::Connect) = {1, 10s, 10s};
+  RetryPolicy policy(opts, 42);
+
+  std::chrono::milliseconds lo = 10s, hi = 0ms;
+  for (int i = 0; i < 200; ++i) {
+    auto d = policy.Delay(Outcome::Connect, 1);
+    ASSERT_TRUE(d.has_value());
+    lo = std::min(lo, *d);
+    hi = std::max(hi, *d);
+  }
+  EXPECT_GE(lo, 5000ms);
+  EXPECT_LE(hi, 10000ms);
+  EXPECT_LT(lo, hi);
+}
+
+TEST(RetryPolicyTest, RetryAfterIsAFloor) {
+  SCOPED_TRACE("Retry-After raises the delay; an excessive one gives up.");
+  RecordProperty("description",
+                 "ParseRetryAfter reads delta-seconds and HTTP-dates; Delay "
+                 "never undercuts it and refuses values over the maximum.");
+
+  const auto now = RetryPolicy::Clock::from_time_t(784111777);  // 1994-11-06
+  EXPECT_EQ(RetryPolicy::ParseRetryAfter(" 120 ", now), 120s);
+  EXPECT_EQ(
+    RetryPolicy::ParseRetryAfter("Sun, 06 Nov 1994 08:50:37 GMT", now), 60s);
+  EXPECT_EQ(
+    RetryPolicy::ParseRetryAfter("Sun, 06 Nov 1994 08:00:00 GMT", now), 0s);
+  EXPECT_FALSE(RetryPolicy::ParseRetryAfter("soon", now).has_value());
+  EXPECT_FALSE(RetryPolicy::ParseRetryAfter("", now).has_value());
+  EXPECT_FALSE(
+    RetryPolicy::ParseRetryAfter("\xa0\xff" "120" "\xe9", now).has_value());
+
+  RetryPolicy::Options opts;
+  opts.jitter = 0;
+  opts.max_retry_after = 600s;
+  opts.For(Outcome::RateLimited) = {3, 1s, 10s};
+  RetryPolicy policy(opts, 1);
+  EXPECT_EQ(policy.Delay(Outcome::RateLimited, 1, 120s), 120000ms);
+  EXPECT_EQ(policy.Delay(Outcome::RateLimited, 3, 0s), 4000ms);
+  EXPECT_FALSE(policy.Delay(Outcome::RateLimited, 1, 601s).has_value());
+}
+
+TEST(RetryPolicyTest, DeadLetterAppendsJsonLines) {
+  SCOPED_TRACE("Exhausted URLs are appended to the dead-letter file.");
+  RecordProperty("description",
+                 "Each Record() call adds one JSON object with the URL, "
+                 "attempt count and outcome name.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "dead_letter_test";
+  fs::remove_all(dir);
+
+  DeadLetter dl(dir / "dead_letter.jsonl");
+  Frontier::Entry e{"https://example.com/gone", 0, 1, 7, 0, 0};
+  dl.Record(e, Outcome::Client, 1, "HTTP 404");
+  e.url = "https://example.com/down";
+  dl.Record(e, Outcome::Server, 4, "HTTP 502");
+
+  std::ifstream in(dl.GetPath());
+  std::string line;
+  std::vector<nlohmann::json> rows;
+  while (std::getline(in, line))
+    rows.push_back(nlohmann::json::parse(line));
+  ASSERT_EQ(rows.size(), 2u);
+  EXPECT_EQ(rows[0]["url"], "https://example.com/gone");
+  EXPECT_EQ(rows[0]["outcome"], "client");
+  EXPECT_EQ(rows[0]["parent"], 7);
+  EXPECT_EQ(rows[1]["attempts"], 4);
+  EXPECT_EQ(rows[1]["detail"], "HTTP 502");
+  fs::remove_all(dir);
+}
+
+TEST(RetryPolicyTest, DeadLetterReplacesInvalidUtf8) {
+  SCOPED_TRACE("A URL with raw Latin-1 bytes is recorded, not thrown on.");
+  RecordProperty("description",
+                 "Invalid UTF-8 in the URL is written as U+FFFD instead of "
+                 "making the JSON dump throw.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "dead_letter_utf8_test";
+  fs::remove_all(dir);
+
+  DeadLetter dl(dir / "dead_letter.jsonl");
+  const Frontier::Entry e{"https://example.com/caf\xe9", 0, 1, 0, 0, 0};
+  ASSERT_NO_THROW(dl.Record(e, Outcome::Client, 1, "HTTP 404"));
+
+  std::ifstream in(dl.GetPath());
+  std::string line;
+  ASSERT_TRUE(std::getline(in, line));
+  EXPECT_EQ(nlohmann::json::parse(line)["url"],
+            "https://example.com/caf\xef\xbf\xbd");
+  fs::remove_all(dir);
+}
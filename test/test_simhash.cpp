@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include "SimHash.hpp"
+
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+// `n` pseudo-random words from a small vocabulary
+std::string Words(unsigned seed, size_t n) {
+  static const char* const kVocab[] = {
+    "crawler", "frontier", "page",  "link",    "domain", "fetch",
+    "parse",   "store",    "cache", "result",  "host",   "queue",
+    "retry",   "circuit",  "trace", "metric",  "index",  "shingle",
+    "hash",    "cluster",  "lua",   "archive", "record", "segment"};
+  std::mt19937 rng(seed);
+  std::string out;
+  for (size_t i = 0; i < n; ++i) {
+    out += kVocab[rng() % (sizeof(kVocab) / sizeof(kVocab[0]))];
+    out += ' ';
+  }
+  return out;
+}
+}  // namespace
+
+TEST(SimHashTest, NearCopiesLandFewBitsApart) {
+  SCOPED_TRACE("Small edits move few bits; different text moves many.");
+  RecordProperty("description",
+                 "A page that differs by a session id in its links stays "
+                 "within 3 bits; case and markup spacing do not matter; "
+                 "unrelated text is far away; short text has no fingerprint.");
+
+  const std::string body = "<html><body>" + Words(1, 600) + "</body></html>";
+  std::string variant = body;
+  variant.insert(body.size() / 3, "<a href='/p?sid=8f3a2c'>next</a>");
+  std::string shouted = body;
+  for (auto& c : shouted)
+    c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+
+  const auto a = SimHash::Fingerprint(body);
+  const auto b = SimHash::Fingerprint(variant);
+  const auto c = SimHash::Fingerprint(shouted);
+  const auto d = SimHash::Fingerprint(Words(2, 600));
+  ASSERT_TRUE(a && b && c && d);
+  EXPECT_LE(SimHash::Distance(*a, *b), 3u);
+  EXPECT_EQ(*a, *c);
+  EXPECT_GT(SimHash::Distance(*a, *d), 10u);
+
+  EXPECT_FALSE(SimHash::Fingerprint("three short words").has_value());
+  EXPECT_TRUE(SimHash::Fingerprint("three short words", 3).has_value());
+}
+
+TEST(SimHashTest, SharedTemplateDoesNotMergePages) {
+  SCOPED_TRACE("Only visible text is fingerprinted, not the template.");
+  RecordProperty("description",
+                 "200 product pages share a heavy template (styles, scripts, "
+                 "class-laden markup, navigation) and differ in title, "
+                 "description and price; none is a near-duplicate of another, "
+                 "while re-serving a page with only its markup changed is.");
+
+  std::string head = "<!DOCTYPE html><html lang='en'><head><style>";
+  for (unsigned i = 0; i < 200; ++i)
+    head += ".product-card-" + std::to_string(i) +
+            " .price-tag { color: #333; margin: 0 auto; font-weight: bold } ";
+  head += "</style><script type='text/javascript'>";
+  for (unsigned i = 0; i < 100; ++i)
+    head += "window.dataLayer.push({event: 'view_item', slot: " +
+            std::to_string(i) + "}); ";
+  head += "</script></head><body class='catalog product-page'><nav "
+          "class='site-nav'><ul class='menu'>";
+  for (const char* item : {"Home", "Shop", "Deals", "Support", "Account"})
+    head += "<li class='menu-item'><a class='menu-link' href='/" +
+            std::string(item) + "'>" + item + "</a></li>";
+  head += "</ul></nav><main class='product-detail'><div class='row'>";
+  std::string foot = "</div></main><footer class='site-footer'><div "
+                     "class='footer-links'>";
+  for (unsigned i = 0; i < 50; ++i)
+    foot += "<div class='footer-col col-" + std::to_string(i) +
+            "'><span class='icon icon-arrow'></span></div>";
+  foot += "&copy; Example Store</div></footer></body></html>";
+
+  auto page = [&](unsigned i, const std::string& cls) {
+    return head + "<h1 class='" + cls + "'>" + Words(1000 + i, 6) +
+           "</h1><p class='" + cls + "-text'>" + Words(2000 + i, 60) +
+           "</p><span class='price'>&#36;" + std::to_string(10 + i) +
+           ".99</span>" + foot;
+  };
+
+  SimHashIndex index({});
+  for (unsigned i = 0; i < 200; ++i)
+    EXPECT_FALSE(index.Check("https://a/p/" + std::to_string(i),
+                             page(i, "product-title"))
+                   .has_value())
+      << "page " << i;
+  EXPECT_EQ(index.Size(), 200u);
+
+  const auto restyled = index.Check("https://a/p/7?v=2", page(7, "hdr-v2"));
+  ASSERT_TRUE(restyled.has_value());
+  EXPECT_EQ(restyled->url, "https://a/p/7");
+  EXPECT_EQ(restyled->distance, 0u);
+}
+
+TEST(SimHashTest, IndexMatchesWithinMaxDistance) {
+  SCOPED_TRACE("Band lookup finds every fingerprint within max_distance.");
+  RecordProperty("description",
+                 "With max_distance 3, fingerprints 3 bits apart match even "
+                 "when the bits fall in different bands, 4 bits apart do "
+                 "not, and duplicates are reported under the first page.");
+
+  SimHashIndex index({SimHash::kDefaultShingle, 3});
+  const std::uint64_t base = 0x0123456789abcdefull;
+  EXPECT_FALSE(index.Insert("https://a/1", base).has_value());
+
+  // one bit in each of three bands
+  const auto near = index.Insert("https://a/2", base ^ (1ull << 0) ^
+                                                  (1ull << 20) ^ (1ull << 40));
+  ASSERT_TRUE(near.has_value());
+  EXPECT_EQ(near->url, "https://a/1");
+  EXPECT_EQ(near->distance, 3u);
+
+  // one bit in each of the four bands: too far
+  EXPECT_FALSE(index
+                 .Insert("https://a/3", base ^ (1ull << 1) ^ (1ull << 21) ^
+                                          (1ull << 41) ^ (1ull << 61))
+                 .has_value());
+  EXPECT_TRUE(index.Insert("https://a/4", base).has_value());
+
+  EXPECT_EQ(index.Size(), 2u);
+  EXPECT_EQ(index.Duplicates(), 2u);
+  const auto clusters = index.Clusters();
+  ASSERT_EQ(clusters.size(), 1u);
+  EXPECT_EQ(clusters[0].url, "https://a/1");
+  EXPECT_EQ(clusters[0].fingerprint, base);
+  ASSERT_EQ(clusters[0].duplicates.size(), 2u);
+  EXPECT_EQ(clusters[0].duplicates[0].url, "https://a/2");
+  EXPECT_EQ(clusters[0].duplicates[1].distance, 0u);
+}
+
+TEST(SimHashTest, IndexIsThreadSafe) {
+  SCOPED_TRACE("Parse workers check pages concurrently.");
+  RecordProperty("description",
+                 "Four threads each check the same 50 pages; every page is "
+                 "indexed once and the other 150 checks are duplicates.");
+
+  SimHashIndex index({});
+  std::vector<std::string> pages;
+  for (unsigned i = 0; i < 50; ++i)
+    pages.push_back(Words(100 + i, 200));
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < pages.size(); ++i)
+        index.Check("https://a/" + std::to_string(t) + "/" + std::to_string(i),
+                    pages[i]);
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+  EXPECT_EQ(index.Size(), 50u);
+  EXPECT_EQ(index.Duplicates(), 150u);
+}
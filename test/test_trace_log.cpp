@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include "TraceLog.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+
+static std::map<std::string, std::int64_t> PhaseMap(const TraceRecord& r) {
+  std::map<std::string, std::int64_t> out;
+  for (const auto& [name, us] : r.Phases())
+    out[name] = us;
+  return out;
+}
+
+TEST(TraceLogTest, PhasesFromCurlMarks) {
+  SCOPED_TRACE("Cumulative curl marks become per-phase durations.");
+  RecordProperty("description",
+                 "A fresh HTTPS fetch splits into dns/connect/tls/request/"
+                 "server/transfer; Lua and store times ride along.");
+
+  TraceRecord r;
+  r.url = "https://a.example/";
+  r.namelookup_us = 100;
+  r.connect_us = 1100;
+  r.appconnect_us = 5100;
+  r.pretransfer_us = 5200;
+  r.starttransfer_us = 25200;
+  r.total_us = 30200;
+  r.lua_us = 800;
+  r.store_us = 300;
+
+  const auto p = PhaseMap(r);
+  EXPECT_EQ(p.at("dns"), 100);
+  EXPECT_EQ(p.at("connect"), 1000);
+  EXPECT_EQ(p.at("tls"), 4000);
+  EXPECT_EQ(p.at("request"), 100);
+  EXPECT_EQ(p.at("server"), 20000);
+  EXPECT_EQ(p.at("transfer"), 5000);
+  EXPECT_EQ(p.at("fetch"), 30200);
+  EXPECT_EQ(p.at("lua"), 800);
+  EXPECT_EQ(p.at("store"), 300);
+  EXPECT_EQ(p.count("redirect"), 0u);
+}
+
+TEST(TraceLogTest, ReusedAndFailedConnections) {
+  SCOPED_TRACE("Skipped phases are zero; a stuck phase gets the remainder.");
+  RecordProperty("description",
+                 "A reused connection has zero dns/connect/tls; a connect "
+                 "that timed out charges the rest of the fetch to connect.");
+
+  TraceRecord reused;
+  reused.url = "https://a.example/x";
+  reused.namelookup_us = reused.connect_us = reused.appconnect_us = 0;
+  reused.pretransfer_us = 50;
+  reused.starttransfer_us = 10050;
+  reused.total_us = 12050;
+  auto p = PhaseMap(reused);
+  EXPECT_EQ(p.at("dns"), 0);
+  EXPECT_EQ(p.at("connect"), 0);
+  EXPECT_EQ(p.at("tls"), 0);
+  EXPECT_EQ(p.at("server"), 10000);
+  EXPECT_EQ(p.at("transfer"), 2000);
+
+  TraceRecord failed;
+  failed.url = "http://b.example/";
+  failed.curl_code = 28;
+  failed.namelookup_us = 50;
+  failed.connect_us = failed.pretransfer_us = failed.starttransfer_us = 0;
+  failed.total_us = 10000000;
+  p = PhaseMap(failed);
+  EXPECT_EQ(p.at("dns"), 50);
+  EXPECT_EQ(p.at("connect"), 9999950);
+  EXPECT_EQ(p.count("tls"), 0u);
+  EXPECT_EQ(p.count("transfer"), 0u);
+
+  TraceRecord cached;
+  cached.cached = true;
+  cached.lua_us = 5;
+  p = PhaseMap(cached);
+  EXPECT_EQ(p.size(), 1u);
+  EXPECT_EQ(p.at("lua"), 5);
+}
+
+TEST(TraceLogTest, WritesJsonLinesThatRoundTrip) {
+  SCOPED_TRACE("Records written by TraceLog read back unchanged.");
+  RecordProperty("description",
+                 "Configure() opens the file for appending; every Write() is "
+                 "one JSON line; FromJson restores the record.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "trace_log_test";
+  fs::remove_all(dir);
+
+  TraceRecord r;
+  r.time_ms = 1700000000000;
+  r.host = "a.example";
+  r.url = "https://a.example/\"q\"";
+  r.status = 503;
+  r.attempt = 2;
+  r.total_us = 1234;
+  r.download_bytes = 99;
+
+  TraceLog::Configure(dir / "trace.jsonl");
+  ASSERT_TRUE(TraceLog::Instance().Enabled());
+  TraceLog::Instance().Write(r);
+  TraceLog::Instance().Write(r);
+  TraceLog::Configure("");  // closes the file
+  EXPECT_FALSE(TraceLog::Instance().Enabled());
+
+  std::ifstream in(dir / "trace.jsonl");
+  std::string line;
+  int lines = 0;
+  while (std::getline(in, line)) {
+    ++lines;
+    auto back = TraceRecord::FromJson(nlohmann::json::parse(line));
+    ASSERT_TRUE(back.has_value());
+    EXPECT_EQ(back->url, r.url);
+    EXPECT_EQ(back->status, 503);
+    EXPECT_EQ(back->attempt, 2u);
+    EXPECT_EQ(back->total_us, 1234);
+    EXPECT_EQ(back->download_bytes, 99);
+    EXPECT_EQ(back->lua_us, -1);
+  }
+  EXPECT_EQ(lines, 2);
+  fs::remove_all(dir);
+}
+
+TEST(TraceLogTest, ReplacesInvalidUtf8) {
+  SCOPED_TRACE("A record with raw Latin-1 bytes is written, not thrown on.");
+  RecordProperty("description",
+                 "Invalid UTF-8 in the host or URL is written as U+FFFD "
+                 "instead of making the JSON dump throw.");
+
+  namespace fs = std::filesystem;
+  const auto dir = fs::temp_directory_path() / "trace_log_utf8_test";
+  fs::remove_all(dir);
+
+  TraceRecord r;
+  r.host = "caf\xe9.example";
+  r.url = "https://caf\xe9.example/";
+
+  TraceLog::Configure(dir / "trace.jsonl");
+  ASSERT_NO_THROW(TraceLog::Instance().Write(r));
+  TraceLog::Configure("");
+
+  std::ifstream in(dir / "trace.jsonl");
+  std::string line;
+  ASSERT_TRUE(std::getline(in, line));
+  auto back = TraceRecord::FromJson(nlohmann::json::parse(line));
+  ASSERT_TRUE(back.has_value());
+  EXPECT_EQ(back->url, "https://caf\xef\xbf\xbd.example/");
+  fs::remove_all(dir);
+}
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include "URL.hpp"
+#include "URLManager.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+class URLManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir = std::filesystem::temp_directory_path() /
+          ("urlm_" + std::to_string(::getpid()) + "_" +
+           ::testing::UnitTest::GetInstance()->current_test_info()->name());
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+  }
+  void TearDown() override {
+    std::filesystem::remove_all(dir);
+  }
+
+  std::filesystem::path ListFor(const URL& domain) const {
+    return dir / (domain.GetSha256() + ".list");
+  }
+
+  static std::vector<std::string> Lines(const std::filesystem::path& p) {
+    std::ifstream in(p);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);)
+      lines.push_back(line);
+    return lines;
+  }
+
+  std::filesystem::path dir;
+};
+}  // namespace
+
+TEST_F(URLManagerTest, StoreDeduplicatesAndGroupCommits) {
+  SCOPED_TRACE("Stored URLs are buffered, de-duplicated and appended once.");
+  RecordProperty("description",
+                 "URLs already in the list file or stored earlier are "
+                 "dropped; nothing is appended until Flush(), which appends "
+                 "every buffered URL in one commit after the existing "
+                 "unterminated last line.");
+
+  const URL domain("https://example.com/");
+  {
+    std::ofstream out(ListFor(domain));
+    out << "https://example.com/seed";  // no trailing newline
+  }
+
+  URLManager urlm(dir);
+  urlm.Store(domain, {URL("https://example.com/seed"),
+                      URL("https://example.com/a")});
+  urlm.Store(domain,
+             {URL("https://example.com/a"), URL("https://example.com/b")});
+  // a page's links arrive as strings in its arena; newlines are dropped
+  std::pmr::monotonic_buffer_resource arena;
+  std::pmr::vector<std::pmr::string> links(&arena);
+  links.emplace_back("https://example.com/c\r\n");
+  links.emplace_back("https://example.com/b");
+  urlm.Store(domain, links);
+  EXPECT_EQ(Lines(ListFor(domain)).size(), 1u) << "appended before commit";
+
+  urlm.Flush();
+  const auto lines = Lines(ListFor(domain));
+  EXPECT_EQ(std::multiset<std::string>(lines.begin(), lines.end()),
+            (std::multiset<std::string>{
+              "https://example.com/seed", "https://example.com/a",
+              "https://example.com/b", "https://example.com/c"}));
+
+  const auto stats = urlm.GetStats();
+  EXPECT_EQ(stats.stored, 3u);
+  EXPECT_EQ(stats.duplicates, 3u);
+  EXPECT_EQ(stats.commits, 1u);
+}
+
+TEST_F(URLManagerTest, ConcurrentStoresWriteWholeUniqueLines) {
+  SCOPED_TRACE("Many threads storing overlapping URLs leave clean files.");
+  RecordProperty("description",
+                 "Threads storing overlapping sets for two domains produce "
+                 "list files with every URL exactly once and no torn lines, "
+                 "including commits triggered by the size threshold.");
+
+  const URL a("https://a.example/");
+  const URL b("https://b.example/");
+  constexpr int kThreads = 8;
+  constexpr int kUrls = 5000;  // enough bytes to cross kCommitBytes
+
+  {
+    URLManager urlm(dir);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        const URL domain = t % 2 ? a : b;  // URL caches lazily: one per thread
+        for (int i = 0; i < kUrls; i += 50) {
+          std::unordered_set<URL> batch;
+          for (int k = i; k < i + 50; ++k)
+            batch.insert(URL(domain.ToString() + "page/" + std::to_string(k) +
+                             "?padding=" + std::string(40, 'x')));
+          urlm.Store(domain, batch);
+        }
+      });
+    }
+    for (auto& th : threads)
+      th.join();
+    EXPECT_GT(urlm.GetStats().commits, 0u);
+  }  // the destructor commits the rest
+
+  for (const URL* domain : {&a, &b}) {
+    const auto lines = Lines(ListFor(*domain));
+    std::set<std::string> unique(lines.begin(), lines.end());
+    EXPECT_EQ(lines.size(), static_cast<size_t>(kUrls));
+    EXPECT_EQ(unique.size(), lines.size());
+    for (const auto& line : lines)
+      EXPECT_EQ(line.rfind(domain->ToString() + "page/", 0), 0u) << line;
+  }
+}
+
+TEST_F(URLManagerTest, FailedAppendKeepsBufferForNextCommit) {
+  SCOPED_TRACE("URLs whose append failed are written by the next commit.");
+  RecordProperty("description",
+                 "With the list file pointing at /dev/full the append fails; "
+                 "the buffered URLs stay buffered and, once the file is "
+                 "writable again, the next Flush() appends them after the "
+                 "unterminated last line, each exactly once.");
+
+  if (!std::filesystem::exists("/dev/full"))
+    GTEST_SKIP() << "no /dev/full";
+
+  const URL domain("https://example.com/");
+  const auto list = ListFor(domain);
+  {
+    std::ofstream out(list);
+    out << "https://example.com/seed";  // no trailing newline
+  }
+
+  URLManager urlm(dir);
+  urlm.Store(domain,
+             {URL("https://example.com/a"), URL("https://example.com/b")});
+
+  std::filesystem::remove(list);
+  std::filesystem::create_symlink("/dev/full", list);
+  urlm.Flush();  // ENOSPC
+  EXPECT_EQ(urlm.GetStats().commits, 0u);
+
+  std::filesystem::remove(list);
+  {
+    std::ofstream out(list);
+    out << "https://example.com/seed";
+  }
+  // already buffered: not stored twice
+  urlm.Store(domain, {URL("https://example.com/b")});
+  urlm.Flush();
+
+  const auto lines = Lines(list);
+  EXPECT_EQ(std::multiset<std::string>(lines.begin(), lines.end()),
+            (std::multiset<std::string>{"https://example.com/seed",
+                                        "https://example.com/a",
+                                        "https://example.com/b"}));
+  EXPECT_EQ(urlm.GetStats().commits, 1u);
+}
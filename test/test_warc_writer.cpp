@@ -0,0 +1,259 @@
+#include <gtest/gtest.h>
+#include "HttpResponse.hpp"
+#include "URL.hpp"
+#include "WarcWriter.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+fs::path FreshDir(const std::string& name) {
+  auto dir = fs::temp_directory_path() /
+             (name + "_" + std::to_string(::getpid()));
+  fs::remove_all(dir);
+  return dir;
+}
+
+std::vector<fs::path> Files(const fs::path& dir, const std::string& ext) {
+  std::vector<fs::path> out;
+  for (const auto& f : fs::directory_iterator(dir)) {
+    if (f.path().string().size() > ext.size() &&
+        f.path().string().compare(f.path().string().size() - ext.size(),
+                                  ext.size(), ext) == 0)
+      out.push_back(f.path());
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+std::string Slurp(const fs::path& p) {
+  std::ifstream in(p, std::ios::binary);
+  std::ostringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// Inflate every gzip member in `data`, concatenated
+std::string Gunzip(std::string_view data) {
+  std::string out;
+  z_stream zs{};
+  inflateInit2(&zs, 15 + 16);
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  zs.avail_in = static_cast<uInt>(data.size());
+  char buf[4096];
+  while (zs.avail_in > 0) {
+    zs.next_out = reinterpret_cast<Bytef*>(buf);
+    zs.avail_out = sizeof(buf);
+    const int rc = inflate(&zs, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - zs.avail_out);
+    if (rc == Z_STREAM_END)
+      inflateReset(&zs);
+    else if (rc != Z_OK)
+      break;
+  }
+  inflateEnd(&zs);
+  return out;
+}
+
+size_t Count(const std::string& hay, const std::string& needle) {
+  size_t n = 0;
+  for (auto p = hay.find(needle); p != std::string::npos;
+       p = hay.find(needle, p + 1))
+    ++n;
+  return n;
+}
+
+HttpResponse MakeResponse(const std::string& body) {
+  HttpResponse r;
+  for (const std::string line :
+       {"HTTP/1.1 301 Moved\r\n", "Location: /page\r\n", "\r\n",
+        "HTTP/1.1 200 OK\r\n", "Content-Type: text/html; charset=utf-8\r\n",
+        "Content-Encoding: gzip\r\n", "Transfer-Encoding: chunked\r\n",
+        "\r\n"}) {
+    r.AddHeaderLine(line);
+    r.AddRawHeaderLine(line.data(), line.size());
+  }
+  r.SetRawRequest("GET /page HTTP/1.1\r\nHost: example.com\r\n\r\n");
+  r.AppendBody(body.data(), body.size());
+  r.SetStatusCode(200);
+  r.SetRedirectCount(1);
+  r.SetEffectiveUrl("https://example.com/page");
+  return r;
+}
+}  // namespace
+
+TEST(WarcWriterTest, WritesRecordsAsGzipMembersWithCdx) {
+  SCOPED_TRACE("A capture is response, request and metadata records.");
+  RecordProperty("description",
+                 "Each record is its own gzip member; the CDX line points at "
+                 "the response member by offset and length, and the HTTP "
+                 "block describes the decoded body curl handed over.");
+
+  const auto dir = FreshDir("warc_writer_test");
+  const std::string body = "<html>hello</html>";
+  {
+    WarcWriter::Options opts;
+    opts.file.dir = dir;
+    WarcWriter w(opts);
+    for (int i = 0; i < 2; ++i)
+      ASSERT_TRUE(w.Write(URL("https://example.com/old"), MakeResponse(body),
+                          {std::chrono::system_clock::now(),
+                           std::chrono::milliseconds(42), 1, 0}));
+    w.Flush();
+    EXPECT_EQ(w.GetStats().captures, 2u);
+  }
+
+  const auto warcs = Files(dir, ".warc.gz");
+  const auto indexes = Files(dir, ".cdx");
+  ASSERT_EQ(warcs.size(), 1u);
+  ASSERT_EQ(indexes.size(), 1u);
+  EXPECT_EQ(indexes[0].stem(), warcs[0].stem().stem());
+
+  const std::string raw = Slurp(warcs[0]);
+  const std::string all = Gunzip(raw);
+  EXPECT_EQ(Count(all, "WARC/1.1\r\n"), 6u);
+  EXPECT_EQ(Count(all, "WARC-Type: request\r\n"), 2u);
+  EXPECT_EQ(Count(all, "WARC-Type: metadata\r\n"), 2u);
+  EXPECT_NE(all.find("requestedURI: https://example.com/old\r\n"),
+            std::string::npos);
+  EXPECT_NE(all.find("contentEncoding: gzip\r\n"), std::string::npos);
+
+  std::istringstream cdx(Slurp(indexes[0]));
+  std::string line;
+  std::getline(cdx, line);
+  EXPECT_EQ(line, " CDX N b a m s k r M S V g");
+  int lines = 0;
+  while (std::getline(cdx, line)) {
+    ++lines;
+    std::istringstream fields(line);
+    std::string key, ts, url, mime, status, digest, redirect, meta, file;
+    std::uint64_t length = 0, offset = 0;
+    fields >> key >> ts >> url >> mime >> status >> digest >> redirect >>
+      meta >> length >> offset >> file;
+    EXPECT_EQ(key, "com,example)/page");
+    EXPECT_EQ(ts.size(), 14u);
+    EXPECT_EQ(url, "https://example.com/page");
+    EXPECT_EQ(mime, "text/html");
+    EXPECT_EQ(status, "200");
+    EXPECT_EQ("sha1:" + digest, WarcWriter::Sha1Digest(body));
+    EXPECT_EQ(file, warcs[0].filename().string());
+
+    ASSERT_LE(offset + length, raw.size());
+    const std::string record = Gunzip(raw.substr(offset, length));
+    EXPECT_EQ(record.rfind("WARC/1.1\r\nWARC-Type: response\r\n", 0), 0u);
+    EXPECT_NE(record.find("\r\n\r\nHTTP/1.1 200 OK\r\n"), std::string::npos);
+    EXPECT_EQ(record.find("301"), std::string::npos);
+    EXPECT_EQ(record.find("Content-Encoding"), std::string::npos);
+    EXPECT_EQ(record.find("chunked"), std::string::npos);
+    EXPECT_NE(record.find("Content-Length: " + std::to_string(body.size()) +
+                          "\r\n\r\n" + body + "\r\n\r\n"),
+              std::string::npos);
+  }
+  EXPECT_EQ(lines, 2);
+  fs::remove_all(dir);
+}
+
+TEST(WarcWriterTest, RotatesBySizeKeepingCapturesWhole) {
+  SCOPED_TRACE("A file never splits one fetch's records.");
+  RecordProperty("description",
+                 "With a limit smaller than one capture, each fetch gets a "
+                 "WARC file and an index of its own.");
+
+  const auto dir = FreshDir("warc_writer_rotate_test");
+  {
+    WarcWriter::Options opts;
+    opts.file.dir = dir;
+    opts.file.max_bytes = 1;
+    WarcWriter w(opts);
+    for (int i = 0; i < 3; ++i)
+      ASSERT_TRUE(w.Write(URL("https://example.com/page"),
+                          MakeResponse(std::string(1000, 'a' + i)),
+                          {std::chrono::system_clock::now(), {}, 0, 0}));
+  }
+  const auto warcs = Files(dir, ".warc.gz");
+  ASSERT_EQ(warcs.size(), 3u);
+  EXPECT_EQ(Files(dir, ".cdx").size(), 3u);
+  EXPECT_TRUE(Files(dir, ".part").empty());
+  for (const auto& f : warcs)
+    EXPECT_EQ(Count(Gunzip(Slurp(f)), "WARC/1.1\r\n"), 3u) << f;
+  fs::remove_all(dir);
+}
+
+TEST(WarcWriterTest, ConcurrentWritersShareOneQueue) {
+  SCOPED_TRACE("Fetch threads only enqueue; one thread appends and indexes.");
+  RecordProperty("description",
+                 "Four threads write 50 captures each through a queue of 2; "
+                 "every capture is archived whole and indexed once, and the "
+                 "CDX lines point at their response members.");
+
+  const auto dir = FreshDir("warc_writer_concurrent_test");
+  {
+    WarcWriter::Options opts;
+    opts.file.dir = dir;
+    opts.max_pending = 2;
+    WarcWriter w(opts);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < 50; ++i)
+          EXPECT_TRUE(w.Write(
+            URL("https://example.com/" + std::to_string(t)),
+            MakeResponse("page " + std::to_string(t * 100 + i)),
+            {std::chrono::system_clock::now(), {}, 0, 0}));
+      });
+    }
+    for (auto& t : threads)
+      t.join();
+    w.Flush();
+    EXPECT_EQ(w.GetStats().captures, 200u);
+  }
+
+  const auto warcs = Files(dir, ".warc.gz");
+  ASSERT_EQ(warcs.size(), 1u);
+  const std::string raw = Slurp(warcs[0]);
+  EXPECT_EQ(Count(Gunzip(raw), "WARC-Type: response\r\n"), 200u);
+
+  std::istringstream cdx(Slurp(Files(dir, ".cdx").at(0)));
+  std::string line;
+  std::getline(cdx, line);
+  int lines = 0;
+  while (std::getline(cdx, line)) {
+    ++lines;
+    std::istringstream fields(line);
+    std::string skip;
+    std::uint64_t length = 0, offset = 0;
+    for (int f = 0; f < 8; ++f)
+      fields >> skip;
+    fields >> length >> offset;
+    ASSERT_LE(offset + length, raw.size());
+    EXPECT_EQ(Gunzip(raw.substr(offset, length))
+                .rfind("WARC/1.1\r\nWARC-Type: response\r\n", 0),
+              0u);
+  }
+  EXPECT_EQ(lines, 200);
+  fs::remove_all(dir);
+}
+
+TEST(WarcWriterTest, SurtAndDigest) {
+  SCOPED_TRACE("Index keys and digests match what archive tools expect.");
+  RecordProperty("description",
+                 "SURT keys reverse the host, drop www., default ports and "
+                 "fragments; digests are base32 SHA-1.");
+
+  EXPECT_EQ(WarcWriter::Surt("https://www.Example.com:443/A/b?x=1#frag"),
+            "com,example)/a/b?x=1");
+  EXPECT_EQ(WarcWriter::Surt("http://sub.example.org:8080"),
+            "org,example,sub:8080)/");
+  EXPECT_EQ(WarcWriter::Sha1Digest(""),
+            "sha1:3I42H3S6NNFQ2MSVX7XZKYAYSCX5QBYJ");
+  EXPECT_EQ(Gunzip(WarcWriter::Gzip("hello")), "hello");
+}
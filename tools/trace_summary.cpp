@@ -0,0 +1,124 @@
+// Summarise crawler trace files (see "trace_file" in conf.json): p50/p95/p99
+// per phase, over all hosts and then per host, busiest hosts first.
+//
+// usage: trace_summary [--hosts N=10] trace.jsonl [more.jsonl ...]
+
+#include "TraceLog.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+// phase name -> samples (us), kept in crawl order of first appearance
+struct PhaseTable {
+  std::vector<std::string> order;
+  std::unordered_map<std::string, std::vector<std::int64_t>> samples;
+  std::int64_t fetch_us{0};  // for ranking hosts
+  size_t pages{0};
+  size_t failed{0};
+
+  void Add(const TraceRecord& r) {
+    ++pages;
+    if (r.HasFetch() && r.curl_code != 0)
+      ++failed;
+    for (const auto& [name, us] : r.Phases()) {
+      auto [it, fresh] = samples.try_emplace(name);
+      if (fresh)
+        order.emplace_back(name);
+      it->second.push_back(us);
+      if (std::strcmp(name, "fetch") == 0)
+        fetch_us += us;
+    }
+  }
+};
+
+// nearest-rank percentile
+double Percentile(const std::vector<std::int64_t>& sorted, double p) {
+  const double n = static_cast<double>(sorted.size());
+  const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * n));
+  return static_cast<double>(sorted[std::max<size_t>(rank, 1) - 1]) / 1000.0;
+}
+
+void Print(const std::string& host, PhaseTable& t) {
+  std::printf("%s: %zu page(s), %zu failed fetch(es)\n", host.c_str(), t.pages,
+              t.failed);
+  std::printf("  %-10s %8s %10s %10s %10s\n", "phase", "n", "p50 ms",
+              "p95 ms", "p99 ms");
+  for (const auto& name : t.order) {
+    auto& v = t.samples[name];
+    std::sort(v.begin(), v.end());
+    std::printf("  %-10s %8zu %10.2f %10.2f %10.2f\n", name.c_str(), v.size(),
+                Percentile(v, 50), Percentile(v, 95), Percentile(v, 99));
+  }
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t max_hosts = 10;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--hosts") == 0 && i + 1 < argc)
+      max_hosts = std::strtoull(argv[++i], nullptr, 10);
+    else
+      files.emplace_back(argv[i]);
+  }
+  if (files.empty()) {
+    std::cerr << "usage: trace_summary [--hosts N] trace.jsonl ...\n";
+    return 2;
+  }
+
+  PhaseTable all;
+  std::map<std::string, PhaseTable> by_host;
+  size_t bad = 0;
+  for (const auto& file : files) {
+    std::ifstream in(file);
+    if (!in) {
+      std::cerr << "cannot open " << file << "\n";
+      return 1;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      if (line.empty())
+        continue;
+      auto j = nlohmann::json::parse(line, nullptr, false);
+      auto rec = TraceRecord::FromJson(j);
+      if (!rec.has_value()) {
+        ++bad;
+        continue;
+      }
+      all.Add(*rec);
+      by_host[rec->host].Add(*rec);
+    }
+  }
+  if (bad)
+    std::cerr << "skipped " << bad << " unreadable line(s)\n";
+  if (all.pages == 0) {
+    std::cerr << "no trace records\n";
+    return 1;
+  }
+
+  Print("all hosts", all);
+
+  std::vector<std::pair<std::string, PhaseTable*>> hosts;
+  for (auto& [host, table] : by_host)
+    hosts.emplace_back(host, &table);
+  std::sort(hosts.begin(), hosts.end(), [](const auto& a, const auto& b) {
+    return a.second->fetch_us > b.second->fetch_us;
+  });
+  if (hosts.size() > max_hosts)
+    hosts.resize(max_hosts);
+  for (auto& [host, table] : hosts) {
+    std::printf("\n");
+    Print(host, *table);
+  }
+  return 0;
+}